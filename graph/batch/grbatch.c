@@ -16,13 +16,479 @@
  *
  ******************************************************************/
 
+#ifndef  _GNU_SOURCE
+#define  _GNU_SOURCE /* we want to use extensions to `time.h' if available */
+#endif
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined( UNIX ) || defined( __unix__ ) || defined( __APPLE__ )
+#include <unistd.h>
+#endif
 
 /* FT graphics subsystem */
 #include "grobjs.h"
 #include "grdevice.h"
 #include "grbatch.h"
 
+/* shared frame timer of the demo programs */
+#include "frametime.h"
+
+
+  /*
+   * The batch device normally reads keys from the standard input.  The
+   * following environment variables allow unattended runs, e.g. to
+   * measure rendering throughput on machines without a display.
+   *
+   *   GRBATCH_SCRIPT  Name of a file with one event per line:
+   *
+   *                     <milliseconds> <keys>
+   *
+   *                   Before delivering the keys, the device sleeps for
+   *                   the difference to the previous time stamp (which
+   *                   is not included in the frame times).  <keys> is
+   *                   either a key name (`Esc', `Tab', `Return',
+   *                   `BackSpace', `Space', `Del', `Ins', `Home', `End',
+   *                   `PageUp', `PageDown', `Left', `Right', `Up', `Down',
+   *                   `F1' ... `F12') or a string of characters, each
+   *                   delivered as a separate key.
+   *                   Empty lines and lines starting with `#' are
+   *                   ignored.  `Esc' is sent at the end of the script.
+   *
+   *   GRBATCH_DUMP    Prefix of file names to which each frame is
+   *                   written, followed by the frame number.
+   *
+   *   GRBATCH_FORMAT  Either `pnm' (the default, binary PGM or PPM) or
+   *                   `png' (uncompressed).
+   *
+   * With a script, the time between the delivery of an event and the
+   * next request, which is spent rendering the frame, is printed for
+   * every frame, followed by a summary when the surface is closed.
+   */
+
+  typedef struct  grBatchSurface_
+  {
+    grSurface       root;
+
+    FILE*           script;
+    char            keys[64];
+    char*           cursor;
+    double          stamp;     /* time stamp of the current keys, ms */
+    double          elapsed;   /* time stamp of the previous keys    */
+
+    const char*     dump;
+    int             png;
+
+    int             frame;
+    double          start;     /* timer value when the keys were sent */
+    double          total;
+    double          min;
+    double          max;
+
+  } grBatchSurface;
+
+
+  typedef struct  grBatchKeyName_
+  {
+    const char*  name;
+    grKey        key;
+
+  } grBatchKeyName;
+
+
+  static const grBatchKeyName  key_names[] =
+  {
+    { "Esc",       grKeyEsc       },
+    { "Tab",       grKeyTab       },
+    { "Return",    grKeyReturn    },
+    { "BackSpace", grKeyBackSpace },
+    { "Space",     grKeySpace     },
+    { "Del",       grKeyDel       },
+    { "Ins",       grKeyIns       },
+    { "Home",      grKeyHome      },
+    { "End",       grKeyEnd       },
+    { "PageUp",    grKeyPageUp    },
+    { "PageDown",  grKeyPageDown  },
+    { "Left",      grKeyLeft      },
+    { "Right",     grKeyRight     },
+    { "Up",        grKeyUp        },
+    { "Down",      grKeyDown      },
+    { "F1",        grKeyF1        },
+    { "F2",        grKeyF2        },
+    { "F3",        grKeyF3        },
+    { "F4",        grKeyF4        },
+    { "F5",        grKeyF5        },
+    { "F6",        grKeyF6        },
+    { "F7",        grKeyF7        },
+    { "F8",        grKeyF8        },
+    { "F9",        grKeyF9        },
+    { "F10",       grKeyF10       },
+    { "F11",       grKeyF11       },
+    { "F12",       grKeyF12       },
+    { NULL,        grKeyNone      }
+  };
+
+
+  static void
+  gr_batch_sleep( double  ms )
+  {
+    if ( ms <= 0 )
+      return;
+
+#if defined _WIN32
+    Sleep( (DWORD)ms );
+#elif defined _POSIX_TIMERS && _POSIX_TIMERS > 0
+    {
+      struct timespec  tv;
+
+
+      tv.tv_sec  = (time_t)( ms / 1E3 );
+      tv.tv_nsec = (long)( ( ms - 1E3 * (double)tv.tv_sec ) * 1E6 );
+      nanosleep( &tv, NULL );
+    }
+#endif
+  }
+
+
+  /* read the next line of the script; returns 0 at its end */
+  static int
+  gr_batch_script_next( grBatchSurface*  surface )
+  {
+    char    line[128];
+    double  stamp;
+    int     n;
+
+
+    while ( fgets( line, sizeof ( line ), surface->script ) )
+    {
+      if ( line[0] == '#' )
+        continue;
+
+      n = 0;
+      if ( sscanf( line, "%lf %63s%n",
+                   &stamp, surface->keys, &n ) < 2 || !n )
+        continue;
+
+      surface->elapsed = surface->stamp;
+      surface->stamp   = stamp;
+      surface->cursor  = surface->keys;
+
+      return 1;
+    }
+
+    return 0;
+  }
+
+
+  static grKey
+  gr_batch_script_key( grBatchSurface*  surface )
+  {
+    const grBatchKeyName*  names;
+
+
+    if ( !surface->cursor || !*surface->cursor )
+    {
+      if ( !gr_batch_script_next( surface ) )
+        return grKeyEsc;
+
+      /* the script contains time stamps, not delays */
+      gr_batch_sleep( surface->stamp - surface->elapsed );
+
+      for ( names = key_names; names->name; names++ )
+        if ( strcmp( surface->keys, names->name ) == 0 )
+        {
+          surface->cursor = NULL;
+          return names->key;
+        }
+    }
+
+    return grKEY( *surface->cursor++ );
+  }
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* Frame dumps.                                                          */
+  /*                                                                       */
+
+  /* expand a row of the bitmap to 8-bit gray or RGB; returns the number */
+  /* of channels, or 0 for unsupported modes                             */
+  static int
+  gr_batch_dump_row( grBitmap*       bitmap,
+                     unsigned char*  read,
+                     unsigned char*  write )
+  {
+    int  x;
+
+
+    switch ( bitmap->mode )
+    {
+    case gr_pixel_mode_gray:
+      for ( x = 0; x < bitmap->width; x++ )
+        write[x] = bitmap->grays == 256
+                     ? read[x]
+                     : (unsigned char)( read[x] * 255 / ( bitmap->grays - 1 ) );
+      return 1;
+
+    case gr_pixel_mode_rgb24:
+      memcpy( write, read, (size_t)bitmap->width * 3 );
+      return 3;
+
+    case gr_pixel_mode_rgb32:
+      for ( x = 0; x < bitmap->width; x++, write += 3 )
+      {
+        uint32_t  p = ( (uint32_t*)read )[x];
+
+
+        write[0] = (unsigned char)( p >> 16 );
+        write[1] = (unsigned char)( p >> 8  );
+        write[2] = (unsigned char)( p       );
+      }
+      return 3;
+
+    case gr_pixel_mode_rgb565:
+      for ( x = 0; x < bitmap->width; x++, write += 3 )
+      {
+        unsigned int  p = ( (unsigned short*)read )[x];
+        unsigned int  r = ( p >> 11 ) & 0x1F;
+        unsigned int  g = ( p >>  5 ) & 0x3F;
+        unsigned int  b =   p         & 0x1F;
+
+
+        write[0] = (unsigned char)( ( r << 3 ) | ( r >> 2 ) );
+        write[1] = (unsigned char)( ( g << 2 ) | ( g >> 4 ) );
+        write[2] = (unsigned char)( ( b << 3 ) | ( b >> 2 ) );
+      }
+      return 3;
+
+    case gr_pixel_mode_rgb555:
+      for ( x = 0; x < bitmap->width; x++, write += 3 )
+      {
+        unsigned int  p = ( (unsigned short*)read )[x];
+        unsigned int  r = ( p >> 10 ) & 0x1F;
+        unsigned int  g = ( p >>  5 ) & 0x1F;
+        unsigned int  b =   p         & 0x1F;
+
+
+        write[0] = (unsigned char)( ( r << 3 ) | ( r >> 2 ) );
+        write[1] = (unsigned char)( ( g << 3 ) | ( g >> 2 ) );
+        write[2] = (unsigned char)( ( b << 3 ) | ( b >> 2 ) );
+      }
+      return 3;
+
+    default:
+      return 0;
+    }
+  }
+
+
+  static unsigned long
+  gr_batch_crc32( unsigned long         crc,
+                  const unsigned char*  data,
+                  size_t                len )
+  {
+    static unsigned long  table[256];
+    unsigned long         c;
+    int                   n, k;
+
+
+    if ( !table[1] )
+      for ( n = 0; n < 256; n++ )
+      {
+        c = (unsigned long)n;
+        for ( k = 0; k < 8; k++ )
+          c = c & 1 ? 0xEDB88320UL ^ ( c >> 1 ) : c >> 1;
+        table[n] = c;
+      }
+
+    crc ^= 0xFFFFFFFFUL;
+    while ( len-- )
+      crc = table[( crc ^ *data++ ) & 0xFF] ^ ( crc >> 8 );
+
+    return crc ^ 0xFFFFFFFFUL;
+  }
+
+
+  static void
+  gr_batch_put32( unsigned char*  p,
+                  unsigned long   v )
+  {
+    p[0] = (unsigned char)( v >> 24 );
+    p[1] = (unsigned char)( v >> 16 );
+    p[2] = (unsigned char)( v >>  8 );
+    p[3] = (unsigned char)( v       );
+  }
+
+
+  static void
+  gr_batch_png_chunk( FILE*                 file,
+                      const char*           type,
+                      const unsigned char*  data,
+                      size_t                len )
+  {
+    unsigned char  buf[4];
+    unsigned long  crc;
+
+
+    gr_batch_put32( buf, (unsigned long)len );
+    fwrite( buf, 1, 4, file );
+    fwrite( type, 1, 4, file );
+    fwrite( data, 1, len, file );
+
+    crc = gr_batch_crc32( 0, (const unsigned char*)type, 4 );
+    crc = gr_batch_crc32( crc, data, len );
+    gr_batch_put32( buf, crc );
+    fwrite( buf, 1, 4, file );
+  }
+
+
+  /* write PNG with stored deflate blocks, so that zlib is not needed */
+  static void
+  gr_batch_write_png( FILE*           file,
+                      unsigned char*  image,
+                      int             width,
+                      int             height,
+                      int             channels )
+  {
+    static const unsigned char  signature[8] =
+                                  { 0x89, 'P', 'N', 'G', '\r', '\n',
+                                    0x1A, '\n' };
+    unsigned char   header[13];
+    unsigned char*  data;
+    unsigned char*  p;
+    size_t          line = (size_t)width * (size_t)channels + 1;
+    size_t          size = line * (size_t)height;
+    size_t          blocks = size / 65535 + 1;
+    unsigned long   a = 1, b = 0;
+    size_t          i, len;
+
+
+    data = (unsigned char*)malloc( 2 + size + 5 * blocks + 4 );
+    if ( !data )
+      return;
+
+    gr_batch_put32( header,     (unsigned long)width );
+    gr_batch_put32( header + 4, (unsigned long)height );
+    header[8]  = 8;                       /* bit depth  */
+    header[9]  = channels == 1 ? 0 : 2;   /* color type */
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+
+    /* zlib stream: header, stored blocks, Adler-32 */
+    p    = data;
+    *p++ = 0x78;
+    *p++ = 0x01;
+
+    for ( i = 0; i < size; i += len )
+    {
+      len  = size - i < 65535 ? size - i : 65535;
+      *p++ = (unsigned char)( i + len == size );  /* BFINAL */
+      *p++ = (unsigned char)( len      );
+      *p++ = (unsigned char)( len >> 8 );
+      *p++ = (unsigned char)( ~len      );
+      *p++ = (unsigned char)( ~len >> 8 );
+      memcpy( p, image + i, len );
+      p += len;
+    }
+
+    for ( i = 0; i < size; i++ )
+    {
+      a = ( a + image[i] ) % 65521;
+      b = ( b + a ) % 65521;
+    }
+    gr_batch_put32( p, ( b << 16 ) | a );
+    p += 4;
+
+    fwrite( signature, 1, 8, file );
+    gr_batch_png_chunk( file, "IHDR", header, 13 );
+    gr_batch_png_chunk( file, "IDAT", data, (size_t)( p - data ) );
+    gr_batch_png_chunk( file, "IEND", NULL, 0 );
+
+    free( data );
+  }
+
+
+  static void
+  gr_batch_dump_frame( grBatchSurface*  surface )
+  {
+    grBitmap*       bitmap = &surface->root.bitmap;
+    size_t          line   = (size_t)bitmap->width * 3 + 1;
+    unsigned char*  image;
+    unsigned char*  read;
+    unsigned char*  write;
+    char            name[1024];
+    FILE*           file;
+    int             channels = 0;
+    int             y;
+
+
+    image = (unsigned char*)malloc( line * (size_t)bitmap->rows );
+    if ( !image )
+      return;
+
+    /* rows are prefixed with the PNG filter type (none) */
+    read  = bitmap->buffer;
+    if ( bitmap->pitch < 0 )
+      read -= ( bitmap->rows - 1 ) * bitmap->pitch;
+
+    write = image;
+    for ( y = 0; y < bitmap->rows; y++, read += bitmap->pitch )
+    {
+      *write++ = 0;
+      channels = gr_batch_dump_row( bitmap, read, write );
+      if ( !channels )
+        break;
+      write += bitmap->width * channels;
+    }
+
+    if ( !channels )
+    {
+      fprintf( stderr, "grbatch: cannot dump this pixel mode\n" );
+      surface->dump = NULL;
+      goto Exit;
+    }
+
+    sprintf( name, "%.1000s%04d.%s", surface->dump, surface->frame,
+             surface->png ? "png" : channels == 1 ? "pgm" : "ppm" );
+
+    file = fopen( name, "wb" );
+    if ( !file )
+    {
+      fprintf( stderr, "grbatch: cannot write `%s'\n", name );
+      goto Exit;
+    }
+
+    if ( surface->png )
+      gr_batch_write_png( file, image, bitmap->width, bitmap->rows,
+                          channels );
+    else
+    {
+      line = (size_t)bitmap->width * (size_t)channels;
+
+      fprintf( file, "P%c\n%d %d\n255\n", channels == 1 ? '5' : '6',
+               bitmap->width, bitmap->rows );
+      for ( y = 0, write = image; y < bitmap->rows; y++, write += line + 1 )
+        fwrite( write + 1, 1, line, file );
+    }
+
+    fclose( file );
+
+  Exit:
+    free( image );
+  }
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* Device interface.                                                     */
+  /*                                                                       */
 
   static int
   gr_batch_device_init( void )
@@ -48,31 +514,83 @@
 
 
   static void
-  gr_batch_surface_done( grSurface*  surface )
+  gr_batch_surface_done( grSurface*  baseSurface )
   {
-    grDoneBitmap( &(surface->bitmap) );
+    grBatchSurface*  surface = (grBatchSurface*)baseSurface;
+
+
+    if ( surface->script )
+    {
+      int  frames = surface->frame - 1;  /* the last one is not timed */
+
+
+      if ( frames > 0 )
+        printf( "%d frames, %.3f ms, %.3f ms/frame"
+                " (min %.3f ms, max %.3f ms)\n",
+                frames, surface->total, surface->total / frames,
+                surface->min, surface->max );
+
+      fclose( surface->script );
+      surface->script = NULL;
+    }
+
+    grDoneBitmap( &surface->root.bitmap );
   }
 
 
   static int
-  gr_batch_surface_listen_event( grSurface*  surface,
+  gr_batch_surface_listen_event( grSurface*  baseSurface,
                                  int         event_mode,
                                  grEvent*    event )
   {
-    (void)surface;    /* unused */
+    grBatchSurface*  surface = (grBatchSurface*)baseSurface;
+
+
     (void)event_mode;
 
+    /* the frame is complete whenever the next event is requested */
+    if ( surface->script && surface->frame > 0 )
+    {
+      double  t = frametime_now() - surface->start;
+
+
+      surface->total += t;
+      if ( surface->frame == 1 || t < surface->min )
+        surface->min = t;
+      if ( t > surface->max )
+        surface->max = t;
+
+      printf( "frame %5d  %9.3f ms\n", surface->frame, t );
+    }
+
+    if ( surface->dump )
+      gr_batch_dump_frame( surface );
+
+    surface->frame++;
+
     event->type = gr_event_key;
-    event->key  = grKEY( getchar() );
+
+    if ( surface->script )
+    {
+      event->key     = gr_batch_script_key( surface );
+      surface->start = frametime_now();
+    }
+    else
+      event->key = grKEY( getchar() );
 
     return 1;
   }
 
 
   static int
-  gr_batch_surface_init( grSurface*  surface,
+  gr_batch_surface_init( grSurface*  baseSurface,
                          grBitmap*   bitmap )
   {
+    grBatchSurface*  surface = (grBatchSurface*)baseSurface;
+    const char*      script  = getenv( "GRBATCH_SCRIPT" );
+    const char*      format  = getenv( "GRBATCH_FORMAT" );
+
+
     /* Set default mode */
     if ( bitmap->mode == gr_pixel_mode_none )
       bitmap->mode = gr_pixel_mode_rgb24;
@@ -81,14 +599,28 @@
                       bitmap->width, bitmap->rows, bitmap ) )
       return 0;
 
-    surface->bitmap     = *bitmap;
-    surface->refresh    = 0;
-    surface->owner      = 0;
+    if ( script && *script )
+    {
+      surface->script = fopen( script, "r" );
+      if ( !surface->script )
+      {
+        fprintf( stderr, "grbatch: cannot open script `%s'\n", script );
+        grDoneBitmap( bitmap );
+        return 0;
+      }
+    }
+
+    surface->dump = getenv( "GRBATCH_DUMP" );
+    surface->png  = format && strcmp( format, "png" ) == 0;
+
+    surface->root.bitmap     = *bitmap;
+    surface->root.refresh    = 0;
+    surface->root.owner      = 0;
 
-    surface->refresh_rect = (grRefreshRectFunc)NULL;  /* nothing to refresh */
-    surface->set_title    = gr_batch_surface_set_title;
-    surface->listen_event = gr_batch_surface_listen_event;
-    surface->done         = gr_batch_surface_done;
+    surface->root.refresh_rect = (grRefreshRectFunc)NULL;  /* nothing to refresh */
+    surface->root.set_title    = gr_batch_surface_set_title;
+    surface->root.listen_event = gr_batch_surface_listen_event;
+    surface->root.done         = gr_batch_surface_done;
 
     return 1;
   }
@@ -96,7 +628,7 @@
 
   grDevice  gr_batch_device =
   {
-    sizeof( grSurface ),
+    sizeof( grBatchSurface ),
     "batch",
 
     gr_batch_device_init,
@@ -18,16 +18,21 @@ DEVICES += BATCH
 
 # batch driver compilation rule
 #
+# (the frame timer `frametime_now' is shared with the demo programs and
+# linked from `$(SRC_DIR)/frametime.c')
+#
 $(OBJ_DIR_2)/grbatch.$O : $(GR_BATCH)/grbatch.c $(GR_BATCH)/grbatch.h \
-                          $(GRAPH_H)
+                          $(SRC_DIR)/frametime.h $(GRAPH_H)
 ifneq ($(LIBTOOL),)
 	$(LIBTOOL) --mode=compile $(CC) -static $(CFLAGS) \
                 $(GRAPH_INCLUDES:%=$I%) \
                 $I$(subst /,$(COMPILER_SEP),$(GR_BATCH)) \
+                $I$(subst /,$(COMPILER_SEP),$(SRC_DIR)) \
                 $T$(subst /,$(COMPILER_SEP),$@ $<)
 else
 	$(CC) $(CFLAGS) $(GRAPH_INCLUDES:%=$I%) \
                 $I$(subst /,$(COMPILER_SEP),$(GR_BATCH)) \
+                $I$(subst /,$(COMPILER_SEP),$(SRC_DIR)) \
                 $T$(subst /,$(COMPILER_SEP),$@ $<)
 endif
 
@@ -265,62 +265,42 @@ gblender_glyph_upgray( grBitmap*  glyph )
 }
 
 
+/* select the blitting function and prepare the blender */
 static int
-gblender_blit_init( GBlenderBlit           blit,
-                    int                    dst_x,
-                    int                    dst_y,
-                    grSurface*             surface,
-                    grBitmap*              glyph )
+gblender_blit_select( GBlenderBlit  blit,
+                      grSurface*    surface,
+                      grPixelMode   mode )
 {
   grBitmap*  target = &surface->bitmap;
   GBlender   blender = surface->gblender;
 
   GBlenderSourceFormat  src_format;
-  int                   src_x = 0;
-  int                   src_y = 0;
-  int                   delta;
-  const unsigned char*  src_buffer = glyph->buffer;
-  int                   src_pitch  = glyph->pitch;
-  int                   src_width  = glyph->width;
-  int                   src_height = glyph->rows;
-  unsigned char*        dst_buffer = target->buffer;
-  const int             dst_pitch  = target->pitch;
-  const int             dst_width  = target->width;
-  const int             dst_height = target->rows;
 
 
-  switch ( glyph->mode )
+  switch ( mode )
   {
   case gr_pixel_mode_gray:
     src_format = GBLENDER_SOURCE_GRAY8;
-    if ( glyph->grays != 256 )
-      gblender_glyph_upgray( glyph );
     if ( blender->channels )
       gblender_clear( blender );
     break;
   case gr_pixel_mode_lcd:
     src_format = GBLENDER_SOURCE_HRGB;
-    src_width /= 3;
     if ( !blender->channels )
       gblender_clear_channels( blender );
     break;
   case gr_pixel_mode_lcd2:
     src_format = GBLENDER_SOURCE_HBGR;
-    src_width /= 3;
     if ( !blender->channels )
       gblender_clear_channels( blender );
     break;
   case gr_pixel_mode_lcdv:
-    src_format  = GBLENDER_SOURCE_VRGB;
-    src_height /= 3;
-    src_pitch  *= 3;
+    src_format = GBLENDER_SOURCE_VRGB;
     if ( !blender->channels )
       gblender_clear_channels( blender );
     break;
   case gr_pixel_mode_lcdv2:
-    src_format  = GBLENDER_SOURCE_VBGR;
-    src_height /= 3;
-    src_pitch  *= 3;
+    src_format = GBLENDER_SOURCE_VBGR;
     if ( !blender->channels )
       gblender_clear_channels( blender );
     break;
@@ -359,6 +339,52 @@ gblender_blit_init( GBlenderBlit           blit,
     return -2;
   }
 
+  return 0;
+}
+
+
+/* clip the glyph against the target and set up the blitting lines */
+static int
+gblender_blit_clip( GBlenderBlit  blit,
+                    int           dst_x,
+                    int           dst_y,
+                    grSurface*    surface,
+                    grBitmap*     glyph )
+{
+  grBitmap*  target = &surface->bitmap;
+
+  int                   src_x = 0;
+  int                   src_y = 0;
+  int                   delta;
+  const unsigned char*  src_buffer = glyph->buffer;
+  int                   src_pitch  = glyph->pitch;
+  int                   src_width  = glyph->width;
+  int                   src_height = glyph->rows;
+  unsigned char*        dst_buffer = target->buffer;
+  const int             dst_pitch  = target->pitch;
+  const int             dst_width  = target->width;
+  const int             dst_height = target->rows;
+
+
+  switch ( glyph->mode )
+  {
+  case gr_pixel_mode_gray:
+    if ( glyph->grays != 256 )
+      gblender_glyph_upgray( glyph );
+    break;
+  case gr_pixel_mode_lcd:
+  case gr_pixel_mode_lcd2:
+    src_width /= 3;
+    break;
+  case gr_pixel_mode_lcdv:
+  case gr_pixel_mode_lcdv2:
+    src_height /= 3;
+    src_pitch  *= 3;
+    break;
+  default:
+    break;
+  }
+
   if ( src_pitch < 0 )
     src_buffer -= src_pitch * ( src_height - 1 );
   if ( dst_pitch < 0 )
@@ -406,6 +432,42 @@ gblender_blit_init( GBlenderBlit           blit,
 }
 
 
+static int
+gblender_blit_init( GBlenderBlit           blit,
+                    int                    dst_x,
+                    int                    dst_y,
+                    grSurface*             surface,
+                    grBitmap*              glyph )
+{
+  if ( gblender_blit_select( blit, surface, glyph->mode ) )
+    return -2;
+
+  return gblender_blit_clip( blit, dst_x, dst_y, surface, glyph );
+}
+
+
+/* sort by color, then by row and column */
+static int
+gblender_item_compare( const void*  a,
+                       const void*  b )
+{
+  const grBlitItem*  item1 = (const grBlitItem*)a;
+  const grBlitItem*  item2 = (const grBlitItem*)b;
+
+
+  if ( item1->color.value != item2->color.value )
+    return item1->color.value < item2->color.value ? -1 : 1;
+
+  if ( item1->y != item2->y )
+    return item1->y < item2->y ? -1 : 1;
+
+  if ( item1->x != item2->x )
+    return item1->x < item2->x ? -1 : 1;
+
+  return 0;
+}
+
+
 GBLENDER_APIDEF( void )
 grSetTargetGamma( grSurface*  surface,
                   double      gamma )
@@ -492,3 +554,55 @@ grBlitGlyphToSurface( grSurface*  surface,
   gblender_blit_run( gblit, color );
   return 1;
 }
+
+
+GBLENDER_APIDEF( int )
+grBlitGlyphsToSurface( grSurface*   surface,
+                       grBlitItem*  items,
+                       int          count )
+{
+  GBlenderBlitRec  gblit[1];
+  grBlitItem*      item;
+  grBlitItem*      limit = items + count;
+  grPixelMode      mode  = gr_pixel_mode_none;
+  int              blitted = 0;
+
+
+  /* check arguments */
+  if ( !surface || ( !items && count ) || count < 0 )
+  {
+    grError = gr_err_bad_argument;
+    return -1;
+  }
+
+  if ( count > 1 )
+    qsort( items, (size_t)count, sizeof ( grBlitItem ),
+           gblender_item_compare );
+
+  for ( item = items; item < limit; item++ )
+  {
+    grBitmap*  glyph = item->glyph;
+
+
+    if ( !glyph || !glyph->buffer )
+      continue;
+
+    /* the blit function and blender state only depend on the mode */
+    if ( glyph->mode != mode )
+    {
+      if ( gblender_blit_select( gblit, surface, glyph->mode ) )
+        return -1;
+
+      mode = glyph->mode;
+    }
+
+    if ( gblender_blit_clip( gblit, (int)item->x, (int)item->y,
+                             surface, glyph ) )
+      continue;
+
+    gblender_blit_run( gblit, item->color );
+    blitted++;
+  }
+
+  return blitted;
+}
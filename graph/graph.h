@@ -181,7 +181,11 @@
   *    This function really allocates a pixel buffer, then returns
   *    a descriptor for it.
   *
-  *    An existing bitmap will be resized.
+  *    An existing bitmap will be resized, keeping its buffer if it is
+  *    large enough; the pixels are not preserved.
+  *
+  *    Pixel buffers are aligned to 64 bytes.  Released buffers are kept
+  *    in a small pool and handed out again for bitmaps of similar size.
   *
   *    Call grDoneBitmap when you're done with it..
   *
@@ -194,6 +198,39 @@
                             grBitmap    *bit );
 
 
+ /**********************************************************************
+  *
+  * <Function>
+  *    grNewBitmapEx
+  *
+  * <Description>
+  *    Like grNewBitmap, with additional flags.
+  *
+  * <Input>
+  *    flags        :: a combination of
+  *
+  *                    gr_bitmap_flag_aligned ::
+  *                      pad the pitch to a multiple of 64 bytes so that
+  *                      every row is aligned; don't use this for device
+  *                      surfaces, which expect the natural pitch
+  *
+  *                    gr_bitmap_flag_zeroed ::
+  *                      clear the pixel buffer; this is skipped for
+  *                      fresh buffers that are known to be zero
+  *
+  **********************************************************************/
+
+#define gr_bitmap_flag_aligned  1
+#define gr_bitmap_flag_zeroed   2
+
+  extern  int  grNewBitmapEx( grPixelMode  pixel_mode,
+                              int          num_grays,
+                              int          width,
+                              int          height,
+                              int          flags,
+                              grBitmap    *bit );
+
+
  /**********************************************************************
   *
   * <Function>
@@ -270,6 +307,54 @@
   extern  void  grDoneBitmap( grBitmap*  bit );
 
 
+ /**********************************************************************
+  *
+  * <Struct>
+  *    grBitmapStats
+  *
+  * <Description>
+  *    Counters of the pixel buffer pool, accumulated since the start of
+  *    the program.
+  *
+  * <Fields>
+  *    requests  :: number of buffers requested by grNewBitmap(Ex)
+  *    kept      :: requests served by the bitmap's own buffer
+  *    reused    :: requests served from the pool
+  *    allocated :: requests that needed a new buffer
+  *    cleared   :: buffers cleared for gr_bitmap_flag_zeroed
+  *    skipped   :: clears skipped because the buffer was known to be
+  *                 zero
+  *
+  **********************************************************************/
+
+  typedef struct  grBitmapStats_
+  {
+    unsigned long  requests;
+    unsigned long  kept;
+    unsigned long  reused;
+    unsigned long  allocated;
+    unsigned long  cleared;
+    unsigned long  skipped;
+
+  } grBitmapStats;
+
+
+ /**********************************************************************
+  *
+  * <Function>
+  *    grGetBitmapStats
+  *
+  * <Description>
+  *    Retrieve the pixel buffer pool counters.
+  *
+  * <Output>
+  *    stats :: the counters
+  *
+  **********************************************************************/
+
+  extern  void  grGetBitmapStats( grBitmapStats*  stats );
+
+
  /**********************************************************************
   *
   * <Function>
@@ -566,6 +651,66 @@
                         grColor     color );
 
 
+ /*********************************************************************
+  *
+  * <Struct>
+  *   grBlitItem
+  *
+  * <Description>
+  *   a glyph bitmap record for grBlitGlyphsToSurface
+  *
+  * <Fields>
+  *   glyph :: handle to source glyph bitmap
+  *   x     :: position of left-most pixel of glyph image
+  *   y     :: position of top-most pixel of glyph image
+  *   color :: color to be used to draw the glyph
+  *
+  ********************************************************************/
+
+  typedef struct grBlitItem_
+  {
+    grBitmap*  glyph;
+    grPos      x;
+    grPos      y;
+    grColor    color;
+
+  } grBlitItem;
+
+
+ /**********************************************************************
+  *
+  * <Function>
+  *    grBlitGlyphsToSurface
+  *
+  * <Description>
+  *    writes an array of glyph bitmaps to a target surface in one pass.
+  *
+  * <Input>
+  *    surface :: handle to surface
+  *    items   :: array of glyph records
+  *    count   :: number of records in array
+  *
+  * <Return>
+  *   Number of blitted glyphs, -1 in case of error.
+  *
+  * <Note>
+  *   This is equivalent to calling grBlitGlyphToSurface for each record,
+  *   except that the blitter is set up once per run of glyphs with the
+  *   same pixel mode and that the blender cache is only reloaded when
+  *   the color changes.
+  *
+  *   The records are sorted in place by color, then by destination row,
+  *   to maximize cache hits.  Overlapping glyphs of different colors
+  *   might thus be drawn in a different order than given.
+  *
+  **********************************************************************/
+
+  extern int
+  grBlitGlyphsToSurface( grSurface*   surface,
+                         grBlitItem*  items,
+                         int          count );
+
+
  /**********************************************************************
   *
   * <Function>
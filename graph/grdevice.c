@@ -174,7 +174,7 @@
 
       /* then remove the bitmap if we're owner */
       if (surface->owner)
-        grFree( surface->bitmap.buffer );
+        grDoneBitmap( &surface->bitmap );
 
       surface->owner         = 0;
       surface->bitmap.buffer = NULL;
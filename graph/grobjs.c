@@ -137,20 +137,184 @@
   }
 
 
+ /**********************************************************************
+  *
+  *  Pixel buffer pool.
+  *
+  *  Bitmap buffers are aligned to GR_BUFFER_ALIGN bytes and preceded by
+  *  a header that records their capacity.  Released buffers are kept in
+  *  `grPool' and reused for requests that need between 3/4 and all of
+  *  their capacity; this catches repeated allocations of the same size
+  *  and windows being resized a little.  The pool is not thread-safe.
+  *
+  **********************************************************************/
+
+#define GR_BUFFER_ALIGN    64
+#define GR_POOL_MAX        8                      /* idle buffers   */
+#define GR_POOL_MAX_BYTES  ( 64 * 1024 * 1024 )   /* their capacity */
+
+  typedef struct  grBufferHeader_
+  {
+    void*   block;     /* as returned by calloc               */
+    size_t  size;      /* capacity after the header           */
+    int     dirty;     /* zero if the buffer is known to be 0 */
+
+  } grBufferHeader;
+
+
+  static grBufferHeader*  grPool[GR_POOL_MAX];
+  static int              grPoolCount;
+  static size_t           grPoolBytes;
+  static grBitmapStats    grStats;
+
+
+  static grBufferHeader*
+  grBufferHeaderOf( unsigned char*  buffer )
+  {
+    return (grBufferHeader*)( buffer - sizeof ( grBufferHeader ) );
+  }
+
+
+  static void
+  grBufferRelease( unsigned char*  buffer )
+  {
+    grBufferHeader*  header;
+
+
+    if ( !buffer )
+      return;
+
+    header        = grBufferHeaderOf( buffer );
+    header->dirty = 1;
+
+    if ( header->size > GR_POOL_MAX_BYTES )
+    {
+      free( header->block );
+      return;
+    }
+
+    /* make room by dropping the oldest buffers */
+    while ( grPoolCount > 0                                      &&
+            ( grPoolCount == GR_POOL_MAX                       ||
+              grPoolBytes + header->size > GR_POOL_MAX_BYTES ) )
+    {
+      grPoolBytes -= grPool[0]->size;
+      free( grPool[0]->block );
+
+      grPoolCount--;
+      memmove( grPool, grPool + 1, (size_t)grPoolCount * sizeof ( *grPool ) );
+    }
+
+    grPool[grPoolCount++] = header;
+    grPoolBytes          += header->size;
+  }
+
+
+  /* get a buffer for `size' bytes, preferring `old' or a pooled one; */
+  /* `old' is only released on success                                */
+  static unsigned char*
+  grBufferAcquire( unsigned char*  old,
+                   size_t          size,
+                   int             flags )
+  {
+    grBufferHeader*  header = NULL;
+    int              i, best = -1;
+
+
+    grStats.requests++;
+
+    if ( old )
+    {
+      header = grBufferHeaderOf( old );
+      if ( header->size >= size && header->size - header->size / 4 <= size )
+      {
+        grStats.kept++;
+        old = NULL;
+      }
+      else
+        header = NULL;
+    }
+
+    if ( !header )
+    {
+      for ( i = 0; i < grPoolCount; i++ )
+        if ( grPool[i]->size >= size                       &&
+             grPool[i]->size - grPool[i]->size / 4 <= size &&
+             ( best < 0 || grPool[i]->size < grPool[best]->size ) )
+          best = i;
+
+      if ( best >= 0 )
+      {
+        header       = grPool[best];
+        grPoolBytes -= header->size;
+
+        grPoolCount--;
+        memmove( grPool + best, grPool + best + 1,
+                 (size_t)( grPoolCount - best ) * sizeof ( *grPool ) );
+
+        grStats.reused++;
+      }
+    }
+
+    if ( !header )
+    {
+      /* calloc'ed memory is known to be zero; for large blocks */
+      /* the system provides it without touching the pages      */
+      void*   block = calloc( 1, sizeof ( grBufferHeader ) +
+                                 GR_BUFFER_ALIGN - 1 + size );
+      size_t  addr;
+
+
+      if ( !block )
+        return NULL;
+
+      addr  = (size_t)block + sizeof ( grBufferHeader ) + GR_BUFFER_ALIGN - 1;
+      addr &= ~(size_t)( GR_BUFFER_ALIGN - 1 );
+
+      header        = (grBufferHeader*)addr - 1;
+      header->block = block;
+      header->size  = size;
+      header->dirty = 0;
+
+      grStats.allocated++;
+    }
+
+    grBufferRelease( old );
+
+    if ( flags & gr_bitmap_flag_zeroed )
+    {
+      if ( header->dirty )
+      {
+        memset( header + 1, 0, size );
+        grStats.cleared++;
+      }
+      else
+        grStats.skipped++;
+    }
+
+    /* the caller is going to write it */
+    header->dirty = 1;
+
+    return (unsigned char*)( header + 1 );
+  }
+
+
  /**********************************************************************
   *
   * <Function>
-  *    grNewBitmap
+  *    grNewBitmapEx
   *
   * <Description>
   *    Creates a new bitmap or resizes an existing one.  The allocated
-  *    pixel buffer is not initialized.
+  *    pixel buffer is not initialized unless `gr_bitmap_flag_zeroed'
+  *    is set.
   *
   * <Input>
   *    pixel_mode   :: the target surface's pixel_mode
   *    num_grays    :: number of grays levels for PAL8 pixel mode
   *    width        :: width in pixels
   *    height       :: height in pixels
+  *    flags        :: see graph.h
   *
   * <Output>
   *    bit  :: descriptor of the new bitmap
@@ -160,14 +324,16 @@
   *
   **********************************************************************/
 
-  extern  int  grNewBitmap( grPixelMode  pixel_mode,
-                            int          num_grays,
-                            int          width,
-                            int          height,
-                            grBitmap    *bit )
+  extern  int  grNewBitmapEx( grPixelMode  pixel_mode,
+                              int          num_grays,
+                              int          width,
+                              int          height,
+                              int          flags,
+                              grBitmap    *bit )
   {
     int             pitch;
     unsigned char*  buffer;
+    size_t          size;
 
 
     /* check mode */
@@ -208,12 +374,23 @@
         return 0;
     }
 
-    buffer = (unsigned char*)realloc( bit->buffer,
-                                      (size_t)pitch * (size_t)height );
-    if ( !buffer && pitch && height )
+    if ( flags & gr_bitmap_flag_aligned )
+      pitch = ( pitch + GR_BUFFER_ALIGN - 1 ) & ~( GR_BUFFER_ALIGN - 1 );
+
+    size = (size_t)pitch * (size_t)height;
+    if ( size )
     {
-      grError = gr_err_memory;
-      goto Fail;
+      buffer = grBufferAcquire( bit->buffer, size, flags );
+      if ( !buffer )
+      {
+        grError = gr_err_memory;
+        goto Fail;
+      }
+    }
+    else
+    {
+      grBufferRelease( bit->buffer );
+      buffer = NULL;
     }
 
     bit->buffer = buffer;
@@ -229,6 +406,39 @@
     return grError;
   }
 
+
+ /**********************************************************************
+  *
+  * <Function>
+  *    grNewBitmap
+  *
+  * <Description>
+  *    Creates a new bitmap or resizes an existing one.  The allocated
+  *    pixel buffer is not initialized.
+  *
+  * <Input>
+  *    pixel_mode   :: the target surface's pixel_mode
+  *    num_grays    :: number of grays levels for PAL8 pixel mode
+  *    width        :: width in pixels
+  *    height       :: height in pixels
+  *
+  * <Output>
+  *    bit  :: descriptor of the new bitmap
+  *
+  * <Return>
+  *    Error code. 0 means success.
+  *
+  **********************************************************************/
+
+  extern  int  grNewBitmap( grPixelMode  pixel_mode,
+                            int          num_grays,
+                            int          width,
+                            int          height,
+                            grBitmap    *bit )
+  {
+    return grNewBitmapEx( pixel_mode, num_grays, width, height, 0, bit );
+  }
+
  /**********************************************************************
   *
   * <Function>
@@ -248,9 +458,25 @@
 
   extern  void  grDoneBitmap( grBitmap*  bit )
   {
-    grFree( bit->buffer );
+    grBufferRelease( bit->buffer );
     bit->buffer = NULL;
   }
 
 
+ /**********************************************************************
+  *
+  * <Function>
+  *    grGetBitmapStats
+  *
+  * <Description>
+  *    Retrieve the pixel buffer pool counters.
+  *
+  **********************************************************************/
+
+  extern  void  grGetBitmapStats( grBitmapStats*  stats )
+  {
+    *stats = grStats;
+  }
+
+
 
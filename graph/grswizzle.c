@@ -70,6 +70,16 @@
  */
 #define  POSTPROCESS
 
+/* SSE2 line filters for the 24-bit and 32-bit layouts are used when the
+ * compiler targets SSE2 and the CPU supports it
+ */
+#if defined( __SSE2__ )                               || \
+    defined( _M_X64 )                                 || \
+    ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#  define  SWIZZLE_SSE2
+#  include <emmintrin.h>
+#endif
+
 /************************************************************************/
 /************************************************************************/
 /*****                                                              *****/
@@ -146,7 +156,7 @@ filter_rect_generic( unsigned char*   read_buff,
                      unsigned char*   temp_lines )
 {
   unsigned char*  lines[3];
-  int             offset   = (x+y) % 3;
+  int             offset;
   int             delta, height2;
 
   /* clip rectangle, just to be sure */
@@ -171,6 +181,9 @@ filter_rect_generic( unsigned char*   read_buff,
   if (width <= 0 || height <= 0)  /* nothing to do */
     return;
 
+  /* the color pattern starts at the clipped origin */
+  offset = (x+y) % 3;
+
   /* now setup the three work lines */
   read_buff  += y*read_pitch  + pix_bytes*x;
   write_buff += y*write_pitch + pix_bytes*x;
@@ -532,6 +545,338 @@ postprocess_line_xrgb32( unsigned char** lines,
 
 
 
+/************************************************************************/
+/************************************************************************/
+/*****                                                              *****/
+/*****               S S E 2   L I N E   F I L T E R S              *****/
+/*****                                                              *****/
+/************************************************************************/
+/************************************************************************/
+
+#ifdef SWIZZLE_SSE2
+
+/* the scalar line functions above select a single color channel per
+ * pixel, cycling through R, G, B from one pixel to the next.  since the
+ * filters are separable per byte, the SSE2 versions filter all bytes of
+ * a line and then keep the selected ones with byte masks.  the masks
+ * repeat every three pixels, i.e., every 9 bytes for RGB24 and every 12
+ * bytes for XRGB32; we store one period plus a full vector for each
+ * initial offset, so that any 16-byte window can be loaded directly.
+ */
+#define  MASK_PERIOD_MAX  12
+#define  MASK_LENGTH      ( MASK_PERIOD_MAX + 16 )
+
+typedef struct  SwizzleMasks_
+{
+  int            period;
+  unsigned char  swizzle[3][MASK_LENGTH]; /* swizzled channel        */
+  unsigned char  center[3][MASK_LENGTH];  /* kept center channel     */
+  unsigned char  left  [3][MASK_LENGTH];  /* left and above average */
+  unsigned char  right [3][MASK_LENGTH];  /* right and below average */
+
+} SwizzleMasks;
+
+static SwizzleMasks  masks_rgb24;
+static SwizzleMasks  masks_xrgb32;
+
+
+/* return the byte of a pixel holding color `c' (0 = red, 1 = green,
+ * 2 = blue)
+ */
+static int
+swizzle_channel_byte( int  pix_bytes,
+                      int  c )
+{
+  if ( pix_bytes == 3 )
+    return c;                  /* R, G, B in memory order */
+  else
+    return 2 - c;              /* little-endian 0x00RRGGBB */
+}
+
+
+static void
+swizzle_masks_init( SwizzleMasks*  m,
+                    int            pix_bytes,
+                    int            post_shift )
+{
+  int  offset, nn;
+
+
+  m->period = 3 * pix_bytes;
+
+  for ( offset = 0; offset < 3; offset++ )
+  {
+    for ( nn = 0; nn < MASK_LENGTH; nn++ )
+    {
+      int  pix  = ( nn % m->period ) / pix_bytes;
+      int  byte = nn % pix_bytes;
+      int  c    = ( offset + pix ) % 3;
+
+
+      /* swizzling keeps channel `c' of each pixel; post-processing   */
+      /* keeps one channel and fills the two other channels from the  */
+      /* neighbours, see `postprocess_line_*' for the details         */
+      m->swizzle[offset][nn] =
+        byte == swizzle_channel_byte( pix_bytes, c ) ? 0xFF : 0;
+      m->center[offset][nn] =
+        byte == swizzle_channel_byte( pix_bytes,
+                                      ( c + post_shift ) % 3 ) ? 0xFF : 0;
+      m->right[offset][nn] =
+        byte == swizzle_channel_byte( pix_bytes,
+                                      ( c + post_shift + 1 ) % 3 ) ? 0xFF : 0;
+      m->left[offset][nn] =
+        byte == swizzle_channel_byte( pix_bytes,
+                                      ( c + post_shift + 2 ) % 3 ) ? 0xFF : 0;
+    }
+  }
+}
+
+
+/* compute `(4*c + l + r + a + b) >> 3' for 16 bytes */
+static __m128i
+swizzle_filter_16( const unsigned char*  current,
+                   const unsigned char*  above,
+                   const unsigned char*  below,
+                   int                   pix_bytes )
+{
+  const __m128i  zero = _mm_setzero_si128();
+
+  __m128i  c = _mm_loadu_si128( (const __m128i*)current );
+  __m128i  l = _mm_loadu_si128( (const __m128i*)( current - pix_bytes ) );
+  __m128i  r = _mm_loadu_si128( (const __m128i*)( current + pix_bytes ) );
+  __m128i  a = _mm_loadu_si128( (const __m128i*)above );
+  __m128i  b = _mm_loadu_si128( (const __m128i*)below );
+
+  __m128i  lo, hi;
+
+
+  lo = _mm_slli_epi16( _mm_unpacklo_epi8( c, zero ), 2 );
+  hi = _mm_slli_epi16( _mm_unpackhi_epi8( c, zero ), 2 );
+
+  lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( l, zero ) );
+  hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( l, zero ) );
+  lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( r, zero ) );
+  hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( r, zero ) );
+  lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( a, zero ) );
+  hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( a, zero ) );
+  lo = _mm_add_epi16( lo, _mm_unpacklo_epi8( b, zero ) );
+  hi = _mm_add_epi16( hi, _mm_unpackhi_epi8( b, zero ) );
+
+  lo = _mm_srli_epi16( lo, 3 );
+  hi = _mm_srli_epi16( hi, 3 );
+
+  return _mm_packus_epi16( lo, hi );
+}
+
+
+/* truncating byte average, `_mm_avg_epu8' would round up */
+static __m128i
+swizzle_average_16( __m128i  a,
+                    __m128i  b )
+{
+  const __m128i  mask = _mm_set1_epi8( 0x7F );
+
+  __m128i  half = _mm_and_si128( _mm_srli_epi16( _mm_xor_si128( a, b ), 1 ),
+                                 mask );
+
+
+  return _mm_add_epi8( _mm_and_si128( a, b ), half );
+}
+
+
+static void
+swizzle_line_sse2( unsigned char**  lines,
+                   unsigned char*   write,
+                   int              width,
+                   int              offset,
+                   int              pix_bytes,
+                   SwizzleMasks*    m )
+{
+  unsigned char*  above   = lines[0] + pix_bytes;
+  unsigned char*  current = lines[1] + pix_bytes;
+  unsigned char*  below   = lines[2] + pix_bytes;
+  unsigned char*  mask    = m->swizzle[offset];
+  int             size    = width * pix_bytes;
+  int             phase   = 0;
+  int             nn;
+
+
+  for ( nn = 0; nn + 16 <= size; nn += 16 )
+  {
+    __m128i  sum = swizzle_filter_16( current + nn, above + nn, below + nn,
+                                      pix_bytes );
+    __m128i  sel = _mm_loadu_si128( (const __m128i*)( mask + phase ) );
+
+
+    _mm_storeu_si128( (__m128i*)( write + nn ), _mm_and_si128( sum, sel ) );
+
+    phase += 16;
+    while ( phase >= m->period )
+      phase -= m->period;
+  }
+
+  for ( ; nn < size; nn++ )
+  {
+    unsigned int  sum;
+
+
+    sum  = (unsigned int)current[nn] << 2;
+    sum += current[nn - pix_bytes] +
+           current[nn + pix_bytes] +
+           above  [nn]             +
+           below  [nn]             ;
+
+    write[nn] = (unsigned char)( ( sum >> 3 ) & mask[phase] );
+
+    if ( ++phase == m->period )
+      phase = 0;
+  }
+}
+
+
+static void
+postprocess_line_sse2( unsigned char**  lines,
+                       unsigned char*   write,
+                       int              width,
+                       int              offset,
+                       int              pix_bytes,
+                       SwizzleMasks*    m )
+{
+  unsigned char*  above   = lines[0] + pix_bytes;
+  unsigned char*  current = lines[1] + pix_bytes;
+  unsigned char*  below   = lines[2] + pix_bytes;
+  unsigned char*  c_mask  = m->center[offset];
+  unsigned char*  l_mask  = m->left[offset];
+  unsigned char*  r_mask  = m->right[offset];
+  int             size    = width * pix_bytes;
+  int             phase   = 0;
+  int             nn;
+
+
+  for ( nn = 0; nn + 16 <= size; nn += 16 )
+  {
+    __m128i  c = _mm_loadu_si128( (const __m128i*)( current + nn ) );
+    __m128i  l = swizzle_average_16(
+                   _mm_loadu_si128( (const __m128i*)( current + nn -
+                                                        pix_bytes ) ),
+                   _mm_loadu_si128( (const __m128i*)( above + nn ) ) );
+    __m128i  r = swizzle_average_16(
+                   _mm_loadu_si128( (const __m128i*)( current + nn +
+                                                        pix_bytes ) ),
+                   _mm_loadu_si128( (const __m128i*)( below + nn ) ) );
+
+    c = _mm_and_si128( c,
+          _mm_loadu_si128( (const __m128i*)( c_mask + phase ) ) );
+    l = _mm_and_si128( l,
+          _mm_loadu_si128( (const __m128i*)( l_mask + phase ) ) );
+    r = _mm_and_si128( r,
+          _mm_loadu_si128( (const __m128i*)( r_mask + phase ) ) );
+
+    _mm_storeu_si128( (__m128i*)( write + nn ),
+                      _mm_or_si128( c, _mm_or_si128( l, r ) ) );
+
+    phase += 16;
+    while ( phase >= m->period )
+      phase -= m->period;
+  }
+
+  for ( ; nn < size; nn++ )
+  {
+    unsigned int  left  = ( current[nn - pix_bytes] + above[nn] ) >> 1;
+    unsigned int  right = ( current[nn + pix_bytes] + below[nn] ) >> 1;
+
+
+    write[nn] = (unsigned char)( ( current[nn] & c_mask[phase] ) |
+                                 ( left        & l_mask[phase] ) |
+                                 ( right       & r_mask[phase] ) );
+
+    if ( ++phase == m->period )
+      phase = 0;
+  }
+}
+
+
+static void
+swizzle_line_rgb24_sse2( unsigned char**  lines,
+                         unsigned char*   write,
+                         int              width,
+                         int              offset )
+{
+  swizzle_line_sse2( lines, write, width, offset, 3, &masks_rgb24 );
+}
+
+
+static void
+postprocess_line_rgb24_sse2( unsigned char**  lines,
+                             unsigned char*   write,
+                             int              width,
+                             int              offset )
+{
+  postprocess_line_sse2( lines, write, width, offset, 3, &masks_rgb24 );
+}
+
+
+static void
+swizzle_line_xrgb32_sse2( unsigned char**  lines,
+                          unsigned char*   write,
+                          int              width,
+                          int              offset )
+{
+  swizzle_line_sse2( lines, write, width, offset, 4, &masks_xrgb32 );
+}
+
+
+static void
+postprocess_line_xrgb32_sse2( unsigned char**  lines,
+                              unsigned char*   write,
+                              int              width,
+                              int              offset )
+{
+  postprocess_line_sse2( lines, write, width, offset, 4, &masks_xrgb32 );
+}
+
+#endif /* SWIZZLE_SSE2 */
+
+
+/* -1 until the CPU has been checked, then 0 or 1 */
+static int  swizzle_simd = -1;
+
+
+static int
+swizzle_simd_available( void )
+{
+#ifdef SWIZZLE_SSE2
+#if defined( __GNUC__ ) && defined( __i386__ )
+  __builtin_cpu_init();
+  if ( !__builtin_cpu_supports( "sse2" ) )
+    return 0;
+#endif
+
+  /* RGB24 post-processing centers on the swizzled channel, */
+  /* while XRGB32 post-processing centers on the next one   */
+  swizzle_masks_init( &masks_rgb24,  3, 0 );
+  swizzle_masks_init( &masks_xrgb32, 4, 1 );
+
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+
+extern int
+gr_swizzle_set_simd( int  enable )
+{
+  if ( swizzle_simd < 0 || enable )
+    swizzle_simd = swizzle_simd_available();
+
+  if ( !enable )
+    swizzle_simd = 0;
+
+  return swizzle_simd;
+}
+
+
 static void
 gr_swizzle_generic( unsigned char*    read_buff,
                    int                read_pitch,
@@ -610,14 +955,29 @@ gr_swizzle_rect_rgb24( unsigned char*    read_buff,
                        int               width,
                        int               height )
 {
+  filter_func_t  swizzle_func     = swizzle_line_rgb24;
+  filter_func_t  postprocess_func = postprocess_line_rgb24;
+
+
+  if ( swizzle_simd < 0 )
+    gr_swizzle_set_simd( 1 );
+
+#if defined( SWIZZLE_SSE2 ) && defined( ANTIALIAS )
+  if ( swizzle_simd )
+  {
+    swizzle_func     = swizzle_line_rgb24_sse2;
+    postprocess_func = postprocess_line_rgb24_sse2;
+  }
+#endif
+
   gr_swizzle_generic( read_buff, read_pitch,
                       write_buff, write_pitch,
                       buff_width,
                       buff_height,
                       x, y, width, height,
                       3,
-                      swizzle_line_rgb24,
-                      postprocess_line_rgb24 );
+                      swizzle_func,
+                      postprocess_func );
 }
 
 
@@ -658,16 +1018,151 @@ gr_swizzle_rect_xrgb32( unsigned char*    read_buff,
                         int               width,
                         int               height )
 {
+  filter_func_t  swizzle_func     = swizzle_line_xrgb32;
+  filter_func_t  postprocess_func = postprocess_line_xrgb32;
+
+
+  if ( swizzle_simd < 0 )
+    gr_swizzle_set_simd( 1 );
+
+#if defined( SWIZZLE_SSE2 ) && defined( ANTIALIAS )
+  if ( swizzle_simd )
+  {
+    swizzle_func     = swizzle_line_xrgb32_sse2;
+    postprocess_func = postprocess_line_xrgb32_sse2;
+  }
+#endif
+
   gr_swizzle_generic( read_buff, read_pitch,
                       write_buff, write_pitch,
                       buff_width,
                       buff_height,
                       x, y, width, height,
                       4,
-                      swizzle_line_xrgb32,
-                      postprocess_line_xrgb32 );
+                      swizzle_func,
+                      postprocess_func );
+}
+
+
+
+#ifdef TEST
+
+/*
+ *  Self-check of the SIMD line filters, without a display:
+ *
+ *    cc -O2 -DTEST -Igraph graph/grswizzle.c
+ *
+ *  Random rectangles of random buffers are filtered once with the
+ *  generic and once with the SIMD line functions; the resulting buffers
+ *  must be identical.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_RUNS       2000
+#define TEST_MAX_WIDTH  300
+#define TEST_MAX_ROWS   40
+
+
+typedef void
+(*swizzle_rect_func_t)( unsigned char*  read_buff,
+                        int             read_pitch,
+                        unsigned char*  write_buff,
+                        int             write_pitch,
+                        int             buff_width,
+                        int             buff_height,
+                        int             x,
+                        int             y,
+                        int             width,
+                        int             height );
+
+
+static int
+test_rect( swizzle_rect_func_t  func,
+           int                  pixbytes,
+           const char*          name )
+{
+  unsigned char*  read_buff;
+  unsigned char*  write_buff;
+  unsigned char*  expected;
+  size_t          size;
+  int             run, errors = 0;
+
+
+  size       = (size_t)( TEST_MAX_WIDTH * pixbytes + 16 ) * TEST_MAX_ROWS;
+  read_buff  = (unsigned char*)malloc( size );
+  write_buff = (unsigned char*)malloc( size );
+  expected   = (unsigned char*)malloc( size );
+  if ( !read_buff || !write_buff || !expected )
+    return 1;
+
+  for ( run = 0; run < TEST_RUNS; run++ )
+  {
+    int     buff_width  = 1 + rand() % TEST_MAX_WIDTH;
+    int     buff_height = 1 + rand() % TEST_MAX_ROWS;
+    int     pitch       = buff_width * pixbytes + 4 * ( rand() % 4 );
+    int     x           = rand() % buff_width;
+    int     y           = rand() % buff_height;
+    int     width       = 1 + rand() % ( buff_width - x );
+    int     height      = 1 + rand() % ( buff_height - y );
+    size_t  i;
+
+
+    /* exercise bottom-up buffers, too */
+    if ( rand() & 1 )
+      pitch = -pitch;
+
+    for ( i = 0; i < size; i++ )
+    {
+      read_buff[i]  = (unsigned char)rand();
+      write_buff[i] = (unsigned char)rand();
+    }
+    memcpy( expected, write_buff, size );
+
+    gr_swizzle_set_simd( 0 );
+    func( read_buff, pitch, expected, pitch,
+          buff_width, buff_height, x, y, width, height );
+
+    gr_swizzle_set_simd( 1 );
+    func( read_buff, pitch, write_buff, pitch,
+          buff_width, buff_height, x, y, width, height );
+
+    if ( memcmp( expected, write_buff, size ) )
+    {
+      printf( "%s: mismatch for %dx%d buffer, pitch %d, rectangle %dx%d+%d+%d\n",
+              name, buff_width, buff_height, pitch, width, height, x, y );
+      errors++;
+    }
+  }
+
+  free( read_buff );
+  free( write_buff );
+  free( expected );
+
+  return errors;
 }
 
 
+int
+main( void )
+{
+  int  errors = 0;
+
 
+  if ( !gr_swizzle_set_simd( 1 ) )
+  {
+    printf( "SIMD filters not available, nothing to check\n" );
+    return 0;
+  }
+
+  srand( 0 );
+  errors += test_rect( gr_swizzle_rect_rgb24,  3, "rgb24" );
+  errors += test_rect( gr_swizzle_rect_xrgb32, 4, "xrgb32" );
+
+  printf( "%d runs per format, %d mismatches\n", TEST_RUNS, errors );
+
+  return errors ? 1 : 0;
+}
 
+#endif /* TEST */
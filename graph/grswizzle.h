@@ -37,4 +37,9 @@ gr_swizzle_rect_xrgb32( unsigned char*    read_buff,
                         int               width,
                         int               height );
 
+/* enable (1) or disable (0) the SIMD line filters, which are used by */
+/* default where available; return 1 if they are active afterwards    */
+int
+gr_swizzle_set_simd( int  enable );
+
 #endif /* GRSWIZZLE_H_ */
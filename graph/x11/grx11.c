@@ -30,6 +30,12 @@
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
 
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
+
 #include "grtypes.h"
 #include "grobjs.h"
 #include "grx11.h"
@@ -795,6 +801,454 @@
   };
 
 
+  /************************************************************************/
+  /************************************************************************/
+  /*****                                                              *****/
+  /*****                VECTORIZED BLITTING ROUTINES                  *****/
+  /*****                                                              *****/
+  /************************************************************************/
+  /************************************************************************/
+
+  /* On x86, RGB triplets are expanded to 32-bit pixels or split into */
+  /* 16-bit channels with the SSSE3 byte shuffle, while gray pixels   */
+  /* only need SSE2 unpacking.  These routines are compiled for their */
+  /* target regardless of the compiler flags and only selected if the */
+  /* CPU supports SSSE3.  The results are identical to the scalar     */
+  /* versions above, which also handle the remaining pixels of lines. */
+
+#if defined( __GNUC__ )                              && \
+    ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define X11_SIMD
+#include <tmmintrin.h>
+#define X11_SSE2   __attribute__(( target( "sse2" ) ))
+#define X11_SSSE3  __attribute__(( target( "ssse3" ) ))
+#endif
+
+
+#ifdef X11_SIMD
+
+  /* expand RGB24 to 32-bit pixels with the given channel shifts */
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_32_ssse3( grX11Blitter*  blit,
+                                  int            r_shift,
+                                  int            g_shift,
+                                  int            b_shift )
+  {
+    unsigned char*  line_read  = blit->src_line + blit->x * 3;
+    unsigned char*  line_write = blit->dst_line + blit->x * 4;
+    int             h          = blit->height;
+    unsigned char   order[16];
+    __m128i         shuffle;
+    int             i;
+
+
+    /* little-endian byte positions of the channels in each pixel */
+    memset( order, 0x80, sizeof ( order ) );
+    for ( i = 0; i < 4; i++ )
+    {
+      order[4 * i + r_shift / 8] = (unsigned char)( 3 * i     );
+      order[4 * i + g_shift / 8] = (unsigned char)( 3 * i + 1 );
+      order[4 * i + b_shift / 8] = (unsigned char)( 3 * i + 2 );
+    }
+    shuffle = _mm_loadu_si128( (const __m128i*)order );
+
+    for ( ; h > 0; h-- )
+    {
+      unsigned char*  lread  = line_read;
+      unsigned char*  lwrite = line_write;
+      int             x      = blit->width;
+
+
+      /* four pixels per step, but 16 bytes are loaded */
+      for ( ; x >= 6; x -= 4, lread += 12, lwrite += 16 )
+      {
+        __m128i  v = _mm_loadu_si128( (const __m128i*)lread );
+
+
+        _mm_storeu_si128( (__m128i*)lwrite, _mm_shuffle_epi8( v, shuffle ) );
+      }
+
+      for ( ; x > 0; x--, lread += 3, lwrite += 4 )
+      {
+        uint32_t  r = lread[0];
+        uint32_t  g = lread[1];
+        uint32_t  b = lread[2];
+
+
+        *(uint32_t*)lwrite = ( r << r_shift ) |
+                             ( g << g_shift ) |
+                             ( b << b_shift );
+      }
+
+      line_read  += blit->src_pitch;
+      line_write += blit->dst_pitch;
+    }
+  }
+
+
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_rgb0888_ssse3( grX11Blitter*  blit )
+  {
+    gr_x11_convert_rgb_to_32_ssse3( blit, 16, 8, 0 );
+  }
+
+
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_bgr0888_ssse3( grX11Blitter*  blit )
+  {
+    gr_x11_convert_rgb_to_32_ssse3( blit, 0, 8, 16 );
+  }
+
+
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_rgb8880_ssse3( grX11Blitter*  blit )
+  {
+    gr_x11_convert_rgb_to_32_ssse3( blit, 24, 16, 8 );
+  }
+
+
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_bgr8880_ssse3( grX11Blitter*  blit )
+  {
+    gr_x11_convert_rgb_to_32_ssse3( blit, 8, 16, 24 );
+  }
+
+
+  /* pack RGB24 into 16-bit pixels with 6 or 5 green bits; `swap' */
+  /* puts the blue channel in the high bits                       */
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_16_ssse3( grX11Blitter*  blit,
+                                  int            green_bits,
+                                  int            swap )
+  {
+    unsigned char*  line_read  = blit->src_line + blit->x * 3;
+    unsigned char*  line_write = blit->dst_line + blit->x * 2;
+    int             h          = blit->height;
+    int             hi         = swap ? 2 : 0;
+    int             lo         = swap ? 0 : 2;
+    int             hi_shift   = 6 - green_bits;
+    int             g_shift    = green_bits - 3;
+    unsigned int    hi_mask    = 0xF800U >> hi_shift;
+    unsigned int    g_mask     = ( ( 1U << green_bits ) - 1 ) << 5;
+    unsigned char   order[6][16];
+    __m128i         shuffle[6];
+    __m128i         vhi_mask   = _mm_set1_epi16( (short)hi_mask );
+    __m128i         vg_mask    = _mm_set1_epi16( (short)g_mask );
+    __m128i         vhi_shift  = _mm_cvtsi32_si128( hi_shift );
+    __m128i         vg_shift   = _mm_cvtsi32_si128( g_shift );
+    int             i;
+
+
+    /* Words 0-3 come from the first load, words 4-7 from the second */
+    /* one; the high channel goes to the high byte of each word.     */
+    memset( order, 0x80, sizeof ( order ) );
+    for ( i = 0; i < 8; i++ )
+    {
+      int  n = i < 4 ? 0 : 1;
+      int  p = 3 * ( i & 3 );
+
+
+      order[n    ][2 * i + 1] = (unsigned char)( p + hi );
+      order[n + 2][2 * i    ] = (unsigned char)( p + 1  );
+      order[n + 4][2 * i    ] = (unsigned char)( p + lo );
+    }
+    for ( i = 0; i < 6; i++ )
+      shuffle[i] = _mm_loadu_si128( (const __m128i*)order[i] );
+
+    for ( ; h > 0; h-- )
+    {
+      unsigned char*   lread  = line_read;
+      unsigned short*  lwrite = (unsigned short*)line_write;
+      int              x      = blit->width;
+
+
+      /* eight pixels per step, but 28 bytes are loaded */
+      for ( ; x >= 10; x -= 8, lread += 24, lwrite += 8 )
+      {
+        __m128i  v0 = _mm_loadu_si128( (const __m128i*)lread );
+        __m128i  v1 = _mm_loadu_si128( (const __m128i*)( lread + 12 ) );
+        __m128i  c_hi, c_g, c_lo;
+
+
+        c_hi = _mm_or_si128( _mm_shuffle_epi8( v0, shuffle[0] ),
+                             _mm_shuffle_epi8( v1, shuffle[1] ) );
+        c_g  = _mm_or_si128( _mm_shuffle_epi8( v0, shuffle[2] ),
+                             _mm_shuffle_epi8( v1, shuffle[3] ) );
+        c_lo = _mm_or_si128( _mm_shuffle_epi8( v0, shuffle[4] ),
+                             _mm_shuffle_epi8( v1, shuffle[5] ) );
+
+        c_hi = _mm_and_si128( _mm_srl_epi16( c_hi, vhi_shift ), vhi_mask );
+        c_g  = _mm_and_si128( _mm_sll_epi16( c_g, vg_shift ), vg_mask );
+        c_lo = _mm_srli_epi16( c_lo, 3 );
+
+        _mm_storeu_si128( (__m128i*)lwrite,
+                          _mm_or_si128( _mm_or_si128( c_hi, c_g ), c_lo ) );
+      }
+
+      for ( ; x > 0; x--, lread += 3, lwrite++ )
+      {
+        unsigned int  c0 = lread[hi];
+        unsigned int  c1 = lread[1];
+        unsigned int  c2 = lread[lo];
+
+
+        lwrite[0] = (unsigned short)( ( ( c0 << 8 >> hi_shift ) & hi_mask ) |
+                                      ( ( c1 << g_shift       ) & g_mask  ) |
+                                      ( ( c2 >> 3             )           ) );
+      }
+
+      line_read  += blit->src_pitch;
+      line_write += blit->dst_pitch;
+    }
+  }
+
+
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_rgb565_ssse3( grX11Blitter*  blit )
+  {
+    gr_x11_convert_rgb_to_16_ssse3( blit, 6, 0 );
+  }
+
+
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_bgr565_ssse3( grX11Blitter*  blit )
+  {
+    gr_x11_convert_rgb_to_16_ssse3( blit, 6, 1 );
+  }
+
+
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_rgb555_ssse3( grX11Blitter*  blit )
+  {
+    gr_x11_convert_rgb_to_16_ssse3( blit, 5, 0 );
+  }
+
+
+  static X11_SSSE3 void
+  gr_x11_convert_rgb_to_bgr555_ssse3( grX11Blitter*  blit )
+  {
+    gr_x11_convert_rgb_to_16_ssse3( blit, 5, 1 );
+  }
+
+
+  /* replicate gray to 32-bit pixels, keeping the bits of `mask' */
+  static X11_SSE2 void
+  gr_x11_convert_gray_to_32_sse2( grX11Blitter*  blit,
+                                  uint32_t       mask )
+  {
+    unsigned char*  line_read  = blit->src_line + blit->x;
+    unsigned char*  line_write = blit->dst_line + blit->x * 4;
+    int             h          = blit->height;
+    __m128i         vmask      = _mm_set1_epi32( (int)mask );
+
+
+    for ( ; h > 0; h-- )
+    {
+      unsigned char*  lread  = line_read;
+      uint32_t*       lwrite = (uint32_t*)line_write;
+      int             x      = blit->width;
+
+
+      for ( ; x >= 16; x -= 16, lread += 16, lwrite += 16 )
+      {
+        __m128i  v  = _mm_loadu_si128( (const __m128i*)lread );
+        __m128i  lo = _mm_unpacklo_epi8( v, v );
+        __m128i  hi = _mm_unpackhi_epi8( v, v );
+
+
+        _mm_storeu_si128( (__m128i*)( lwrite      ),
+                          _mm_and_si128( _mm_unpacklo_epi16( lo, lo ),
+                                         vmask ) );
+        _mm_storeu_si128( (__m128i*)( lwrite +  4 ),
+                          _mm_and_si128( _mm_unpackhi_epi16( lo, lo ),
+                                         vmask ) );
+        _mm_storeu_si128( (__m128i*)( lwrite +  8 ),
+                          _mm_and_si128( _mm_unpacklo_epi16( hi, hi ),
+                                         vmask ) );
+        _mm_storeu_si128( (__m128i*)( lwrite + 12 ),
+                          _mm_and_si128( _mm_unpackhi_epi16( hi, hi ),
+                                         vmask ) );
+      }
+
+      for ( ; x > 0; x--, lread++, lwrite++ )
+        *lwrite = ( *lread * 0x01010101U ) & mask;
+
+      line_read  += blit->src_pitch;
+      line_write += blit->dst_pitch;
+    }
+  }
+
+
+  static X11_SSE2 void
+  gr_x11_convert_gray_to_rgb0888_sse2( grX11Blitter*  blit )
+  {
+    gr_x11_convert_gray_to_32_sse2( blit, 0x00FFFFFFU );
+  }
+
+
+  static X11_SSE2 void
+  gr_x11_convert_gray_to_rgb8880_sse2( grX11Blitter*  blit )
+  {
+    gr_x11_convert_gray_to_32_sse2( blit, 0xFFFFFF00U );
+  }
+
+
+  /* replicate gray to 16-bit pixels with 6 or 5 green bits */
+  static X11_SSE2 void
+  gr_x11_convert_gray_to_16_sse2( grX11Blitter*  blit,
+                                  int            green_bits )
+  {
+    unsigned char*  line_read  = blit->src_line + blit->x;
+    unsigned char*  line_write = blit->dst_line + blit->x * 2;
+    int             h          = blit->height;
+    int             g_shift    = 8 - green_bits;
+    int             r_shift    = 5 + green_bits;
+    __m128i         vg_shift   = _mm_cvtsi32_si128( g_shift );
+    __m128i         vr_shift   = _mm_cvtsi32_si128( r_shift );
+    __m128i         zero       = _mm_setzero_si128();
+
+
+    for ( ; h > 0; h-- )
+    {
+      unsigned char*   lread  = line_read;
+      unsigned short*  lwrite = (unsigned short*)line_write;
+      int              x      = blit->width;
+
+
+      for ( ; x >= 8; x -= 8, lread += 8, lwrite += 8 )
+      {
+        __m128i  p = _mm_unpacklo_epi8(
+                       _mm_loadl_epi64( (const __m128i*)lread ), zero );
+        __m128i  b = _mm_srli_epi16( p, 3 );
+        __m128i  g = _mm_slli_epi16( _mm_srl_epi16( p, vg_shift ), 5 );
+        __m128i  r = _mm_sll_epi16( b, vr_shift );
+
+
+        _mm_storeu_si128( (__m128i*)lwrite,
+                          _mm_or_si128( _mm_or_si128( r, g ), b ) );
+      }
+
+      for ( ; x > 0; x--, lread++, lwrite++ )
+      {
+        unsigned int  p = lread[0];
+
+
+        lwrite[0] = (unsigned short)( ( ( p >> 3 ) << r_shift ) |
+                                      ( ( p >> g_shift ) << 5 ) |
+                                      ( ( p >> 3 )            ) );
+      }
+
+      line_read  += blit->src_pitch;
+      line_write += blit->dst_pitch;
+    }
+  }
+
+
+  static X11_SSE2 void
+  gr_x11_convert_gray_to_rgb565_sse2( grX11Blitter*  blit )
+  {
+    gr_x11_convert_gray_to_16_sse2( blit, 6 );
+  }
+
+
+  static X11_SSE2 void
+  gr_x11_convert_gray_to_rgb555_sse2( grX11Blitter*  blit )
+  {
+    gr_x11_convert_gray_to_16_sse2( blit, 5 );
+  }
+
+
+  typedef struct  grX11SimdRec_
+  {
+    const grX11Format*  format;
+    grX11ConvertFunc    rgb_convert;
+    grX11ConvertFunc    gray_convert;
+
+  } grX11Simd;
+
+
+  /* the 24-bit formats are rare and left to the scalar routines */
+  static const grX11Simd  gr_x11_simd_formats[] =
+  {
+    { &gr_x11_format_rgb0888,
+      gr_x11_convert_rgb_to_rgb0888_ssse3,
+      gr_x11_convert_gray_to_rgb0888_sse2 },
+    { &gr_x11_format_bgr0888,
+      gr_x11_convert_rgb_to_bgr0888_ssse3,
+      gr_x11_convert_gray_to_rgb0888_sse2 },
+    { &gr_x11_format_rgb8880,
+      gr_x11_convert_rgb_to_rgb8880_ssse3,
+      gr_x11_convert_gray_to_rgb8880_sse2 },
+    { &gr_x11_format_bgr8880,
+      gr_x11_convert_rgb_to_bgr8880_ssse3,
+      gr_x11_convert_gray_to_rgb8880_sse2 },
+    { &gr_x11_format_rgb565,
+      gr_x11_convert_rgb_to_rgb565_ssse3,
+      gr_x11_convert_gray_to_rgb565_sse2 },
+    { &gr_x11_format_bgr565,
+      gr_x11_convert_rgb_to_bgr565_ssse3,
+      gr_x11_convert_gray_to_rgb565_sse2 },
+    { &gr_x11_format_rgb555,
+      gr_x11_convert_rgb_to_rgb555_ssse3,
+      gr_x11_convert_gray_to_rgb555_sse2 },
+    { &gr_x11_format_bgr555,
+      gr_x11_convert_rgb_to_bgr555_ssse3,
+      gr_x11_convert_gray_to_rgb555_sse2 },
+    { NULL, NULL, NULL }
+  };
+
+#endif /* X11_SIMD */
+
+
+#ifdef HAVE_XSHM
+
+  /************************************************************************/
+  /************************************************************************/
+  /*****                                                              *****/
+  /*****          COPY ROUTINES FOR SHARED MEMORY IMAGES              *****/
+  /*****                                                              *****/
+  /************************************************************************/
+  /************************************************************************/
+
+  /* When the image lives in shared memory, the surface bitmap cannot  */
+  /* be used directly, and the pixels of native formats are copied.    */
+
+  static void
+  gr_x11_convert_copy_16( grX11Blitter*  blit )
+  {
+    unsigned char*  line_read  = blit->src_line + blit->x * 2;
+    unsigned char*  line_write = blit->dst_line + blit->x * 2;
+    int             h          = blit->height;
+
+
+    for ( ; h > 0; h-- )
+    {
+      memcpy( line_write, line_read, (size_t)blit->width * 2 );
+      line_read  += blit->src_pitch;
+      line_write += blit->dst_pitch;
+    }
+  }
+
+
+  static void
+  gr_x11_convert_copy_32( grX11Blitter*  blit )
+  {
+    unsigned char*  line_read  = blit->src_line + blit->x * 4;
+    unsigned char*  line_write = blit->dst_line + blit->x * 4;
+    int             h          = blit->height;
+
+
+    for ( ; h > 0; h-- )
+    {
+      memcpy( line_write, line_read, (size_t)blit->width * 4 );
+      line_read  += blit->src_pitch;
+      line_write += blit->dst_pitch;
+    }
+  }
+
+#endif /* HAVE_XSHM */
+
+
   /************************************************************************/
   /************************************************************************/
   /*****                                                              *****/
@@ -826,6 +1280,11 @@
     const grX11Format*  format;
     int                 scanline_pad;
     Visual*             visual;
+    int                 simd;            /* vectorized converters usable */
+#ifdef HAVE_XSHM
+    int                 shm;             /* MIT-SHM extension available */
+    int                 shm_completion;  /* its completion event type   */
+#endif
 
   } grX11Device;
 
@@ -833,6 +1292,25 @@
   static grX11Device  x11dev;
 
 
+  /* select the fastest routine for a given display format */
+  static grX11ConvertFunc
+  gr_x11_format_convert( const grX11Format*  format,
+                         int                 gray )
+  {
+#ifdef X11_SIMD
+    const grX11Simd*  simd;
+
+
+    if ( x11dev.simd )
+      for ( simd = gr_x11_simd_formats; simd->format; simd++ )
+        if ( simd->format == format )
+          return gray ? simd->gray_convert : simd->rgb_convert;
+#endif
+
+    return gray ? format->gray_convert : format->rgb_convert;
+  }
+
+
   static void
   gr_x11_device_done( void )
   {
@@ -865,6 +1343,23 @@
     x11dev.busy = XCreateFontCursor( x11dev.display, XC_watch );
     x11dev.scanline_pad = BitmapPad( x11dev.display );
 
+#ifdef X11_SIMD
+    __builtin_cpu_init();
+    x11dev.simd = __builtin_cpu_supports( "ssse3" );
+#endif
+
+#ifdef HAVE_XSHM
+    /* shared memory only works with a local server; this is */
+    /* checked when the first segment gets attached          */
+    if ( XShmQueryExtension( x11dev.display ) )
+    {
+      x11dev.shm            = 1;
+      x11dev.shm_completion = XShmGetEventBase( x11dev.display ) +
+                              ShmCompletion;
+    }
+    LOG(( "MIT-SHM: %s\n", x11dev.shm ? "yes" : "no" ));
+#endif
+
     LOG(( "Display: BitmapUnit = %d, BitmapPad = %d, ByteOrder = %s\n",
           BitmapUnit( x11dev.display ), BitmapPad( x11dev.display ),
           ImageByteOrder( x11dev.display ) == LSBFirst ? "LSBFirst"
@@ -955,6 +1450,15 @@
 
     XImage*             ximage;
     grX11ConvertFunc    convert;
+#ifdef HAVE_XSHM
+    XShmSegmentInfo     shminfo;
+    int                 shm;          /* image is in shared memory   */
+    int                 shm_pending;  /* outstanding XShmPutImage    */
+    grX11ConvertFunc    shm_copy;     /* replaces zero-copy          */
+#endif
+
+    unsigned char*      shadow;       /* bitmap as last sent         */
+    int                 shadow_valid;
 
     char                key_buffer[10];
     int                 key_cursor;
@@ -963,6 +1467,373 @@
   } grX11Surface;
 
 
+#ifdef HAVE_XSHM
+
+  static int  gr_x11_shm_error;
+
+
+  static int
+  gr_x11_shm_error_handler( Display*      display,
+                            XErrorEvent*  event )
+  {
+    (void)display;
+    (void)event;
+
+    gr_x11_shm_error = 1;
+
+    return 0;
+  }
+
+
+  static Bool
+  gr_x11_shm_is_completion( Display*  display,
+                            XEvent*   event,
+                            XPointer  arg )
+  {
+    (void)display;
+    (void)arg;
+
+    return event->type == x11dev.shm_completion;
+  }
+
+
+  /* wait until the server has finished reading the shared image */
+  static void
+  gr_x11_surface_shm_wait( grX11Surface*  surface )
+  {
+    XEvent  event;
+
+
+    while ( surface->shm_pending > 0 )
+    {
+      XIfEvent( surface->display, &event, gr_x11_shm_is_completion, NULL );
+      surface->shm_pending--;
+    }
+  }
+
+
+  /* create an image in a shared memory segment; returns NULL on failure */
+  static XImage*
+  gr_x11_surface_shm_create( grX11Surface*  surface,
+                             int            width,
+                             int            height )
+  {
+    XShmSegmentInfo*  shminfo = &surface->shminfo;
+    XImage*           ximage;
+    XErrorHandler     handler;
+
+
+    ximage = XShmCreateImage( surface->display,
+                              surface->visual,
+                              (unsigned int)x11dev.format->x_depth,
+                              ZPixmap,
+                              NULL,
+                              shminfo,
+                              (unsigned int)width,
+                              (unsigned int)height );
+    if ( !ximage )
+      return NULL;
+
+    shminfo->shmid = shmget( IPC_PRIVATE,
+                             (size_t)ximage->bytes_per_line * (size_t)height,
+                             IPC_CREAT | 0600 );
+    if ( shminfo->shmid < 0 )
+      goto Fail_Image;
+
+    shminfo->shmaddr  = (char*)shmat( shminfo->shmid, NULL, 0 );
+    shminfo->readOnly = False;
+    if ( shminfo->shmaddr == (char*)-1 )
+      goto Fail_Segment;
+
+    /* attaching fails asynchronously if the server is remote */
+    gr_x11_shm_error = 0;
+    handler          = XSetErrorHandler( gr_x11_shm_error_handler );
+
+    XShmAttach( surface->display, shminfo );
+    XSync( surface->display, False );
+
+    XSetErrorHandler( handler );
+
+    if ( gr_x11_shm_error )
+    {
+      LOG(( "MIT-SHM: cannot attach segment, using XPutImage\n" ));
+
+      x11dev.shm = 0;
+      shmdt( shminfo->shmaddr );
+      goto Fail_Segment;
+    }
+
+    /* the segment now goes away with its last detachment */
+    shmctl( shminfo->shmid, IPC_RMID, NULL );
+
+    ximage->data = shminfo->shmaddr;
+
+    return ximage;
+
+  Fail_Segment:
+    shmctl( shminfo->shmid, IPC_RMID, NULL );
+
+  Fail_Image:
+    XDestroyImage( ximage );
+
+    return NULL;
+  }
+
+#endif /* HAVE_XSHM */
+
+
+  /* create the surface X11 image, preferably in shared memory, */
+  /* and the shadow bitmap used to find damaged areas           */
+  static int
+  gr_x11_surface_create_image( grX11Surface*  surface )
+  {
+    grBitmap*  bitmap = &surface->root.bitmap;
+    XImage*    ximage;
+    size_t     size;
+
+
+#ifdef HAVE_XSHM
+    if ( x11dev.shm )
+    {
+      ximage = gr_x11_surface_shm_create( surface,
+                                          bitmap->width,
+                                          bitmap->rows );
+      if ( ximage )
+      {
+        surface->shm = 1;
+        goto Setup;
+      }
+    }
+#endif
+
+    ximage = XCreateImage( surface->display,
+                           surface->visual,
+                           (unsigned int)x11dev.format->x_depth,
+                           ZPixmap,
+                           0,
+                           NULL,
+                           (unsigned int)bitmap->width,
+                           (unsigned int)bitmap->rows,
+                           x11dev.scanline_pad,
+                           0 );
+    if ( !ximage )
+      return 0;
+
+    /* Allocate or link surface image data */
+    if ( surface->convert )
+    {
+      ximage->data = (char*)malloc( (size_t)bitmap->rows *
+                                    (size_t)ximage->bytes_per_line );
+      if ( !ximage->data )
+      {
+        XDestroyImage( ximage );
+        return 0;
+      }
+    }
+    else
+    {
+      ximage->data           = (char*)bitmap->buffer;
+      ximage->bytes_per_line = bitmap->pitch;
+    }
+
+#ifdef HAVE_XSHM
+  Setup:
+#endif
+    if ( !surface->convert )
+    {
+      const int x = 1;
+
+      ximage->byte_order = *(char*)&x ? LSBFirst : MSBFirst;
+      ximage->bitmap_pad = 32;
+      ximage->red_mask   = x11dev.format->x_red_mask;
+      ximage->green_mask = x11dev.format->x_green_mask;
+      ximage->blue_mask  = x11dev.format->x_blue_mask;
+    }
+
+    surface->ximage = ximage;
+
+    /* damage tracking is simply disabled if this fails */
+    size = (size_t)bitmap->rows * (size_t)bitmap->pitch;
+
+    free( surface->shadow );
+    surface->shadow       = size ? (unsigned char*)malloc( size ) : NULL;
+    surface->shadow_valid = 0;
+
+    return 1;
+  }
+
+
+  static void
+  gr_x11_surface_destroy_image( grX11Surface*  surface )
+  {
+    XImage*  ximage = surface->ximage;
+
+
+    if ( !ximage )
+      return;
+
+#ifdef HAVE_XSHM
+    if ( surface->shm )
+    {
+      gr_x11_surface_shm_wait( surface );
+
+      XShmDetach( surface->display, &surface->shminfo );
+      shmdt( surface->shminfo.shmaddr );
+
+      ximage->data = NULL;
+      surface->shm = 0;
+    }
+    else
+#endif
+    if ( !surface->convert )
+      ximage->data = NULL;
+
+    XDestroyImage( ximage );
+    surface->ximage = NULL;
+  }
+
+
+  /* Narrow a rectangle to the pixels that differ from the shadow */
+  /* bitmap, updating the latter.  Returns 1 if nothing changed.  */
+  static int
+  gr_x11_surface_damage( grX11Surface*  surface,
+                         int*           ax,
+                         int*           ay,
+                         int*           aw,
+                         int*           ah )
+  {
+    grBitmap*  bitmap = &surface->root.bitmap;
+    int        x0     = *ax;
+    int        y0     = *ay;
+    int        x1     = *ax + *aw;
+    int        y1     = *ay + *ah;
+    int        left, right, top, bottom;
+    int        bpp, y;
+
+
+    /* clip rectangle to bitmap */
+    if ( x0 < 0 )
+      x0 = 0;
+    if ( y0 < 0 )
+      y0 = 0;
+    if ( x1 > bitmap->width )
+      x1 = bitmap->width;
+    if ( y1 > bitmap->rows )
+      y1 = bitmap->rows;
+
+    if ( x0 >= x1 || y0 >= y1 )
+      return 1;
+
+    *ax = x0;
+    *ay = y0;
+    *aw = x1 - x0;
+    *ah = y1 - y0;
+
+    if ( !surface->shadow )
+      return 0;
+
+    if ( !surface->shadow_valid )
+    {
+      memcpy( surface->shadow, bitmap->buffer,
+              (size_t)bitmap->rows * (size_t)bitmap->pitch );
+      surface->shadow_valid = 1;
+
+      return 0;
+    }
+
+    switch ( bitmap->mode )
+    {
+    case gr_pixel_mode_rgb32:
+      bpp = 4;
+      break;
+    case gr_pixel_mode_rgb24:
+      bpp = 3;
+      break;
+    case gr_pixel_mode_rgb565:
+    case gr_pixel_mode_rgb555:
+      bpp = 2;
+      break;
+    default:
+      bpp = 1;
+    }
+
+    /* byte offsets of the damaged area */
+    left   = x1 * bpp;
+    right  = x0 * bpp;
+    top    = y1;
+    bottom = y0;
+
+    for ( y = y0; y < y1; y++ )
+    {
+      unsigned char*  src = bitmap->buffer   + y * bitmap->pitch;
+      unsigned char*  dst = surface->shadow  + y * bitmap->pitch;
+      int             l   = x0 * bpp;
+      int             r   = x1 * bpp;
+
+
+      if ( !memcmp( src + l, dst + l, (size_t)( r - l ) ) )
+        continue;
+
+      while ( src[l] == dst[l] )
+        l++;
+      while ( src[r - 1] == dst[r - 1] )
+        r--;
+
+      memcpy( dst + l, src + l, (size_t)( r - l ) );
+
+      if ( l < left )
+        left = l;
+      if ( r > right )
+        right = r;
+      if ( y < top )
+        top = y;
+      bottom = y + 1;
+    }
+
+    if ( top >= bottom )
+      return 1;
+
+    *ax = left / bpp;
+    *aw = ( right + bpp - 1 ) / bpp - *ax;
+    *ay = top;
+    *ah = bottom - top;
+
+    return 0;
+  }
+
+
+  /* send part of the surface image to the window */
+  static void
+  gr_x11_surface_put( grX11Surface*  surface,
+                      int            x,
+                      int            y,
+                      int            w,
+                      int            h )
+  {
+#ifdef HAVE_XSHM
+    if ( surface->shm )
+    {
+      XShmPutImage( surface->display,
+                    surface->win,
+                    surface->gc,
+                    surface->ximage,
+                    x, y, x, y,
+                    (unsigned int)w, (unsigned int)h,
+                    True );
+      surface->shm_pending++;
+      return;
+    }
+#endif
+
+    XPutImage( surface->display,
+               surface->win,
+               surface->gc,
+               surface->ximage,
+               x, y, x, y,
+               (unsigned int)w, (unsigned int)h );
+  }
+
+
   /* close a given window */
   static void
   gr_x11_surface_done( grSurface*  baseSurface )
@@ -973,13 +1844,7 @@
 
     if ( display )
     {
-      if ( surface->ximage )
-      {
-        if ( !surface->convert )
-          surface->ximage->data = NULL;
-        XDestroyImage( surface->ximage );
-        surface->ximage = NULL;
-      }
+      gr_x11_surface_destroy_image( surface );
 
       if ( surface->win )
       {
@@ -988,6 +1853,9 @@
       }
     }
 
+    free( surface->shadow );
+    surface->shadow = NULL;
+
     grDoneBitmap( &surface->root.bitmap );
   }
 
@@ -999,20 +1867,35 @@
                                int         w,
                                int         h )
   {
-    grX11Surface*  surface = (grX11Surface*)baseSurface;
-    grX11Blitter   blit;
+    grX11Surface*     surface = (grX11Surface*)baseSurface;
+    grX11ConvertFunc  convert = surface->convert;
+    grX11Blitter      blit;
+
 
+    if ( !surface->ximage )
+      return;
+
+    /* only convert and send what has changed since the last time */
+    if ( gr_x11_surface_damage( surface, &x, &y, &w, &h ) )
+      return;
 
-    if ( surface->convert                    &&
-         !gr_x11_blitter_reset( &blit, &surface->root.bitmap, surface->ximage,
-                                x, y, w, h ) )
-      surface->convert( &blit );
+#ifdef HAVE_XSHM
+    if ( surface->shm )
+    {
+      if ( !convert )
+        convert = surface->shm_copy;
 
-    /* without background defined, this only generates Expose event */
-    XClearArea( surface->display, surface->win,
-                x, y,
-                (unsigned)w, (unsigned)h,
-                True );
+      /* do not overwrite pixels the server is still reading */
+      gr_x11_surface_shm_wait( surface );
+    }
+#endif
+
+    if ( convert                                                        &&
+         !gr_x11_blitter_reset( &blit, &surface->root.bitmap,
+                                surface->ximage, x, y, w, h ) )
+      convert( &blit );
+
+    gr_x11_surface_put( surface, x, y, w, h );
   }
 
 
@@ -1111,10 +1994,7 @@
                          int            width,
                          int            height )
   {
-    grBitmap*  bitmap  = &surface->root.bitmap;
-    XImage*    ximage  = surface->ximage;
-    int        pitch;
-    char*      buffer;
+    grBitmap*  bitmap = &surface->root.bitmap;
 
 
     /* resize the bitmap */
@@ -1125,34 +2005,10 @@
                       bitmap ) )
       return 0;
 
-    /* reallocate surface image */
-    pitch  = width * ximage->bits_per_pixel >> 3;
-
-    if ( ximage->bits_per_pixel != ximage->bitmap_pad )
-    {
-      int  over = width * ximage->bits_per_pixel
-                        % ximage->bitmap_pad;
-
-      if ( over )
-        pitch += ( ximage->bitmap_pad - over ) >> 3;
-    }
-
-    if ( surface->convert )
-    {
-      buffer = (char*)realloc( ximage->data, (size_t)height * (size_t)pitch );
-      if ( !buffer && height && pitch )
-        return 0;
-
-      ximage->data = buffer;
-    }
-    else
-      ximage->data = (char*)bitmap->buffer;
-
-    ximage->bytes_per_line = pitch;
-    ximage->width          = width;
-    ximage->height         = height;
+    /* recreate surface image */
+    gr_x11_surface_destroy_image( surface );
 
-    return 1;
+    return gr_x11_surface_create_image( surface );
   }
 
 
@@ -1225,8 +2081,8 @@
         break;
 
       case ConfigureNotify:
-        if ( ( x_event.xconfigure.width  != surface->ximage->width  ||
-               x_event.xconfigure.height != surface->ximage->height )    &&
+        if ( ( x_event.xconfigure.width  != surface->root.bitmap.width ||
+               x_event.xconfigure.height != surface->root.bitmap.rows  ) &&
              gr_x11_surface_resize( surface, x_event.xconfigure.width,
                                              x_event.xconfigure.height ) )
         {
@@ -1256,16 +2112,12 @@
              x_event.xexpose.y + x_event.xexpose.height
                    > exposed.y +         exposed.height )
         {
-          XPutImage( surface->display,
-                     surface->win,
-                     surface->gc,
-                     surface->ximage,
-                     x_event.xexpose.x,
-                     x_event.xexpose.y,
-                     x_event.xexpose.x,
-                     x_event.xexpose.y,
-                     (unsigned int)x_event.xexpose.width,
-                     (unsigned int)x_event.xexpose.height );
+          if ( surface->ximage )
+            gr_x11_surface_put( surface,
+                                x_event.xexpose.x,
+                                x_event.xexpose.y,
+                                x_event.xexpose.width,
+                                x_event.xexpose.height );
 
           exposed = x_event.xexpose;
           LOG(( "painted\n" ));
@@ -1277,6 +2129,14 @@
         break;
 
       /* You should add more cases to handle mouse events, etc. */
+
+      default:
+#ifdef HAVE_XSHM
+        if ( x_event.type == x11dev.shm_completion &&
+             surface->shm_pending > 0              )
+          surface->shm_pending--;
+#endif
+        break;
       }
     }
 
@@ -1348,14 +2208,14 @@
       break;
 
     case gr_pixel_mode_rgb24:
-      surface->convert = x11dev.format->rgb_convert;
+      surface->convert = gr_x11_format_convert( x11dev.format, 0 );
       break;
 
     case gr_pixel_mode_gray:
       /* we only support 256-gray level 8-bit pixmaps */
       if ( bitmap->grays == 256 )
       {
-        surface->convert = x11dev.format->gray_convert;
+        surface->convert = gr_x11_format_convert( x11dev.format, 1 );
         break;
       }
       /* fall through */
@@ -1375,40 +2235,16 @@
 
     surface->root.bitmap = *bitmap;
 
+#ifdef HAVE_XSHM
+    surface->shm_copy = x11dev.format->x_bits_per_pixel == 32
+                          ? gr_x11_convert_copy_32
+                          : gr_x11_convert_copy_16;
+#endif
+
     /* Now create the surface X11 image */
-    surface->ximage = XCreateImage( display,
-                                    surface->visual,
-                                    (unsigned int)x11dev.format->x_depth,
-                                    ZPixmap,
-                                    0,
-                                    NULL,
-                                    (unsigned int)bitmap->width,
-                                    (unsigned int)bitmap->rows,
-                                    x11dev.scanline_pad,
-                                    0 );
-    if ( !surface->ximage )
+    if ( !gr_x11_surface_create_image( surface ) )
       return 0;
 
-    /* Allocate or link surface image data */
-    if ( surface->convert )
-    {
-      surface->ximage->data = (char*)malloc( (size_t)bitmap->rows *
-                              (size_t)surface->ximage->bytes_per_line );
-      if ( !surface->ximage->data )
-        return 0;
-    }
-    else
-    {
-      const int x = 1;
-
-      surface->ximage->byte_order = *(char*)&x ? LSBFirst : MSBFirst;
-      surface->ximage->bitmap_pad = 32;
-      surface->ximage->red_mask   = x11dev.format->x_red_mask;
-      surface->ximage->green_mask = x11dev.format->x_green_mask;
-      surface->ximage->blue_mask  = x11dev.format->x_blue_mask;
-      surface->ximage->data       = (char*)bitmap->buffer;
-    }
-
     {
       int                   screen = DefaultScreen( display );
       XTextProperty         xtp  = { (unsigned char*)"FreeType", 31, 8, 8 };
@@ -1604,4 +2440,138 @@
 #endif /* TEST */
 
 
+#ifdef BENCHMARK
+
+  /*
+   * Micro-benchmark of the pixel converters, without a display:
+   *
+   *   cc -O2 -DBENCHMARK -Igraph -Igraph/x11 graph/x11/grx11.c \
+   *      graph/grobjs.c -lX11
+   *
+   * For each format, the scalar and vectorized converters are timed on
+   * a random RGB24 and gray frame; their outputs must match exactly.
+   */
+
+#include <time.h>
+
+#define BENCH_WIDTH   1917  /* odd, to exercise the line tails */
+#define BENCH_HEIGHT  1080
+#define BENCH_FRAMES  100
+
+
+  static double
+  bench_convert( grX11ConvertFunc  convert,
+                 grBitmap*         source,
+                 XImage*           target )
+  {
+    grX11Blitter  blit;
+    clock_t       start;
+    int           n;
+
+
+    memset( target->data, 0,
+            (size_t)target->height * (size_t)target->bytes_per_line );
+
+    start = clock();
+    for ( n = 0; n < BENCH_FRAMES; n++ )
+    {
+      gr_x11_blitter_reset( &blit, source, target,
+                            0, 0, source->width, source->rows );
+      convert( &blit );
+    }
+
+    /* megapixels per second */
+    return (double)BENCH_FRAMES * source->width * source->rows /
+           ( (double)( clock() - start ) / CLOCKS_PER_SEC ) / 1e6;
+  }
+
+
+  int
+  main( void )
+  {
+    const grX11Format**  pformat;
+    grBitmap             sources[2];
+    XImage               target;
+    char*                data;
+    size_t               size;
+    int                  i, k, errors = 0;
+
+
+#ifdef X11_SIMD
+    __builtin_cpu_init();
+    x11dev.simd = __builtin_cpu_supports( "ssse3" );
+#endif
+
+    memset( sources, 0, sizeof ( sources ) );
+    grNewBitmap( gr_pixel_mode_rgb24, 256,
+                 BENCH_WIDTH, BENCH_HEIGHT, &sources[0] );
+    grNewBitmap( gr_pixel_mode_gray, 256,
+                 BENCH_WIDTH, BENCH_HEIGHT, &sources[1] );
+
+    srand( 0 );
+    for ( k = 0; k < 2; k++ )
+      for ( i = 0; i < sources[k].rows * sources[k].pitch; i++ )
+        sources[k].buffer[i] = (unsigned char)rand();
+
+    memset( &target, 0, sizeof ( target ) );
+    target.width          = BENCH_WIDTH;
+    target.height         = BENCH_HEIGHT;
+    target.bytes_per_line = ( BENCH_WIDTH * 4 + 3 ) & ~3;
+
+    size        = (size_t)BENCH_HEIGHT * (size_t)target.bytes_per_line;
+    target.data = (char*)malloc( size );
+    data        = (char*)malloc( size );
+    if ( !target.data || !data )
+      return 1;
+
+    printf( "%dx%d, %d frames, SIMD %s\n",
+            BENCH_WIDTH, BENCH_HEIGHT, BENCH_FRAMES,
+            x11dev.simd ? "available" : "not available" );
+    printf( "depth/bpp  R:G:B masks               source"
+            "     scalar      SIMD (Mpixel/s)\n" );
+
+    for ( pformat = gr_x11_formats; *pformat; pformat++ )
+    {
+      for ( k = 0; k < 2; k++ )
+      {
+        grX11ConvertFunc  scalar = k ? (*pformat)->gray_convert
+                                     : (*pformat)->rgb_convert;
+        grX11ConvertFunc  fast   = gr_x11_format_convert( *pformat, k );
+
+
+        printf( "%2d/%2d  %08lx:%08lx:%08lx  %-5s  %9.1f",
+                (*pformat)->x_depth, (*pformat)->x_bits_per_pixel,
+                (*pformat)->x_red_mask, (*pformat)->x_green_mask,
+                (*pformat)->x_blue_mask, k ? "gray" : "rgb",
+                bench_convert( scalar, &sources[k], &target ) );
+
+        if ( fast == scalar )
+        {
+          printf( "         -\n" );
+          continue;
+        }
+
+        memcpy( data, target.data, size );
+        printf( " %9.1f", bench_convert( fast, &sources[k], &target ) );
+
+        if ( memcmp( data, target.data, size ) )
+        {
+          printf( "  MISMATCH" );
+          errors++;
+        }
+        printf( "\n" );
+      }
+    }
+
+    free( data );
+    free( target.data );
+    grDoneBitmap( &sources[0] );
+    grDoneBitmap( &sources[1] );
+
+    return errors ? 1 : 0;
+  }
+
+#endif /* BENCHMARK */
+
+
 /* END */
@@ -13,6 +13,16 @@ X11_CFLAGS ?= $(shell $(PKG_CONFIG) --cflags x11)
 X11_LIBS   ?= $(shell $(PKG_CONFIG) --libs x11)
 
 ifneq ($(X11_LIBS),)
+  # The MIT-SHM extension is optional.
+  #
+  XEXT_CFLAGS ?= $(shell $(PKG_CONFIG) --cflags xext)
+  XEXT_LIBS   ?= $(shell $(PKG_CONFIG) --libs xext)
+
+  ifneq ($(XEXT_LIBS),)
+    X11_CFLAGS += $(XEXT_CFLAGS) -DHAVE_XSHM
+    X11_LIBS   += $(XEXT_LIBS)
+  endif
+
   # The GRAPH_LINK variable is expanded each time an executable is linked
   # against the graphics library.
   #
@@ -0,0 +1,285 @@
+/****************************************************************************/
+/*                                                                          */
+/*  The FreeType project -- a free and portable quality TrueType renderer.  */
+/*                                                                          */
+/*  Copyright (C) 2026 by                                                   */
+/*  D. Turner, R.Wilhelm, and W. Lemberg                                    */
+/*                                                                          */
+/*                                                                          */
+/*  acutance.c - horizontal and vertical acutance of 8-bit bitmaps.         */
+/*                                                                          */
+/****************************************************************************/
+
+
+#include "acutance.h"
+
+
+  /* the vertical pass keeps the last derivative of this many columns */
+#define ACUTANCE_STRIP  256
+
+#define ABS( x )  ( (x) < 0 ? -(x) : (x) )
+
+  /* a pixel of a row padded with zeros */
+#define PIXEL( line, j, width )  \
+          ( (j) >= 0 && (j) < (width) ? (int)(line)[j] : 0 )
+
+  /* SSE2 loops are used when the compiler targets SSE2; the scalar */
+  /* loops handle the rest and can be vectorized by the compiler     */
+#if defined( __SSE2__ )                               || \
+    defined( _M_X64 )                                 || \
+    ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#  define  ACUTANCE_SSE2
+#  include <emmintrin.h>
+#endif
+
+
+  static const unsigned char  zeros[ACUTANCE_STRIP];
+
+
+#ifdef ACUTANCE_SSE2
+
+  /* sum of the four 32-bit lanes */
+  static unsigned int
+  acutance_sum_sse2( __m128i  v )
+  {
+    v = _mm_add_epi32( v, _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    v = _mm_add_epi32( v, _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+
+    return (unsigned int)_mm_cvtsi128_si32( v );
+  }
+
+
+  /* absolute values of 16-bit lanes, added pairwise into 32-bit lanes */
+  static __m128i
+  acutance_abs_sse2( __m128i  v )
+  {
+    v = _mm_max_epi16( v, _mm_sub_epi16( _mm_setzero_si128(), v ) );
+
+    return _mm_madd_epi16( v, _mm_set1_epi16( 1 ) );
+  }
+
+
+  /* the inner part of a row, 16 pixels at a time; return where to go on */
+  static int
+  acutance_row_sse2( const unsigned char*  line,
+                     int                   width,
+                     unsigned int*         s1,
+                     unsigned int*         s2 )
+  {
+    const __m128i  zero = _mm_setzero_si128();
+    __m128i        acc1 = zero;
+    __m128i        acc2 = zero;
+    int            j;
+
+
+    for ( j = 2; j + 16 <= width; j += 16 )
+    {
+      __m128i  a = _mm_loadu_si128( (const __m128i*)( line + j - 2 ) );
+      __m128i  b = _mm_loadu_si128( (const __m128i*)( line + j - 1 ) );
+      __m128i  c = _mm_loadu_si128( (const __m128i*)( line + j     ) );
+      __m128i  lo, hi;
+
+
+      /* the sum of absolute byte differences is a single instruction */
+      acc1 = _mm_add_epi32( acc1, _mm_sad_epu8( b, c ) );
+
+      lo = _mm_sub_epi16( _mm_slli_epi16( _mm_unpacklo_epi8( b, zero ), 1 ),
+                          _mm_add_epi16( _mm_unpacklo_epi8( a, zero ),
+                                         _mm_unpacklo_epi8( c, zero ) ) );
+      hi = _mm_sub_epi16( _mm_slli_epi16( _mm_unpackhi_epi8( b, zero ), 1 ),
+                          _mm_add_epi16( _mm_unpackhi_epi8( a, zero ),
+                                         _mm_unpackhi_epi8( c, zero ) ) );
+
+      acc2 = _mm_add_epi32( acc2, acutance_abs_sse2( lo ) );
+      acc2 = _mm_add_epi32( acc2, acutance_abs_sse2( hi ) );
+    }
+
+    *s1 += acutance_sum_sse2( acc1 );
+    *s2 += acutance_sum_sse2( acc2 );
+
+    return j;
+  }
+
+
+  /* the vertical derivatives of a row, 16 columns at a time */
+  static unsigned int
+  acutance_rows_sse2( const unsigned char*  prev,
+                      const unsigned char*  line,
+                      unsigned int          width,
+                      short*                diff,
+                      unsigned int*         s1,
+                      unsigned int*         s2 )
+  {
+    const __m128i  zero = _mm_setzero_si128();
+    __m128i        acc1 = zero;
+    __m128i        acc2 = zero;
+    unsigned int   j;
+
+
+    for ( j = 0; j + 16 <= width; j += 16 )
+    {
+      __m128i  p  = _mm_loadu_si128( (const __m128i*)( prev + j ) );
+      __m128i  c  = _mm_loadu_si128( (const __m128i*)( line + j ) );
+      __m128i  lo = _mm_sub_epi16( _mm_unpacklo_epi8( p, zero ),
+                                   _mm_unpacklo_epi8( c, zero ) );
+      __m128i  hi = _mm_sub_epi16( _mm_unpackhi_epi8( p, zero ),
+                                   _mm_unpackhi_epi8( c, zero ) );
+
+
+      acc1 = _mm_add_epi32( acc1, _mm_sad_epu8( p, c ) );
+
+      acc2 = _mm_add_epi32( acc2, acutance_abs_sse2(
+               _mm_sub_epi16( lo, _mm_loadu_si128(
+                                    (const __m128i*)( diff + j ) ) ) ) );
+      acc2 = _mm_add_epi32( acc2, acutance_abs_sse2(
+               _mm_sub_epi16( hi, _mm_loadu_si128(
+                                    (const __m128i*)( diff + j + 8 ) ) ) ) );
+
+      _mm_storeu_si128( (__m128i*)( diff + j     ), lo );
+      _mm_storeu_si128( (__m128i*)( diff + j + 8 ), hi );
+    }
+
+    *s1 += acutance_sum_sse2( acc1 );
+    *s2 += acutance_sum_sse2( acc2 );
+
+    return j;
+  }
+
+#endif /* ACUTANCE_SSE2 */
+
+
+  void
+  acutance_init( Acutance*  acut )
+  {
+    acut->first[0]  = acut->first[1]  = 0;
+    acut->second[0] = acut->second[1] = 0;
+  }
+
+
+  /* With `b' the row padded by two zeros on both sides, the first */
+  /* derivative at `j' is b[j-1] - b[j] and the second derivative  */
+  /* is 2 * b[j-1] - b[j] - b[j-2], for `j' from 0 to width + 1.   */
+  static void
+  acutance_row( Acutance*             acut,
+                const unsigned char*  line,
+                int                   width )
+  {
+    unsigned int  s1 = 0, s2 = 0;
+    int           a, b, c, d1, d2, j;
+
+
+    j = 2;
+#ifdef ACUTANCE_SSE2
+    j = acutance_row_sse2( line, width, &s1, &s2 );
+#endif
+
+    /* no zeros inside the row; no dependencies between iterations */
+    for ( ; j < width; j++ )
+    {
+      d1 = line[j - 1] - line[j];
+      d2 = 2 * line[j - 1] - line[j] - line[j - 2];
+
+      s1 += (unsigned int)ABS( d1 );
+      s2 += (unsigned int)ABS( d2 );
+    }
+
+    /* the two columns at either end */
+    for ( j = 0; j < width + 2; j = ( j == 1 && width > 2 ) ? width : j + 1 )
+    {
+      a = PIXEL( line, j - 2, width );
+      b = PIXEL( line, j - 1, width );
+      c = PIXEL( line, j,     width );
+
+      d1 = b - c;
+      d2 = 2 * b - c - a;
+
+      s1 += (unsigned int)ABS( d1 );
+      s2 += (unsigned int)ABS( d2 );
+    }
+
+    acut->first[0]  += s1;
+    acut->second[0] += s2;
+  }
+
+
+  /* The columns are processed in strips, row by row, remembering the */
+  /* last first derivative of each column in `diff'.  The bitmap is    */
+  /* padded by a row of zeros above and two rows of zeros below.       */
+  static void
+  acutance_strip( Acutance*             acut,
+                  const unsigned char*  buffer,
+                  unsigned int          width,
+                  unsigned int          rows,
+                  int                   pitch )
+  {
+    short                 diff[ACUTANCE_STRIP] = { 0 };
+    const unsigned char*  prev = zeros;
+    const unsigned char*  line = buffer;
+    unsigned int          i, j;
+    unsigned int          s1, s2;
+    int                   d;
+
+
+    for ( i = 0; i < rows + 2; i++, line += pitch )
+    {
+      if ( i >= rows )
+        line = zeros;
+
+      s1 = s2 = 0;
+      j  = 0;
+
+#ifdef ACUTANCE_SSE2
+      j = acutance_rows_sse2( prev, line, width, diff, &s1, &s2 );
+#endif
+
+      for ( ; j < width; j++ )
+      {
+        d       = prev[j] - line[j];
+        s1     += (unsigned int)ABS( d );
+        s2     += (unsigned int)ABS( d - diff[j] );
+        diff[j] = (short)d;
+      }
+
+      acut->first[1]  += s1;
+      acut->second[1] += s2;
+
+      prev = line;
+    }
+  }
+
+
+  void
+  acutance_add( Acutance*             acut,
+                const unsigned char*  buffer,
+                unsigned int          width,
+                unsigned int          rows,
+                int                   pitch )
+  {
+    unsigned int  i;
+
+
+    /* X-acutance */
+    for ( i = 0; i < rows; i++ )
+      acutance_row( acut, buffer + (long)i * pitch, (int)width );
+
+    /* Y-acutance */
+    for ( i = 0; i < width; i += ACUTANCE_STRIP )
+      acutance_strip( acut, buffer + i,
+                      width - i < ACUTANCE_STRIP ? width - i
+                                                 : ACUTANCE_STRIP,
+                      rows, pitch );
+  }
+
+
+  double
+  acutance_get( const Acutance*  acut,
+                int              dir )
+  {
+    if ( !acut->first[dir] )
+      return -1.0;
+
+    return (double)acut->second[dir] / acut->first[dir];
+  }
+
+
+/* End */
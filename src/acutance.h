@@ -0,0 +1,78 @@
+/****************************************************************************/
+/*                                                                          */
+/*  The FreeType project -- a free and portable quality TrueType renderer.  */
+/*                                                                          */
+/*  Copyright (C) 2026 by                                                   */
+/*  D. Turner, R.Wilhelm, and W. Lemberg                                    */
+/*                                                                          */
+/*                                                                          */
+/*  acutance.h - horizontal and vertical acutance of 8-bit bitmaps.         */
+/*                                                                          */
+/****************************************************************************/
+
+
+#ifndef ACUTANCE_H_
+#define ACUTANCE_H_
+
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+
+  /*
+   * The acutance of a bitmap is the sum of the absolute second
+   * derivatives of its gray levels divided by the sum of the absolute
+   * first derivatives, taken along the rows (X) or the columns (Y) with
+   * the bitmap padded by zeros.  It is equal to 2.0 for bilevel images
+   * and smaller for blurry ones.
+   *
+   * The sums are kept separately so that the acutance of many bitmaps,
+   * e.g., of all glyphs of a font, can be accumulated.
+   */
+  typedef struct  Acutance_
+  {
+    unsigned long  first[2];    /* X and Y sums of first derivatives  */
+    unsigned long  second[2];   /* X and Y sums of second derivatives */
+
+  } Acutance;
+
+
+  /*
+   * Reset all sums to zero.
+   */
+  extern void
+  acutance_init( Acutance*  acut );
+
+
+  /*
+   * Add the derivatives of a bitmap with one byte per pixel whose rows
+   * start at `buffer + i * pitch'.  Both passes read the bitmap row by
+   * row, with loops over whole rows that compilers can vectorize.
+   */
+  extern void
+  acutance_add( Acutance*             acut,
+                const unsigned char*  buffer,
+                unsigned int          width,
+                unsigned int          rows,
+                int                   pitch );
+
+
+  /*
+   * Return the X (`dir' 0) or Y (`dir' 1) acutance, or -1 if nothing
+   * but blank pixels was added.
+   */
+  extern double
+  acutance_get( const Acutance*  acut,
+                int              dir );
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+
+#endif /* ACUTANCE_H_ */
+
+
+/* End */
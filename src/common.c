@@ -1,5 +1,9 @@
 /* some utility functions */
 
+#ifndef  _GNU_SOURCE
+#define  _GNU_SOURCE /* we use `madvise' and `mincore' */
+#endif
+
 #include "common.h"
 
 #include <stdio.h>
@@ -7,6 +11,18 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined( _WIN32 )
+#define FT_MAP_WIN32
+#include <stdint.h>
+#include <windows.h>
+#elif defined( __unix__ ) || defined( __APPLE__ )
+#define FT_MAP_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
   const char*
   ft_basename( const char*  name )
@@ -56,6 +72,173 @@
   }
 
 
+  void*
+  ft_map_file( const char*  path,
+               size_t*      asize )
+  {
+#if defined( FT_MAP_WIN32 )
+
+    HANDLE         file, mapping;
+    LARGE_INTEGER  size;
+    void*          address = NULL;
+
+
+    file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if ( file == INVALID_HANDLE_VALUE )
+      return NULL;
+
+    if ( GetFileSizeEx( file, &size )        &&
+         size.QuadPart > 0                   &&
+         (ULONGLONG)size.QuadPart <= SIZE_MAX )
+    {
+      mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+      if ( mapping )
+      {
+        address = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+        CloseHandle( mapping );
+      }
+    }
+
+    CloseHandle( file );
+
+    if ( address )
+      *asize = (size_t)size.QuadPart;
+
+    return address;
+
+#elif defined( FT_MAP_POSIX )
+
+    struct stat  st;
+    void*        address;
+    int          fd = open( path, O_RDONLY );
+
+
+    if ( fd < 0 )
+      return NULL;
+
+    if ( fstat( fd, &st ) || st.st_size <= 0 )
+    {
+      close( fd );
+      return NULL;
+    }
+
+    address = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if ( address == MAP_FAILED )
+      return NULL;
+
+#ifdef MADV_WILLNEED
+    /* start reading the file in the background */
+    madvise( address, (size_t)st.st_size, MADV_WILLNEED );
+#endif
+
+    *asize = (size_t)st.st_size;
+
+    return address;
+
+#else /* !FT_MAP_WIN32 && !FT_MAP_POSIX */
+
+    FILE*  file = fopen( path, "rb" );
+    long   size;
+    void*  address = NULL;
+
+
+    if ( !file )
+      return NULL;
+
+    if ( !fseek( file, 0, SEEK_END )      &&
+         ( size = ftell( file ) ) > 0     &&
+         !fseek( file, 0, SEEK_SET )      &&
+         ( address = malloc( (size_t)size ) ) != NULL )
+    {
+      if ( fread( address, (size_t)size, 1, file ) )
+        *asize = (size_t)size;
+      else
+      {
+        free( address );
+        address = NULL;
+      }
+    }
+
+    fclose( file );
+
+    return address;
+
+#endif /* !FT_MAP_WIN32 && !FT_MAP_POSIX */
+  }
+
+
+  void
+  ft_unmap_file( void*   address,
+                 size_t  size )
+  {
+#if defined( FT_MAP_WIN32 )
+
+    (void)size;
+    UnmapViewOfFile( address );
+
+#elif defined( FT_MAP_POSIX )
+
+    munmap( address, size );
+
+#else
+
+    (void)size;
+    free( address );
+
+#endif
+  }
+
+
+  size_t
+  ft_resident_bytes( void*   address,
+                     size_t  size )
+  {
+#if defined( FT_MAP_POSIX ) && defined( _SC_PAGESIZE )
+
+    size_t  page = (size_t)sysconf( _SC_PAGESIZE );
+    size_t  num_pages, i, resident = 0;
+    void*   vec;
+
+
+    if ( !page )
+      return size;
+
+    num_pages = ( size + page - 1 ) / page;
+
+    vec = malloc( num_pages );
+    if ( !vec )
+      return size;
+
+    /* the vector is `char*' on some systems, `unsigned char*' on others */
+    if ( mincore( address, size, vec ) )
+      resident = size;
+    else
+    {
+      for ( i = 0; i < num_pages; i++ )
+        if ( ( (unsigned char*)vec )[i] & 1 )
+          resident += page;
+
+      if ( resident > size )
+        resident = size;
+    }
+
+    free( vec );
+
+    return resident;
+
+#else
+
+    (void)address;
+
+    return size;
+
+#endif
+  }
+
+
   void
   Panic( const char*  fmt,
          ... )
@@ -1,6 +1,8 @@
 #ifndef COMMON_H_
 #define COMMON_H_
 
+#include <stddef.h>
+
 
 #ifdef __cplusplus
   extern "C" {
@@ -33,6 +35,29 @@
   extern char*
   ft_strdup( const char*  name );
 
+  /*
+   * Map the file `path' read-only into memory, or read it into a heap
+   * buffer on platforms without memory mapping.  Return NULL on failure,
+   * otherwise the address; `*asize' receives the file size.  Use
+   * `ft_unmap_file' to release the memory.
+   */
+  extern void*
+  ft_map_file( const char*  path,
+               size_t*      asize );
+
+  extern void
+  ft_unmap_file( void*   address,
+                 size_t  size );
+
+  /*
+   * Return the number of bytes of a file returned by `ft_map_file' that
+   * are currently held in memory, or `size' if this cannot be
+   * determined.
+   */
+  extern size_t
+  ft_resident_bytes( void*   address,
+                     size_t  size );
+
 #ifdef __cplusplus
   }
 #endif
@@ -0,0 +1,150 @@
+/****************************************************************************/
+/*                                                                          */
+/*  The FreeType project -- a free and portable quality TrueType renderer.  */
+/*                                                                          */
+/*  Copyright (C) 2026 by                                                   */
+/*  D. Turner, R.Wilhelm, and W. Lemberg                                    */
+/*                                                                          */
+/*                                                                          */
+/*  frametime.c - per-frame timing overlay for the graphical demos.         */
+/*                                                                          */
+/****************************************************************************/
+
+
+#ifndef  _GNU_SOURCE
+#define  _GNU_SOURCE /* we want to use extensions to `time.h' if available */
+#endif
+
+#include "frametime.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>  /* for `_POSIX_TIMERS' */
+#endif
+
+
+#define FRAMETIME_LINE_HEIGHT  12
+
+
+  double
+  frametime_now( void )
+  {
+#if defined _WIN32
+    static double  interval;
+    LARGE_INTEGER  ticks;
+
+
+    if ( !interval )
+    {
+      QueryPerformanceFrequency( &ticks );
+      interval = 1E3 / (double)ticks.QuadPart;
+    }
+
+    QueryPerformanceCounter( &ticks );
+
+    return interval * (double)ticks.QuadPart;
+
+#elif defined _POSIX_TIMERS && _POSIX_TIMERS > 0
+    struct timespec  tv;
+
+
+    /* wall time, including waits for the display */
+#ifdef _POSIX_MONOTONIC_CLOCK
+    clock_gettime( CLOCK_MONOTONIC, &tv );
+#else
+    clock_gettime( CLOCK_REALTIME, &tv );
+#endif /* _POSIX_MONOTONIC_CLOCK */
+
+    return 1E3 * (double)tv.tv_sec + 1E-6 * (double)tv.tv_nsec;
+
+#else
+    return 1E3 * (double)clock() / (double)CLOCKS_PER_SEC;
+#endif
+  }
+
+
+  void
+  frametime_begin( FrameTime*  ft )
+  {
+    if ( !ft->enabled )
+      return;
+
+    memset( ft->phases, 0, sizeof ( ft->phases ) );
+    ft->start = frametime_now();
+  }
+
+
+  double
+  frametime_start( FrameTime*  ft )
+  {
+    return ft->enabled ? frametime_now() : 0.0;
+  }
+
+
+  void
+  frametime_stop( FrameTime*      ft,
+                  FrameTimePhase  phase,
+                  double          start )
+  {
+    if ( ft->enabled )
+      ft->phases[phase] += frametime_now() - start;
+  }
+
+
+  static void
+  frametime_line( grBitmap*    bitmap,
+                  int          line,
+                  const char*  text,
+                  grColor      fore_color,
+                  grColor      back_color )
+  {
+    int  y = bitmap->rows - line * FRAMETIME_LINE_HEIGHT;
+
+
+    /* keep it readable on top of the glyphs */
+    grFillRect( bitmap, 0, y - 2, 8 * (int)strlen( text ) + 4,
+                FRAMETIME_LINE_HEIGHT, back_color );
+    grWriteCellString( bitmap, 2, y, text, fore_color );
+  }
+
+
+  void
+  frametime_draw( FrameTime*   ft,
+                  grBitmap*    bitmap,
+                  grColor      fore_color,
+                  grColor      back_color,
+                  const char*  extra )
+  {
+    char    buf[128];
+    double  total, other;
+
+
+    if ( !ft->enabled )
+      return;
+
+    total = frametime_now() - ft->start;
+    other = total - ft->phases[FRAMETIME_LOAD]
+                  - ft->phases[FRAMETIME_RENDER]
+                  - ft->phases[FRAMETIME_BLIT];
+
+    snprintf( buf, sizeof ( buf ),
+              "frame %.2f ms: load %.2f, render %.2f, blit %.2f, other %.2f",
+              total,
+              ft->phases[FRAMETIME_LOAD],
+              ft->phases[FRAMETIME_RENDER],
+              ft->phases[FRAMETIME_BLIT],
+              other > 0 ? other : 0.0 );
+
+    frametime_line( bitmap, 1, buf, fore_color, back_color );
+
+    if ( extra )
+      frametime_line( bitmap, 2, extra, fore_color, back_color );
+  }
+
+
+/* End */
@@ -0,0 +1,95 @@
+/****************************************************************************/
+/*                                                                          */
+/*  The FreeType project -- a free and portable quality TrueType renderer.  */
+/*                                                                          */
+/*  Copyright (C) 2026 by                                                   */
+/*  D. Turner, R.Wilhelm, and W. Lemberg                                    */
+/*                                                                          */
+/*                                                                          */
+/*  frametime.h - per-frame timing overlay for the graphical demos.         */
+/*                                                                          */
+/****************************************************************************/
+
+
+#ifndef FRAMETIME_H_
+#define FRAMETIME_H_
+
+
+#include "graph.h"
+
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+
+  /* the timed phases of a frame; the rest is reported as `other' */
+  typedef enum  FrameTimePhase_
+  {
+    FRAMETIME_LOAD = 0,  /* glyph loading, including cache lookups */
+    FRAMETIME_RENDER,    /* rasterization                          */
+    FRAMETIME_BLIT,      /* blitting glyph bitmaps to the surface  */
+
+    FRAMETIME_MAX
+
+  } FrameTimePhase;
+
+
+  typedef struct  FrameTime_
+  {
+    int     enabled;                  /* nothing is timed otherwise */
+    double  start;                    /* of the frame, in ms        */
+    double  phases[FRAMETIME_MAX];    /* spent so far, in ms        */
+
+  } FrameTime;
+
+
+  /*
+   * Return a monotonic wall-clock time stamp in milliseconds.
+   */
+  extern double
+  frametime_now( void );
+
+
+  /*
+   * Start timing a new frame.
+   */
+  extern void
+  frametime_begin( FrameTime*  ft );
+
+
+  /*
+   * Bracket a phase: `frametime_start' returns the time stamp to pass to
+   * `frametime_stop', which adds the elapsed time to `phase'.  Both
+   * calls are cheap if timing is disabled.
+   */
+  extern double
+  frametime_start( FrameTime*  ft );
+
+  extern void
+  frametime_stop( FrameTime*      ft,
+                  FrameTimePhase  phase,
+                  double          start );
+
+
+  /*
+   * Write the timings of the current frame to the bottom left corner of
+   * `bitmap', preceded by the `extra' line if not NULL.
+   */
+  extern void
+  frametime_draw( FrameTime*   ft,
+                  grBitmap*    bitmap,
+                  grColor      fore_color,
+                  grColor      back_color,
+                  const char*  extra );
+
+
+#ifdef __cplusplus
+  }
+#endif
+
+
+#endif /* FRAMETIME_H_ */
+
+
+/* End */
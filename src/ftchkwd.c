@@ -14,6 +14,10 @@
 
 #include <ft2build.h>
 #include <freetype/freetype.h>
+#include <freetype/ftadvanc.h>
+
+#include "mlgetopt.h"
+#include "workpool.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -23,13 +27,59 @@
   FT_Error  error;
 
 
+  /* the most frequent advance widths shown for a KO face */
+#define MAX_WIDTHS  8
+
+  /* files are checked in batches of this many per worker */
+#define BATCH_PER_WORKER  16
+
+
+  typedef struct  WidthCount_
+  {
+    FT_Fixed  advance;
+    FT_UInt   count;
+
+  } WidthCount;
+
+
+  /* the result of checking one file, printed in file order */
+  typedef struct  CheckRec_
+  {
+    int         stage;      /* 0 if the face was checked, see below */
+    FT_Error    error;
+
+    char*       family;
+    int         fixed_flag;
+    int         num_proportional;
+
+    int         num_widths; /* distinct advance widths */
+    WidthCount  widths[MAX_WIDTHS];
+
+  } CheckRec;
+
+#define STAGE_UNKNOWN_FORMAT  1   /* reported on stderr */
+#define STAGE_RETRY_UNKNOWN   2   /* after appending `.ttf' */
+#define STAGE_RETRY_ERROR     3
+
+
+  typedef struct  Batch_
+  {
+    char**       fnames;
+    CheckRec*    checks;
+    FT_Library*  libraries;    /* one per worker, created on demand */
+
+  } Batch;
+
+
   static void
   Usage( char*  name )
   {
     printf( "ftchkwd: test fixed font width -- part of the FreeType project\n" );
     printf( "---------------------------------------------------------------------\n" );
     printf( "\n" );
-    printf( "Usage: %s fontname[.ttf|.ttc] [fontname2..]\n", name );
+    printf( "Usage: %s [-j N] fontname[.ttf|.ttc] [fontname2..]\n", name );
+    printf( "\n" );
+    printf( "  -j N      Check the files on N threads (0 for one per CPU).\n" );
     printf( "\n" );
 
     exit( 1 );
@@ -63,50 +113,256 @@
   }
 
 
+  static int
+  compare_advances( const void*  a,
+                    const void*  b )
+  {
+    FT_Fixed  x = *(const FT_Fixed*)a;
+    FT_Fixed  y = *(const FT_Fixed*)b;
+
+
+    return x < y ? -1 : x > y;
+  }
+
+
+  static int
+  compare_counts( const void*  a,
+                  const void*  b )
+  {
+    const WidthCount*  x = (const WidthCount*)a;
+    const WidthCount*  y = (const WidthCount*)b;
+
+
+    if ( x->count != y->count )
+      return x->count > y->count ? -1 : 1;
+
+    return x->advance < y->advance ? -1 : x->advance > y->advance;
+  }
+
+
+  /* Sort `advances' and keep the most frequent widths in `check'. */
   static void
-  check_face( FT_Face      face,
-              const char*  filepathname,
-              int          idx )
+  count_widths( CheckRec*  check,
+                FT_Fixed*  advances,
+                FT_UInt    num_advances )
   {
-    int  face_has_fixed_flag = FT_IS_FIXED_WIDTH(face);
-    int  face_max_advance    = face->max_advance_width;
-    int  num_proportional    = 0;
-    int  n;
+    WidthCount  widths[MAX_WIDTHS + 1];
+    FT_UInt     n, start;
+    int         num = 0;
 
-    FT_UNUSED( idx );
 
+    qsort( advances, num_advances, sizeof ( FT_Fixed ), compare_advances );
+
+    check->num_widths = 0;
+
+    for ( start = 0; start < num_advances; start = n )
+    {
+      for ( n = start + 1;
+            n < num_advances && advances[n] == advances[start];
+            n++ )
+        ;
+
+      /* keep the list sorted; the last entry is dropped if it is full */
+      widths[num].advance = advances[start];
+      widths[num].count   = n - start;
+      qsort( widths, (size_t)num + 1, sizeof ( WidthCount ),
+             compare_counts );
+      if ( num < MAX_WIDTHS )
+        num++;
+
+      check->num_widths++;
+    }
+
+    memcpy( check->widths, widths, (size_t)num * sizeof ( WidthCount ) );
+  }
+
+
+  static void
+  check_face( FT_Face    face,
+              CheckRec*  check )
+  {
+    FT_Fixed*  advances;
+    FT_UInt    num_advances = 0;
+    FT_UInt    n;
+
+
+    check->fixed_flag = FT_IS_FIXED_WIDTH( face );
+
+    /* the face is gone when the result is printed */
+    if ( face->family_name )
+    {
+      size_t  len = strlen( face->family_name ) + 1;
+
+
+      check->family = (char*)malloc( len );
+      if ( check->family )
+        memcpy( check->family, face->family_name, len );
+    }
+
+    advances = (FT_Fixed*)malloc( ( (size_t)face->num_glyphs + 1 ) *
+                                  sizeof ( FT_Fixed ) );
+    if ( !advances )
+      return;
+
+    /* in font units; most drivers just read the `hmtx' table */
+    if ( !FT_Get_Advances( face, 0, (FT_UInt)face->num_glyphs,
+                           FT_LOAD_NO_SCALE, advances ) )
+      num_advances = (FT_UInt)face->num_glyphs;
+    else
+    {
+      /* skip the glyphs that cannot be loaded */
+      for ( n = 0; n < (FT_UInt)face->num_glyphs; n++ )
+        if ( !FT_Get_Advance( face, n, FT_LOAD_NO_SCALE,
+                              &advances[num_advances] ) )
+          num_advances++;
+    }
+
+    for ( n = 0; n < num_advances; n++ )
+      if ( advances[n] != face->max_advance_width )
+        check->num_proportional++;
+
+    /* the histogram is only shown for faces flagged KO */
+    if ( ( check->num_proportional > 0 ) == ( check->fixed_flag != 0 ) )
+      count_widths( check, advances, num_advances );
+
+    free( advances );
+  }
+
+
+  static void
+  check_file( FT_Library   library,
+              const char*  fname,
+              CheckRec*    check )
+  {
+    FT_Face   face;
+    FT_Error  error;
+    char      filename[1024 + 4];
+    int       i;
 
-    printf( "%15s : %20s : ",
-            file_basename( filepathname ),
-            face->family_name ? face->family_name : "UNKNOWN FAMILY" );
 
-    for ( n = 0; n < face->num_glyphs; n++ )
+    /* try to open the file with no extra extension first */
+    error = FT_New_Face( library, fname, 0, &face );
+    if ( !error )
+      goto Success;
+
+    if ( error == FT_Err_Unknown_File_Format )
+    {
+      check->stage = STAGE_UNKNOWN_FORMAT;
+      return;
+    }
+
+    /* Ok, we could not load the file.  Try to add an extension to */
+    /* its name if possible.                                       */
+
+    i = (int)strlen( fname );
+    while ( i > 0 && fname[i] != '\\' && fname[i] != '/' )
+    {
+      if ( fname[i] == '.' )
+        i = 0;
+      i--;
+    }
+
+#ifndef macintosh
+    snprintf( filename, sizeof ( filename ), "%s%s", fname,
+              ( i >= 0 ? ".ttf" : "" ) );
+#else
+    snprintf( filename, sizeof ( filename ), "%s", fname );
+#endif
+
+    /* Load face */
+    error = FT_New_Face( library, filename, 0, &face );
+    if ( error )
+    {
+      check->stage = error == FT_Err_Unknown_File_Format
+                       ? STAGE_RETRY_UNKNOWN
+                       : STAGE_RETRY_ERROR;
+      check->error = error;
+      return;
+    }
+
+  Success:
+    check_face( face, check );
+
+    FT_Done_Face( face );
+  }
+
+
+  static void
+  print_check( const char*  fname,
+               CheckRec*    check )
+  {
+    int  i;
+
+
+    switch ( check->stage )
     {
-      /* load the glyph outline */
-      error = FT_Load_Glyph( face, n, FT_LOAD_NO_SCALE );
-      if ( error )
-        continue;
+    case STAGE_UNKNOWN_FORMAT:
+      fprintf( stderr, "%s: unknown format\n", fname );
+      return;
+
+    case STAGE_RETRY_UNKNOWN:
+      printf( "unknown format\n" );
+      return;
 
-      if ( face->glyph->metrics.horiAdvance != face_max_advance )
-        num_proportional++;
+    case STAGE_RETRY_ERROR:
+      printf( "could not find/open file (error: %d)\n", check->error );
+      return;
     }
 
-    if ( num_proportional > 0 )
+    printf( "%15s : %20s : ",
+            file_basename( fname ),
+            check->family ? check->family : "UNKNOWN FAMILY" );
+
+    if ( check->num_proportional > 0 )
     {
-      if ( face_has_fixed_flag )
+      if ( check->fixed_flag )
         printf( "KO!  Tagged as fixed, but has %d `proportional' glyphs",
-                 num_proportional );
+                 check->num_proportional );
       else
         printf( "OK (proportional)" );
     }
     else
     {
-      if ( face_has_fixed_flag )
+      if ( check->fixed_flag )
         printf( "OK (fixed-width)" );
       else
         printf( "KO!  Tagged as proportional but has fixed width" );
     }
     printf( "\n" );
+
+    if ( check->num_widths )
+    {
+      printf( "%15s   advance widths (%d):", "", check->num_widths );
+      for ( i = 0; i < check->num_widths && i < MAX_WIDTHS; i++ )
+        printf( "%s %ld (%u)", i ? "," : "",
+                check->widths[i].advance, check->widths[i].count );
+      if ( check->num_widths > MAX_WIDTHS )
+        printf( ", ..." );
+      printf( "\n" );
+    }
+  }
+
+
+  /* a job of `workpool_run': check one file of the batch */
+  static void
+  check_job( void*         data,
+             unsigned int  index,
+             unsigned int  worker )
+  {
+    Batch*       batch   = (Batch*)data;
+    FT_Library*  library = &batch->libraries[worker];
+    CheckRec*    check   = &batch->checks[index];
+
+
+    if ( !*library && FT_Init_FreeType( library ) )
+    {
+      *library     = NULL;
+      check->stage = STAGE_RETRY_ERROR;
+      check->error = FT_Err_Out_Of_Memory;
+      return;
+    }
+
+    check_file( *library, batch->fnames[index], check );
   }
 
 
@@ -114,76 +370,75 @@
   main( int     argc,
         char**  argv )
   {
-    FT_Face     face;
-    FT_Library  library;
-
-    int         i, file_index;
-    char        filename[1024 + 4];
-    char*       execname;
-    char*       fname;
+    Batch     batch;
+    char*     execname;
+    int       option;
+    int       num_workers = 1;
+    int       batch_size, file_index, count, i;
 
 
     execname = argv[0];
 
-    if ( argc < 2 )
+    while ( ( option = getopt( argc, argv, "j:" ) ) != -1 )
+    {
+      if ( option != 'j' )
+        Usage( execname );
+
+      num_workers = atoi( optarg );
+      if ( num_workers <= 0 )
+        num_workers = (int)workpool_num_cpus();
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if ( argc < 1 )
       Usage( execname );
 
-    error = FT_Init_FreeType( &library );
+    batch_size = num_workers * BATCH_PER_WORKER;
+
+    batch.checks    = (CheckRec*)malloc( (size_t)batch_size *
+                                         sizeof ( CheckRec ) );
+    batch.libraries = (FT_Library*)calloc( (size_t)num_workers,
+                                           sizeof ( FT_Library ) );
+    if ( !batch.checks || !batch.libraries )
+    {
+      error = FT_Err_Out_Of_Memory;
+      Panic( "Could not allocate memory" );
+    }
+
+    /* the first library is created here to catch errors early */
+    error = FT_Init_FreeType( &batch.libraries[0] );
     if ( error )
       Panic( "Could not create library object" );
 
     /* Now check all files */
-    for ( file_index = 1; file_index < argc; file_index++ )
+    for ( file_index = 0; file_index < argc; file_index += count )
     {
-      fname = argv[file_index];
-
-      /* try to open the file with no extra extension first */
-      error = FT_New_Face( library, fname, 0, &face );
-      if ( !error )
-        goto Success;
-
-      if ( error == FT_Err_Unknown_File_Format )
-      {
-        fprintf( stderr, "%s: unknown format\n", fname );
-        continue;
-      }
-
-      /* Ok, we could not load the file.  Try to add an extension to */
-      /* its name if possible.                                       */
+      count = argc - file_index;
+      if ( count > batch_size )
+        count = batch_size;
 
-      i = strlen( fname );
-      while ( i > 0 && fname[i] != '\\' && fname[i] != '/' )
-      {
-        if ( fname[i] == '.' )
-          i = 0;
-        i--;
-      }
+      batch.fnames = argv + file_index;
+      memset( batch.checks, 0, (size_t)count * sizeof ( CheckRec ) );
 
-#ifndef macintosh
-      snprintf( filename, sizeof ( filename ), "%s%s", fname,
-                ( i >= 0 ? ".ttf" : "" ) );
-#else
-      snprintf( filename, sizeof ( filename ), "%s", fname );
-#endif
+      workpool_run( (unsigned int)num_workers, (unsigned int)count,
+                    check_job, &batch );
 
-      /* Load face */
-      error = FT_New_Face( library, filename, 0, &face );
-      if ( error )
+      for ( i = 0; i < count; i++ )
       {
-        if ( error == FT_Err_Unknown_File_Format )
-          printf( "unknown format\n" );
-        else
-          printf( "could not find/open file (error: %d)\n", error );
-        continue;
+        print_check( batch.fnames[i], &batch.checks[i] );
+        free( batch.checks[i].family );
       }
+    }
 
-  Success:
-      check_face( face, fname, face->face_index );
+    for ( i = 0; i < num_workers; i++ )
+      if ( batch.libraries[i] )
+        FT_Done_FreeType( batch.libraries[i] );
 
-      FT_Done_Face( face );
-    }
+    free( batch.checks );
+    free( batch.libraries );
 
-    FT_Done_FreeType( library );
     exit( 0 );      /* for safety reasons */
 
     return 0;       /* never reached */
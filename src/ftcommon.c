@@ -27,6 +27,7 @@
 
 #include "common.h"
 #include "strbuf.h"
+#include "workpool.h"
 #include "ftcommon.h"
 #include "rsvg-port.h"
 
@@ -34,6 +35,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <limits.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>  /* for the font index */
 
 
 #ifdef _WIN32
@@ -219,6 +224,8 @@
     if ( !display )
       return;
 
+    FTDemo_Display_Print_Wait();
+
     display->bitmap = NULL;
     grDoneSurface( display->surface );
 
@@ -267,15 +274,14 @@
                      FT_Pointer  request_data,
                      FT_Face*    aface )
   {
-    PFont  font = (PFont)face_id;
+    PFont           font   = (PFont)face_id;
+    FTDemo_Handle*  handle = (FTDemo_Handle*)request_data;
 
-    FT_UNUSED( request_data );
 
-
-    if ( font->file_address != NULL )
+    if ( font->file != NULL )
       error = FT_New_Memory_Face( lib,
-                                  (const FT_Byte*)font->file_address,
-                                  (FT_Long)font->file_size,
+                                  (const FT_Byte*)font->file->address,
+                                  (FT_Long)font->file->size,
                                   font->face_index,
                                   aface );
     else
@@ -288,6 +294,8 @@
       const char*  format = FT_Get_Font_Format( *aface );
 
 
+      handle->faces_opened++;
+
       if ( !strcmp( format, "Type 1" ) )
       {
         /* Build the extension file name from the main font file name.
@@ -342,6 +350,106 @@
   }
 
 
+  /* map a font file into memory, without users yet */
+  static PFontFile
+  FTDemo_Font_File_New( const char*  filepath )
+  {
+    PFontFile  file = (PFontFile)malloc( sizeof ( TFontFile ) );
+
+
+    if ( !file )
+      return NULL;
+
+    file->next         = NULL;
+    file->filepathname = ft_strdup( filepath );
+    file->address      = ft_map_file( filepath, &file->size );
+    file->ref_count    = 0;
+
+    if ( !file->filepathname || !file->address )
+    {
+      if ( file->address )
+        ft_unmap_file( file->address, file->size );
+      free( (void*)file->filepathname );
+      free( file );
+      return NULL;
+    }
+
+    return file;
+  }
+
+
+  static void
+  FTDemo_Font_File_Free( PFontFile  file )
+  {
+    ft_unmap_file( file->address, file->size );
+    free( (void*)file->filepathname );
+    free( file );
+  }
+
+
+  /* drop a reference to a font file, releasing it with the last one */
+  static void
+  FTDemo_Font_File_Release( FTDemo_Handle*  handle,
+                            PFontFile       file )
+  {
+    PFontFile*  pfile;
+
+
+    if ( !file || --file->ref_count > 0 )
+      return;
+
+    for ( pfile = &handle->font_files; *pfile; pfile = &(*pfile)->next )
+      if ( *pfile == file )
+      {
+        *pfile = file->next;
+        break;
+      }
+
+    FTDemo_Font_File_Free( file );
+  }
+
+
+  static void
+  FTDemo_File_Info_Free( PFileInfo  info )
+  {
+    if ( !info )
+      return;
+
+    free( (void*)info->filepathname );
+    free( info->faces );
+    free( info );
+  }
+
+
+  static void
+  FTDemo_Font_Index_Done( FTDemo_Handle*  handle )
+  {
+    int  b;
+
+
+    if ( !handle->font_index )
+      return;
+
+    for ( b = 0; b < FONT_INDEX_BUCKETS; b++ )
+    {
+      PFileInfo  info = handle->font_index[b];
+
+
+      while ( info )
+      {
+        PFileInfo  next = info->next;
+
+
+        FTDemo_File_Info_Free( info );
+        info = next;
+      }
+    }
+
+    free( handle->font_index );
+    handle->font_index = NULL;
+  }
+
+
   FTDemo_Handle*
   FTDemo_New( void )
   {
@@ -363,7 +471,8 @@
                            "ot-svg", "svg-hooks", &rsvg_hooks );
 
     error = FTC_Manager_New( handle->library, 0, 0, 0,
-                             my_face_requester, 0, &handle->cache_manager );
+                             my_face_requester, handle,
+                             &handle->cache_manager );
     if ( error )
       PanicZ( "could not initialize cache manager" );
 
@@ -393,11 +502,18 @@
     handle->autohint   = 0;
     handle->lcd_mode   = LCD_MODE_AA;
 
-    handle->use_sbits_cache = 1;
+    handle->use_sbits_cache  = 1;
+    handle->use_plain_render = 1;
+    handle->use_batch_blit   = 1;
+    handle->use_bitmap_cache = 1;
+    handle->subpixel_phases  = 0;
+
+    handle->font_index_path = getenv( "FTDEMO_FONT_INDEX" );
+    if ( handle->font_index_path && !*handle->font_index_path )
+      handle->font_index_path = NULL;
 
     /* string_init */
-    memset( handle->string, 0, sizeof ( TGlyph ) * MAX_GLYPHS );
-    handle->string_length = 0;
+    memset( &handle->string, 0, sizeof ( TGlyphString ) );
 
     return handle;
   }
@@ -412,35 +528,110 @@
     if ( !handle )
       return;
 
+    /* string_done */
+    for ( i = 0; i < handle->string.capacity; i++ )
+    {
+      if ( handle->string.images[i] )
+        FT_Done_Glyph( handle->string.images[i] );
+    }
+
+    free( handle->string.indices );
+    free( handle->string.images );
+    free( handle->string.lsb_deltas );
+    free( handle->string.rsb_deltas );
+    free( handle->string.hadvances );
+    free( handle->string.vvectors );
+    free( handle->string.vadvances );
+
+    FTDemo_Bitmap_Cache_Reset( handle );
+    free( handle->bitmap_cache );
+
+    FT_Stroker_Done( handle->stroker );
+    FT_Bitmap_Done( handle->library, &handle->bitmap );
+    FTC_Manager_Done( handle->cache_manager );
+    FT_Done_FreeType( handle->library );
+
+    /* the faces are gone, so are the users of preloaded files */
     for ( i = 0; i < handle->max_fonts; i++ )
     {
       if ( handle->fonts[i] )
       {
         if ( handle->fonts[i]->filepathname )
           free( (void*)handle->fonts[i]->filepathname );
+        FTDemo_Font_File_Release( handle, handle->fonts[i]->file );
         free( handle->fonts[i] );
       }
     }
     free( handle->fonts );
 
-    /* string_done */
-    for ( i = 0; i < MAX_GLYPHS; i++ )
-    {
-      PGlyph  glyph = handle->string + i;
+    FTDemo_Font_Index_Done( handle );
 
+    free( handle );
 
-      if ( glyph->image )
-        FT_Done_Glyph( glyph->image );
-    }
+    fflush( stdout );  /* clean mintty pipes */
+  }
 
-    FT_Stroker_Done( handle->stroker );
-    FT_Bitmap_Done( handle->library, &handle->bitmap );
-    FTC_Manager_Done( handle->cache_manager );
-    FT_Done_FreeType( handle->library );
 
-    free( handle );
+  void
+  FTDemo_Frame_Time_Begin( FTDemo_Handle*  handle )
+  {
+    grBitmapStats  stats;
 
-    fflush( stdout );  /* clean mintty pipes */
+
+    if ( !handle->frame_time.enabled )
+      return;
+
+    handle->frame_counts[0] = handle->bitmap_cache_hits;
+    handle->frame_counts[1] = handle->bitmap_cache_misses;
+    handle->frame_counts[2] = handle->faces_opened;
+
+    grGetBitmapStats( &stats );
+    handle->frame_counts[3] = stats.requests;
+    handle->frame_counts[4] = stats.kept + stats.reused;
+
+    frametime_begin( &handle->frame_time );
+  }
+
+
+  /* FreeType's cache manager does not count its hits; we show what */
+  /* the string bitmap cache and the face requester know instead    */
+  void
+  FTDemo_Frame_Time_Draw( FTDemo_Handle*   handle,
+                          FTDemo_Display*  display )
+  {
+    char           buf[160];
+    StrBuf         sb[1];
+    unsigned long  hits, misses, faces, requests, reused;
+    grBitmapStats  stats;
+
+
+    if ( !handle->frame_time.enabled )
+      return;
+
+    grGetBitmapStats( &stats );
+
+    hits     = handle->bitmap_cache_hits   - handle->frame_counts[0];
+    misses   = handle->bitmap_cache_misses - handle->frame_counts[1];
+    faces    = handle->faces_opened        - handle->frame_counts[2];
+    requests = stats.requests              - handle->frame_counts[3];
+    reused   = stats.kept + stats.reused   - handle->frame_counts[4];
+
+    strbuf_init( sb, buf, sizeof ( buf ) );
+    strbuf_reset( sb );
+
+    if ( hits + misses )
+      strbuf_format( sb, "string bitmaps: %.1f%% of %lu cached, ",
+                     100.0 * (double)hits / (double)( hits + misses ),
+                     hits + misses );
+
+    strbuf_format( sb, "faces opened: %lu", faces );
+
+    if ( requests )
+      strbuf_format( sb, ", bitmap buffers: %lu of %lu reused",
+                     reused, requests );
+
+    frametime_draw( &handle->frame_time, display->bitmap,
+                    display->fore_color, display->back_color, buf );
   }
 
 
@@ -517,8 +708,8 @@
 
     while ( ( size = grSetIcon( display->surface, picon ) ) )
     {
-      grNewBitmap( gr_pixel_mode_rgb32, 256, size, size, &icon );
-      memset( icon.buffer, 0, (size_t)icon.rows * (size_t)icon.pitch );
+      grNewBitmapEx( gr_pixel_mode_rgb32, 256, size, size,
+                     gr_bitmap_flag_zeroed, &icon );
 
       for ( i = 0; i < FT.n_points; i++ )
       {
@@ -542,212 +733,780 @@
   }
 
 
-  FT_Error
-  FTDemo_Install_Font( FTDemo_Handle*  handle,
-                       const char*     filepath,
-                       FT_Bool         outline_only,
-                       FT_Bool         no_instances )
+  static int
+  get_last_char( FT_Face     face,
+                 FT_CharMap  cmap )
   {
-    long          i, num_faces;
-    FT_Face       face;
+    FT_ULong  res, max, mid, min = 0;
+    FT_UInt   gidx;
 
 
-    /* We use a conservative approach here, at the cost of calling     */
-    /* `FT_New_Face' quite often.  The idea is that our demo programs  */
-    /* should be able to try all faces and named instances of a font,  */
-    /* expecting that some faces don't work for various reasons, e.g., */
-    /* a broken subfont, or an unsupported NFNT bitmap font in a Mac   */
-    /* dfont resource that holds more than a single font.              */
+    switch ( cmap->encoding )
+    {
+    case FT_ENCODING_ADOBE_LATIN_1:
+    case FT_ENCODING_ADOBE_STANDARD:
+    case FT_ENCODING_ADOBE_EXPERT:
+    case FT_ENCODING_ADOBE_CUSTOM:
+    case FT_ENCODING_APPLE_ROMAN:
+      return 0xFF;
 
-    error = FT_New_Face( handle->library, filepath, -1, &face );
-    if ( error )
-      return error;
-    num_faces = face->num_faces;
-    FT_Done_Face( face );
+    case FT_ENCODING_UNICODE:
+      max = 0x110000;
+      break;
 
-    /* allocate new font object(s) */
-    for ( i = 0; i < num_faces; i++ )
-    {
-      PFont  font;
-      long   j, instance_count;
+    /* some fonts use range 0x00-0x100, others have 0xF000-0xF0FF */
+    case FT_ENCODING_MS_SYMBOL:
+    default:
+      max = 0x10000;
+      break;
+    }
 
+    if ( FT_Set_Charmap ( face, cmap ) )
+      return -1;
 
-      error = FT_New_Face( handle->library, filepath, -( i + 1 ), &face );
-      if ( error )
-        continue;
-      instance_count = no_instances ? 0 : face->style_flags >> 16;
-      FT_Done_Face( face );
+    /* binary search for the last charcode */
+    do
+    {
+      mid = ( min + max ) >> 1;
+      res = FT_Get_Next_Char( face, mid, &gidx );
 
-      /* load face with and without named instances */
-      for ( j = 0; j < instance_count + 1; j++ )
+      if ( gidx )
+        min = res;
+      else
       {
-        error = FT_New_Face( handle->library,
-                             filepath,
-                             ( j << 16 ) + i,
-                             &face );
-        if ( error )
-          continue;
+        max = mid;
 
-        if ( outline_only && !FT_IS_SCALABLE( face ) )
+        /* once moved, it helps to advance min through sparse regions */
+        if ( min )
         {
-          FT_Done_Face( face );
-          continue;
+          res = FT_Get_Next_Char( face, min, &gidx );
+
+          if ( gidx )
+            min = res;
+          else
+            max = min;  /* found it */
         }
+      }
+    } while ( max > min );
 
-        font = (PFont)malloc( sizeof ( *font ) );
+    return (int)max;
+  }
 
-        font->filepathname = ft_strdup( filepath );
-        if ( !font->filepathname )
-          return FT_Err_Out_Of_Memory;
 
-        font->face_index = ( j << 16 ) + i;
+  /* the fonts found in one file */
+  typedef struct  TFontProbe_
+  {
+    const char*  filepath;
+    FT_Error     error;
+    PFileInfo    info;          /* scanned, not yet in the font index */
 
-        if ( handle->encoding < (unsigned long)face->num_charmaps )
-          font->cmap_index = handle->encoding;
-        else if ( handle->encoding != FT_ENCODING_ORDER                     &&
-                  !FT_Select_Charmap( face, (FT_Encoding)handle->encoding ) )
-          font->cmap_index = FT_Get_Charmap_Index( face->charmap );
-        else
-          font->cmap_index = face->num_charmaps;  /* FT_ENCODING_ORDER */
+    PFont*       fonts;
+    int          num_fonts;
+    int          max_fonts;
 
-        font->palette_index = 0;
+  } TFontProbe;
 
-        if ( handle->preload )
-        {
-          FILE*   file = fopen( filepath, "rb" );
-          size_t  file_size;
 
+  typedef struct  TFontInstall_
+  {
+    FTDemo_Handle*  handle;
+    FT_Library*     libraries;     /* one per worker thread */
+    TFontProbe*     probes;
+    FT_Bool         outline_only;
+    FT_Bool         no_instances;
 
-          if ( file == NULL )  /* shouldn't happen */
-          {
-            free( (void*)font->filepathname );
-            free( font );
-            return FT_Err_Invalid_Argument;
-          }
+  } TFontInstall;
 
-          fseek( file, 0, SEEK_END );
-          file_size = (size_t)ftell( file );
-          fseek( file, 0, SEEK_SET );
 
-          if ( file_size <= 0 )
-          {
-            free( font );
-            fclose( file );
-            return FT_Err_Invalid_Stream_Operation;
-          }
+  static FT_Error
+  FTDemo_Probe_Add( TFontProbe*  probe,
+                    PFont        font )
+  {
+    if ( probe->num_fonts >= probe->max_fonts )
+    {
+      int     max_fonts = probe->max_fonts ? 2 * probe->max_fonts : 4;
+      PFont*  fonts     = (PFont*)realloc( probe->fonts,
+                                           (size_t)max_fonts *
+                                             sizeof ( PFont ) );
 
-          font->file_address = malloc( file_size );
-          if ( !font->file_address )
-          {
-            free( font );
-            fclose( file );
-            return FT_Err_Out_Of_Memory;
-          }
 
-          if ( !fread( font->file_address, file_size, 1, file ) )
-          {
-            free( font->file_address );
-            free( font );
-            fclose( file );
-            return FT_Err_Invalid_Stream_Read;
-          }
+      if ( !fonts )
+        return FT_Err_Out_Of_Memory;
 
-          font->file_size = file_size;
+      probe->fonts     = fonts;
+      probe->max_fonts = max_fonts;
+    }
 
-          fclose( file );
-        }
-        else
+    probe->fonts[probe->num_fonts++] = font;
+
+    return FT_Err_Ok;
+  }
+
+
+  static PFileInfo
+  FTDemo_File_Info_New( const char*    filepath,
+                        unsigned long  file_size,
+                        long           file_time,
+                        unsigned long  encoding )
+  {
+    PFileInfo  info = (PFileInfo)calloc( 1, sizeof ( TFileInfo ) );
+
+
+    if ( !info )
+      return NULL;
+
+    info->filepathname = ft_strdup( filepath );
+    info->file_size    = file_size;
+    info->file_time    = file_time;
+    info->encoding     = encoding;
+
+    if ( !info->filepathname )
+    {
+      free( info );
+      return NULL;
+    }
+
+    return info;
+  }
+
+
+  static unsigned int
+  FTDemo_Font_Index_Hash( const char*  filepath )
+  {
+    unsigned int  hash = 2166136261U;
+
+
+    while ( *filepath )
+      hash = ( hash ^ (unsigned char)*filepath++ ) * 16777619U;
+
+    return hash % FONT_INDEX_BUCKETS;
+  }
+
+
+  /* The index is only read while the worker threads run, and */
+  /* only changed by the main thread in between.              */
+  static PFileInfo
+  FTDemo_Font_Index_Find( FTDemo_Handle*  handle,
+                          const char*     filepath )
+  {
+    PFileInfo  info;
+
+
+    info = handle->font_index[FTDemo_Font_Index_Hash( filepath )];
+    for ( ; info; info = info->next )
+      if ( !strcmp( info->filepathname, filepath ) )
+        break;
+
+    return info;
+  }
+
+
+  /* replace the entry of the same file, if any; appending keeps */
+  /* the order of the index file stable                          */
+  static void
+  FTDemo_Font_Index_Insert( FTDemo_Handle*  handle,
+                            PFileInfo       info )
+  {
+    PFileInfo*  pinfo;
+
+
+    pinfo = handle->font_index + FTDemo_Font_Index_Hash( info->filepathname );
+
+    while ( *pinfo )
+    {
+      PFileInfo  cur = *pinfo;
+
+
+      if ( !strcmp( cur->filepathname, info->filepathname ) )
+      {
+        *pinfo = cur->next;
+        FTDemo_File_Info_Free( cur );
+      }
+      else
+        pinfo = &cur->next;
+    }
+
+    info->next = NULL;
+    *pinfo     = info;
+
+    handle->font_index_dirty = 1;
+  }
+
+
+  static void
+  FTDemo_Font_Index_Header( FTDemo_Handle*  handle,
+                            char*           buf,
+                            size_t          size )
+  {
+    FT_Int  major, minor, patch;
+
+
+    FT_Library_Version( handle->library, &major, &minor, &patch );
+
+    snprintf( buf, size, "FTDEMO-FONT-INDEX 1 FreeType %d.%d.%d\n",
+              major, minor, patch );
+  }
+
+
+  /* The index is a text file with a header line, and for each font    */
+  /* file a line                                                       */
+  /*                                                                   */
+  /*   size mtime encoding error num_faces path                        */
+  /*                                                                   */
+  /* followed by `num_faces' lines                                     */
+  /*                                                                   */
+  /*   valid scalable num_instances cmap_index num_indices             */
+  /*                                                                   */
+  /* A missing or damaged index (or one written by another FreeType    */
+  /* version) is silently rebuilt.                                     */
+  static void
+  FTDemo_Font_Index_Load( FTDemo_Handle*  handle )
+  {
+    FILE*  f;
+    char   header[64];
+    char   line[4096];
+
+
+    handle->font_index = (PFileInfo*)calloc( FONT_INDEX_BUCKETS,
+                                             sizeof ( PFileInfo ) );
+    if ( !handle->font_index )
+      PanicZ( "could not allocate the font index" );
+
+    f = fopen( handle->font_index_path, "r" );
+    if ( !f )
+      return;
+
+    FTDemo_Font_Index_Header( handle, header, sizeof ( header ) );
+
+    if ( !fgets( line, sizeof ( line ), f ) || strcmp( line, header ) )
+      goto Exit;
+
+    while ( fgets( line, sizeof ( line ), f ) )
+    {
+      PFileInfo      info;
+      unsigned long  file_size, encoding;
+      long           file_time, num_faces, i;
+      int            err, pos = 0;
+      size_t         len = strlen( line );
+
+
+      if ( len == 0 || line[len - 1] != '\n' )
+        break;
+      line[len - 1] = '\0';
+
+      if ( sscanf( line, "%lu %ld %lu %d %ld %n",
+                   &file_size, &file_time, &encoding,
+                   &err, &num_faces, &pos ) < 5 ||
+           !pos || num_faces < 0 || num_faces > 0xFFFF )
+        break;
+
+      info = FTDemo_File_Info_New( line + pos,
+                                   file_size, file_time, encoding );
+      if ( !info )
+        break;
+
+      info->error     = err;
+      info->num_faces = num_faces;
+      info->faces     = (TFaceInfo*)calloc( (size_t)num_faces + 1,
+                                            sizeof ( TFaceInfo ) );
+
+      for ( i = 0; info->faces && i < num_faces; i++ )
+      {
+        TFaceInfo*  fi = info->faces + i;
+
+
+        if ( !fgets( line, sizeof ( line ), f )               ||
+             sscanf( line, "%d %d %ld %d %d",
+                     &fi->valid, &fi->scalable, &fi->num_instances,
+                     &fi->cmap_index, &fi->num_indices ) != 5 )
+          break;
+      }
+
+      if ( !info->faces || i < num_faces )
+      {
+        FTDemo_File_Info_Free( info );
+        break;
+      }
+
+      FTDemo_Font_Index_Insert( handle, info );
+    }
+
+  Exit:
+    fclose( f );
+
+    /* the file only needs to be written if something new gets added */
+    handle->font_index_dirty = 0;
+  }
+
+
+  /* write to a temporary file first so that readers never see */
+  /* a partial index                                           */
+  static void
+  FTDemo_Font_Index_Save( FTDemo_Handle*  handle )
+  {
+    char*  tmppath;
+    FILE*  f;
+    char   header[64];
+    int    b;
+
+
+    tmppath = (char*)malloc( strlen( handle->font_index_path ) + 5 );
+    if ( !tmppath )
+      return;
+
+    sprintf( tmppath, "%s.tmp", handle->font_index_path );
+
+    f = fopen( tmppath, "w" );
+    if ( !f )
+    {
+      free( tmppath );
+      return;
+    }
+
+    FTDemo_Font_Index_Header( handle, header, sizeof ( header ) );
+    fputs( header, f );
+
+    for ( b = 0; b < FONT_INDEX_BUCKETS; b++ )
+    {
+      PFileInfo  info;
+
+
+      for ( info = handle->font_index[b]; info; info = info->next )
+      {
+        FT_Long  i;
+
+
+        fprintf( f, "%lu %ld %lu %d %ld %s\n",
+                 info->file_size, info->file_time, info->encoding,
+                 info->error, info->num_faces, info->filepathname );
+
+        for ( i = 0; i < info->num_faces; i++ )
         {
-          font->file_address = NULL;
-          font->file_size    = 0;
+          TFaceInfo*  fi = info->faces + i;
+
+
+          fprintf( f, "%d %d %ld %d %d\n",
+                   fi->valid, fi->scalable, fi->num_instances,
+                   fi->cmap_index, fi->num_indices );
         }
+      }
+    }
 
+    if ( fclose( f ) )
+      remove( tmppath );
+    else
+    {
+#ifdef _WIN32
+      remove( handle->font_index_path );  /* `rename' does not replace */
+#endif
+      if ( !rename( tmppath, handle->font_index_path ) )
+        handle->font_index_dirty = 0;
+    }
+
+    free( tmppath );
+  }
+
+
+  static FT_Error
+  FTDemo_Probe_Open( FT_Library   library,
+                     const char*  filepath,
+                     PFontFile    file,
+                     FT_Long      face_index,
+                     FT_Face     *aface )
+  {
+    if ( file )
+      return FT_New_Memory_Face( library,
+                                 (const FT_Byte*)file->address,
+                                 (FT_Long)file->size,
+                                 face_index,
+                                 aface );
+    else
+      return FT_New_Face( library, filepath, face_index, aface );
+  }
+
+
+  /* We use a conservative approach here, trying all faces of a font   */
+  /* since some of them might not work for various reasons, e.g., a    */
+  /* broken subfont, or an unsupported NFNT bitmap font in a Mac dfont */
+  /* resource that holds more than a single font.  Each face is opened */
+  /* once; its named instances are only checked when selected.         */
+  /*                                                                   */
+  /* The number of character indices is only counted for the font      */
+  /* index; otherwise it is done when a font gets selected.            */
+  static FT_Error
+  FTDemo_Probe_Scan( FTDemo_Handle*  handle,
+                     FT_Library      library,
+                     PFontFile       file,
+                     PFileInfo       info )
+  {
+    FT_Face   face = NULL;
+    FT_Long   i, num_faces;
+    FT_Error  err;
+
+
+    err = FTDemo_Probe_Open( library, info->filepathname, file, 0, &face );
+    if ( err )
+    {
+      /* the first face also tells whether we know the format at all */
+      err = FTDemo_Probe_Open( library, info->filepathname, file, -1,
+                               &face );
+      if ( err )
+        return err;
+
+      num_faces = face->num_faces;
+      FT_Done_Face( face );
+      face = NULL;
+    }
+    else
+      num_faces = face->num_faces;
+
+    info->faces = (TFaceInfo*)calloc( (size_t)num_faces + 1,
+                                      sizeof ( TFaceInfo ) );
+    if ( !info->faces )
+    {
+      if ( face )
         FT_Done_Face( face );
+      return FT_Err_Out_Of_Memory;
+    }
+    info->num_faces = num_faces;
+
+    for ( i = 0; i < num_faces; i++ )
+    {
+      TFaceInfo*     fi       = info->faces + i;
+      unsigned long  encoding = info->encoding;
+
+
+      if ( i > 0                                                        &&
+           FTDemo_Probe_Open( library, info->filepathname, file, i,
+                              &face )                                   )
         face = NULL;
 
-        if ( handle->max_fonts == 0 )
+      if ( !face )
+        continue;
+
+      fi->valid         = 1;
+      fi->scalable      = FT_IS_SCALABLE( face ) != 0;
+      fi->num_instances = face->style_flags >> 16;
+
+      if ( encoding < (unsigned long)face->num_charmaps )
+        fi->cmap_index = (int)encoding;
+      else if ( encoding != FT_ENCODING_ORDER                     &&
+                !FT_Select_Charmap( face, (FT_Encoding)encoding ) )
+        fi->cmap_index = FT_Get_Charmap_Index( face->charmap );
+      else
+        fi->cmap_index = face->num_charmaps;  /* FT_ENCODING_ORDER */
+
+      if ( handle->font_index_path           &&
+           fi->cmap_index < face->num_charmaps )
+        fi->num_indices =
+          get_last_char( face, face->charmaps[fi->cmap_index] ) + 1;
+
+      FT_Done_Face( face );
+      face = NULL;
+    }
+
+    return FT_Err_Ok;
+  }
+
+
+  /* This runs on a worker thread with its own library object, so it */
+  /* must not touch the global `error' variable.                     */
+  static void
+  FTDemo_Probe_Font( void*         data,
+                     unsigned int  index,
+                     unsigned int  worker )
+  {
+    TFontInstall*   install = (TFontInstall*)data;
+    TFontProbe*     probe   = install->probes + index;
+    FTDemo_Handle*  handle  = install->handle;
+    FT_Library      library = install->libraries[worker];
+
+    PFontFile      file = NULL;
+    PFileInfo      info = NULL;
+    unsigned long  file_size = 0;
+    long           file_time = 0;
+    FT_Bool        indexed   = 0;
+    FT_Long        i, j, instance_count;
+    FT_Error       err;
+
+
+    if ( handle->font_index )
+    {
+      struct stat  st;
+
+
+      /* a stale entry is replaced by the main thread later on */
+      if ( !stat( probe->filepath, &st ) )
+      {
+        file_size = (unsigned long)st.st_size;
+        file_time = (long)st.st_mtime;
+        indexed   = 1;
+
+        info = FTDemo_Font_Index_Find( handle, probe->filepath );
+        if ( info                                &&
+             ( info->file_size != file_size    ||
+               info->file_time != file_time    ||
+               info->encoding  != handle->encoding ) )
+          info = NULL;
+      }
+    }
+
+    if ( handle->preload && !( info && info->error ) )
+    {
+      file = FTDemo_Font_File_New( probe->filepath );
+      if ( !file )
+      {
+        err = FT_Err_Cannot_Open_Resource;
+        goto Exit;
+      }
+    }
+
+    if ( !info )
+    {
+      info = FTDemo_File_Info_New( probe->filepath,
+                                   file_size, file_time,
+                                   handle->encoding );
+      if ( !info )
+      {
+        err = FT_Err_Out_Of_Memory;
+        goto Exit;
+      }
+
+      info->error = FTDemo_Probe_Scan( handle, library, file, info );
+      probe->info = info;
+    }
+
+    err = info->error;
+    if ( err )
+      goto Exit;
+
+    for ( i = 0; i < info->num_faces; i++ )
+    {
+      TFaceInfo*  fi = info->faces + i;
+
+
+      if ( !fi->valid )
+        continue;
+
+      instance_count = install->no_instances ? 0 : fi->num_instances;
+
+      if ( install->outline_only && !fi->scalable )
+        instance_count = -1;
+
+      /* add face with and without named instances */
+      for ( j = 0; j < instance_count + 1; j++ )
+      {
+        PFont  font = (PFont)malloc( sizeof ( *font ) );
+
+
+        if ( !font )
         {
-          handle->max_fonts = 16;
-          handle->fonts     = (PFont*)calloc( (size_t)handle->max_fonts,
-                                              sizeof ( PFont ) );
+          err = FT_Err_Out_Of_Memory;
+          goto Exit;
         }
-        else if ( handle->num_fonts >= handle->max_fonts )
+
+        font->filepathname = ft_strdup( probe->filepath );
+        if ( !font->filepathname )
+        {
+          free( font );
+          err = FT_Err_Out_Of_Memory;
+          goto Exit;
+        }
+
+        font->face_index    = (int)( ( j << 16 ) + i );
+        font->cmap_index    = fi->cmap_index;
+        font->palette_index = 0;
+        font->num_indices   = fi->num_indices;
+        font->indices_cmap  = fi->num_indices ? fi->cmap_index : -1;
+        font->file          = NULL;
+
+        err = FTDemo_Probe_Add( probe, font );
+        if ( err )
         {
-          handle->max_fonts *= 2;
-          handle->fonts      = (PFont*)realloc( handle->fonts,
-                                                (size_t)handle->max_fonts *
-                                                  sizeof ( PFont ) );
-
-          memset( &handle->fonts[handle->num_fonts], 0,
-                  (size_t)( handle->max_fonts - handle->num_fonts ) *
-                    sizeof ( PFont ) );
+          free( (void*)font->filepathname );
+          free( font );
+          goto Exit;
         }
 
-        handle->fonts[handle->num_fonts++] = font;
+        if ( file )
+        {
+          font->file = file;
+          file->ref_count++;
+        }
       }
     }
 
-    return FT_Err_Ok;
+    err = FT_Err_Ok;
+
+  Exit:
+    /* the preloaded file is shared by all fonts of this file */
+    if ( file && !file->ref_count )
+      FTDemo_Font_File_Free( file );
+
+    /* don't remember files that could not be examined */
+    if ( probe->info                                           &&
+         ( !indexed                                          ||
+           probe->info->error == FT_Err_Out_Of_Memory        ||
+           probe->info->error == FT_Err_Cannot_Open_Resource ) )
+    {
+      FTDemo_File_Info_Free( probe->info );
+      probe->info = NULL;
+    }
+
+    probe->error = err;
   }
 
 
-  static int
-  get_last_char( FT_Face     face,
-                 FT_CharMap  cmap )
+  static void
+  FTDemo_Add_Font( FTDemo_Handle*  handle,
+                   PFont           font )
   {
-    FT_ULong  res, max, mid, min = 0;
-    FT_UInt   gidx;
+    if ( handle->max_fonts == 0 )
+    {
+      handle->max_fonts = 16;
+      handle->fonts     = (PFont*)calloc( (size_t)handle->max_fonts,
+                                          sizeof ( PFont ) );
+    }
+    else if ( handle->num_fonts >= handle->max_fonts )
+    {
+      handle->max_fonts *= 2;
+      handle->fonts      = (PFont*)realloc( handle->fonts,
+                                            (size_t)handle->max_fonts *
+                                              sizeof ( PFont ) );
 
+      memset( &handle->fonts[handle->num_fonts], 0,
+              (size_t)( handle->max_fonts - handle->num_fonts ) *
+                sizeof ( PFont ) );
+    }
 
-    switch ( cmap->encoding )
-    {
-    case FT_ENCODING_ADOBE_LATIN_1:
-    case FT_ENCODING_ADOBE_STANDARD:
-    case FT_ENCODING_ADOBE_EXPERT:
-    case FT_ENCODING_ADOBE_CUSTOM:
-    case FT_ENCODING_APPLE_ROMAN:
-      return 0xFF;
+    handle->fonts[handle->num_fonts++] = font;
+  }
 
-    case FT_ENCODING_UNICODE:
-      max = 0x110000;
-      break;
 
-    /* some fonts use range 0x00-0x100, others have 0xF000-0xF0FF */
-    case FT_ENCODING_MS_SYMBOL:
-    default:
-      max = 0x10000;
-      break;
+  FT_Error
+  FTDemo_Install_Fonts( FTDemo_Handle*  handle,
+                        int             num_files,
+                        char**          filepaths,
+                        FT_Bool         outline_only,
+                        FT_Bool         no_instances,
+                        FT_Error*       errors )
+  {
+    TFontInstall  install;
+    unsigned int  num_workers, n;
+    int           i, k;
+
+
+    if ( num_files <= 0 )
+      return FT_Err_Ok;
+
+    if ( handle->font_index_path && !handle->font_index )
+      FTDemo_Font_Index_Load( handle );
+
+    install.handle       = handle;
+    install.outline_only = outline_only;
+    install.no_instances = no_instances;
+
+    install.probes = (TFontProbe*)calloc( (size_t)num_files,
+                                          sizeof ( TFontProbe ) );
+    if ( !install.probes )
+      return FT_Err_Out_Of_Memory;
+
+    for ( i = 0; i < num_files; i++ )
+      install.probes[i].filepath = filepaths[i];
+
+    /* FreeType library objects must not be shared between threads */
+    num_workers = workpool_num_cpus();
+    if ( num_workers > (unsigned int)num_files )
+      num_workers = (unsigned int)num_files;
+
+    install.libraries = (FT_Library*)calloc( num_workers,
+                                             sizeof ( FT_Library ) );
+    if ( !install.libraries )
+    {
+      free( install.probes );
+      return FT_Err_Out_Of_Memory;
     }
 
-    if ( FT_Set_Charmap ( face, cmap ) )
-      return -1;
+    install.libraries[0] = handle->library;
+    for ( n = 1; n < num_workers; n++ )
+      if ( FT_Init_FreeType( &install.libraries[n] ) )
+        break;
+    num_workers = n;
 
-    /* binary search for the last charcode */
-    do
+    workpool_run( num_workers, (unsigned int)num_files,
+                  FTDemo_Probe_Font, &install );
+
+    for ( n = 1; n < num_workers; n++ )
+      FT_Done_FreeType( install.libraries[n] );
+    free( install.libraries );
+
+    /* install in the order of the file list */
+    for ( i = 0; i < num_files; i++ )
     {
-      mid = ( min + max ) >> 1;
-      res = FT_Get_Next_Char( face, mid, &gidx );
+      TFontProbe*  probe = install.probes + i;
+      PFontFile    file  = probe->num_fonts ? probe->fonts[0]->file : NULL;
 
-      if ( gidx )
-        min = res;
-      else
+
+      if ( file )
       {
-        max = mid;
+        PFontFile  cur;
 
-        /* once moved, it helps to advance min through sparse regions */
-        if ( min )
+
+        /* share a file installed before */
+        for ( cur = handle->font_files; cur; cur = cur->next )
+          if ( !strcmp( cur->filepathname, file->filepathname ) &&
+               cur->size == file->size                          )
+            break;
+
+        if ( cur )
         {
-          res = FT_Get_Next_Char( face, min, &gidx );
+          for ( k = 0; k < probe->num_fonts; k++ )
+            probe->fonts[k]->file = cur;
 
-          if ( gidx )
-            min = res;
-          else
-            max = min;  /* found it */
+          cur->ref_count += file->ref_count;
+          FTDemo_Font_File_Free( file );
+        }
+        else
+        {
+          file->next         = handle->font_files;
+          handle->font_files = file;
         }
       }
-    } while ( max > min );
 
-    return (int)max;
+      for ( k = 0; k < probe->num_fonts; k++ )
+        FTDemo_Add_Font( handle, probe->fonts[k] );
+
+      if ( errors )
+        errors[i] = probe->error;
+
+      if ( probe->info )
+        FTDemo_Font_Index_Insert( handle, probe->info );
+
+      free( probe->fonts );
+    }
+
+    free( install.probes );
+
+    if ( handle->font_index_dirty )
+      FTDemo_Font_Index_Save( handle );
+
+    return FT_Err_Ok;
+  }
+
+
+  FT_Error
+  FTDemo_Install_Font( FTDemo_Handle*  handle,
+                       const char*     filepath,
+                       FT_Bool         outline_only,
+                       FT_Bool         no_instances )
+  {
+    FT_Error  err;
+
+
+    error = FTDemo_Install_Fonts( handle, 1, (char**)&filepath,
+                                  outline_only, no_instances, &err );
+
+    return error ? error : err;
   }
 
 
@@ -762,18 +1521,32 @@
     handle->current_font   = font;
     handle->scaler.face_id = (FTC_FaceID)font;
 
+    /* named instances are not checked before they get selected */
     error = FTC_Manager_LookupFace( handle->cache_manager,
                                     handle->scaler.face_id, &face );
+    if ( error )
+    {
+      font->num_indices  = 0;
+      font->indices_cmap = -1;
+      handle->encoding   = FT_ENCODING_ORDER;
+      return;
+    }
 
     if ( index < face->num_charmaps )
     {
-      font->num_indices = get_last_char( face, face->charmaps[index] ) + 1;
-      handle->encoding  = face->charmaps[index]->encoding;
+      /* the font index may have counted them already */
+      if ( font->indices_cmap != index || font->num_indices <= 0 )
+      {
+        font->num_indices  = get_last_char( face, face->charmaps[index] ) + 1;
+        font->indices_cmap = index;
+      }
+      handle->encoding = face->charmaps[index]->encoding;
     }
     else
     {
-      font->num_indices = face->num_glyphs;
-      handle->encoding  = FT_ENCODING_ORDER;
+      font->num_indices  = face->num_glyphs;
+      font->indices_cmap = -1;
+      handle->encoding   = FT_ENCODING_ORDER;
     }
   }
 
@@ -871,6 +1644,29 @@
   }
 
 
+  int
+  FTDemo_Get_Preload_Size( FTDemo_Handle*  handle,
+                           size_t*         mapped,
+                           size_t*         resident )
+  {
+    PFontFile  file;
+    int        count = 0;
+
+
+    *mapped   = 0;
+    *resident = 0;
+
+    for ( file = handle->font_files; file; file = file->next )
+    {
+      *mapped   += file->size;
+      *resident += ft_resident_bytes( file->address, file->size );
+      count++;
+    }
+
+    return count;
+  }
+
+
   void
   FTDemo_Update_Current_Flags( FTDemo_Handle*  handle )
   {
@@ -931,6 +1727,8 @@
     }
 
     handle->load_flags = flags;
+
+    FTDemo_Bitmap_Cache_Reset( handle );
   }
 
 
@@ -1039,6 +1837,7 @@
     /* lazy to walk over all loaded fonts to check whether they */
     /* are of appropriate type, then unloading them explicitly. */
     FTC_Manager_Reset( handle->cache_manager );
+    FTDemo_Bitmap_Cache_Reset( handle );
 
     return 1;
   }
@@ -1359,6 +2158,7 @@
          glyf->format == FT_GLYPH_FORMAT_SVG     )
     {
       FT_Render_Mode  render_mode;
+      double          t;
 
 
       switch ( handle->lcd_mode )
@@ -1387,7 +2187,9 @@
       }
 
       /* render the glyph to a bitmap, don't destroy original */
+      t     = frametime_start( &handle->frame_time );
       error = FT_Glyph_To_Bitmap( &glyf, render_mode, NULL, 0 );
+      frametime_stop( &handle->frame_time, FRAMETIME_RENDER, t );
       if ( error )
         return error;
 
@@ -1493,12 +2295,17 @@
       FT_Bitmap  source;
 
 
+      double     t = frametime_start( &handle->frame_time );
+
+
+      /* this also renders the bitmaps not cached yet */
       error = FTC_SBitCache_LookupScaler( handle->sbits_cache,
                                           &handle->scaler,
                                           (FT_ULong)handle->load_flags,
                                           Index,
                                           &sbit,
                                           NULL );
+      frametime_stop( &handle->frame_time, FRAMETIME_LOAD, t );
       if ( error )
         goto Exit;
 
@@ -1570,6 +2377,7 @@
     /* them on demand. we can thus support very large sizes easily..     */
     {
       FT_Glyph  glyf;
+      double    t = frametime_start( &handle->frame_time );
 
 
       error = FTC_ImageCache_LookupScaler( handle->image_cache,
@@ -1578,6 +2386,7 @@
                                            Index,
                                            &glyf,
                                            NULL );
+      frametime_stop( &handle->frame_time, FRAMETIME_LOAD, t );
 
       if ( !error )
         error = FTDemo_Glyph_To_Bitmap( handle, glyf, target, left, top,
@@ -1603,6 +2412,7 @@
     int       left, top, x_advance, y_advance;
     grBitmap  bit3;
     FT_Glyph  glyf;
+    double    t;
 
 
     error = FTDemo_Index_To_Bitmap( handle,
@@ -1615,8 +2425,10 @@
       return error;
 
     /* now render the bitmap into the display surface */
+    t = frametime_start( &handle->frame_time );
     grBlitGlyphToSurface( display->surface, &bit3, *pen_x + left,
                           *pen_y - top, display->fore_color );
+    frametime_stop( &handle->frame_time, FRAMETIME_BLIT, t );
 
     if ( glyf )
       FT_Done_Glyph( glyf );
@@ -1638,6 +2450,7 @@
     int       left, top, x_advance, y_advance;
     grBitmap  bit3;
     FT_Glyph  glyf;
+    double    t;
 
 
     error = FTDemo_Glyph_To_Bitmap( handle, glyph, &bit3, &left, &top,
@@ -1650,8 +2463,10 @@
     }
 
     /* now render the bitmap into the display surface */
+    t = frametime_start( &handle->frame_time );
     grBlitGlyphToSurface( display->surface, &bit3, *pen_x + left,
                           *pen_y - top, color );
+    frametime_stop( &handle->frame_time, FRAMETIME_BLIT, t );
 
     if ( glyf )
       FT_Done_Glyph( glyf );
@@ -1697,26 +2512,63 @@
   }
 
 
+  /* make room for `capacity' glyphs; new images are NULL */
+  static void
+  FTDemo_String_Grow( TGlyphString*  string,
+                      int            capacity )
+  {
+    size_t  n = (size_t)capacity;
+
+
+    if ( capacity <= string->capacity )
+      return;
+
+    string->indices    = (FT_UInt*)realloc( string->indices,
+                                            n * sizeof ( FT_UInt ) );
+    string->images     = (FT_Glyph*)realloc( string->images,
+                                             n * sizeof ( FT_Glyph ) );
+    string->lsb_deltas = (FT_Pos*)realloc( string->lsb_deltas,
+                                           n * sizeof ( FT_Pos ) );
+    string->rsb_deltas = (FT_Pos*)realloc( string->rsb_deltas,
+                                           n * sizeof ( FT_Pos ) );
+    string->hadvances  = (FT_Vector*)realloc( string->hadvances,
+                                              n * sizeof ( FT_Vector ) );
+    string->vvectors   = (FT_Vector*)realloc( string->vvectors,
+                                              n * sizeof ( FT_Vector ) );
+    string->vadvances  = (FT_Vector*)realloc( string->vadvances,
+                                              n * sizeof ( FT_Vector ) );
+
+    if ( !string->indices    || !string->images    ||
+         !string->lsb_deltas || !string->rsb_deltas ||
+         !string->hadvances  || !string->vvectors   ||
+         !string->vadvances  )
+      PanicZ( "not enough memory for the string" );
+
+    memset( string->images + string->capacity, 0,
+            (size_t)( capacity - string->capacity ) * sizeof ( FT_Glyph ) );
+
+    string->capacity = capacity;
+  }
+
+
   void
   FTDemo_String_Set( FTDemo_Handle*  handle,
                      const char*     string )
   {
+    TGlyphString*  str = &handle->string;
     int            ch;
-    PGlyph         glyph = handle->string;
-
 
-    handle->string_length = 0;
 
-    while ( ( ch = utf8_next( &string ) ) > 0 )
-    {
-      glyph->glyph_index = FTDemo_Get_Index( handle, (FT_UInt32)ch );
+    /* there are at most as many characters as bytes */
+    if ( strlen( string ) > INT_MAX )
+      PanicZ( "string too long" );
+    FTDemo_String_Grow( str, (int)strlen( string ) );
 
-      glyph++;
-      handle->string_length++;
+    str->length = 0;
 
-      if ( handle->string_length >= MAX_GLYPHS )
-        break;
-    }
+    while ( ( ch = utf8_next( &string ) ) > 0 )
+      str->indices[str->length++] = FTDemo_Get_Index( handle,
+                                                      (FT_UInt32)ch );
   }
 
 
@@ -1724,12 +2576,13 @@
   FTDemo_String_Load( FTDemo_Handle*          handle,
                       FTDemo_String_Context*  sc )
   {
-    FT_Size  size;
-    FT_Face  face;
-    FT_Int   i;
-    FT_Int   length = handle->string_length;
-    PGlyph   glyph, prev;
-    FT_Pos   track_kern   = 0;
+    TGlyphString*  str = &handle->string;
+    FT_Size        size;
+    FT_Face        face;
+    FT_Int         i;
+    FT_Int         length = str->length;
+    FT_Pos         track_kern   = 0;
+    double         t;
 
 
     error = FTDemo_Get_Size( handle, &size );
@@ -1738,39 +2591,43 @@
 
     face = size->face;
 
-    for ( glyph = handle->string, i = 0; i < length; glyph++, i++ )
+    t = frametime_start( &handle->frame_time );
+
+    for ( i = 0; i < length; i++ )
     {
       /* clear existing image if there is one */
-      if ( glyph->image )
+      if ( str->images[i] )
       {
-        FT_Done_Glyph( glyph->image );
-        glyph->image = NULL;
+        FT_Done_Glyph( str->images[i] );
+        str->images[i] = NULL;
       }
 
       /* load the glyph and get the image */
-      if ( !FT_Load_Glyph( face, glyph->glyph_index,
-                           handle->load_flags )        &&
-           !FT_Get_Glyph( face->glyph, &glyph->image ) )
+      if ( !FT_Load_Glyph( face, str->indices[i],
+                           handle->load_flags )          &&
+           !FT_Get_Glyph( face->glyph, &str->images[i] ) )
       {
         FT_Glyph_Metrics*  metrics = &face->glyph->metrics;
 
 
         /* note that in vertical layout, y-positive goes downwards */
 
-        glyph->vvector.x  =  metrics->vertBearingX - metrics->horiBearingX;
-        glyph->vvector.y  = -metrics->vertBearingY - metrics->horiBearingY;
+        str->vvectors[i].x  =  metrics->vertBearingX - metrics->horiBearingX;
+        str->vvectors[i].y  = -metrics->vertBearingY - metrics->horiBearingY;
 
-        glyph->vadvance.x = 0;
-        glyph->vadvance.y = -metrics->vertAdvance;
+        str->vadvances[i].x = 0;
+        str->vadvances[i].y = -metrics->vertAdvance;
 
-        glyph->lsb_delta = face->glyph->lsb_delta;
-        glyph->rsb_delta = face->glyph->rsb_delta;
+        str->lsb_deltas[i] = face->glyph->lsb_delta;
+        str->rsb_deltas[i] = face->glyph->rsb_delta;
 
-        glyph->hadvance.x = metrics->horiAdvance;
-        glyph->hadvance.y = 0;
+        str->hadvances[i].x = metrics->horiAdvance;
+        str->hadvances[i].y = 0;
       }
     }
 
+    frametime_stop( &handle->frame_time, FRAMETIME_LOAD, t );
+
     if ( sc->kerning_degree )
     {
       /* this function needs and returns points, not pixels */
@@ -1781,44 +2638,51 @@
         track_kern = ( track_kern >> 10 ) * (FT_Long)handle->scaler.x_res / 72;
     }
 
-    for ( prev = handle->string + length, glyph = handle->string, i = 0;
-          i < length;
-          prev = glyph, glyph++, i++ )
+    for ( i = 0; i < length; i++ )
     {
-      if ( !glyph->image )
+      FT_Vector*  prev;
+
+
+      if ( !str->images[i] )
         continue;
 
       if ( handle->lcd_mode == LCD_MODE_LIGHT_SUBPIXEL )
-        glyph->hadvance.x += glyph->lsb_delta - glyph->rsb_delta;
+        str->hadvances[i].x += str->lsb_deltas[i] - str->rsb_deltas[i];
+
+      /* the rest adjusts the advance of the previous glyph */
+      if ( i == 0 )
+        continue;
+
+      prev = &str->hadvances[i - 1];
 
-      prev->hadvance.x += track_kern;
+      prev->x += track_kern;
 
       if ( sc->kerning_mode )
       {
         FT_Vector  kern;
 
 
-        FT_Get_Kerning( face, prev->glyph_index, glyph->glyph_index,
+        FT_Get_Kerning( face, str->indices[i - 1], str->indices[i],
                         FT_KERNING_UNFITTED, &kern );
 
-        prev->hadvance.x += kern.x;
-        prev->hadvance.y += kern.y;
+        prev->x += kern.x;
+        prev->y += kern.y;
 
         if ( handle->lcd_mode != LCD_MODE_LIGHT_SUBPIXEL &&
              sc->kerning_mode > KERNING_MODE_NORMAL      )
         {
-          if ( prev->rsb_delta - glyph->lsb_delta > 32 )
-            prev->hadvance.x -= 64;
-          else if ( prev->rsb_delta - glyph->lsb_delta < -31 )
-            prev->hadvance.x += 64;
+          if ( str->rsb_deltas[i - 1] - str->lsb_deltas[i] > 32 )
+            prev->x -= 64;
+          else if ( str->rsb_deltas[i - 1] - str->lsb_deltas[i] < -31 )
+            prev->x += 64;
         }
       }
 
       if ( handle->lcd_mode != LCD_MODE_LIGHT_SUBPIXEL &&
            handle->hinted                              )
       {
-        prev->hadvance.x = ROUND( prev->hadvance.x );
-        prev->hadvance.y = ROUND( prev->hadvance.y );
+        prev->x = ROUND( prev->x );
+        prev->y = ROUND( prev->y );
       }
     }
 
@@ -1826,6 +2690,238 @@
   }
 
 
+  void
+  FTDemo_Bitmap_Cache_Reset( FTDemo_Handle*  handle )
+  {
+    PBitmapNode  node, next;
+    int          i;
+
+
+    if ( !handle->bitmap_cache )
+      return;
+
+    for ( i = 0; i < BITMAP_CACHE_BUCKETS; i++ )
+    {
+      for ( node = handle->bitmap_cache[i]; node; node = next )
+      {
+        next = node->next;
+        free( node );
+      }
+
+      handle->bitmap_cache[i] = NULL;
+    }
+
+    handle->bitmap_cache_bytes = 0;
+  }
+
+
+  /* Find a rendered string glyph; `key' receives all fields that */
+  /* select it, and `origin' is the pen position in 26.6 format.  */
+  static PBitmapNode
+  FTDemo_Bitmap_Cache_Lookup( FTDemo_Handle*          handle,
+                              FTDemo_String_Context*  sc,
+                              FT_UInt                 glyph_index,
+                              FT_Glyph                image,
+                              FT_Vector*              origin,
+                              PBitmapNode             key )
+  {
+    PBitmapNode  node;
+    FT_UInt32    hash;
+
+
+    if ( !handle->bitmap_cache )
+    {
+      handle->bitmap_cache = (PBitmapNode*)calloc( BITMAP_CACHE_BUCKETS,
+                                                   sizeof ( PBitmapNode ) );
+      if ( !handle->bitmap_cache )
+        return NULL;
+    }
+
+    key->scaler      = handle->scaler;
+    key->load_flags  = handle->load_flags;
+    key->lcd_mode    = handle->lcd_mode;
+    key->vertical    = sc->vertical;
+    key->glyph_index = glyph_index;
+
+    if ( sc->matrix )
+      key->matrix = *sc->matrix;
+    else
+    {
+      key->matrix.xx = key->matrix.yy = 0x10000L;
+      key->matrix.xy = key->matrix.yx = 0;
+    }
+
+    /* bitmaps are not resampled, outlines are rendered at each phase */
+    if ( image->format == FT_GLYPH_FORMAT_BITMAP )
+      key->phase.x = key->phase.y = 0;
+    else
+    {
+      key->phase.x = origin->x & 63;
+      key->phase.y = origin->y & 63;
+    }
+
+    hash = key->glyph_index;
+    hash = hash * 31 + (FT_UInt32)key->phase.x;
+    hash = hash * 31 + (FT_UInt32)key->phase.y;
+    hash = hash * 31 + key->scaler.width;
+    hash = hash * 31 + key->scaler.height;
+    hash = hash * 31 + (FT_UInt32)(size_t)key->scaler.face_id;
+    hash = hash * 31 + (FT_UInt32)key->matrix.xy;
+    hash = ( hash ^ ( hash >> 16 ) ) % BITMAP_CACHE_BUCKETS;
+
+    key->next = (PBitmapNode)(size_t)hash;  /* remember the bucket */
+
+    for ( node = handle->bitmap_cache[hash]; node; node = node->next )
+      if ( node->glyph_index      == key->glyph_index      &&
+           node->phase.x          == key->phase.x          &&
+           node->phase.y          == key->phase.y          &&
+           node->scaler.face_id   == key->scaler.face_id   &&
+           node->scaler.width     == key->scaler.width     &&
+           node->scaler.height    == key->scaler.height    &&
+           node->scaler.pixel     == key->scaler.pixel     &&
+           node->scaler.x_res     == key->scaler.x_res     &&
+           node->scaler.y_res     == key->scaler.y_res     &&
+           node->load_flags       == key->load_flags       &&
+           node->lcd_mode         == key->lcd_mode         &&
+           node->vertical         == key->vertical         &&
+           node->matrix.xx        == key->matrix.xx        &&
+           node->matrix.xy        == key->matrix.xy        &&
+           node->matrix.yx        == key->matrix.yx        &&
+           node->matrix.yy        == key->matrix.yy        )
+      {
+        handle->bitmap_cache_hits++;
+        return node;
+      }
+
+    handle->bitmap_cache_misses++;
+    return NULL;
+  }
+
+
+  /* store a copy of a glyph rendered at `left' and `top' (upwards) */
+  static PBitmapNode
+  FTDemo_Bitmap_Cache_Insert( FTDemo_Handle*  handle,
+                              PBitmapNode     key,
+                              grBitmap*       bitmap,
+                              int             left,
+                              int             top )
+  {
+    PBitmapNode  node;
+    size_t       hash = (size_t)key->next;
+    size_t       size, i;
+
+
+    size = (size_t)bitmap->rows * (size_t)abs( bitmap->pitch );
+
+    node = (PBitmapNode)malloc( sizeof ( TBitmapNode ) + size );
+    if ( !node )
+      return NULL;
+
+    *node = *key;
+
+    node->bitmap        = *bitmap;
+    node->bitmap.buffer = (unsigned char*)( node + 1 );
+    if ( size )
+      memcpy( node->bitmap.buffer, bitmap->buffer, size );
+
+    /* The blitter scales bitmaps with 4 or 16 grays to 256 grays in */
+    /* place; the copies it gets of a cached bitmap must not do that. */
+    if ( node->bitmap.mode == gr_pixel_mode_gray &&
+         node->bitmap.grays > 1                  &&
+         node->bitmap.grays != 256               )
+    {
+      unsigned char  scale;
+
+
+      scale = (unsigned char)( 255 / ( node->bitmap.grays - 1 ) );
+
+      for ( i = 0; i < size; i++ )
+        node->bitmap.buffer[i] *= scale;
+
+      node->bitmap.grays = 256;
+    }
+
+    node->left = left;
+    node->top  = top;
+
+    node->next                 = handle->bitmap_cache[hash];
+    handle->bitmap_cache[hash] = node;
+
+    handle->bitmap_cache_bytes += sizeof ( TBitmapNode ) + size;
+
+    return node;
+  }
+
+
+  /* round a 26.6 coordinate to the nearest of `phases' pixel fractions */
+  static FT_Pos
+  FTDemo_Quantize_Phase( FT_Pos  x,
+                         int     phases )
+  {
+    FT_Pos  step = ( ( x & 63 ) * phases + 32 ) >> 6;
+
+
+    return ( x & ~63 ) + step * 64 / phases;
+  }
+
+
+  /* string glyphs waiting to be blitted */
+  typedef struct  TBlitBatch_
+  {
+    grBitmap    bits [MAX_BLITS];
+    grBlitItem  items[MAX_BLITS];
+    FT_Glyph    glyfs[MAX_BLITS];  /* owners of the bitmap buffers */
+    int         num_items;
+
+  } TBlitBatch;
+
+
+  /* blit pending string glyphs and release their images */
+  static void
+  FTDemo_String_Flush( FTDemo_Handle*   handle,
+                       FTDemo_Display*  display,
+                       TBlitBatch*      batch )
+  {
+    int     i;
+    double  t = frametime_start( &handle->frame_time );
+
+
+    grBlitGlyphsToSurface( display->surface, batch->items, batch->num_items );
+    frametime_stop( &handle->frame_time, FRAMETIME_BLIT, t );
+
+    /* the items are sorted now, but the images are not */
+    for ( i = 0; i < batch->num_items; i++ )
+      FT_Done_Glyph( batch->glyfs[i] );
+
+    batch->num_items = 0;
+  }
+
+
+  /* add a rendered glyph to the batch; `glyf' (if any) owns the bitmap */
+  static void
+  FTDemo_String_Queue( FTDemo_Handle*   handle,
+                       FTDemo_Display*  display,
+                       TBlitBatch*      batch,
+                       grBitmap*        bitmap,
+                       int              x,
+                       int              y,
+                       FT_Glyph         glyf )
+  {
+    int  n = batch->num_items;
+
+
+    batch->bits [n]       = *bitmap;
+    batch->glyfs[n]       = glyf;
+    batch->items[n].glyph = &batch->bits[n];
+    batch->items[n].x     = x;
+    batch->items[n].y     = y;
+    batch->items[n].color = display->fore_color;
+
+    if ( ++batch->num_items == MAX_BLITS )
+      FTDemo_String_Flush( handle, display, batch );
+  }
+
+
   int
   FTDemo_String_Draw( FTDemo_Handle*          handle,
                       FTDemo_Display*         display,
@@ -1833,11 +2929,16 @@
                       int                     x,
                       int                     y )
   {
-    int        first = sc->offset;
-    int        last  = handle->string_length;
-    int        m, n;
-    FT_Vector  pen = { 0, 0};
-    FT_Vector  advance;
+    TGlyphString*  str   = &handle->string;
+    FT_Vector*     advances;
+    int            first = sc->offset;
+    int            last  = str->length;
+    int            m, n;
+    FT_Vector      pen = { 0, 0};
+    FT_Vector      advance;
+    FT_Bool        plain;
+
+    TBlitBatch  batch;
 
 
     if ( x < 0                      ||
@@ -1846,33 +2947,39 @@
          y > display->bitmap->rows  )
       return 0;
 
+    batch.num_items = 0;
+
+    /* untransformed glyphs can be rendered in place */
+    plain = handle->use_plain_render                      &&
+            ( !sc->matrix                               ||
+              ( sc->matrix->xx == 0x10000L &&
+                sc->matrix->xy == 0        &&
+                sc->matrix->yx == 0        &&
+                sc->matrix->yy == 0x10000L ) );
+
     /* change to Cartesian coordinates */
     y = display->bitmap->rows - y;
 
+    advances = sc->vertical ? str->vadvances : str->hadvances;
+
     /* calculate the extent */
     if ( sc->extent )
       for ( n = first; n < first + last || pen.x > 0; n++ )  /* chk progress */
       {
-        m = n % handle->string_length;  /* recycling */
-        if ( pen.x + handle->string[m].hadvance.x > sc->extent )
+        m = n % str->length;  /* recycling */
+        if ( pen.x + str->hadvances[m].x > sc->extent )
         {
           last = n;
           break;
         }
-        pen.x += handle->string[m].hadvance.x;
-        pen.y += handle->string[m].hadvance.y;
-      }
-    else if ( sc->vertical )
-      for ( n = first; n < last; n++ )
-      {
-        pen.x += handle->string[n].vadvance.x;
-        pen.y += handle->string[n].vadvance.y;
+        pen.x += str->hadvances[m].x;
+        pen.y += str->hadvances[m].y;
       }
     else
       for ( n = first; n < last; n++ )
       {
-        pen.x += handle->string[n].hadvance.x;
-        pen.y += handle->string[n].hadvance.y;
+        pen.x += advances[n].x;
+        pen.y += advances[n].y;
       }
 
     /* round to control initial pen position and preserve hinting... */
@@ -1888,60 +2995,164 @@
 
     for ( n = first; n < last; n++ )
     {
-      PGlyph    glyph = handle->string + n % handle->string_length;
-      FT_Glyph  image;
-      FT_BBox   bbox;
+      int          g     = n % str->length;
+      FT_Glyph     glyph = str->images[g];
+      PBitmapNode  node  = NULL;
+      TBitmapNode  key;
+      FT_Vector    origin;
+      FT_Vector    shift = { 0, 0 };  /* whole pixels, for `plain' */
+      FT_Vector    phase = { 0, 0 };
+      FT_Glyph     image;
+      FT_Bool      owned;             /* is `image' a copy? */
+      FT_BBox      bbox;
+
+
+      if ( !glyph )
+        continue;
 
+      /* a glyph rendered at `origin' moves with its integer part */
+      origin = pen;
+      if ( glyph->format == FT_GLYPH_FORMAT_BITMAP )
+      {
+        if ( sc->vertical )
+        {
+          origin.x += str->vvectors[g].x;
+          origin.y += str->vvectors[g].y;
+        }
+      }
+      else if ( handle->subpixel_phases > 0 )
+      {
+        /* render only a few variants of each glyph */
+        origin.x = FTDemo_Quantize_Phase( pen.x, handle->subpixel_phases );
+        origin.y = FTDemo_Quantize_Phase( pen.y, handle->subpixel_phases );
+      }
 
-      if ( !glyph->image )
-        continue;
+      advance = advances[g];
 
-      /* copy image */
-      error = FT_Glyph_Copy( glyph->image, &image );
-      if ( error )
+      if ( sc->matrix )
+        FT_Vector_Transform( &advance, sc->matrix );
+
+      /* blank glyphs like spaces only move the pen */
+      if ( glyph->format == FT_GLYPH_FORMAT_OUTLINE           &&
+           ( (FT_OutlineGlyph)glyph )->outline.n_contours == 0 )
+      {
+        pen.x += advance.x;
+        pen.y += advance.y;
         continue;
+      }
 
-      if ( image->format != FT_GLYPH_FORMAT_BITMAP )
+      if ( handle->use_bitmap_cache )
+        node = FTDemo_Bitmap_Cache_Lookup( handle, sc,
+                                           str->indices[g], glyph,
+                                           &origin, &key );
+
+      if ( node )
       {
-        if ( sc->vertical )
-          error = FT_Glyph_Transform( image, NULL, &glyph->vvector );
+        int  left = node->left + (int)( origin.x >> 6 );
+        int  top  = node->top  + (int)( origin.y >> 6 );
 
-        if ( !error )
-          error = FT_Glyph_Transform( image, sc->matrix, &pen );
 
-        if ( error )
+        pen.x += advance.x;
+        pen.y += advance.y;
+
+        if ( left + node->bitmap.width > 0          &&
+             top > 0                                &&
+             left < display->bitmap->width          &&
+             top - node->bitmap.rows < display->bitmap->rows )
         {
-          FT_Done_Glyph( image );
-          continue;
+          /* change back to the usual coordinates */
+          top = display->bitmap->rows - top;
+
+          if ( handle->use_batch_blit )
+            FTDemo_String_Queue( handle, display, &batch,
+                                 &node->bitmap, left, top, NULL );
+          else
+          {
+            double  t = frametime_start( &handle->frame_time );
+
+
+            grBlitGlyphToSurface( display->surface, &node->bitmap,
+                                  left, top, display->fore_color );
+            frametime_stop( &handle->frame_time, FRAMETIME_BLIT, t );
+          }
+        }
+
+        continue;
+      }
+
+      if ( plain && glyph->format == FT_GLYPH_FORMAT_BITMAP )
+      {
+        /* blit the glyph's own bitmap at the pen position */
+        image = glyph;
+        owned = 0;
+        shift = origin;
+      }
+      else if ( plain && glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+      {
+        /* render the glyph's own outline at the fractional part of */
+        /* the pen position, then move the bitmap by whole pixels   */
+        image = glyph;
+        owned = 0;
+        shift = origin;
+
+        if ( sc->vertical )
+        {
+          shift.x += str->vvectors[g].x;
+          shift.y += str->vvectors[g].y;
         }
+
+        phase.x = shift.x & 63;
+        phase.y = shift.y & 63;
+
+        FT_Outline_Translate( &( (FT_OutlineGlyph)image )->outline,
+                              phase.x, phase.y );
       }
       else
       {
-        FT_BitmapGlyph  bitmap = (FT_BitmapGlyph)image;
+        /* copy image */
+        error = FT_Glyph_Copy( glyph, &image );
+        if ( error )
+          continue;
 
+        owned = 1;
 
-        if ( sc->vertical )
+        if ( image->format != FT_GLYPH_FORMAT_BITMAP )
         {
-          bitmap->left += ( glyph->vvector.x + pen.x ) >> 6;
-          bitmap->top  += ( glyph->vvector.y + pen.y ) >> 6;
+          if ( sc->vertical )
+            error = FT_Glyph_Transform( image, NULL, &str->vvectors[g] );
+
+          if ( !error )
+            error = FT_Glyph_Transform( image, sc->matrix, &origin );
+
+          if ( error )
+          {
+            FT_Done_Glyph( image );
+            continue;
+          }
         }
         else
         {
-          bitmap->left += pen.x >> 6;
-          bitmap->top  += pen.y >> 6;
-        }
-      }
+          FT_BitmapGlyph  bitmap = (FT_BitmapGlyph)image;
 
-      advance = sc->vertical ? glyph->vadvance : glyph->hadvance;
 
-      if ( sc->matrix )
-        FT_Vector_Transform( &advance, sc->matrix );
+          bitmap->left += origin.x >> 6;
+          bitmap->top  += origin.y >> 6;
+        }
+      }
 
       pen.x += advance.x;
       pen.y += advance.y;
 
       FT_Glyph_Get_CBox( image, FT_GLYPH_BBOX_PIXELS, &bbox );
 
+      shift.x >>= 6;
+      shift.y >>= 6;
+
+      bbox.xMin += shift.x;
+      bbox.xMax += shift.x;
+      bbox.yMin += shift.y;
+      bbox.yMax += shift.y;
+
 #if 0
       if ( n == 0 )
       {
@@ -1966,21 +3177,80 @@
                                         &dummy1, &dummy2, &glyf );
         if ( !error )
         {
+          left += (int)shift.x;
+          top  += (int)shift.y;
+
+          if ( handle->use_bitmap_cache )
+          {
+            size_t  size = (size_t)bit3.rows * (size_t)abs( bit3.pitch );
+
+
+            /* pending glyphs might refer to cached bitmaps */
+            if ( handle->bitmap_cache_bytes + size > BITMAP_CACHE_BYTES )
+            {
+              FTDemo_String_Flush( handle, display, &batch );
+              FTDemo_Bitmap_Cache_Reset( handle );
+            }
+
+            node = FTDemo_Bitmap_Cache_Insert( handle, &key, &bit3,
+                                               left - (int)( origin.x >> 6 ),
+                                               top  - (int)( origin.y >> 6 ) );
+            if ( node )
+            {
+              bit3 = node->bitmap;
+
+              if ( glyf )
+                FT_Done_Glyph( glyf );
+              glyf = NULL;
+            }
+          }
+
           /* change back to the usual coordinates */
           top = display->bitmap->rows - top;
 
-          /* now render the bitmap into the display surface */
-          grBlitGlyphToSurface( display->surface, &bit3, left, top,
-                                display->fore_color );
+          /* the conversion buffer is reused by the next glyph */
+          if ( !handle->use_batch_blit                 ||
+               bit3.buffer == handle->bitmap.buffer    )
+          {
+            double  t = frametime_start( &handle->frame_time );
+
 
-          if ( glyf )
-            FT_Done_Glyph( glyf );
+            /* now render the bitmap into the display surface */
+            grBlitGlyphToSurface( display->surface, &bit3, left, top,
+                                  display->fore_color );
+            frametime_stop( &handle->frame_time, FRAMETIME_BLIT, t );
+
+            if ( glyf )
+              FT_Done_Glyph( glyf );
+          }
+          else
+          {
+            /* keep the rendered bitmap until the batch is flushed */
+            if ( !glyf && !node && owned )
+            {
+              glyf  = image;
+              image = NULL;
+            }
+
+            FTDemo_String_Queue( handle, display, &batch,
+                                 &bit3, left, top, glyf );
+          }
         }
       }
 
-      FT_Done_Glyph( image );
+      if ( !owned )
+      {
+        /* restore the string's glyph */
+        if ( phase.x || phase.y )
+          FT_Outline_Translate( &( (FT_OutlineGlyph)image )->outline,
+                                -phase.x, -phase.y );
+      }
+      else if ( image )
+        FT_Done_Glyph( image );
     }
 
+    FTDemo_String_Flush( handle, display, &batch );
+
     return last - first;
   }
 
@@ -1997,6 +3267,7 @@
     grBitmap*         target = display->bitmap;
     FT_Outline*       outline;
     FT_Raster_Params  params;
+    double            t;
 
 
     if ( glyph->format != FT_GLYPH_FORMAT_OUTLINE )
@@ -2017,7 +3288,12 @@
     params.clip_box.xMax = -x + target->width;
     params.clip_box.yMax =  y;
 
-    return FT_Outline_Render( handle->library, outline, &params );
+    /* the spans go directly to the surface */
+    t     = frametime_start( &handle->frame_time );
+    error = FT_Outline_Render( handle->library, outline, &params );
+    frametime_stop( &handle->frame_time, FRAMETIME_RENDER, t );
+
+    return error;
   }
 
 
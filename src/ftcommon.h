@@ -74,6 +74,7 @@
 
 #include "graph.h"
 #include "grobjs.h"
+#include "frametime.h"
 #include "grfont.h"
 
   typedef struct
@@ -108,12 +109,18 @@
   FTDemo_Display_Clear( FTDemo_Display*  display );
 
 
-  /* dump display image in PNG format */
+  /* dump display image in PNG or PNM format, in the background */
+  /* unless disabled; see the FTDEMO_PRINT_* environment variables */
   int
   FTDemo_Display_Print( FTDemo_Display*  display,
                         const char*      filename,
                         FT_String*       ver_str );
 
+
+  /* wait until the last image has been written */
+  void
+  FTDemo_Display_Print_Wait( void );
+
   /*************************************************************************/
   /*************************************************************************/
   /*****                                                               *****/
@@ -122,23 +129,86 @@
   /*************************************************************************/
   /*************************************************************************/
 
-#define MAX_GLYPHS 512            /* at most 512 glyphs in the string */
 #define MAX_GLYPH_BYTES  150000   /* 150kB for the glyph image cache */
+#define MAX_BLITS  64             /* glyphs blitted in one batch       */
+#define BITMAP_CACHE_BUCKETS  1024               /* rendered glyph cache */
+#define BITMAP_CACHE_BYTES    ( 4 * 1024 * 1024 )
+#define FONT_INDEX_BUCKETS    4096               /* font file index      */
+
+
+  /* the string glyphs, with one array per field to keep the */
+  /* layout loops over the advances compact                  */
+  typedef struct  TGlyphString_
+  {
+    int         length;
+    int         capacity;
+
+    FT_UInt*    indices;
+    FT_Glyph*   images;      /* the glyph images */
+
+    FT_Pos*     lsb_deltas;  /* delta caused by hinting */
+    FT_Pos*     rsb_deltas;  /* delta caused by hinting */
+    FT_Vector*  hadvances;   /* kerned horizontal advance */
+
+    FT_Vector*  vvectors;    /* vert. origin => hori. origin */
+    FT_Vector*  vadvances;   /* vertical advance */
+
+  } TGlyphString;
+
+  /* a string glyph rendered at a given subpixel phase */
+  typedef struct  TBitmapNode_
+  {
+    struct TBitmapNode_*  next;
+
+    FTC_ScalerRec  scaler;        /* face and size                     */
+    FT_Int32       load_flags;
+    int            lcd_mode;
+    FT_Matrix      matrix;
+    int            vertical;
+    FT_UInt        glyph_index;
+    FT_Vector      phase;         /* fractional part of pen position   */
+
+    grBitmap       bitmap;        /* buffer follows the node           */
+    int            left;          /* relative to integer pen position, */
+    int            top;           /* upwards                           */
+
+  } TBitmapNode, *PBitmapNode;
+
+  /* a preloaded font file, shared by all fonts it holds */
+  typedef struct  TFontFile_
+  {
+    struct TFontFile_*  next;
+    const char*         filepathname;
+    void*               address;     /* see `ft_map_file' */
+    size_t              size;
+    int                 ref_count;   /* number of fonts using it */
 
+  } TFontFile, *PFontFile;
 
-  typedef struct  TGlyph_
+  /* what the font index knows about a face */
+  typedef struct  TFaceInfo_
   {
-    FT_UInt    glyph_index;
-    FT_Glyph   image;    /* the glyph image */
+    int      valid;          /* can be opened                */
+    int      scalable;
+    FT_Long  num_instances;  /* named instances              */
+    int      cmap_index;     /* as in `TFont'                */
+    int      num_indices;    /* as in `TFont', or 0 if unset */
 
-    FT_Pos     lsb_delta; /* delta caused by hinting */
-    FT_Pos     rsb_delta; /* delta caused by hinting */
-    FT_Vector  hadvance;  /* kerned horizontal advance */
+  } TFaceInfo;
 
-    FT_Vector  vvector;   /* vert. origin => hori. origin */
-    FT_Vector  vadvance;  /* vertical advance */
+  /* what the font index knows about a font file */
+  typedef struct  TFileInfo_
+  {
+    struct TFileInfo_*  next;
+    const char*         filepathname;
+    unsigned long       file_size;
+    long                file_time;   /* modification time          */
+    unsigned long       encoding;    /* selects the cmap indices   */
+    FT_Error            error;       /* why the file was rejected  */
+    FT_Long             num_faces;
+    TFaceInfo*          faces;
 
-  } TGlyph, *PGlyph;
+  } TFileInfo, *PFileInfo;
 
   /* this simple record is used to model a given `installed' face */
   typedef struct  TFont_
@@ -148,8 +218,8 @@
     int          cmap_index;
     int          palette_index;
     int          num_indices;
-    void*        file_address;  /* for preloaded files */
-    size_t       file_size;
+    int          indices_cmap;  /* cmap counted by `num_indices', or -1 */
+    PFontFile    file;          /* for preloaded files */
 
   } TFont, *PFont;
 
@@ -205,8 +275,18 @@
     PFont*          fonts;             /* installed fonts */
     int             num_fonts;
     int             max_fonts;
+    PFontFile       font_files;        /* preloaded font files */
+
+    const char*     font_index_path;   /* from FTDEMO_FONT_INDEX  */
+    PFileInfo*      font_index;        /* hash table of font files */
+    int             font_index_dirty;
 
     int             use_sbits_cache;   /* toggle sbits cache */
+    int             use_plain_render;  /* render unrotated glyphs in place */
+    int             use_batch_blit;    /* blit string glyphs in batches */
+    int             use_bitmap_cache;  /* reuse rendered string glyphs  */
+    int             subpixel_phases;   /* string glyph positions per    */
+                                       /* pixel, or 0 for exact ones    */
 
     /* use FTDemo_Set_Current_XXX to set the following two fields */
     PFont           current_font;      /* selected font */
@@ -226,8 +306,18 @@
     /* don't touch the following fields! */
 
     /* used for string rendering */
-    TGlyph          string[MAX_GLYPHS];
-    int             string_length;
+    TGlyphString    string;
+
+    PBitmapNode*    bitmap_cache;      /* hash table of rendered glyphs */
+    size_t          bitmap_cache_bytes;
+    unsigned long   bitmap_cache_hits;
+    unsigned long   bitmap_cache_misses;
+
+    FrameTime       frame_time;        /* toggled with the `T' key */
+    unsigned long   faces_opened;      /* by the cache manager     */
+    unsigned long   frame_counts[5];   /* the counters above and   */
+                                       /* of the bitmap pool, at   */
+                                       /* the start of the frame   */
 
     unsigned long   encoding;
     FT_Stroker      stroker;
@@ -244,6 +334,17 @@
   FTDemo_Done( FTDemo_Handle*  handle );
 
 
+  /* start timing a frame if the overlay is enabled */
+  void
+  FTDemo_Frame_Time_Begin( FTDemo_Handle*  handle );
+
+
+  /* show the timings and cache statistics of the frame */
+  void
+  FTDemo_Frame_Time_Draw( FTDemo_Handle*   handle,
+                          FTDemo_Display*  display );
+
+
   /* append version information */
   void
   FTDemo_Version( FTDemo_Handle*  handle,
@@ -263,11 +364,29 @@
                        FT_Bool         outline_only,
                        FT_Bool         no_instances );
 
+  /* install the fonts of several files, probing them concurrently; */
+  /* the fonts are added in file order, and `errors' (if not NULL)  */
+  /* receives the result for each file                              */
+  FT_Error
+  FTDemo_Install_Fonts( FTDemo_Handle*  handle,
+                        int             num_files,
+                        char**          filepaths,
+                        FT_Bool         outline_only,
+                        FT_Bool         no_instances,
+                        FT_Error*       errors );
+
 
   void
   FTDemo_Set_Preload( FTDemo_Handle*  handle,
                       int             preload );
 
+  /* return the number of preloaded files, their total size, and how */
+  /* much of it is currently resident in memory                      */
+  int
+  FTDemo_Get_Preload_Size( FTDemo_Handle*  handle,
+                           size_t*         mapped,
+                           size_t*         resident );
+
   void
   FTDemo_Set_Current_Font( FTDemo_Handle*  handle,
                            PFont           font );
@@ -371,6 +490,12 @@
                     int*             pen_y);
 
 
+  /* forget rendered string glyphs; this is done automatically by */
+  /* FTDemo_Update_Current_Flags and FTDemo_Hinting_Engine_Change  */
+  void
+  FTDemo_Bitmap_Cache_Reset( FTDemo_Handle*  handle );
+
+
   /* set the string to be drawn */
   void
   FTDemo_String_Set( FTDemo_Handle*  handle,
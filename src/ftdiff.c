@@ -208,6 +208,7 @@
     char**          files;
     DisplayRec      display;
     char            filepath0[1024];
+    FrameTime       frame_time;
 
   } RenderStateRec, *RenderState;
 
@@ -495,13 +496,16 @@
     HintMode     rmode          = column->hint_mode;
     FT_Bool      have_0x0A      = 0;
     FT_Bool      have_0x0D      = 0;
+    double       t;
 
 
     /* changing a property is in most cases a global operation; */
     /* we are on the safe side if we reload the face completely */
     /* (this is something a normal program doesn't need to do)  */
+    t = frametime_start( &state->frame_time );
     render_state_set_file( state );
     _render_state_rescale( state );
+    frametime_stop( &state->frame_time, FRAMETIME_LOAD, t );
 
     face = state->face;
 
@@ -589,8 +593,10 @@
         have_0x0D = 0;
       }
 
+      t      = frametime_start( &state->frame_time );
       gindex = FT_Get_Char_Index( state->face, (FT_ULong)ch );
       error  = FT_Load_Glyph( face, gindex, load_flags );
+      frametime_stop( &state->frame_time, FRAMETIME_LOAD, t );
 
       if ( error )
         continue;
@@ -659,9 +665,13 @@
       }
 
       if ( slot->format == FT_GLYPH_FORMAT_OUTLINE )
+      {
+        t = frametime_start( &state->frame_time );
         FT_Render_Glyph( slot,
                          column->use_lcd_filter ? FT_RENDER_MODE_LCD
                                                 : FT_RENDER_MODE_NORMAL );
+        frametime_stop( &state->frame_time, FRAMETIME_RENDER, t );
+      }
 
       if ( xmax >= right )
       {
@@ -683,11 +693,13 @@
         else if ( slot->bitmap.pixel_mode == FT_PIXEL_MODE_LCD )
           mode = DISPLAY_MODE_LCD;
 
+        t = frametime_start( &state->frame_time );
         state->display.disp_draw( state->display.disp, mode,
                                   ( x_origin >> 6 ) + slot->bitmap_left,
                                   y - slot->bitmap_top,
                                   (int)map->width, (int)map->rows,
                                   map->pitch, map->buffer );
+        frametime_stop( &state->frame_time, FRAMETIME_BLIT, t );
       }
       if ( rmode == HINT_MODE_UNHINTED                ||
            rmode == HINT_MODE_AUTOHINT_LIGHT_SUBPIXEL )
@@ -1013,7 +1025,7 @@
     grWriteln( "  p, n        previous/next font        1, 2, 3      select column          " );
     grWriteln( "  Up, Down    adjust size by 0.5pt      Left, Right  switch between columns " );
     grWriteln( "  PgUp, PgDn  adjust size by 5pt        g, v         adjust gamma value     " );
-    grWriteln( "                                                                            " );
+    grWriteln( "                                        T            toggle frame timing    " );
     grWriteln( " per-column parameters:                                                     " );
     grWriteln( "  d           toggle lsb/rsb deltas     hinting modes:                      " );
     grWriteln( "  h           cycle hinting mode          A          unhinted               " );
@@ -1263,6 +1275,10 @@
       column->use_cboxes = !column->use_cboxes;
       break;
 
+    case grKEY( 'T' ):
+      state->frame_time.enabled = !state->frame_time.enabled;
+      break;
+
     case grKEY( '[' ):
       if ( !column->use_custom_lcd_filter )
         break;
@@ -1491,6 +1507,7 @@
 
 
       adisplay_clear( adisplay );
+      frametime_begin( &state->frame_time );
 
       /* We have this layout:                                */
       /*                                                     */
@@ -1519,6 +1536,8 @@
                          column_width, column_height );
 
       write_global_info( state );
+      frametime_draw( &state->frame_time, adisplay->bitmap,
+                      adisplay->fore_color, adisplay->back_color, NULL );
 
       grRefreshSurface( adisplay->surface );
       grListenSurface( adisplay->surface, 0, &event );
@@ -35,67 +35,355 @@
 #include "common.h"
 #include "output.h"
 #include "mlgetopt.h"
+#include "workpool.h"
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 
-  static FT_Error  error;
-
-  static int  comma_flag  = 0;
   static int  coverage    = 0;
   static int  name_tables = 0;
   static int  bytecode    = 0;
   static int  tables      = 0;
   static int  utf8        = 0;
+  static int  json        = 0;
+  static int  profile     = 0;
+
+
+  /* the report of a file goes to `file' directly or, if it is dumped */
+  /* by a worker thread, to `buffer' until it is its turn to be shown; */
+  /* warnings about broken fonts are held in `warnings' until then, or */
+  /* until they can be added to the JSON object of the face            */
+  typedef struct  Output_
+  {
+    FILE*        file;
+    char*        buffer;
+    size_t       length;
+    size_t       size;
+    int          comma;    /* JSON: does the next value need a comma? */
+
+    const char*  fname;    /* prefix of warnings if several files */
+    char*        warnings;
+    size_t       warnings_length;
+    size_t       warnings_size;
+
+  } Output;
+
+
+  /* files are dumped in batches of this many per worker to bound */
+  /* the memory used by buffered reports                          */
+#define BATCH_PER_WORKER  16
+
+  typedef struct  Batch_
+  {
+    char**        fnames;
+    Output*       outputs;
+    int*          failed;
+    FT_Library*   libraries;   /* one per worker, created on demand */
+
+  } Batch;
+
+
+  /* composites nested at least this deep share a histogram bin */
+#define GLYF_MAX_DEPTH  8
+
+  /* the glyphs of a `glyf' table by kind, and their sizes */
+  typedef struct  GlyfCount_
+  {
+    FT_Int    simple;
+    FT_Int    simple_overlap;
+    FT_Int    composite;
+    FT_Int    composite_overlap;
+    FT_Int    empty;
+    FT_Int    invalid;
+
+    FT_ULong  contours;            /* of simple glyphs */
+    FT_ULong  points;
+    FT_UInt   max_contours;
+    FT_UInt   max_points;
+    FT_ULong  instructions;        /* bytes of glyph programs */
+    FT_Int    instructed;          /* glyphs with a program   */
+    FT_UInt   max_instructions;
+    FT_ULong  components;          /* of composite glyphs     */
+    FT_Int    depths[GLYF_MAX_DEPTH];  /* composites by depth */
+
+  } GlyfCount;
+
+
+  /* the size and estimated cost of a TrueType program */
+  typedef struct  ProgramCost_
+  {
+    FT_UInt   glyph;          /* of a glyph program */
+    FT_ULong  bytes;
+    FT_ULong  instructions;
+    FT_ULong  cost;           /* instructions, with called functions */
+
+  } ProgramCost;
+
+
+  typedef struct  TableSize_
+  {
+    FT_ULong  tag;
+    FT_ULong  length;
+
+  } TableSize;
+
+
+  /* the table sizes and bytecode statistics of option `-P' */
+  typedef struct  Profile_
+  {
+    TableSize*    tables;          /* largest first */
+    FT_UInt       num_tables;
+    FT_ULong      tables_length;
+
+    ProgramCost   fpgm;
+    ProgramCost   prep;
+    ProgramCost   glyf;            /* sum over all glyph programs */
+    ProgramCost*  glyphs;          /* largest first */
+    FT_UInt       num_glyphs;
+
+    FT_ULong*     functions;       /* cost of each function, or 0 */
+    FT_UInt       max_functions;
+    FT_UInt       num_functions;
+    FT_ULong      functions_cost;  /* sum over all functions */
+
+    FT_ULong      push_bytes;      /* data of the push instructions */
+    FT_ULong      opcodes[256];
+
+  } Profile;
+
+
+  /* A font file mapped into memory on first use, to access the tables */
+  /* of SFNT fonts in place.  `base' is NULL if it cannot be mapped.    */
+  typedef struct  FontFile_
+  {
+    const char*     path;
+    const FT_Byte*  base;
+    size_t          size;
+    int             mapped;   /* was mapping tried? */
+
+  } FontFile;
+
+
+  /* a table in the mapped file, or a copy of it in `copy' */
+  typedef struct  Table_
+  {
+    const FT_Byte*  data;
+    FT_ULong        length;
+    FT_Byte*        copy;
+
+  } Table;
+
+
+  static const FT_String*
+  Error_String( FT_Error  error )
+  {
+    const FT_String  *str;
+
+
+    switch( error )
+    #include <freetype/fterrors.h>
+
+    return str;
+  }
 
 
   /* PanicZ */
   static void
   PanicZ( FT_Library   library,
+          FT_Error     error,
           const char*  message )
   {
-    const FT_String  *str;
+    FT_Done_FreeType( library );
 
+    fprintf( stderr, "%s\n  error = 0x%04x, %s\n",
+             message, error, Error_String( error ) );
+    exit( 1 );
+  }
 
-    FT_Done_FreeType( library );
 
-    switch( error )
-    #include <freetype/fterrors.h>
+  /* append to a growing buffer; return the number of characters */
+  static int
+  VAppend( char**       pbuffer,
+           size_t*      plength,
+           size_t*      psize,
+           const char*  format,
+           va_list      args )
+  {
+    int  ret = -1;
 
-    fprintf( stderr, "%s\n  error = 0x%04x, %s\n", message, error, str );
-    exit( 1 );
+
+    for ( ;; )
+    {
+      size_t   available = *psize - *plength;
+      va_list  copy;
+
+
+      if ( available )
+      {
+        va_copy( copy, args );
+        ret = vsnprintf( *pbuffer + *plength, available, format, copy );
+        va_end( copy );
+      }
+
+      if ( ret >= 0 && (size_t)ret < available )
+      {
+        *plength += (size_t)ret;
+        break;
+      }
+
+      /* NOTE: On Windows, vsnprintf() can return -1 in case of */
+      /* truncation!                                            */
+      {
+        size_t  size = *psize ? 2 * *psize : 4096;
+        char*   buffer;
+
+
+        if ( ret >= 0 && size < *plength + (size_t)ret + 1 )
+          size = *plength + (size_t)ret + 1;
+
+        buffer = (char*)realloc( *pbuffer, size );
+        if ( !buffer )
+        {
+          fprintf( stderr, "ftdump: out of memory\n" );
+          exit( 1 );
+        }
+
+        *pbuffer = buffer;
+        *psize   = size;
+      }
+    }
+
+    return ret;
+  }
+
+
+  static int
+  Append( char**       pbuffer,
+          size_t*      plength,
+          size_t*      psize,
+          const char*  format,
+          ... )
+  {
+    va_list  args;
+    int      ret;
+
+
+    va_start( args, format );
+    ret = VAppend( pbuffer, plength, psize, format, args );
+    va_end( args );
+
+    return ret;
+  }
+
+
+  static int
+  VPrint( Output*      out,
+          const char*  format,
+          va_list      args )
+  {
+    if ( out->file )
+      return vfprintf( out->file, format, args );
+
+    return VAppend( &out->buffer, &out->length, &out->size, format, args );
+  }
+
+
+  /* return the number of characters printed, like `printf' */
+  static int
+  Print( Output*      out,
+         const char*  format,
+         ... )
+  {
+    va_list  args;
+    int      ret;
+
+
+    va_start( args, format );
+    ret = VPrint( out, format, args );
+    va_end( args );
+
+    return ret;
+  }
+
+
+  /* are several files dumped? */
+  static int  many_files = 0;
+
+
+  /* Report a problem with a font, one line per call.  In text mode, it */
+  /* goes to standard error after the report so far, prefixed with the */
+  /* file name if there are several files; in JSON mode, it is added to */
+  /* the `warnings' of the face.                                        */
+  static void
+  Warn( Output*      out,
+        const char*  format,
+        ... )
+  {
+    va_list  args;
+
+
+    if ( !json && out->file )
+    {
+      fflush( out->file );
+
+      if ( many_files )
+        fprintf( stderr, "%s: ", out->fname );
+
+      va_start( args, format );
+      vfprintf( stderr, format, args );
+      va_end( args );
+
+      fputc( '\n', stderr );
+      return;
+    }
+
+    if ( !json && many_files )
+      Append( &out->warnings, &out->warnings_length, &out->warnings_size,
+              "%s: ", out->fname );
+
+    va_start( args, format );
+    VAppend( &out->warnings, &out->warnings_length, &out->warnings_size,
+             format, args );
+    va_end( args );
+
+    Append( &out->warnings, &out->warnings_length, &out->warnings_size,
+            "\n" );
   }
 
 
   static void
-  Print_Comma( const char*  message )
+  Print_Comma( Output*      out,
+               int*         comma_flag,
+               const char*  message )
   {
-    if ( comma_flag )
-      printf( ", " );
+    if ( *comma_flag )
+      Print( out, ", " );
 
-    printf( "%s", message );
-    comma_flag = 1;
+    Print( out, "%s", message );
+    *comma_flag = 1;
   }
 
 
   static void
-  Print_Array( FT_Short*  data,
+  Print_Array( Output*    out,
+               FT_Short*  data,
                FT_Byte    num_data )
   {
     FT_Int  i;
 
 
-    printf( "[" );
+    Print( out, "[" );
     if ( num_data )
     {
-      printf( "%d", data[0] );
+      Print( out, "%d", data[0] );
       for ( i = 1; i < num_data; i++ )
-        printf( ", %d", data[i] );
+        Print( out, ", %d", data[i] );
     }
-    printf( "]\n" );
+    Print( out, "]\n" );
   }
 
 
@@ -110,7 +398,7 @@
       "ftdump: simple font dumper -- part of the FreeType project\n"
       "----------------------------------------------------------\n"
       "\n"
-      "Usage: %s [options] fontname\n"
+      "Usage: %s [options] fontname ...\n"
       "\n",
              execname );
 
@@ -118,142 +406,251 @@
       "  -c, -C    Print charmap coverage and/or CID coverage.\n"
       "  -n        Print SFNT 'name' table or Type1 font info.\n"
       "  -p        Print TrueType programs.\n"
+      "  -P        Print a hinting profile: table sizes, the largest\n"
+      "            glyph programs, and instruction frequencies.\n"
       "  -t        Print SFNT table list.\n"
       "  -u        Emit UTF8.\n"
       "\n"
+      "  -j N      Dump the files on N threads (0 for one per CPU);\n"
+      "            the reports are still printed in order.\n"
+      "  -J        Emit one JSON object per line and face instead of\n"
+      "            text, including errors; `-p' is ignored.\n"
+      "\n"
       "  -v        Show version.\n"
       "\n" );
 
-    exit( 1 );
+    /* status 1 means that a file could not be dumped */
+    exit( 2 );
   }
 
 
-  static char*
-  Name_Field( const char*  name )
+  /* print a field name, padded to align the values */
+  static void
+  Print_Label( Output*      out,
+               const char*  name )
   {
-    static char  result[80];
-    int          left = ( 20 - (int)strlen( name ) );
+    int  left = ( 20 - (int)strlen( name ) );
 
 
     if ( left <= 0 )
       left = 1;
 
-    snprintf( result, sizeof ( result ), "   %s:%*s", name, left, " " );
+    Print( out, "   %s:%*s", name, left, " " );
+  }
 
-    return result;
+
+  static void
+  Print_Field( Output*      out,
+               const char*  name,
+               const char*  format,
+               ... )
+  {
+    va_list  args;
+
+
+    Print_Label( out, name );
+
+    va_start( args, format );
+    VPrint( out, format, args );
+    va_end( args );
+  }
+
+
+  /* `put_ascii' and `put_unicode_be16' for an `Output' */
+  static void
+  Print_Ascii( Output*   out,
+               FT_Byte*  string,
+               FT_UInt   string_len,
+               FT_UInt   indent )
+  {
+    FT_UInt  len;
+    char*    s;
+
+
+    len = put_ascii_string_size( string, string_len, indent );
+    s   = (char*)malloc( len );
+    if ( !s )
+      Print( out, "allocation error for name string" );
+    else
+    {
+      put_ascii_string( s, string, string_len, indent );
+      Print( out, "%s", s );
+      free( s );
+    }
+  }
+
+
+  static void
+  Print_Unicode( Output*   out,
+                 FT_Byte*  string,
+                 FT_UInt   string_len,
+                 FT_UInt   indent )
+  {
+    FT_UInt  len;
+    char*    s;
+
+
+    len = put_unicode_be16_string_size( string, string_len, indent, utf8 );
+    s   = (char*)malloc( len );
+    if ( !s )
+      Print( out, "allocation error for name string" );
+    else
+    {
+      put_unicode_be16_string( s, string, string_len, indent, utf8 );
+      Print( out, "%s", s );
+      free( s );
+    }
+  }
+
+
+  /* Write `t' seconds since 1970-01-01 as `YYYY-MM-DD' into `buf', */
+  /* with the proleptic Gregorian calendar.  Unlike `gmtime', this  */
+  /* can be called by several threads at once.                      */
+  static void
+  Format_Date( char*   buf,
+               size_t  size,
+               time_t  t )
+  {
+    long  days  = (long)( t / 86400 ) + 719468L;  /* from 0000-03-01 */
+    long  era   = days / 146097L;
+    long  doe   = days - era * 146097L;           /* [0, 146096]    */
+    long  yoe   = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365;
+    long  doy   = doe - ( 365 * yoe + yoe / 4 - yoe / 100 );
+    long  mp    = ( 5 * doy + 2 ) / 153;          /* March is 0     */
+    long  year  = yoe + era * 400;
+    int   day   = (int)( doy - ( 153 * mp + 2 ) / 5 + 1 );
+    int   month = (int)( mp < 10 ? mp + 3 : mp - 9 );
+
+
+    if ( month <= 2 )
+      year++;
+
+    snprintf( buf, size, "%ld-%02d-%02d", year, month % 100, day % 100 );
   }
 
 
 #define Print_Type_Number( name ) \
-  printf( "%s%d\n", Name_Field ( #name ), face->name )
+  Print_Field( out, #name, "%d\n", face->name )
+
+
+  /* convert a date of the `head' table to seconds since 1970-01-01 */
+  static time_t
+  Head_Time( const FT_ULong*  date )
+  {
+    time_t  t = (time_t)date[1];
+
+
+    /* ignore most of upper bits until 2176 and adjust epoch */
+    return date[0] == 1 ? t + 2212122496U
+                        : t - 2082844800U;
+  }
 
 
   static void
-  Print_Name( FT_Face  face )
+  Print_Name( Output*  out,
+              FT_Face  face )
   {
     const char*     ps_name;
     TT_Header*      head;
     PS_FontInfoRec  font_info;
 
 
-    printf( "font info entries\n" );
+    Print( out, "font info entries\n" );
 
     /* XXX: Foundry?  Copyright?  Version? ... */
 
-    printf( "%s%s\n", Name_Field( "family" ), face->family_name );
-    printf( "%s%s\n", Name_Field( "style" ), face->style_name );
+    Print_Field( out, "family", "%s\n", face->family_name );
+    Print_Field( out, "style", "%s\n", face->style_name );
 
     ps_name = FT_Get_Postscript_Name( face );
     if ( ps_name == NULL )
       ps_name = "UNAVAILABLE";
 
-    printf( "%s%s\n", Name_Field( "postscript" ), ps_name );
+    Print_Field( out, "postscript", "%s\n", ps_name );
 
     head = (TT_Header*)FT_Get_Sfnt_Table( face, FT_SFNT_HEAD );
     if ( head )
     {
-      char    buf[11];
-      time_t  created  = (time_t)head->Created [1];
-      time_t  modified = (time_t)head->Modified[1];
+      char    buf[32];
+      time_t  created  = Head_Time( head->Created );
+      time_t  modified = Head_Time( head->Modified );
 
 
-      /* ignore most of upper bits until 2176 and adjust epoch */
-      created  = head->Created [0] == 1 ? created  + 2212122496U
-                                        : created  - 2082844800U;
-      modified = head->Modified[0] == 1 ? modified + 2212122496U
-                                        : modified - 2082844800U;
-
-      /* ignore pre-epoch time that gmtime cannot handle on some systems */
+      /* ignore pre-epoch time */
       if ( created >= 0 )
       {
-        strftime( buf, sizeof ( buf ), "%Y-%m-%d", gmtime( &created ) );
-        printf( "%s%s\n", Name_Field( "created" ), buf );
+        Format_Date( buf, sizeof ( buf ), created );
+        Print_Field( out, "created", "%s\n", buf );
       }
       if ( modified >= 0 )
       {
-        strftime( buf, sizeof ( buf ), "%Y-%m-%d", gmtime( &modified ) );
-        printf( "%s%s\n", Name_Field( "modified" ), buf );
+        Format_Date( buf, sizeof ( buf ), modified );
+        Print_Field( out, "modified", "%s\n", buf );
       }
 
-      printf( head->Font_Revision & 0xFFC0 ? "%s%.4g\n" : "%s%.2f\n",
-              Name_Field( "revision" ), head->Font_Revision / 65536.0 );
+      Print_Field( out, "revision",
+                   head->Font_Revision & 0xFFC0 ? "%.4g\n" : "%.2f\n",
+                   head->Font_Revision / 65536.0 );
     }
     else if ( !FT_Get_PS_Font_Info( face, &font_info ) && font_info.version )
     {
-      printf( "%s%s\n", Name_Field( "version" ), font_info.version );
+      Print_Field( out, "version", "%s\n", font_info.version );
     }
   }
 
 
   static void
-  Print_Type( FT_Face  face )
+  Print_Type( Output*  out,
+              FT_Face  face )
   {
-    printf( "font type entries\n" );
+    int  comma_flag;
+
 
-    printf( "%s%s\n", Name_Field( "FreeType driver" ),
-            FT_FACE_DRIVER_NAME( face ) );
+    Print( out, "font type entries\n" );
+
+    Print_Field( out, "FreeType driver", "%s\n",
+                 FT_FACE_DRIVER_NAME( face ) );
 
     /* Is it better to dump all sfnt tag names? */
-    printf( "%s%s\n", Name_Field( "sfnt wrapped" ),
-            FT_IS_SFNT( face ) ? (char *)"yes" : (char *)"no" );
+    Print_Field( out, "sfnt wrapped", "%s\n",
+                 FT_IS_SFNT( face ) ? (char *)"yes" : (char *)"no" );
 
     /* isScalable? */
     comma_flag = 0;
-    printf( "%s", Name_Field( "type" ) );
+    Print_Label( out, "type" );
     if ( FT_IS_SCALABLE( face ) )
     {
-      Print_Comma( "scalable" );
+      Print_Comma( out, &comma_flag, "scalable" );
       if ( FT_HAS_MULTIPLE_MASTERS( face ) )
-        Print_Comma( "multiple masters" );
+        Print_Comma( out, &comma_flag, "multiple masters" );
     }
     if ( FT_HAS_FIXED_SIZES( face ) )
-      Print_Comma( "fixed size" );
-    printf( "\n" );
+      Print_Comma( out, &comma_flag, "fixed size" );
+    Print( out, "\n" );
 
     /* Direction */
     comma_flag = 0;
-    printf( "%s", Name_Field( "direction" ) );
+    Print_Label( out, "direction" );
     if ( FT_HAS_HORIZONTAL( face ) )
-      Print_Comma( "horizontal" );
+      Print_Comma( out, &comma_flag, "horizontal" );
 
     if ( FT_HAS_VERTICAL( face ) )
-      Print_Comma( "vertical" );
+      Print_Comma( out, &comma_flag, "vertical" );
 
-    printf( "\n" );
+    Print( out, "\n" );
 
-    printf( "%s%s\n", Name_Field( "fixed width" ),
-            FT_IS_FIXED_WIDTH( face ) ? (char *)"yes" : (char *)"no" );
+    Print_Field( out, "fixed width", "%s\n",
+                 FT_IS_FIXED_WIDTH( face ) ? (char *)"yes" : (char *)"no" );
 
-    printf( "%s%s\n", Name_Field( "glyph names" ),
-            FT_HAS_GLYPH_NAMES( face ) ? (char *)"yes" : (char *)"no" );
+    Print_Field( out, "glyph names", "%s\n",
+                 FT_HAS_GLYPH_NAMES( face ) ? (char *)"yes" : (char *)"no" );
 
     if ( FT_IS_SCALABLE( face ) )
     {
-      printf( "%s%d\n", Name_Field( "EM size" ), face->units_per_EM );
-      printf( "%s(%ld,%ld):(%ld,%ld)\n",
-              Name_Field( "global BBox" ),
-              face->bbox.xMin, face->bbox.yMin,
-              face->bbox.xMax, face->bbox.yMax );
+      Print_Field( out, "EM size", "%d\n", face->units_per_EM );
+      Print_Field( out, "global BBox", "(%ld,%ld):(%ld,%ld)\n",
+                   face->bbox.xMin, face->bbox.yMin,
+                   face->bbox.xMax, face->bbox.yMax );
       Print_Type_Number( ascender );
       Print_Type_Number( descender );
       Print_Type_Number( height );
@@ -347,52 +744,53 @@
 
 
   static void
-  Print_Sfnt_Names( FT_Face  face )
+  Print_Sfnt_Names( Output*  out,
+                    FT_Face  face )
   {
     FT_SfntName  name;
     FT_UInt      num_names, i;
 
 
-    printf( "font string entries\n" );
+    Print( out, "font string entries\n" );
 
     num_names = FT_Get_Sfnt_Name_Count( face );
     for ( i = 0; i < num_names; i++ )
     {
-      error = FT_Get_Sfnt_Name( face, i, &name );
-      if ( error == FT_Err_Ok )
+      if ( FT_Get_Sfnt_Name( face, i, &name ) == FT_Err_Ok )
       {
         const char*  NameID     = name_id( name.name_id );
         const char*  PlatformID = platform_id( name.platform_id );
 
 
         if ( NameID )
-          printf( "   %-15s [%s]", NameID, PlatformID );
+          Print( out, "   %-15s [%s]", NameID, PlatformID );
         else
-          printf( "   Name ID %-5d   [%s]", name.name_id, PlatformID );
+          Print( out, "   Name ID %-5d   [%s]", name.name_id, PlatformID );
 
         switch ( name.platform_id )
         {
         case TT_PLATFORM_APPLE_UNICODE:
-          fputs( ":\n", stdout );
+          Print( out, ":\n" );
           switch ( name.encoding_id )
           {
           case TT_APPLE_ID_DEFAULT:
           case TT_APPLE_ID_UNICODE_1_1:
           case TT_APPLE_ID_ISO_10646:
           case TT_APPLE_ID_UNICODE_2_0:
-            put_unicode_be16( name.string, name.string_len, 6, utf8 );
+            Print_Unicode( out, name.string, name.string_len, 6 );
             break;
 
           default:
-            printf( "{unsupported Unicode encoding %d}", name.encoding_id );
+            Print( out, "{unsupported Unicode encoding %d}",
+                   name.encoding_id );
             break;
           }
           break;
 
         case TT_PLATFORM_MACINTOSH:
           if ( name.language_id != TT_MAC_LANGID_ENGLISH )
-            printf( " (language=%u)", name.language_id );
-          fputs( ":\n", stdout );
+            Print( out, " (language=%u)", name.language_id );
+          Print( out, ":\n" );
 
           switch ( name.encoding_id )
           {
@@ -400,89 +798,90 @@
             /* FIXME: convert from MacRoman to ASCII/ISO8895-1/whatever */
             /* (MacRoman is mostly like ISO8895-1 but there are         */
             /* differences)                                             */
-            put_ascii( name.string, name.string_len, 6 );
+            Print_Ascii( out, name.string, name.string_len, 6 );
             break;
 
           default:
-            printf( "      [data in encoding %d]", name.encoding_id );
+            Print( out, "      [data in encoding %d]", name.encoding_id );
             break;
           }
 
           break;
 
         case TT_PLATFORM_ISO:
-          fputs( ":\n", stdout );
+          Print( out, ":\n" );
           switch ( name.encoding_id )
           {
           case TT_ISO_ID_7BIT_ASCII:
           case TT_ISO_ID_8859_1:
-            put_ascii( name.string, name.string_len, 6 );
+            Print_Ascii( out, name.string, name.string_len, 6 );
             break;
 
           case TT_ISO_ID_10646:
-            put_unicode_be16( name.string, name.string_len, 6, utf8 );
+            Print_Unicode( out, name.string, name.string_len, 6 );
             break;
 
           default:
-            printf( "{unsupported encoding %d}", name.encoding_id );
+            Print( out, "{unsupported encoding %d}", name.encoding_id );
             break;
           }
           break;
 
         case TT_PLATFORM_MICROSOFT:
           if ( name.language_id != TT_MS_LANGID_ENGLISH_UNITED_STATES )
-            printf( " (language=0x%04x)", name.language_id );
-          fputs( ":\n", stdout );
+            Print( out, " (language=0x%04x)", name.language_id );
+          Print( out, ":\n" );
 
           switch ( name.encoding_id )
           {
             /* TT_MS_ID_SYMBOL_CS is Unicode, similar to PID/EID=3/1 */
           case TT_MS_ID_SYMBOL_CS:
           case TT_MS_ID_UNICODE_CS:
-            put_unicode_be16( name.string, name.string_len, 6, utf8 );
+            Print_Unicode( out, name.string, name.string_len, 6 );
             break;
 
           default:
-            printf( "{unsupported encoding %d}", name.encoding_id );
+            Print( out, "{unsupported encoding %d}", name.encoding_id );
             break;
           }
 
           break;
 
         default:
-          printf( "{unsupported platform}" );
+          Print( out, "{unsupported platform}" );
           break;
         }
 
-        printf( "\n" );
+        Print( out, "\n" );
       }
     }
   }
 
 
   static void
-  Print_FontInfo_Dictionary( PS_FontInfo  fi )
-  {
-    printf( "/FontInfo dictionary\n" );
-
-    printf( "%s%s\n", Name_Field( "FamilyName" ),
-            fi->family_name );
-    printf( "%s%s\n", Name_Field( "FullName" ),
-            fi->full_name );
-    printf( "%s%d\n", Name_Field( "isFixedPitch" ),
-            fi->is_fixed_pitch );
-    printf( "%s%.3g\n", Name_Field( "ItalicAngle" ),
-            fi->italic_angle / 65536. );
-    printf( "%s%s\n", Name_Field( "Notice" ),
-            fi->notice );
-    printf( "%s%d\n", Name_Field( "UnderlinePosition" ),
-            fi->underline_position );
-    printf( "%s%u\n", Name_Field( "UnderlineThickness" ),
-            fi->underline_thickness );
-    printf( "%s%s\n", Name_Field( "version" ),
-            fi->version );
-    printf( "%s%s\n", Name_Field( "Weight" ),
-            fi->weight );
+  Print_FontInfo_Dictionary( Output*      out,
+                             PS_FontInfo  fi )
+  {
+    Print( out, "/FontInfo dictionary\n" );
+
+    Print_Field( out, "FamilyName", "%s\n",
+                 fi->family_name );
+    Print_Field( out, "FullName", "%s\n",
+                 fi->full_name );
+    Print_Field( out, "isFixedPitch", "%d\n",
+                 fi->is_fixed_pitch );
+    Print_Field( out, "ItalicAngle", "%.3g\n",
+                 fi->italic_angle / 65536. );
+    Print_Field( out, "Notice", "%s\n",
+                 fi->notice );
+    Print_Field( out, "UnderlinePosition", "%d\n",
+                 fi->underline_position );
+    Print_Field( out, "UnderlineThickness", "%u\n",
+                 fi->underline_thickness );
+    Print_Field( out, "version", "%s\n",
+                 fi->version );
+    Print_Field( out, "Weight", "%s\n",
+                 fi->weight );
   }
 
 
@@ -497,19 +896,23 @@
 #endif
   /*
    * Print a range specified by 2 integers.
+   * JSON output always uses a pair.
    */
   static void
-  Print_UInt_Range( FT_UInt  from,
+  Print_UInt_Range( Output*  out,
+                    FT_UInt  from,
                     FT_UInt  to,
                     char*    is_first )
   {
     if (!(*is_first))
-      printf(",");
+      Print( out, "," );
 
-    if ( from == to )
-      printf( "%d", from );
+    if ( json && from <= to )
+      Print( out, "[%d,%d]", from, to );
+    else if ( from == to )
+      Print( out, "%d", from );
     else if ( from < to )
-      printf( "%d-%d", from, to );
+      Print( out, "%d-%d", from, to );
 
     *is_first = 0;
   }
@@ -521,7 +924,8 @@
    *
    */
   static void
-  Print_CIDs( FT_Face  face )
+  Print_CIDs( Output*  out,
+              FT_Face  face )
   {
     FT_UInt  gid = 0, max_gid = FT_UINT_MAX;
     FT_UInt  cid = 0, rng_from = 0, rng_to = 0;
@@ -531,9 +935,12 @@
     if ( face->num_glyphs < 1 )
       return;
 
-    printf( "\n" );
-    printf( "CID coverage\n" );
-    printf( "   " );
+    if ( !json )
+    {
+      Print( out, "\n" );
+      Print( out, "CID coverage\n" );
+      Print( out, "   " );
+    }
 
     if ( (FT_ULong)face->num_glyphs < FT_UINT_MAX )
       max_gid = (FT_UInt)face->num_glyphs;
@@ -545,7 +952,7 @@
 
       if ( FT_CID_MAX < cid )
       {
-        fprintf( stderr, "gid=%d resulted too large CID=%d, ignore it\n", gid, cid );
+        Warn( out, "gid=%d resulted too large CID=%d, ignore it", gid, cid );
         break;
       }
 
@@ -564,13 +971,14 @@
       }
 
       /* Found a gap (rng_to + 1 < cid), print the last range */
-      Print_UInt_Range( rng_from, rng_to, &is_first_rng );
+      Print_UInt_Range( out, rng_from, rng_to, &is_first_rng );
       rng_to = rng_from = cid;
     }
 
-    Print_UInt_Range( rng_from, rng_to, &is_first_rng );
+    Print_UInt_Range( out, rng_from, rng_to, &is_first_rng );
 
-    printf( "\n" );
+    if ( !json )
+      Print( out, "\n" );
   }
 
 
@@ -579,7 +987,8 @@
    * but other tables, like gcid, can have ROS info too.
    */
   static void
-  Print_ROS_From_Face( FT_Face  face )
+  Print_ROS_From_Face( Output*  out,
+                       FT_Face  face )
   {
     FT_Bool      is_cid = 0;
     const char*  r = NULL;
@@ -596,80 +1005,82 @@
     if ( FT_Get_CID_Registry_Ordering_Supplement( face, &r, &o, &s ) )
       return;
 
-    printf( "\n" );
-    printf( "/CIDSystemInfo dictionary\n" );
+    Print( out, "\n" );
+    Print( out, "/CIDSystemInfo dictionary\n" );
 
     if ( r )
-      printf( "%s%s\n", Name_Field( "Registry" ), r );
+      Print_Field( out, "Registry", "%s\n", r );
 
     if ( o )
-      printf( "%s%s\n", Name_Field( "Ordering" ), o );
+      Print_Field( out, "Ordering", "%s\n", o );
 
-    printf( "%s%d\n", Name_Field( "Supplement" ), s );
+    Print_Field( out, "Supplement", "%d\n", s );
 
     if ( coverage > 0 )
-      Print_CIDs( face );
+      Print_CIDs( out, face );
   }
 
 
   static void
-  Print_FontPrivate_Dictionary( PS_Private  fp )
-  {
-    printf( "/Private dictionary\n" );
-
-    printf( "%s%d\n", Name_Field( "BlueFuzz" ),
-            fp->blue_fuzz );
-    printf( "%s%.6f\n", Name_Field( "BlueScale" ),
-            (double)fp->blue_scale / 65536 / 1000 );
-    printf( "%s%d\n", Name_Field( "BlueShift" ),
-            fp->blue_shift );
-    printf( "%s", Name_Field( "BlueValues" ) );
-    Print_Array( fp->blue_values,
-                 fp->num_blue_values );
-    printf( "%s%.4f\n", Name_Field( "ExpansionFactor" ),
-            (double)fp->expansion_factor / 65536 );
-    printf( "%s", Name_Field( "FamilyBlues" ) );
-    Print_Array( fp->family_blues,
-                 fp->num_family_blues );
-    printf( "%s", Name_Field( "FamilyOtherBlues" ) );
-    Print_Array( fp->family_other_blues,
-                 fp->num_family_other_blues );
-    printf( "%s%s\n", Name_Field( "ForceBold" ),
-            fp->force_bold ? "true" : "false" );
-    printf( "%s%ld\n", Name_Field( "LanguageGroup" ),
-            fp->language_group );
-    printf( "%s%d\n", Name_Field( "lenIV" ),
-            fp->lenIV );
-    printf( "%s", Name_Field( "MinFeature" ) );
-    Print_Array( fp->min_feature,
-                 2 );
-    printf( "%s", Name_Field( "OtherBlues" ) );
-    Print_Array( fp->other_blues,
-                 fp->num_other_blues );
-    printf( "%s%ld\n", Name_Field( "password" ),
-            fp->password );
-    printf( "%s%s\n", Name_Field( "RndStemUp" ),
-            fp->round_stem_up ? "true" : "false" );
+  Print_FontPrivate_Dictionary( Output*     out,
+                                PS_Private  fp )
+  {
+    Print( out, "/Private dictionary\n" );
+
+    Print_Field( out, "BlueFuzz", "%d\n",
+                 fp->blue_fuzz );
+    Print_Field( out, "BlueScale", "%.6f\n",
+                 (double)fp->blue_scale / 65536 / 1000 );
+    Print_Field( out, "BlueShift", "%d\n",
+                 fp->blue_shift );
+    Print_Label( out, "BlueValues" );
+    Print_Array( out, fp->blue_values,
+                      fp->num_blue_values );
+    Print_Field( out, "ExpansionFactor", "%.4f\n",
+                 (double)fp->expansion_factor / 65536 );
+    Print_Label( out, "FamilyBlues" );
+    Print_Array( out, fp->family_blues,
+                      fp->num_family_blues );
+    Print_Label( out, "FamilyOtherBlues" );
+    Print_Array( out, fp->family_other_blues,
+                      fp->num_family_other_blues );
+    Print_Field( out, "ForceBold", "%s\n",
+                 fp->force_bold ? "true" : "false" );
+    Print_Field( out, "LanguageGroup", "%ld\n",
+                 fp->language_group );
+    Print_Field( out, "lenIV", "%d\n",
+                 fp->lenIV );
+    Print_Label( out, "MinFeature" );
+    Print_Array( out, fp->min_feature,
+                      2 );
+    Print_Label( out, "OtherBlues" );
+    Print_Array( out, fp->other_blues,
+                      fp->num_other_blues );
+    Print_Field( out, "password", "%ld\n",
+                 fp->password );
+    Print_Field( out, "RndStemUp", "%s\n",
+                 fp->round_stem_up ? "true" : "false" );
     /* casting to `FT_Short` is not really correct, but... */
-    printf( "%s", Name_Field( "StdHW" ) );
-    Print_Array( (FT_Short*)fp->standard_width,
-                 1 );
-    printf( "%s", Name_Field( "StdVW" ) );
-    Print_Array( (FT_Short*)fp->standard_height,
-                 1 );
-    printf( "%s", Name_Field( "StemSnapH" ) );
-    Print_Array( fp->snap_widths,
-                 fp->num_snap_widths );
-    printf( "%s", Name_Field( "StemSnapV" ) );
-    Print_Array( fp->snap_heights,
-                 fp->num_snap_heights );
-    printf( "%s%d\n", Name_Field( "UniqueID" ),
-            fp->unique_id );
+    Print_Label( out, "StdHW" );
+    Print_Array( out, (FT_Short*)fp->standard_width,
+                      1 );
+    Print_Label( out, "StdVW" );
+    Print_Array( out, (FT_Short*)fp->standard_height,
+                      1 );
+    Print_Label( out, "StemSnapH" );
+    Print_Array( out, fp->snap_widths,
+                      fp->num_snap_widths );
+    Print_Label( out, "StemSnapV" );
+    Print_Array( out, fp->snap_heights,
+                      fp->num_snap_heights );
+    Print_Field( out, "UniqueID", "%d\n",
+                 fp->unique_id );
   }
 
 
   static void
-  Print_Sfnt_Tables( FT_Face  face )
+  Print_Sfnt_Tables( Output*  out,
+                     FT_Face  face )
   {
     FT_ULong  num_tables, i;
     FT_ULong  tag, length;
@@ -678,7 +1089,7 @@
 
     FT_Sfnt_Table_Info( face, 0, NULL, &num_tables );
 
-    printf( "font tables (%lu)\n", num_tables );
+    Print( out, "font tables (%lu)\n", num_tables );
 
     for ( i = 0; i < num_tables; i++ )
     {
@@ -692,27 +1103,28 @@
       else
         continue;
 
-      printf( "  %2lu: %c%c%c%c   %02X %02X %02X %02X ...\n", i,
-                                   (FT_Char)( tag >> 24 ),
-                                   (FT_Char)( tag >> 16 ),
-                                   (FT_Char)( tag >>  8 ),
-                                   (FT_Char)( tag ),
-                                       (FT_UInt)buffer[0],
-                                       (FT_UInt)buffer[1],
-                                       (FT_UInt)buffer[2],
-                                       (FT_UInt)buffer[3] );
+      Print( out, "  %2lu: %c%c%c%c   %02X %02X %02X %02X ...\n", i,
+             (FT_Char)( tag >> 24 ),
+             (FT_Char)( tag >> 16 ),
+             (FT_Char)( tag >>  8 ),
+             (FT_Char)( tag ),
+             (FT_UInt)buffer[0],
+             (FT_UInt)buffer[1],
+             (FT_UInt)buffer[2],
+             (FT_UInt)buffer[3] );
     }
   }
 
 
   static void
-  Print_Fixed( FT_Face  face )
+  Print_Fixed( Output*  out,
+               FT_Face  face )
   {
     int  i;
 
 
     /* num_fixed_size */
-    printf( "fixed size\n" );
+    Print( out, "fixed size\n" );
 
     /* available size */
     for ( i = 0; i < face->num_fixed_sizes; i++ )
@@ -720,17 +1132,18 @@
       FT_Bitmap_Size*  bsize = face->available_sizes + i;
 
 
-      printf( "   %3d: height %d, width %d\n",
-              i, bsize->height, bsize->width );
-      printf( "        size %.3f, x_ppem %.3f, y_ppem %.3f\n",
-              bsize->size / 64.0,
-              bsize->x_ppem / 64.0, bsize->y_ppem / 64.0 );
+      Print( out, "   %3d: height %d, width %d\n",
+             i, bsize->height, bsize->width );
+      Print( out, "        size %.3f, x_ppem %.3f, y_ppem %.3f\n",
+             bsize->size / 64.0,
+             bsize->x_ppem / 64.0, bsize->y_ppem / 64.0 );
     }
   }
 
 
   static void
-  Print_Charmaps( FT_Face  face )
+  Print_Charmaps( Output*  out,
+                  FT_Face  face )
   {
     int  i, active = -1;
 
@@ -739,7 +1152,7 @@
       active = FT_Get_Charmap_Index( face->charmap );
 
     /* CharMaps */
-    printf( "charmaps (%d)\n", face->num_charmaps );
+    Print( out, "charmaps (%d)\n", face->num_charmaps );
 
     for ( i = 0; i < face->num_charmaps; i++ )
     {
@@ -752,31 +1165,31 @@
       FT_WinFNT_HeaderRec  header;
 
 
-      printf( cmap->encoding ? " %c%2d: %c%c%c%c"
-                             : " %c%2d: none",
-              i == active ? '*' : ' ',
-              i,
-              cmap->encoding >> 24,
-              cmap->encoding >> 16,
-              cmap->encoding >> 8,
-              cmap->encoding );
+      Print( out, cmap->encoding ? " %c%2d: %c%c%c%c"
+                                 : " %c%2d: none",
+             i == active ? '*' : ' ',
+             i,
+             cmap->encoding >> 24,
+             cmap->encoding >> 16,
+             cmap->encoding >> 8,
+             cmap->encoding );
 
-      printf( ", platform %u, encoding %2u",
-              cmap->platform_id,
-              cmap->encoding_id );
+      Print( out, ", platform %u, encoding %2u",
+             cmap->platform_id,
+             cmap->encoding_id );
 
       if ( format >= 0 )
-        printf( lang_id != 0xFFFFFFFFUL ? ", format %2lu, language %lu "
-                                        : ", format %2lu, UVS",
-                format, lang_id );
+        Print( out, lang_id != 0xFFFFFFFFUL ? ", format %2lu, language %lu "
+                                            : ", format %2lu, UVS",
+               format, lang_id );
       else if ( !FT_Get_BDF_Charset_ID( face, &encoding, &registry ) )
-        printf( ", charset %s-%s", registry, encoding );
+        Print( out, ", charset %s-%s", registry, encoding );
       else if ( !FT_Get_WinFNT_Header( face, &header ) )
-        printf( header.charset < 10 ? ", charset %hhu"
-                                    : ", charset %hhu <%hhX>",
-                header.charset, header.charset );
+        Print( out, header.charset < 10 ? ", charset %hhu"
+                                        : ", charset %hhu <%hhX>",
+               header.charset, header.charset );
 
-      printf ( "\n" );
+      Print( out, "\n" );
 
       if ( lang_id == 0xFFFFFFFFUL )  /* nothing further for UVS */
         continue;
@@ -798,10 +1211,10 @@
           else
             buf[0] = '\0';
 
-          printf( "      0x%04lx => %u %s\n", charcode, gindex, buf );
+          Print( out, "      0x%04lx => %u %s\n", charcode, gindex, buf );
           charcode = FT_Get_Next_Char( face, charcode, &gindex );
         }
-        printf( "\n" );
+        Print( out, "\n" );
       }
       else if ( coverage == 1 )
       {
@@ -825,8 +1238,8 @@
           }
           else
           {
-            printf( f1, last );
-            printf( f2, next );
+            Print( out, f1, last );
+            Print( out, f2, next );
 
             f1 = "";
             f2 = f3 = ",%04lx";
@@ -835,8 +1248,8 @@
           last = next;
           next = FT_Get_Next_Char( face, last, &gindex );
         }
-        printf( f1, last );
-        printf( "\n" );
+        Print( out, f1, last );
+        Print( out, "\n" );
       }
     }
   }
@@ -855,8 +1268,7 @@
 
     for ( i = 0; i < num_names; i++ )
     {
-      error = FT_Get_Sfnt_Name( face, i, &name );
-      if ( error )
+      if ( FT_Get_Sfnt_Name( face, i, &name ) )
         continue;
 
       if ( name.name_id == strid )
@@ -878,12 +1290,14 @@
 
 
   static void
-  Print_MM_Info( FT_Face  face )
+  Print_MM_Info( Output*  out,
+                 FT_Face  face )
   {
     FT_MM_Var*       mm;
     FT_Multi_Master  dummy;
     FT_SfntName      name;
     FT_UInt          is_GX, i;
+    FT_Error         error;
 
 
     /* MM or GX axes */
@@ -893,13 +1307,13 @@
     error = FT_Get_MM_Var( face, &mm );
     if ( error )
     {
-      printf( "   Can't access axis data (error code %d)\n", error );
+      Print( out, "   Can't access axis data (error code %d)\n", error );
       return;
     }
 
-    printf( "%s info\n", is_GX ? "GX" : "MM" );
+    Print( out, "%s info\n", is_GX ? "GX" : "MM" );
 
-    printf( "  axes (%u)\n", mm->num_axis );
+    Print( out, "  axes (%u)\n", mm->num_axis );
 
     for ( i = 0; i < mm->num_axis; i++ )
     {
@@ -908,21 +1322,21 @@
       if ( is_GX )
         get_english_name_entry( face, mm->axis[i].strid, &name );
 
-      printf( "    %u: ", i );
+      Print( out, "    %u: ", i );
       if ( name.string )
       {
         if ( name.platform_id == TT_PLATFORM_MACINTOSH )
-          put_ascii( name.string, name.string_len, 0 );
+          Print_Ascii( out, name.string, name.string_len, 0 );
         else
-          put_unicode_be16( name.string, name.string_len, 0, utf8 );
+          Print_Unicode( out, name.string, name.string_len, 0 );
       }
       else
-        printf( "%s", mm->axis[i].name );
+        Print( out, "%s", mm->axis[i].name );
 
-      printf( ", [%g;%g], default %g\n",
-              mm->axis[i].minimum / 65536.0,
-              mm->axis[i].maximum / 65536.0,
-              mm->axis[i].def / 65536.0 );
+      Print( out, ", [%g;%g], default %g\n",
+             mm->axis[i].minimum / 65536.0,
+             mm->axis[i].maximum / 65536.0,
+             mm->axis[i].def / 65536.0 );
     }
 
     if ( is_GX )
@@ -951,8 +1365,8 @@
       if ( ps_name == NULL )
         ps_name = "UNAVAILABLE";
 
-      printf( "\n"
-              "  VF PS name prefix: %s\n", ps_name );
+      Print( out, "\n"
+                  "  VF PS name prefix: %s\n", ps_name );
 
       /* Switch off variation font handling. */
       FT_Set_Var_Design_Coordinates( face, 0, NULL );
@@ -968,8 +1382,8 @@
       FT_Get_Default_Named_Instance( face, &default_named_instance );
       default_named_instance--;   /* `named_styles` is a zero-based array */
 
-      printf( "\n" );
-      printf( "  named instances (%u)\n", instance_count );
+      Print( out, "\n" );
+      Print( out, "  named instances (%u)\n", instance_count );
 
       for ( i = 0; i < instance_count; i++ )
       {
@@ -981,48 +1395,48 @@
 
         /* Since FreeType starts the instance numbering with value 1 */
         /* in `face_index` we report the same here for consistency.  */
-        pos = printf( "    %u: ", i + 1);
+        pos = Print( out, "    %u: ", i + 1);
 
         name.string = NULL;
         get_english_name_entry( face, named_styles[i].strid, &name );
         if ( name.string )
         {
           if ( name.platform_id == TT_PLATFORM_MACINTOSH )
-            put_ascii( name.string, name.string_len, 0 );
+            Print_Ascii( out, name.string, name.string_len, 0 );
           else
-            put_unicode_be16( name.string, name.string_len, 0, utf8 );
+            Print_Unicode( out, name.string, name.string_len, 0 );
         }
         else
-          printf( "UNAVAILABLE" );
-        printf( "%s\n", i == default_named_instance ? " (default)" : "" );
+          Print( out, "UNAVAILABLE" );
+        Print( out, "%s\n", i == default_named_instance ? " (default)" : "" );
 
         name.string = NULL;
         get_english_name_entry( face, named_styles[i].psid, &name );
-        printf( "%*s   PS: ", pos, "" );
+        Print( out, "%*s   PS: ", pos, "" );
         if ( name.string )
         {
           if ( name.platform_id == TT_PLATFORM_MACINTOSH )
-            put_ascii( name.string, name.string_len, 0 );
+            Print_Ascii( out, name.string, name.string_len, 0 );
           else
-            put_unicode_be16( name.string, name.string_len, 0, utf8 );
+            Print_Unicode( out, name.string, name.string_len, 0 );
         }
         else
-          printf( "UNAVAILABLE" );
-        printf( "\n" );
+          Print( out, "UNAVAILABLE" );
+        Print( out, "\n" );
 
         semicolon = 0;
         c         = named_styles[i].coords;
 
-        printf( "%*scoord: (", pos, "" );
+        Print( out, "%*scoord: (", pos, "" );
         for ( j = 0; j < mm->num_axis; j++ )
         {
-          printf( "%s%g", semicolon ? ";" : "", c[j] / 65536.0);
+          Print( out, "%s%g", semicolon ? ";" : "", c[j] / 65536.0);
           semicolon = 1;
         }
-        printf( ")\n" );
+        Print( out, ")\n" );
       }
 
-      printf( "\n" );
+      Print( out, "\n" );
     }
 
   Exit:
@@ -1030,8 +1444,208 @@
   }
 
 
+#define PEEK_USHORT( p )  (FT_UInt16)( (p)[0] << 8 | (p)[1] )
+#define PEEK_ULONG( p )   ( (FT_UInt32)(p)[0] << 24 | \
+                            (FT_UInt32)(p)[1] << 16 | \
+                            (FT_UInt32)(p)[2] << 8  | \
+                            (FT_UInt32)(p)[3]       )
+
+
+  /* Look up a table of an SFNT font or collection in the mapped file. */
+  /* WOFF and other wrapped formats are not found.                     */
+  static int
+  Find_Table( FontFile*  file,
+              FT_Long    face_index,
+              FT_ULong   tag,
+              FT_ULong*  aoffset,
+              FT_ULong*  alength )
+  {
+    const FT_Byte*  base;
+    FT_UInt32       dir = 0, version;
+    FT_UInt         num_tables, i;
+
+
+    if ( !file->mapped )
+    {
+      file->base   = (const FT_Byte*)ft_map_file( file->path, &file->size );
+      file->mapped = 1;
+    }
+
+    base = file->base;
+    if ( !base || file->size < 12 )
+      return 0;
+
+    face_index &= 0xFFFF;   /* ignore named instances */
+
+    if ( PEEK_ULONG( base ) == TTAG_ttcf )
+    {
+      if ( (FT_ULong)face_index >= PEEK_ULONG( base + 8 )     ||
+           12 + 4 * (size_t)face_index + 4 > file->size )
+        return 0;
+
+      dir = PEEK_ULONG( base + 12 + 4 * face_index );
+    }
+    else if ( face_index )
+      return 0;
+
+    if ( (size_t)dir + 12 > file->size )
+      return 0;
+
+    version = PEEK_ULONG( base + dir );
+    if ( version != 0x00010000UL && version != TTAG_true &&
+         version != TTAG_OTTO                            )
+      return 0;
+
+    num_tables = PEEK_USHORT( base + dir + 4 );
+    if ( (size_t)dir + 12 + 16 * (size_t)num_tables > file->size )
+      return 0;
+
+    for ( i = 0; i < num_tables; i++ )
+    {
+      const FT_Byte*  rec = base + dir + 12 + 16 * i;
+
+
+      if ( PEEK_ULONG( rec ) == tag )
+      {
+        *aoffset = PEEK_ULONG( rec + 8 );
+        *alength = PEEK_ULONG( rec + 12 );
+
+        return *aoffset <= file->size              &&
+               *alength <= file->size - *aoffset;
+      }
+    }
+
+    return 0;
+  }
+
+
+  /* Get a table, in place if possible, with at least `min_length' */
+  /* bytes; if `min_length' is zero, get the whole table.  Tables   */
+  /* that are not found in the mapped file or that are too short    */
+  /* are loaded by FreeType into a heap buffer.                     */
+  static FT_Error
+  Load_Table( FontFile*  file,
+              FT_Face    face,
+              FT_ULong   tag,
+              FT_ULong   min_length,
+              Table*     table )
+  {
+    FT_ULong  offset, length;
+    FT_Error  error;
+
+
+    table->copy = NULL;
+
+    if ( Find_Table( file, face->face_index, tag, &offset, &length ) &&
+         length >= min_length                                        )
+    {
+      table->data   = file->base + offset;
+      table->length = min_length ? min_length : length;
+
+      return FT_Err_Ok;
+    }
+
+    length = min_length;
+    if ( !length )
+    {
+      error = FT_Load_Sfnt_Table( face, tag, 0, NULL, &length );
+      if ( error )
+        return error;
+    }
+
+    table->copy = (FT_Byte*)malloc( length ? length : 1 );
+    if ( !table->copy )
+      return FT_Err_Out_Of_Memory;
+
+    error = FT_Load_Sfnt_Table( face, tag, 0, table->copy, &length );
+    if ( error )
+    {
+      free( table->copy );
+      table->copy = NULL;
+      return error;
+    }
+
+    table->data   = table->copy;
+    table->length = length;
+
+    return FT_Err_Ok;
+  }
+
+
+  static void
+  Release_Table( Table*  table )
+  {
+    free( table->copy );
+    table->copy = NULL;
+    table->data = NULL;
+  }
+
+
+  /* the data of glyph `i' in the `glyf' table, from `loc' to `end' */
+  static void
+  Get_Glyph_Range( const FT_Byte*  offset,
+                   FT_Short        long_format,
+                   FT_ULong        glyf_length,
+                   FT_Int          i,
+                   FT_UInt32*      aloc,
+                   FT_UInt32*      aend )
+  {
+    FT_UInt32  loc, end;
+
+
+    if ( long_format )
+    {
+      loc = PEEK_ULONG( offset + 4 * i );
+      end = PEEK_ULONG( offset + 4 * i + 4 );
+    }
+    else
+    {
+      loc = (FT_UInt32)PEEK_USHORT( offset + 2 * i     ) << 1;
+      end = (FT_UInt32)PEEK_USHORT( offset + 2 * i + 2 ) << 1;
+    }
+
+    if ( end > glyf_length )
+      end = glyf_length;
+
+    *aloc = loc;
+    *aend = end;
+  }
+
+
+  /* Return the offset after the component at `loc' of a composite */
+  /* glyph that ends at `end', or 0 if the component is truncated.  */
+  static FT_UInt32
+  Skip_Component( const FT_Byte*  buffer,
+                  FT_UInt32       loc,
+                  FT_UInt32       end,
+                  FT_UShort*      aflags,
+                  FT_UShort*      agid )
+  {
+    FT_UShort  flags;
+
+
+    if ( loc + 3 >= end )
+      return 0;
+
+    flags   = PEEK_USHORT( buffer + loc );
+    *agid   = PEEK_USHORT( buffer + loc + 2 );
+    *aflags = flags;
+
+    loc += 4;
+
+    loc += flags & FT_SUBGLYPH_FLAG_ARGS_ARE_WORDS ? 4 : 2;
+
+    loc += flags & FT_SUBGLYPH_FLAG_SCALE ? 2
+             : flags & FT_SUBGLYPH_FLAG_XY_SCALE ? 4
+                 : flags & FT_SUBGLYPH_FLAG_2X2 ? 8 : 0;
+
+    return loc <= end ? loc : 0;
+  }
+
+
   static void
-  Print_Bytecode( FT_Byte*     buffer,
+  Print_Bytecode( Output*      out,
+                  FT_Byte*     buffer,
                   FT_UShort    length,
                   const char*  tag )
   {
@@ -1042,11 +1656,11 @@
     for ( i = 0; i < length; i++ )
     {
       if ( ( i & 15 ) == 0 )
-        printf( "\n%s:%04hx ", tag, i );
+        Print( out, "\n%s:%04hx ", tag, i );
 
       if ( j == 0 )
       {
-        printf( " %02x", (FT_UInt)buffer[i] );
+        Print( out, " %02x", (FT_UInt)buffer[i] );
 
         if ( buffer[i] == 0x40 )
           j = -1;
@@ -1059,7 +1673,7 @@
       }
       else
       {
-        printf( "_%02x", (FT_UInt)buffer[i] );
+        Print( out, "_%02x", (FT_UInt)buffer[i] );
 
         if ( j == -1 )
           j = buffer[i];
@@ -1069,12 +1683,14 @@
           j--;
       }
     }
-    printf( "\n" );
+    Print( out, "\n" );
   }
 
 
   static void
-  Print_Programs( FT_Face  face )
+  Print_Programs( Output*    out,
+                  FontFile*  file,
+                  FT_Face    face )
   {
     FT_Int    i, num_glyphs = (FT_UInt)face->num_glyphs;
     FT_ULong  fpgm_length = 0;
@@ -1082,7 +1698,13 @@
     FT_ULong  loca_length;
     FT_ULong  glyf_length = 0;
     FT_Byte*  buffer = NULL;
-    FT_Byte*  offset = NULL;
+    FT_Error  error;
+
+    const FT_Byte*  offset;
+    const FT_Byte*  glyph_data;
+
+    Table  loca = { NULL, 0, NULL };
+    Table  glyf = { NULL, 0, NULL };
 
     TT_Header*  head;
 
@@ -1099,8 +1721,8 @@
     if ( error )
       goto Exit;
 
-    printf( "font program" );
-    Print_Bytecode( buffer, (FT_UShort)fpgm_length, "fpgm" );
+    Print( out, "font program" );
+    Print_Bytecode( out, buffer, (FT_UShort)fpgm_length, "fpgm" );
 
   Prep:
     error = FT_Load_Sfnt_Table( face, TTAG_prep, 0, NULL, &prep_length );
@@ -1115,8 +1737,8 @@
     if ( error )
       goto Exit;
 
-    printf( "\ncontrol value program" );
-    Print_Bytecode( buffer, (FT_UShort)prep_length, "prep" );
+    Print( out, "\ncontrol value program" );
+    Print_Bytecode( out, buffer, (FT_UShort)prep_length, "prep" );
 
   Glyf:
     head =     (TT_Header*)FT_Get_Sfnt_Table( face, FT_SFNT_HEAD );
@@ -1125,25 +1747,18 @@
 
     loca_length = ( head->Index_To_Loc_Format ? 4 : 2 ) * ( num_glyphs + 1 );
 
-    offset = (FT_Byte*)malloc( loca_length );
-    if ( offset == NULL )
-      goto Exit;
-
-    error = FT_Load_Sfnt_Table( face, TTAG_loca, 0, offset, &loca_length );
+    /* the glyph programs are dumped in place if the file is mapped */
+    error = Load_Table( file, face, TTAG_loca, loca_length, &loca );
     if ( error )
       goto Exit;
 
-    error = FT_Load_Sfnt_Table( face, TTAG_glyf, 0, NULL, &glyf_length );
-    if ( error || glyf_length == 0 )
-      goto Exit;
-
-    buffer = (FT_Byte*)realloc( buffer, glyf_length );
-    if ( buffer == NULL )
+    error = Load_Table( file, face, TTAG_glyf, 0, &glyf );
+    if ( error || glyf.length == 0 )
       goto Exit;
 
-    error = FT_Load_Sfnt_Table( face, TTAG_glyf, 0, buffer, &glyf_length );
-    if ( error )
-      goto Exit;
+    offset      = loca.data;
+    glyph_data  = glyf.data;
+    glyf_length = glyf.length;
 
     for ( i = 0; i < num_glyphs; i++ )
     {
@@ -1152,38 +1767,19 @@
       char       tag[5];
 
 
-      if ( head->Index_To_Loc_Format )
-      {
-        loc = (FT_UInt32)offset[4 * i    ] << 24 |
-              (FT_UInt32)offset[4 * i + 1] << 16 |
-              (FT_UInt32)offset[4 * i + 2] << 8  |
-              (FT_UInt32)offset[4 * i + 3];
-        end = (FT_UInt32)offset[4 * i + 4] << 24 |
-              (FT_UInt32)offset[4 * i + 5] << 16 |
-              (FT_UInt32)offset[4 * i + 6] << 8  |
-              (FT_UInt32)offset[4 * i + 7];
-      }
-      else
-      {
-        loc = (FT_UInt32)offset[2 * i    ] << 9 |
-              (FT_UInt32)offset[2 * i + 1] << 1;
-        end = (FT_UInt32)offset[2 * i + 2] << 9 |
-              (FT_UInt32)offset[2 * i + 3] << 1;
-      }
-
-      if ( end > glyf_length )
-        end = glyf_length;
+      Get_Glyph_Range( offset, head->Index_To_Loc_Format, glyf_length, i,
+                       &loc, &end );
 
       if ( loc == end )
         continue;
 
       if ( loc + 1 >= end )
       {
-        fprintf( stderr, "glyph %d: invalid offset (%d)\n", i, loc );
+        Warn( out, "glyph %d: invalid offset (%d)", i, loc );
         continue;
       }
 
-      len  = (FT_UInt16)( buffer[loc] << 8 | buffer[loc + 1] );
+      len  = (FT_UInt16)( glyph_data[loc] << 8 | glyph_data[loc + 1] );
       loc += 10;
 
       if ( (FT_Int16)len < 0 )  /* composite */
@@ -1195,11 +1791,11 @@
         {
           if ( loc + 1 >= end )
           {
-            fprintf( stderr, "glyph %d: invalid offset (%d)\n", i, loc );
+            Warn( out, "glyph %d: invalid offset (%d)", i, loc );
             goto Continue;
           }
 
-          flags = (FT_UInt16)( buffer[loc] << 8 | buffer[loc + 1] );
+          flags = (FT_UInt16)( glyph_data[loc] << 8 | glyph_data[loc + 1] );
 
           loc += 4;
 
@@ -1220,11 +1816,11 @@
       {
         /* zero-contour glyphs can have no data */
         if ( len )
-          fprintf( stderr, "glyph %d: invalid offset (%d)\n", i, loc );
+          Warn( out, "glyph %d: invalid offset (%d)", i, loc );
         continue;
       }
 
-      len = (FT_UInt16)( buffer[loc] << 8 | buffer[loc + 1] );
+      len = (FT_UInt16)( glyph_data[loc] << 8 | glyph_data[loc + 1] );
 
       if ( len == 0 )
         continue;
@@ -1233,13 +1829,13 @@
 
       if ( loc + len > end )
       {
-        fprintf( stderr, "glyph %d: invalid size (%d)\n", i, len );
+        Warn( out, "glyph %d: invalid size (%d)", i, len );
         continue;
       }
 
       snprintf( tag, sizeof ( tag ), "%04hx", i );
-      printf( "\nglyph %d (%.4s)", i, tag );
-      Print_Bytecode( buffer + loc, len, tag );
+      Print( out, "\nglyph %d (%.4s)", i, tag );
+      Print_Bytecode( out, (FT_Byte*)glyph_data + loc, len, tag );
 
     Continue:
       ;
@@ -1247,115 +1843,158 @@
 
   Exit:
     free( buffer );
-    free( offset );
+    Release_Table( &loca );
+    Release_Table( &glyf );
   }
 
 
-  static void
-  Print_Glyfs( FT_Face  face )
+  /* One more than the deepest component of the composite glyph at */
+  /* `loc', with the depths of simple glyphs being zero.            */
+  static FT_Byte
+  Composite_Depth( const FT_Byte*  buffer,
+                   FT_UInt32       loc,
+                   FT_UInt32       end,
+                   const FT_Byte*  depth,
+                   FT_Int          num_glyphs )
+  {
+    FT_UShort  flags, gid;
+    FT_Byte    result = 1;
+
+
+    do
+    {
+      loc = Skip_Component( buffer, loc, end, &flags, &gid );
+      if ( !loc )
+        break;
+
+      if ( gid < num_glyphs && depth[gid] >= result )
+        result = depth[gid] < GLYF_MAX_DEPTH ? depth[gid] + 1
+                                             : GLYF_MAX_DEPTH;
+    } while ( flags & 0x20 );  /* more components */
+
+    return result;
+  }
+
+
+  /* Count the glyphs in the `glyf' table by kind, with their     */
+  /* contours, points, instructions, and components.  The tables  */
+  /* are scanned in place if the font file is mapped.  Return 0 if */
+  /* there is no such table or it cannot be loaded.                */
+  static int
+  Count_Glyfs( Output*     out,
+               FontFile*   file,
+               FT_Face     face,
+               GlyfCount*  count )
   {
     FT_Int    i, num_glyphs = (FT_Int)face->num_glyphs;
     FT_ULong  loca_length;
-    FT_ULong  glyf_length = 0;
-    FT_Byte*  buffer = NULL;
-    FT_Byte*  offset = NULL;
+    FT_ULong  glyf_length;
+    FT_Byte*  depth  = NULL;
+    FT_Error  error;
+    int       result = 0;
+    int       pass, changed;
 
-    FT_Int    simple            = 0;
-    FT_Int    simple_overlap    = 0;
-    FT_Int    composite         = 0;
-    FT_Int    composite_overlap = 0;
-    FT_Int    empty             = 0;
+    const FT_Byte*  offset;
+    const FT_Byte*  buffer;
+
+    Table  loca = { NULL, 0, NULL };
+    Table  glyf = { NULL, 0, NULL };
 
     TT_Header*  head;
 
 
+    memset( count, 0, sizeof ( *count ) );
+
     head = (TT_Header*)FT_Get_Sfnt_Table( face, FT_SFNT_HEAD );
     if ( head == NULL )
-      return;
+      return 0;
 
     loca_length = ( head->Index_To_Loc_Format ? 4 : 2 ) * ( num_glyphs + 1 );
 
-    offset = (FT_Byte*)malloc( loca_length );
-    if ( offset == NULL )
-      goto Exit;
-
-    error = FT_Load_Sfnt_Table( face, TTAG_loca, 0, offset, &loca_length );
+    error = Load_Table( file, face, TTAG_loca, loca_length, &loca );
     if ( error )
       goto Exit;
 
-    error = FT_Load_Sfnt_Table( face, TTAG_glyf, 0, NULL, &glyf_length );
-    if ( error || glyf_length == 0 )
+    error = Load_Table( file, face, TTAG_glyf, 0, &glyf );
+    if ( error || glyf.length == 0 )
       goto Exit;
 
-    buffer = (FT_Byte*)malloc( glyf_length );
-    if ( buffer == NULL )
-      goto Exit;
+    offset      = loca.data;
+    buffer      = glyf.data;
+    glyf_length = glyf.length;
 
-    error = FT_Load_Sfnt_Table( face, TTAG_glyf, 0, buffer, &glyf_length );
-    if ( error )
+    /* the depth of each composite glyph, or zero */
+    depth = (FT_Byte*)calloc( (size_t)num_glyphs + 1, 1 );
+    if ( depth == NULL )
       goto Exit;
 
     for ( i = 0; i < num_glyphs; i++ )
     {
       FT_UInt32  loc, end;
       FT_UInt16  len;
-      FT_UShort  flags;
+      FT_UShort  flags, gid;
 
 
-      if ( head->Index_To_Loc_Format )
-      {
-        loc = (FT_UInt32)offset[4 * i    ] << 24 |
-              (FT_UInt32)offset[4 * i + 1] << 16 |
-              (FT_UInt32)offset[4 * i + 2] << 8  |
-              (FT_UInt32)offset[4 * i + 3];
-        end = (FT_UInt32)offset[4 * i + 4] << 24 |
-              (FT_UInt32)offset[4 * i + 5] << 16 |
-              (FT_UInt32)offset[4 * i + 6] << 8  |
-              (FT_UInt32)offset[4 * i + 7];
-      }
-      else
-      {
-        loc = (FT_UInt32)offset[2 * i    ] << 9 |
-              (FT_UInt32)offset[2 * i + 1] << 1;
-        end = (FT_UInt32)offset[2 * i + 2] << 9 |
-              (FT_UInt32)offset[2 * i + 3] << 1;
-      }
-
-      if ( end > glyf_length )
-        end = glyf_length;
+      Get_Glyph_Range( offset, head->Index_To_Loc_Format, glyf_length, i,
+                       &loc, &end );
 
       if ( loc == end )
       {
-        empty++;
+        count->empty++;
         continue;
       }
 
       if ( end == 0 || loc >= end - 1 )
       {
-        fprintf( stderr, "glyph %d: invalid offset (%u)\n", i, loc );
+        Warn( out, "glyph %d: invalid offset (%u)", i, loc );
         continue;
       }
 
-      len  = (FT_UInt16)( buffer[loc] << 8 | buffer[loc + 1] );
+      len  = PEEK_USHORT( buffer + loc );
       loc += 10;
 
       if ( (FT_Int16)len < 0 )  /* composite */
       {
-        composite++;
+        count->composite++;
 
         if ( loc + 1 >= end )
         {
-          fprintf( stderr, "glyph %d: invalid offset (%u)\n", i, loc );
+          Warn( out, "glyph %d: invalid offset (%u)", i, loc );
           continue;
         }
 
-        flags = (FT_UInt16)( buffer[loc] << 8 | buffer[loc + 1] );
-        composite_overlap += ( flags & 0x400 ) >> 10;
+        flags = PEEK_USHORT( buffer + loc );
+        count->composite_overlap += ( flags & 0x400 ) >> 10;
+
+        depth[i] = 1;
+
+        do
+        {
+          loc = Skip_Component( buffer, loc, end, &flags, &gid );
+          if ( !loc )
+            break;
+
+          count->components++;
+        } while ( flags & 0x20 );  /* more components */
+
+        /* the program follows the last component */
+        if ( loc && ( flags & 0x100 ) && loc + 1 < end )
+          len = PEEK_USHORT( buffer + loc );
+        else
+          len = 0;
+
+        if ( len && loc + 2 + len <= end )
+        {
+          count->instructions += len;
+          count->instructed++;
+          if ( len > count->max_instructions )
+            count->max_instructions = len;
+        }
 
         continue;
       }
 
-      simple++;
+      count->simple++;
 
       loc += 2 * len; /* skip contour ends */
 
@@ -1363,251 +2002,2115 @@
       {
         /* zero-contour glyphs can have no data */
         if ( len )
-          fprintf( stderr, "glyph %d: invalid offset (%d)\n", i, loc );
+          Warn( out, "glyph %d: invalid offset (%d)", i, loc );
         continue;
       }
 
-      len = (FT_UInt16)( buffer[loc] << 8 | buffer[loc + 1] );
+      if ( len )
+      {
+        /* the last contour end gives the number of points */
+        FT_UInt  points = PEEK_USHORT( buffer + loc - 2 ) + 1U;
+
+
+        count->contours += len;
+        count->points   += points;
+        if ( len > count->max_contours )
+          count->max_contours = len;
+        if ( points > count->max_points )
+          count->max_points = points;
+      }
+
+      len = PEEK_USHORT( buffer + loc );
 
       loc += 2 + len; /* skip instructions */
 
       if ( loc >= end )
       {
-        fprintf( stderr, "glyph %d: invalid offset (%d)\n", i, loc );
+        Warn( out, "glyph %d: invalid offset (%d)", i, loc );
         continue;
       }
 
+      if ( len )
+      {
+        count->instructions += len;
+        count->instructed++;
+        if ( len > count->max_instructions )
+          count->max_instructions = len;
+      }
+
       flags = (FT_UInt16)buffer[loc];
 
-      simple_overlap += ( flags & 0x40 ) >> 6;
+      count->simple_overlap += ( flags & 0x40 ) >> 6;
 
       /* followed by more point flags and coordinates */
     }
 
-    printf( "%s%d", Name_Field( "   simple" ), simple );
-    printf( simple_overlap    ? ", with overlap flagged in %d\n"
-                              : "\n",
-            simple_overlap );
-    printf( "%s%d", Name_Field( "   composite" ), composite );
-    printf( composite_overlap ? ", with overlap flagged in %d\n"
-                              : "\n",
-            composite_overlap );
-    if ( empty )
-      printf( "%s%d\n", Name_Field( "   empty" ), empty );
+    /* Composite depths propagate by one level per pass, so that  */
+    /* nesting deeper than GLYF_MAX_DEPTH, including cycles in    */
+    /* broken fonts, ends up in the last bin.                     */
+    for ( pass = 1, changed = 1; changed && pass < GLYF_MAX_DEPTH; pass++ )
+    {
+      changed = 0;
+
+      for ( i = 0; i < num_glyphs; i++ )
+      {
+        FT_UInt32  loc, end;
+        FT_Byte    d;
+
+
+        if ( !depth[i] )
+          continue;
+
+        Get_Glyph_Range( offset, head->Index_To_Loc_Format, glyf_length, i,
+                         &loc, &end );
+
+        d = Composite_Depth( buffer, loc + 10, end, depth, num_glyphs );
+        if ( d != depth[i] )
+        {
+          depth[i] = d;
+          changed  = 1;
+        }
+      }
+    }
+
+    for ( i = 0; i < num_glyphs; i++ )
+      if ( depth[i] )
+        count->depths[depth[i] - 1]++;
 
-    num_glyphs -= simple + composite + empty;
-    if ( num_glyphs )
-      printf( "%s%d\n", Name_Field( "   invalid" ), num_glyphs );
+    count->invalid = num_glyphs - count->simple - count->composite -
+                       count->empty;
 
+    result = 1;
 
   Exit:
-    free( buffer );
-    free( offset );
+    free( depth );
+    Release_Table( &loca );
+    Release_Table( &glyf );
+
+    return result;
   }
 
 
-  int
-  main( int    argc,
-        char*  argv[] )
+  static void
+  Print_Glyfs( Output*    out,
+               FontFile*  file,
+               FT_Face    face )
   {
-    int    i, file;
-    char   filename[1024];
-    int    num_faces;
-    int    option;
-
-    FT_Library  library;      /* the FreeType library */
-    FT_Face     face;         /* the font face        */
-
-    const char*  execname = ft_basename( argv[0] );
+    GlyfCount  count;
+    int        d;
 
 
-    /* Initialize engine */
-    error = FT_Init_FreeType( &library );
-    if ( error )
-      PanicZ( library, "Could not initialize FreeType library" );
+    if ( !Count_Glyfs( out, file, face, &count ) )
+      return;
 
-    while ( 1 )
+    Print_Field( out, "   simple", "%d", count.simple );
+    Print( out, count.simple_overlap    ? ", with overlap flagged in %d\n"
+                                        : "\n",
+           count.simple_overlap );
+    Print_Field( out, "   composite", "%d", count.composite );
+    Print( out, count.composite_overlap ? ", with overlap flagged in %d\n"
+                                        : "\n",
+           count.composite_overlap );
+    if ( count.empty )
+      Print_Field( out, "   empty", "%d\n", count.empty );
+    if ( count.invalid )
+      Print_Field( out, "   invalid", "%d\n", count.invalid );
+
+    if ( count.contours )
     {
-      option = getopt( argc, argv, "Ccnptuv" );
+      Print_Field( out, "   contours", "%lu, at most %u per glyph\n",
+                   count.contours, count.max_contours );
+      Print_Field( out, "   points", "%lu, at most %u per glyph\n",
+                   count.points, count.max_points );
+    }
+    if ( count.instructed )
+      Print_Field( out, "   instructions",
+                   "%lu bytes in %d glyphs, at most %u\n",
+                   count.instructions, count.instructed,
+                   count.max_instructions );
+    if ( count.components )
+    {
+      int  first = 1;
 
-      if ( option == -1 )
-        break;
 
-      switch ( option )
+      Print_Field( out, "   components", "%lu\n", count.components );
+      Print_Label( out, "   composite depth" );
+      for ( d = 0; d < GLYF_MAX_DEPTH; d++ )
       {
-      case 'C':
-        coverage = 2;
-        break;
+        if ( !count.depths[d] )
+          continue;
 
-      case 'c':
-        coverage = 1;
-        break;
+        Print( out, d == GLYF_MAX_DEPTH - 1 ? "%s%d+: %d" : "%s%d: %d",
+               first ? "" : ", ", d + 1, count.depths[d] );
+        first = 0;
+      }
+      Print( out, "\n" );
+    }
+  }
 
-      case 'n':
-        name_tables = 1;
-        break;
 
-      case 'p':
-        bytecode = 1;
-        break;
+  /*************************************************************************/
+  /*                                                                       */
+  /* Hinting profile.  All TrueType programs are scanned once; the cost   */
+  /* of a program is its number of instructions plus, for each call of a  */
+  /* function whose number is pushed right before, the cost of that       */
+  /* function.  Calls of unknown functions count with the average cost of */
+  /* all functions, and both branches of conditionals are counted.        */
+  /*                                                                       */
+  /*************************************************************************/
 
-      case 't':
-        tables = 1;
-        break;
 
-      case 'u':
-        utf8 = 1;
-        break;
+  /* the number of pushed values remembered to find function numbers */
+#define PROFILE_STACK  32
 
-      case 'v':
-        {
-          FT_Int  major, minor, patch;
+  /* the largest glyph programs shown in the text report */
+#define PROFILE_TOP    20
 
 
-          FT_Library_Version( library, &major, &minor, &patch );
+  typedef struct  OpcodeName_
+  {
+    FT_Byte      first;
+    FT_Byte      last;
+    const char*  name;
 
-          printf( "ftdump (FreeType) %d.%d", major, minor );
-          if ( patch )
-            printf( ".%d", patch );
-          printf( "\n" );
-          exit( 0 );
-        }
-        /* break; */
+  } OpcodeName;
 
-      default:
-        usage( library, execname );
-        break;
-      }
-    }
 
-    argc -= optind;
-    argv += optind;
+  /* TrueType instructions, with their variants merged */
+  static const OpcodeName  opcode_names[] =
+  {
+    { 0x00, 0x01, "SVTCA" },     { 0x02, 0x03, "SPVTCA" },
+    { 0x04, 0x05, "SFVTCA" },    { 0x06, 0x07, "SPVTL" },
+    { 0x08, 0x09, "SFVTL" },     { 0x0A, 0x0A, "SPVFS" },
+    { 0x0B, 0x0B, "SFVFS" },     { 0x0C, 0x0C, "GPV" },
+    { 0x0D, 0x0D, "GFV" },       { 0x0E, 0x0E, "SFVTPV" },
+    { 0x0F, 0x0F, "ISECT" },     { 0x10, 0x10, "SRP0" },
+    { 0x11, 0x11, "SRP1" },      { 0x12, 0x12, "SRP2" },
+    { 0x13, 0x13, "SZP0" },      { 0x14, 0x14, "SZP1" },
+    { 0x15, 0x15, "SZP2" },      { 0x16, 0x16, "SZPS" },
+    { 0x17, 0x17, "SLOOP" },     { 0x18, 0x18, "RTG" },
+    { 0x19, 0x19, "RTHG" },      { 0x1A, 0x1A, "SMD" },
+    { 0x1B, 0x1B, "ELSE" },      { 0x1C, 0x1C, "JMPR" },
+    { 0x1D, 0x1D, "SCVTCI" },    { 0x1E, 0x1E, "SSWCI" },
+    { 0x1F, 0x1F, "SSW" },       { 0x20, 0x20, "DUP" },
+    { 0x21, 0x21, "POP" },       { 0x22, 0x22, "CLEAR" },
+    { 0x23, 0x23, "SWAP" },      { 0x24, 0x24, "DEPTH" },
+    { 0x25, 0x25, "CINDEX" },    { 0x26, 0x26, "MINDEX" },
+    { 0x27, 0x27, "ALIGNPTS" },  { 0x29, 0x29, "UTP" },
+    { 0x2A, 0x2A, "LOOPCALL" },  { 0x2B, 0x2B, "CALL" },
+    { 0x2C, 0x2C, "FDEF" },      { 0x2D, 0x2D, "ENDF" },
+    { 0x2E, 0x2F, "MDAP" },      { 0x30, 0x31, "IUP" },
+    { 0x32, 0x33, "SHP" },       { 0x34, 0x35, "SHC" },
+    { 0x36, 0x37, "SHZ" },       { 0x38, 0x38, "SHPIX" },
+    { 0x39, 0x39, "IP" },        { 0x3A, 0x3B, "MSIRP" },
+    { 0x3C, 0x3C, "ALIGNRP" },   { 0x3D, 0x3D, "RTDG" },
+    { 0x3E, 0x3F, "MIAP" },      { 0x40, 0x40, "NPUSHB" },
+    { 0x41, 0x41, "NPUSHW" },    { 0x42, 0x42, "WS" },
+    { 0x43, 0x43, "RS" },        { 0x44, 0x44, "WCVTP" },
+    { 0x45, 0x45, "RCVT" },      { 0x46, 0x47, "GC" },
+    { 0x48, 0x48, "SCFS" },      { 0x49, 0x4A, "MD" },
+    { 0x4B, 0x4B, "MPPEM" },     { 0x4C, 0x4C, "MPS" },
+    { 0x4D, 0x4D, "FLIPON" },    { 0x4E, 0x4E, "FLIPOFF" },
+    { 0x4F, 0x4F, "DEBUG" },     { 0x50, 0x50, "LT" },
+    { 0x51, 0x51, "LTEQ" },      { 0x52, 0x52, "GT" },
+    { 0x53, 0x53, "GTEQ" },      { 0x54, 0x54, "EQ" },
+    { 0x55, 0x55, "NEQ" },       { 0x56, 0x56, "ODD" },
+    { 0x57, 0x57, "EVEN" },      { 0x58, 0x58, "IF" },
+    { 0x59, 0x59, "EIF" },       { 0x5A, 0x5A, "AND" },
+    { 0x5B, 0x5B, "OR" },        { 0x5C, 0x5C, "NOT" },
+    { 0x5D, 0x5D, "DELTAP1" },   { 0x5E, 0x5E, "SDB" },
+    { 0x5F, 0x5F, "SDS" },       { 0x60, 0x60, "ADD" },
+    { 0x61, 0x61, "SUB" },       { 0x62, 0x62, "DIV" },
+    { 0x63, 0x63, "MUL" },       { 0x64, 0x64, "ABS" },
+    { 0x65, 0x65, "NEG" },       { 0x66, 0x66, "FLOOR" },
+    { 0x67, 0x67, "CEILING" },   { 0x68, 0x6B, "ROUND" },
+    { 0x6C, 0x6F, "NROUND" },    { 0x70, 0x70, "WCVTF" },
+    { 0x71, 0x71, "DELTAP2" },   { 0x72, 0x72, "DELTAP3" },
+    { 0x73, 0x73, "DELTAC1" },   { 0x74, 0x74, "DELTAC2" },
+    { 0x75, 0x75, "DELTAC3" },   { 0x76, 0x76, "SROUND" },
+    { 0x77, 0x77, "S45ROUND" },  { 0x78, 0x78, "JROT" },
+    { 0x79, 0x79, "JROF" },      { 0x7A, 0x7A, "ROFF" },
+    { 0x7C, 0x7C, "RUTG" },      { 0x7D, 0x7D, "RDTG" },
+    { 0x7E, 0x7E, "SANGW" },     { 0x7F, 0x7F, "AA" },
+    { 0x80, 0x80, "FLIPPT" },    { 0x81, 0x81, "FLIPRGON" },
+    { 0x82, 0x82, "FLIPRGOFF" }, { 0x85, 0x85, "SCANCTRL" },
+    { 0x86, 0x87, "SDPVTL" },    { 0x88, 0x88, "GETINFO" },
+    { 0x89, 0x89, "IDEF" },      { 0x8A, 0x8A, "ROLL" },
+    { 0x8B, 0x8B, "MAX" },       { 0x8C, 0x8C, "MIN" },
+    { 0x8D, 0x8D, "SCANTYPE" },  { 0x8E, 0x8E, "INSTCTRL" },
+    { 0x91, 0x91, "GETVARIATION" },
+    { 0x92, 0x92, "GETDATA" },   { 0xB0, 0xB7, "PUSHB" },
+    { 0xB8, 0xBF, "PUSHW" },     { 0xC0, 0xDF, "MDRP" },
+    { 0xE0, 0xFF, "MIRP" }
+  };
+
+#define NUM_OPCODE_NAMES  \
+          (int)( sizeof ( opcode_names ) / sizeof ( opcode_names[0] ) )
+
+
+  typedef struct  OpcodeCount_
+  {
+    const char*  name;
+    FT_ULong     count;
 
-    if ( argc != 1 )
-      usage( library, execname );
+  } OpcodeCount;
 
-    file = 0;
 
-    snprintf( filename, sizeof ( filename ), "%s", argv[file] );
+  static int
+  compare_tables( const void*  a,
+                  const void*  b )
+  {
+    const TableSize*  ta = (const TableSize*)a;
+    const TableSize*  tb = (const TableSize*)b;
 
-    /* try to load the file name as is */
-    error = FT_New_Face( library, filename, -1, &face );
-    if ( !error )
-      goto Success;
 
-#ifndef macintosh
-    /* try again, with `.ttf' appended if no extension */
-    i = (int)strlen( filename );
-    while ( i > 0 && filename[i] != '\\' && filename[i] != '/' )
+    if ( ta->length != tb->length )
+      return ta->length > tb->length ? -1 : 1;
+
+    return ta->tag < tb->tag ? -1 : ta->tag > tb->tag;
+  }
+
+
+  static int
+  compare_programs( const void*  a,
+                    const void*  b )
+  {
+    const ProgramCost*  pa = (const ProgramCost*)a;
+    const ProgramCost*  pb = (const ProgramCost*)b;
+
+
+    if ( pa->bytes != pb->bytes )
+      return pa->bytes > pb->bytes ? -1 : 1;
+
+    return pa->glyph < pb->glyph ? -1 : pa->glyph > pb->glyph;
+  }
+
+
+  static int
+  compare_opcodes( const void*  a,
+                   const void*  b )
+  {
+    const OpcodeCount*  oa = (const OpcodeCount*)a;
+    const OpcodeCount*  ob = (const OpcodeCount*)b;
+
+
+    if ( oa->count != ob->count )
+      return oa->count > ob->count ? -1 : 1;
+
+    return strcmp( oa->name, ob->name );
+  }
+
+
+  /* Sum the opcode counts by name, most frequent first, with */
+  /* undefined opcodes last; return the number of entries.     */
+  static int
+  Count_Opcodes( const Profile*  prof,
+                 OpcodeCount*    counts )
+  {
+    FT_ULong  total = 0, named = 0;
+    int       i, n  = 0;
+
+
+    for ( i = 0; i < NUM_OPCODE_NAMES; i++ )
     {
-      if ( filename[i] == '.' )
-        i = 0;
-      i--;
+      FT_ULong  count = 0;
+      int       op;
+
+
+      for ( op = opcode_names[i].first; op <= opcode_names[i].last; op++ )
+        count += prof->opcodes[op];
+
+      if ( count )
+      {
+        counts[n].name  = opcode_names[i].name;
+        counts[n].count = count;
+        named          += count;
+        n++;
+      }
     }
 
-    if ( i >= 0 )
-    {
-      snprintf( filename, sizeof ( filename ), "%s%s", argv[file], ".ttf" );
+    qsort( counts, (size_t)n, sizeof ( *counts ), compare_opcodes );
 
-      error = FT_New_Face( library, filename, -1, &face );
+    for ( i = 0; i < 256; i++ )
+      total += prof->opcodes[i];
+
+    if ( total > named )
+    {
+      counts[n].name  = "undefined";
+      counts[n].count = total - named;
+      n++;
     }
-#endif
 
-    if ( error )
-      PanicZ( library, "Unrecognized font format." );
+    return n;
+  }
 
-  Success:
-    num_faces = face->num_faces;
-    FT_Done_Face( face );
 
-    printf( num_faces == 1 ? "There is %d face in %s.\n"
-                           : "There are %d faces in %s.\n",
-            num_faces, ft_basename( filename ) );
+  static FT_ULong
+  Function_Cost( const Profile*  prof,
+                 FT_Long         number )
+  {
+    if ( number >= 0                            &&
+         (FT_ULong)number < prof->max_functions &&
+         prof->functions[number]                )
+      return prof->functions[number];
 
-    for ( i = 0; i < num_faces; i++ )
+    return prof->num_functions ? prof->functions_cost / prof->num_functions
+                               : 0;
+  }
+
+
+  /* Add a program to the opcode counts and compute its cost.  Function */
+  /* definitions are recorded if `prof->functions' is set.              */
+  static void
+  Profile_Program( Profile*        prof,
+                   const FT_Byte*  code,
+                   FT_ULong        length,
+                   ProgramCost*    cost )
+  {
+    FT_Long   stack[PROFILE_STACK];
+    FT_Long   outer[PROFILE_STACK];  /* the stack before `FDEF' */
+    FT_Int    sp       = 0;
+    FT_Int    outer_sp = -1;
+    FT_ULong  i        = 0;
+    FT_Long   fdef     = -1;         /* the function being defined */
+    FT_ULong  fdef_cost = 0;
+
+
+    cost->bytes += length;
+
+    while ( i < length )
     {
-      printf( "\n----- Face number: %d -----\n\n", i );
+      FT_Byte   op    = code[i++];
+      FT_ULong  count = 0;
+      int       words = 0;
 
-      error = FT_New_Face( library, filename, i, &face );
-      if ( error )
-        PanicZ( library, "Could not open face." );
 
-      Print_Name( face );
+      prof->opcodes[op]++;
+      cost->instructions++;
+      cost->cost++;
 
-      printf( "%s%ld\n", Name_Field( "glyph count" ), face->num_glyphs );
-      if ( FT_IS_SFNT( face ) )
-        Print_Glyfs( face );
+      if ( op == 0x40 || op == 0x41 )  /* NPUSHB, NPUSHW */
+      {
+        if ( i >= length )
+          break;
 
-      printf( "\n" );
-      Print_Type( face );
+        count = code[i++];
+        words = op == 0x41;
+      }
+      else if ( op >= 0xB0 && op <= 0xBF )  /* PUSHB, PUSHW */
+      {
+        count = ( op & 7 ) + 1U;
+        words = op >= 0xB8;
+      }
 
-      if ( name_tables )
+      if ( count )
       {
-        PS_FontInfoRec  font_info;
-        PS_PrivateRec   font_private;
+        if ( i + ( count << words ) > length )
+          count = ( length - i ) >> words;
 
+        prof->push_bytes += count << words;
 
-        if ( FT_Get_PS_Font_Info( face, &font_info ) == FT_Err_Ok )
+        for ( ; count > 0; count--, i += 1U << words )
         {
-          printf( "\n" );
-          Print_FontInfo_Dictionary( &font_info );
+          if ( sp == PROFILE_STACK )
+          {
+            memmove( stack, stack + 1,
+                     ( PROFILE_STACK - 1 ) * sizeof ( *stack ) );
+            sp--;
+          }
+
+          stack[sp++] = words ? (FT_Short)PEEK_USHORT( code + i ) : code[i];
         }
 
-        if ( FT_Get_PS_Font_Private( face, &font_private ) == FT_Err_Ok )
+        continue;
+      }
+
+      switch ( op )
+      {
+      case 0x2B:  /* CALL */
+        cost->cost += Function_Cost( prof, sp > 0 ? stack[sp - 1] : -1 );
+        break;
+
+      case 0x2A:  /* LOOPCALL */
+        if ( sp > 1 && stack[sp - 2] > 0 )
+          cost->cost += (FT_ULong)stack[sp - 2] *
+                          Function_Cost( prof, stack[sp - 1] );
+        else
+          cost->cost += Function_Cost( prof, -1 );
+        break;
+
+      case 0x2C:  /* FDEF */
+        /* the body is not executed; keep the rest of the stack for */
+        /* the next definitions, which are often pushed at once      */
+        if ( prof->functions && sp > 0 && outer_sp < 0 )
         {
-          printf( "\n" );
-          Print_FontPrivate_Dictionary( &font_private );
+          fdef      = stack[--sp];
+          fdef_cost = cost->cost;
+          outer_sp  = sp;
+          memcpy( outer, stack, (size_t)sp * sizeof ( *stack ) );
         }
+        break;
 
-        if ( FT_IS_SFNT( face ) )
+      case 0x2D:  /* ENDF */
+        if ( fdef >= 0 && (FT_ULong)fdef < prof->max_functions )
         {
-          printf( "\n" );
-          Print_Sfnt_Names( face );
+          prof->functions[fdef] = cost->cost - fdef_cost;
+          prof->functions_cost += prof->functions[fdef];
+          prof->num_functions++;
         }
-      }
+        fdef = -1;
 
-      if ( tables && FT_IS_SFNT( face ) )
-      {
-        printf( "\n" );
-        Print_Sfnt_Tables( face );
+        if ( outer_sp >= 0 )
+        {
+          sp = outer_sp;
+          memcpy( stack, outer, (size_t)sp * sizeof ( *stack ) );
+          outer_sp = -1;
+          continue;
+        }
+        break;
       }
 
-      if ( bytecode && FT_IS_SFNT( face ) )
-      {
-        printf( "\n" );
-        Print_Programs( face );
-      }
+      /* the stack effect of other instructions is not tracked */
+      sp = 0;
+    }
+  }
 
-      if ( face->num_fixed_sizes )
-      {
-        printf( "\n" );
-        Print_Fixed( face );
-      }
 
-      if ( face->num_charmaps )
+  /* The glyph program of the glyph at `loc' to `end', or NULL. */
+  static const FT_Byte*
+  Glyph_Program( const FT_Byte*  buffer,
+                 FT_UInt32       loc,
+                 FT_UInt32       end,
+                 FT_UInt16*      alength )
+  {
+    FT_UShort  flags = 0;
+    FT_UShort  gid;
+    FT_UInt16  len;
+
+
+    if ( end == 0 || loc >= end - 1 )
+      return NULL;
+
+    len  = PEEK_USHORT( buffer + loc );
+    loc += 10;
+
+    if ( (FT_Int16)len < 0 )  /* composite */
+    {
+      do
       {
-        printf( "\n" );
-        Print_Charmaps( face );
-      }
+        loc = Skip_Component( buffer, loc, end, &flags, &gid );
+        if ( !loc )
+          return NULL;
+      } while ( flags & 0x20 );  /* more components */
 
-      /* FT_IS_CID_KEYED() does not catch an OpenType/CFF,
-       * let Print_ROS_From_Face() catch various cases.
-       */
-      Print_ROS_From_Face( face );
+      if ( ( flags & 0x100 ) == 0 )
+        return NULL;
+    }
+    else
+      loc += 2 * len;
 
-      if ( FT_HAS_MULTIPLE_MASTERS( face ) )
+    if ( loc + 1 >= end )
+      return NULL;
+
+    len  = PEEK_USHORT( buffer + loc );
+    loc += 2;
+
+    if ( len == 0 || loc + len > end )
+      return NULL;
+
+    *alength = len;
+
+    return buffer + loc;
+  }
+
+
+  /* Collect the profile of a face; release it with `Done_Profile'. */
+  static void
+  Get_Profile( FontFile*  file,
+               FT_Face    face,
+               Profile*   prof )
+  {
+    FT_ULong  num_tables, i;
+    FT_Int    gid;
+
+    TT_Header*       head;
+    TT_MaxProfile*   maxp;
+
+    Table  fpgm = { NULL, 0, NULL };
+    Table  prep = { NULL, 0, NULL };
+    Table  loca = { NULL, 0, NULL };
+    Table  glyf = { NULL, 0, NULL };
+
+
+    memset( prof, 0, sizeof ( *prof ) );
+
+    FT_Sfnt_Table_Info( face, 0, NULL, &num_tables );
+
+    prof->tables = (TableSize*)malloc( ( num_tables + 1 ) *
+                                       sizeof ( TableSize ) );
+    if ( prof->tables )
+    {
+      for ( i = 0; i < num_tables; i++ )
       {
-        printf( "\n" );
-        Print_MM_Info( face );
+        TableSize*  t = &prof->tables[i];
+
+
+        FT_Sfnt_Table_Info( face, (FT_UInt)i, &t->tag, &t->length );
+        prof->tables_length += t->length;
       }
 
+      prof->num_tables = (FT_UInt)num_tables;
+      qsort( prof->tables, num_tables, sizeof ( TableSize ),
+             compare_tables );
+    }
+
+    maxp = (TT_MaxProfile*)FT_Get_Sfnt_Table( face, FT_SFNT_MAXP );
+    if ( maxp && maxp->version >= 0x10000L && maxp->maxFunctionDefs )
+    {
+      prof->functions = (FT_ULong*)calloc( maxp->maxFunctionDefs,
+                                           sizeof ( FT_ULong ) );
+      if ( prof->functions )
+        prof->max_functions = maxp->maxFunctionDefs;
+    }
+
+    if ( !Load_Table( file, face, TTAG_fpgm, 0, &fpgm ) )
+      Profile_Program( prof, fpgm.data, fpgm.length, &prof->fpgm );
+
+    /* function definitions outside of `fpgm' are not recorded */
+    free( prof->functions );
+    prof->functions     = NULL;
+    prof->max_functions = 0;
+
+    if ( !Load_Table( file, face, TTAG_prep, 0, &prep ) )
+      Profile_Program( prof, prep.data, prep.length, &prof->prep );
+
+    head = (TT_Header*)FT_Get_Sfnt_Table( face, FT_SFNT_HEAD );
+    if ( !head                                                       ||
+         Load_Table( file, face, TTAG_loca,
+                     ( head->Index_To_Loc_Format ? 4 : 2 ) *
+                       ( (FT_ULong)face->num_glyphs + 1 ), &loca )  ||
+         Load_Table( file, face, TTAG_glyf, 0, &glyf )               )
+      goto Exit;
+
+    prof->glyphs = (ProgramCost*)calloc( (size_t)face->num_glyphs + 1,
+                                         sizeof ( ProgramCost ) );
+    if ( !prof->glyphs )
+      goto Exit;
+
+    for ( gid = 0; gid < face->num_glyphs; gid++ )
+    {
+      const FT_Byte*  code;
+      FT_UInt32       loc, end;
+      FT_UInt16       len;
+      ProgramCost*    cost = &prof->glyphs[prof->num_glyphs];
+
+
+      Get_Glyph_Range( loca.data, head->Index_To_Loc_Format, glyf.length,
+                       gid, &loc, &end );
+
+      code = Glyph_Program( glyf.data, loc, end, &len );
+      if ( !code )
+        continue;
+
+      cost->glyph = (FT_UInt)gid;
+      Profile_Program( prof, code, len, cost );
+
+      prof->glyf.bytes        += cost->bytes;
+      prof->glyf.instructions += cost->instructions;
+      prof->glyf.cost         += cost->cost;
+      prof->num_glyphs++;
+    }
+
+    qsort( prof->glyphs, prof->num_glyphs, sizeof ( ProgramCost ),
+           compare_programs );
+
+  Exit:
+    Release_Table( &fpgm );
+    Release_Table( &prep );
+    Release_Table( &loca );
+    Release_Table( &glyf );
+  }
+
+
+  static void
+  Done_Profile( Profile*  prof )
+  {
+    free( prof->tables );
+    free( prof->glyphs );
+    free( prof->functions );
+  }
+
+
+  static double
+  Percent( FT_ULong  part,
+           FT_ULong  total )
+  {
+    return total ? 100.0 * part / total : 0.0;
+  }
+
+
+  static void
+  Print_Profile( Output*    out,
+                 FontFile*  file,
+                 FT_Face    face )
+  {
+    Profile      prof;
+    OpcodeCount  counts[NUM_OPCODE_NAMES + 1];
+    FT_ULong     instructions;
+    FT_ULong     max_cost = 0;
+    FT_UInt      i;
+    int          n;
+
+
+    Get_Profile( file, face, &prof );
+
+    Print( out, "table sizes (%lu bytes)\n", prof.tables_length );
+    for ( i = 0; i < prof.num_tables; i++ )
+      Print( out, "  %c%c%c%c %10lu  %5.1f%%\n",
+             (FT_Char)( prof.tables[i].tag >> 24 ),
+             (FT_Char)( prof.tables[i].tag >> 16 ),
+             (FT_Char)( prof.tables[i].tag >>  8 ),
+             (FT_Char)( prof.tables[i].tag ),
+             prof.tables[i].length,
+             Percent( prof.tables[i].length, prof.tables_length ) );
+
+    instructions = prof.fpgm.instructions + prof.prep.instructions +
+                     prof.glyf.instructions;
+    if ( !instructions )
+      goto Exit;
+
+    Print( out, "\n" );
+    Print( out, "hinting profile\n" );
+    if ( prof.fpgm.bytes )
+      Print_Field( out, "font program",
+                   "%lu bytes, %lu instructions, %u functions\n",
+                   prof.fpgm.bytes, prof.fpgm.instructions,
+                   prof.num_functions );
+    if ( prof.prep.bytes )
+      Print_Field( out, "CVT program",
+                   "%lu bytes, %lu instructions, cost %lu\n",
+                   prof.prep.bytes, prof.prep.instructions,
+                   prof.prep.cost );
+    if ( prof.num_glyphs )
+    {
+      for ( i = 0; i < prof.num_glyphs; i++ )
+        if ( prof.glyphs[i].cost > max_cost )
+          max_cost = prof.glyphs[i].cost;
+
+      Print_Field( out, "glyph programs",
+                   "%lu bytes in %u glyphs, %lu instructions\n",
+                   prof.glyf.bytes, prof.num_glyphs,
+                   prof.glyf.instructions );
+      Print_Field( out, "glyph cost",
+                   "%lu, %.1f per glyph, at most %lu\n",
+                   prof.glyf.cost,
+                   (double)prof.glyf.cost / prof.num_glyphs,
+                   max_cost );
+    }
+    Print_Field( out, "push data", "%lu bytes, %.1f%% of all programs\n",
+                 prof.push_bytes,
+                 Percent( prof.push_bytes, prof.fpgm.bytes +
+                                             prof.prep.bytes +
+                                             prof.glyf.bytes ) );
+
+    if ( prof.num_glyphs )
+    {
+      Print( out, "\n" );
+      Print( out, "largest glyph programs (%u of %u)\n",
+             prof.num_glyphs < PROFILE_TOP ? prof.num_glyphs : PROFILE_TOP,
+             prof.num_glyphs );
+      Print( out, "  glyph   bytes  instructions    cost\n" );
+      for ( i = 0; i < prof.num_glyphs && i < PROFILE_TOP; i++ )
+        Print( out, "  %5u  %6lu  %12lu  %6lu\n",
+               prof.glyphs[i].glyph, prof.glyphs[i].bytes,
+               prof.glyphs[i].instructions, prof.glyphs[i].cost );
+    }
+
+    Print( out, "\n" );
+    Print( out, "instructions (%lu)\n", instructions );
+
+    n = Count_Opcodes( &prof, counts );
+    for ( i = 0; i < (FT_UInt)n; i++ )
+      Print( out, "  %-12s %10lu  %5.1f%%\n",
+             counts[i].name, counts[i].count,
+             Percent( counts[i].count, instructions ) );
+
+  Exit:
+    Done_Profile( &prof );
+  }
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* JSON output.  Each face is written as a single object on one line.   */
+  /* Strings from the `name' table are converted to UTF-8; other strings  */
+  /* are taken as ISO 8859-1, which is what FreeType returns for SFNT     */
+  /* family and style names.                                              */
+  /*                                                                       */
+  /*************************************************************************/
+
+
+  /* the upper half of MacRoman */
+  static const FT_UShort  mac_roman[128] =
+  {
+    0x00C4, 0x00C5, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00DC, 0x00E1,
+    0x00E0, 0x00E2, 0x00E4, 0x00E3, 0x00E5, 0x00E7, 0x00E9, 0x00E8,
+    0x00EA, 0x00EB, 0x00ED, 0x00EC, 0x00EE, 0x00EF, 0x00F1, 0x00F3,
+    0x00F2, 0x00F4, 0x00F6, 0x00F5, 0x00FA, 0x00F9, 0x00FB, 0x00FC,
+    0x2020, 0x00B0, 0x00A2, 0x00A3, 0x00A7, 0x2022, 0x00B6, 0x00DF,
+    0x00AE, 0x00A9, 0x2122, 0x00B4, 0x00A8, 0x2260, 0x00C6, 0x00D8,
+    0x221E, 0x00B1, 0x2264, 0x2265, 0x00A5, 0x00B5, 0x2202, 0x2211,
+    0x220F, 0x03C0, 0x222B, 0x00AA, 0x00BA, 0x03A9, 0x00E6, 0x00F8,
+    0x00BF, 0x00A1, 0x00AC, 0x221A, 0x0192, 0x2248, 0x2206, 0x00AB,
+    0x00BB, 0x2026, 0x00A0, 0x00C0, 0x00C3, 0x00D5, 0x0152, 0x0153,
+    0x2013, 0x2014, 0x201C, 0x201D, 0x2018, 0x2019, 0x00F7, 0x25CA,
+    0x00FF, 0x0178, 0x2044, 0x20AC, 0x2039, 0x203A, 0xFB01, 0xFB02,
+    0x2021, 0x00B7, 0x201A, 0x201E, 0x2030, 0x00C2, 0x00CA, 0x00C1,
+    0x00CB, 0x00C8, 0x00CD, 0x00CE, 0x00CF, 0x00CC, 0x00D3, 0x00D4,
+    0xF8FF, 0x00D2, 0x00DA, 0x00DB, 0x00D9, 0x0131, 0x02C6, 0x02DC,
+    0x00AF, 0x02D8, 0x02D9, 0x02DA, 0x00B8, 0x02DD, 0x02DB, 0x02C7
+  };
+
+
+  /* start a member of the current object, or an element if `key' is NULL */
+  static void
+  JSON_Key( Output*      out,
+            const char*  key )
+  {
+    if ( out->comma )
+      Print( out, "," );
+    if ( key )
+      Print( out, "\"%s\":", key );
+
+    out->comma = 1;
+  }
+
+
+  static void
+  JSON_Open( Output*      out,
+             const char*  key,
+             char         bracket )
+  {
+    JSON_Key( out, key );
+    Print( out, "%c", bracket );
+
+    out->comma = 0;
+  }
+
+
+  static void
+  JSON_Close( Output*  out,
+              char     bracket )
+  {
+    Print( out, "%c", bracket );
+
+    out->comma = 1;
+  }
+
+
+  static void
+  JSON_Long( Output*      out,
+             const char*  key,
+             long         value )
+  {
+    JSON_Key( out, key );
+    Print( out, "%ld", value );
+  }
+
+
+  static void
+  JSON_Double( Output*      out,
+               const char*  key,
+               double       value )
+  {
+    JSON_Key( out, key );
+    Print( out, "%.10g", value );
+  }
+
+
+  static void
+  JSON_Bool( Output*      out,
+             const char*  key,
+             int          value )
+  {
+    JSON_Key( out, key );
+    Print( out, value ? "true" : "false" );
+  }
+
+
+  static void
+  JSON_Null( Output*      out,
+             const char*  key )
+  {
+    JSON_Key( out, key );
+    Print( out, "null" );
+  }
+
+
+  /* a character of a string, escaped or encoded in UTF-8 */
+  static void
+  JSON_Char( Output*    out,
+             FT_UInt32  c )
+  {
+    if ( c == '"' || c == '\\' )
+      Print( out, "\\%c", (int)c );
+    else if ( c < 0x20 )
+      Print( out, "\\u%04x", (unsigned int)c );
+    else if ( c < 0x80 )
+      Print( out, "%c", (int)c );
+    else if ( c < 0x800 )
+      Print( out, "%c%c",
+             (int)( 0xC0 | ( c >> 6 ) ),
+             (int)( 0x80 | ( c & 0x3F ) ) );
+    else if ( c < 0x10000UL )
+      Print( out, "%c%c%c",
+             (int)( 0xE0 | ( c >> 12 ) ),
+             (int)( 0x80 | ( ( c >> 6 ) & 0x3F ) ),
+             (int)( 0x80 | ( c & 0x3F ) ) );
+    else
+      Print( out, "%c%c%c%c",
+             (int)( 0xF0 | ( c >> 18 ) ),
+             (int)( 0x80 | ( ( c >> 12 ) & 0x3F ) ),
+             (int)( 0x80 | ( ( c >> 6 ) & 0x3F ) ),
+             (int)( 0x80 | ( c & 0x3F ) ) );
+  }
+
+
+  static void
+  JSON_Text( Output*      out,
+             const char*  key,
+             const char*  text )
+  {
+    const unsigned char*  p = (const unsigned char*)text;
+
+
+    if ( !p )
+    {
+      JSON_Null( out, key );
+      return;
+    }
+
+    JSON_Key( out, key );
+    Print( out, "\"" );
+    for ( ; *p; p++ )
+      JSON_Char( out, *p );
+    Print( out, "\"" );
+  }
+
+
+  static void
+  JSON_Tag( Output*      out,
+            const char*  key,
+            FT_ULong     tag )
+  {
+    char  buf[5];
+
+
+    buf[0] = (char)( tag >> 24 );
+    buf[1] = (char)( tag >> 16 );
+    buf[2] = (char)( tag >>  8 );
+    buf[3] = (char)( tag );
+    buf[4] = '\0';
+
+    JSON_Text( out, key, buf );
+  }
+
+
+  /* a string of the `name' table; null for unsupported encodings */
+  static void
+  JSON_Name( Output*             out,
+             const char*         key,
+             const FT_SfntName*  name )
+  {
+    FT_UInt  i, len = name->string_len;
+    int      kind;  /* 0: unsupported, 1: UTF-16BE, 2: MacRoman, 3: Latin-1 */
+
+
+    switch ( name->platform_id )
+    {
+    case TT_PLATFORM_APPLE_UNICODE:
+      kind = name->encoding_id <= TT_APPLE_ID_UNICODE_32 ? 1 : 0;
+      break;
+
+    case TT_PLATFORM_MACINTOSH:
+      kind = name->encoding_id == TT_MAC_ID_ROMAN ? 2 : 0;
+      break;
+
+    case TT_PLATFORM_ISO:
+      kind = name->encoding_id == TT_ISO_ID_10646 ? 1
+           : name->encoding_id == TT_ISO_ID_7BIT_ASCII ||
+             name->encoding_id == TT_ISO_ID_8859_1     ? 3 : 0;
+      break;
+
+    case TT_PLATFORM_MICROSOFT:
+      kind = name->encoding_id == TT_MS_ID_SYMBOL_CS  ||
+             name->encoding_id == TT_MS_ID_UNICODE_CS ||
+             name->encoding_id == TT_MS_ID_UCS_4      ? 1 : 0;
+      break;
+
+    default:
+      kind = 0;
+    }
+
+    if ( !kind )
+    {
+      JSON_Null( out, key );
+      return;
+    }
+
+    JSON_Key( out, key );
+    Print( out, "\"" );
+
+    if ( kind == 1 )
+    {
+      for ( i = 0; i + 1 < len; i += 2 )
+      {
+        FT_UInt32  c = (FT_UInt32)name->string[i] << 8 | name->string[i + 1];
+
+
+        if ( c >= 0xD800 && c < 0xDC00 && i + 3 < len )
+        {
+          FT_UInt32  d = (FT_UInt32)name->string[i + 2] << 8 |
+                                    name->string[i + 3];
+
+
+          if ( d >= 0xDC00 && d < 0xE000 )
+          {
+            c  = 0x10000UL + ( ( c - 0xD800 ) << 10 ) + ( d - 0xDC00 );
+            i += 2;
+          }
+        }
+
+        /* replace unpaired surrogates */
+        if ( c >= 0xD800 && c < 0xE000 )
+          c = 0xFFFD;
+
+        JSON_Char( out, c );
+      }
+    }
+    else
+    {
+      for ( i = 0; i < len; i++ )
+      {
+        FT_UInt32  c = name->string[i];
+
+
+        if ( kind == 2 && c >= 0x80 )
+          c = mac_roman[c - 0x80];
+
+        JSON_Char( out, c );
+      }
+    }
+
+    Print( out, "\"" );
+  }
+
+
+  static void
+  JSON_Range( Output*   out,
+              FT_ULong  first,
+              FT_ULong  last )
+  {
+    JSON_Open( out, NULL, '[' );
+    JSON_Long( out, NULL, (long)first );
+    JSON_Long( out, NULL, (long)last );
+    JSON_Close( out, ']' );
+  }
+
+
+  static void
+  JSON_Shorts( Output*      out,
+               const char*  key,
+               FT_Short*    data,
+               FT_Byte      num_data )
+  {
+    FT_Int  i;
+
+
+    JSON_Open( out, key, '[' );
+    for ( i = 0; i < num_data; i++ )
+      JSON_Long( out, NULL, data[i] );
+    JSON_Close( out, ']' );
+  }
+
+
+  /* an English name of the `name' table, or `fallback' */
+  static void
+  JSON_English_Name( Output*      out,
+                     const char*  key,
+                     FT_Face      face,
+                     FT_UInt      strid,
+                     const char*  fallback )
+  {
+    FT_SfntName  name;
+
+
+    name.string = NULL;
+    get_english_name_entry( face, strid, &name );
+
+    if ( name.string )
+      JSON_Name( out, key, &name );
+    else
+      JSON_Text( out, key, fallback );
+  }
+
+
+  static void
+  JSON_Names( Output*    out,
+              FontFile*  file,
+              FT_Face    face )
+  {
+    PS_FontInfoRec  font_info;
+    TT_Header*      head;
+    char            buf[32];
+
+
+    JSON_Text( out, "family", face->family_name );
+    JSON_Text( out, "style", face->style_name );
+    JSON_Text( out, "postscript", FT_Get_Postscript_Name( face ) );
+
+    head = (TT_Header*)FT_Get_Sfnt_Table( face, FT_SFNT_HEAD );
+    if ( head )
+    {
+      time_t  created  = Head_Time( head->Created );
+      time_t  modified = Head_Time( head->Modified );
+
+
+      if ( created >= 0 )
+      {
+        Format_Date( buf, sizeof ( buf ), created );
+        JSON_Text( out, "created", buf );
+      }
+      if ( modified >= 0 )
+      {
+        Format_Date( buf, sizeof ( buf ), modified );
+        JSON_Text( out, "modified", buf );
+      }
+
+      JSON_Double( out, "revision", head->Font_Revision / 65536.0 );
+    }
+    else if ( !FT_Get_PS_Font_Info( face, &font_info ) && font_info.version )
+      JSON_Text( out, "version", font_info.version );
+
+    JSON_Long( out, "glyphs", face->num_glyphs );
+
+    if ( FT_IS_SFNT( face ) )
+    {
+      GlyfCount  count;
+      int        d;
+
+
+      if ( Count_Glyfs( out, file, face, &count ) )
+      {
+        JSON_Open( out, "glyf", '{' );
+        JSON_Long( out, "simple", count.simple );
+        JSON_Long( out, "simple_overlap", count.simple_overlap );
+        JSON_Long( out, "composite", count.composite );
+        JSON_Long( out, "composite_overlap", count.composite_overlap );
+        JSON_Long( out, "empty", count.empty );
+        JSON_Long( out, "invalid", count.invalid );
+        JSON_Long( out, "contours", (long)count.contours );
+        JSON_Long( out, "max_contours", count.max_contours );
+        JSON_Long( out, "points", (long)count.points );
+        JSON_Long( out, "max_points", count.max_points );
+        JSON_Long( out, "instructions", (long)count.instructions );
+        JSON_Long( out, "instructed", count.instructed );
+        JSON_Long( out, "max_instructions", count.max_instructions );
+        JSON_Long( out, "components", (long)count.components );
+        JSON_Open( out, "depths", '[' );
+        for ( d = 0; d < GLYF_MAX_DEPTH; d++ )
+          JSON_Long( out, NULL, count.depths[d] );
+        JSON_Close( out, ']' );
+        JSON_Close( out, '}' );
+      }
+    }
+  }
+
+
+  static void
+  JSON_Program( Output*             out,
+                const char*         key,
+                const ProgramCost*  cost )
+  {
+    JSON_Open( out, key, '{' );
+    JSON_Long( out, "bytes", (long)cost->bytes );
+    JSON_Long( out, "instructions", (long)cost->instructions );
+    JSON_Long( out, "cost", (long)cost->cost );
+    JSON_Close( out, '}' );
+  }
+
+
+  /* all glyph programs are listed as [glyph, bytes, instructions, cost] */
+  static void
+  JSON_Profile( Output*    out,
+                FontFile*  file,
+                FT_Face    face )
+  {
+    Profile      prof;
+    OpcodeCount  counts[NUM_OPCODE_NAMES + 1];
+    FT_UInt      i;
+    int          n;
+
+
+    Get_Profile( file, face, &prof );
+
+    JSON_Open( out, "profile", '{' );
+
+    JSON_Open( out, "tables", '[' );
+    for ( i = 0; i < prof.num_tables; i++ )
+    {
+      JSON_Open( out, NULL, '[' );
+      JSON_Tag( out, NULL, prof.tables[i].tag );
+      JSON_Long( out, NULL, (long)prof.tables[i].length );
+      JSON_Close( out, ']' );
+    }
+    JSON_Close( out, ']' );
+
+    JSON_Program( out, "fpgm", &prof.fpgm );
+    JSON_Long( out, "functions", prof.num_functions );
+    JSON_Program( out, "prep", &prof.prep );
+    JSON_Program( out, "glyf", &prof.glyf );
+    JSON_Long( out, "push_bytes", (long)prof.push_bytes );
+
+    JSON_Open( out, "glyphs", '[' );
+    for ( i = 0; i < prof.num_glyphs; i++ )
+    {
+      JSON_Open( out, NULL, '[' );
+      JSON_Long( out, NULL, prof.glyphs[i].glyph );
+      JSON_Long( out, NULL, (long)prof.glyphs[i].bytes );
+      JSON_Long( out, NULL, (long)prof.glyphs[i].instructions );
+      JSON_Long( out, NULL, (long)prof.glyphs[i].cost );
+      JSON_Close( out, ']' );
+    }
+    JSON_Close( out, ']' );
+
+    JSON_Open( out, "opcodes", '{' );
+    n = Count_Opcodes( &prof, counts );
+    for ( i = 0; i < (FT_UInt)n; i++ )
+      JSON_Long( out, counts[i].name, (long)counts[i].count );
+    JSON_Close( out, '}' );
+
+    JSON_Close( out, '}' );
+
+    Done_Profile( &prof );
+  }
+
+
+  static void
+  JSON_Type( Output*  out,
+             FT_Face  face )
+  {
+    JSON_Text( out, "driver", FT_FACE_DRIVER_NAME( face ) );
+    JSON_Bool( out, "sfnt", FT_IS_SFNT( face ) );
+
+    JSON_Open( out, "type", '[' );
+    if ( FT_IS_SCALABLE( face ) )
+    {
+      JSON_Text( out, NULL, "scalable" );
+      if ( FT_HAS_MULTIPLE_MASTERS( face ) )
+        JSON_Text( out, NULL, "multiple masters" );
+    }
+    if ( FT_HAS_FIXED_SIZES( face ) )
+      JSON_Text( out, NULL, "fixed size" );
+    JSON_Close( out, ']' );
+
+    JSON_Open( out, "direction", '[' );
+    if ( FT_HAS_HORIZONTAL( face ) )
+      JSON_Text( out, NULL, "horizontal" );
+    if ( FT_HAS_VERTICAL( face ) )
+      JSON_Text( out, NULL, "vertical" );
+    JSON_Close( out, ']' );
+
+    JSON_Bool( out, "fixed_width", FT_IS_FIXED_WIDTH( face ) );
+    JSON_Bool( out, "glyph_names", FT_HAS_GLYPH_NAMES( face ) );
+
+    if ( FT_IS_SCALABLE( face ) )
+    {
+      JSON_Long( out, "units_per_em", face->units_per_EM );
+
+      JSON_Open( out, "bbox", '[' );
+      JSON_Long( out, NULL, face->bbox.xMin );
+      JSON_Long( out, NULL, face->bbox.yMin );
+      JSON_Long( out, NULL, face->bbox.xMax );
+      JSON_Long( out, NULL, face->bbox.yMax );
+      JSON_Close( out, ']' );
+
+      JSON_Long( out, "ascender", face->ascender );
+      JSON_Long( out, "descender", face->descender );
+      JSON_Long( out, "height", face->height );
+      JSON_Long( out, "max_advance_width", face->max_advance_width );
+      JSON_Long( out, "max_advance_height", face->max_advance_height );
+      JSON_Long( out, "underline_position", face->underline_position );
+      JSON_Long( out, "underline_thickness", face->underline_thickness );
+    }
+  }
+
+
+  static void
+  JSON_Dictionaries( Output*  out,
+                     FT_Face  face )
+  {
+    PS_FontInfoRec  fi;
+    PS_PrivateRec   fp;
+
+
+    if ( FT_Get_PS_Font_Info( face, &fi ) == FT_Err_Ok )
+    {
+      JSON_Open( out, "font_info", '{' );
+      JSON_Text( out, "FamilyName", fi.family_name );
+      JSON_Text( out, "FullName", fi.full_name );
+      JSON_Bool( out, "isFixedPitch", fi.is_fixed_pitch );
+      JSON_Double( out, "ItalicAngle", fi.italic_angle / 65536. );
+      JSON_Text( out, "Notice", fi.notice );
+      JSON_Long( out, "UnderlinePosition", fi.underline_position );
+      JSON_Long( out, "UnderlineThickness", fi.underline_thickness );
+      JSON_Text( out, "version", fi.version );
+      JSON_Text( out, "Weight", fi.weight );
+      JSON_Close( out, '}' );
+    }
+
+    if ( FT_Get_PS_Font_Private( face, &fp ) == FT_Err_Ok )
+    {
+      JSON_Open( out, "private", '{' );
+      JSON_Long( out, "BlueFuzz", fp.blue_fuzz );
+      JSON_Double( out, "BlueScale", (double)fp.blue_scale / 65536 / 1000 );
+      JSON_Long( out, "BlueShift", fp.blue_shift );
+      JSON_Shorts( out, "BlueValues",
+                   fp.blue_values, fp.num_blue_values );
+      JSON_Double( out, "ExpansionFactor",
+                   (double)fp.expansion_factor / 65536 );
+      JSON_Shorts( out, "FamilyBlues",
+                   fp.family_blues, fp.num_family_blues );
+      JSON_Shorts( out, "FamilyOtherBlues",
+                   fp.family_other_blues, fp.num_family_other_blues );
+      JSON_Bool( out, "ForceBold", fp.force_bold );
+      JSON_Long( out, "LanguageGroup", fp.language_group );
+      JSON_Long( out, "lenIV", fp.lenIV );
+      JSON_Shorts( out, "MinFeature", fp.min_feature, 2 );
+      JSON_Shorts( out, "OtherBlues",
+                   fp.other_blues, fp.num_other_blues );
+      JSON_Long( out, "password", fp.password );
+      JSON_Bool( out, "RndStemUp", fp.round_stem_up );
+      JSON_Long( out, "StdHW", fp.standard_width[0] );
+      JSON_Long( out, "StdVW", fp.standard_height[0] );
+      JSON_Shorts( out, "StemSnapH",
+                   fp.snap_widths, fp.num_snap_widths );
+      JSON_Shorts( out, "StemSnapV",
+                   fp.snap_heights, fp.num_snap_heights );
+      JSON_Long( out, "UniqueID", fp.unique_id );
+      JSON_Close( out, '}' );
+    }
+
+    if ( FT_IS_SFNT( face ) )
+    {
+      FT_SfntName  name;
+      FT_UInt      num_names, i;
+
+
+      JSON_Open( out, "names", '[' );
+
+      num_names = FT_Get_Sfnt_Name_Count( face );
+      for ( i = 0; i < num_names; i++ )
+      {
+        if ( FT_Get_Sfnt_Name( face, i, &name ) )
+          continue;
+
+        JSON_Open( out, NULL, '{' );
+        JSON_Long( out, "name_id", name.name_id );
+        JSON_Long( out, "platform_id", name.platform_id );
+        JSON_Long( out, "encoding_id", name.encoding_id );
+        JSON_Long( out, "language_id", name.language_id );
+        JSON_Name( out, "string", &name );
+        JSON_Close( out, '}' );
+      }
+
+      JSON_Close( out, ']' );
+    }
+  }
+
+
+  static void
+  JSON_Sfnt_Tables( Output*  out,
+                    FT_Face  face )
+  {
+    FT_ULong  num_tables, i;
+    FT_ULong  tag, length;
+
+
+    FT_Sfnt_Table_Info( face, 0, NULL, &num_tables );
+
+    JSON_Open( out, "tables", '[' );
+
+    for ( i = 0; i < num_tables; i++ )
+    {
+      FT_Sfnt_Table_Info( face, (FT_UInt)i, &tag, &length );
+
+      JSON_Open( out, NULL, '{' );
+      JSON_Tag( out, "tag", tag );
+      JSON_Long( out, "length", (long)length );
+      JSON_Close( out, '}' );
+    }
+
+    JSON_Close( out, ']' );
+  }
+
+
+  static void
+  JSON_Fixed( Output*  out,
+              FT_Face  face )
+  {
+    int  i;
+
+
+    JSON_Open( out, "fixed_sizes", '[' );
+
+    for ( i = 0; i < face->num_fixed_sizes; i++ )
+    {
+      FT_Bitmap_Size*  bsize = face->available_sizes + i;
+
+
+      JSON_Open( out, NULL, '{' );
+      JSON_Long( out, "height", bsize->height );
+      JSON_Long( out, "width", bsize->width );
+      JSON_Double( out, "size", bsize->size / 64.0 );
+      JSON_Double( out, "x_ppem", bsize->x_ppem / 64.0 );
+      JSON_Double( out, "y_ppem", bsize->y_ppem / 64.0 );
+      JSON_Close( out, '}' );
+    }
+
+    JSON_Close( out, ']' );
+  }
+
+
+  static void
+  JSON_Charmaps( Output*  out,
+                 FT_Face  face )
+  {
+    int  i, active = -1;
+
+
+    if ( face->charmap )
+      active = FT_Get_Charmap_Index( face->charmap );
+
+    JSON_Open( out, "charmaps", '[' );
+
+    for ( i = 0; i < face->num_charmaps; i++ )
+    {
+      FT_CharMap   cmap = face->charmaps[i];
+      FT_Long      format  = FT_Get_CMap_Format( cmap );
+      FT_ULong     lang_id = FT_Get_CMap_Language_ID( cmap );
+      const char*  encoding;
+      const char*  registry;
+
+      FT_WinFNT_HeaderRec  header;
+
+
+      JSON_Open( out, NULL, '{' );
+      JSON_Bool( out, "active", i == active );
+      if ( cmap->encoding )
+        JSON_Tag( out, "encoding", cmap->encoding );
+      else
+        JSON_Null( out, "encoding" );
+      JSON_Long( out, "platform_id", cmap->platform_id );
+      JSON_Long( out, "encoding_id", cmap->encoding_id );
+
+      if ( format >= 0 )
+      {
+        JSON_Long( out, "format", format );
+        if ( lang_id != 0xFFFFFFFFUL )
+          JSON_Long( out, "language", (long)lang_id );
+        else
+          JSON_Bool( out, "uvs", 1 );
+      }
+      else if ( !FT_Get_BDF_Charset_ID( face, &encoding, &registry ) )
+      {
+        JSON_Key( out, "charset" );
+        Print( out, "\"" );
+        for ( ; *registry; registry++ )
+          JSON_Char( out, (unsigned char)*registry );
+        Print( out, "-" );
+        for ( ; *encoding; encoding++ )
+          JSON_Char( out, (unsigned char)*encoding );
+        Print( out, "\"" );
+      }
+      else if ( !FT_Get_WinFNT_Header( face, &header ) )
+        JSON_Long( out, "windows_charset", header.charset );
+
+      /* the mappings as [code, gid, name] or ranges as [first, last] */
+      if ( lang_id != 0xFFFFFFFFUL && coverage )
+      {
+        FT_ULong   charcode, first = 0, last = 0;
+        FT_UInt    gindex;
+        FT_String  buf[32];
+        int        have_range = 0;
+
+
+        FT_Set_Charmap( face, cmap );
+
+        JSON_Open( out, coverage == 2 ? "map" : "ranges", '[' );
+
+        charcode = FT_Get_First_Char( face, &gindex );
+        while ( gindex )
+        {
+          if ( coverage == 2 )
+          {
+            JSON_Open( out, NULL, '[' );
+            JSON_Long( out, NULL, (long)charcode );
+            JSON_Long( out, NULL, gindex );
+            if ( FT_HAS_GLYPH_NAMES( face ) &&
+                 !FT_Get_Glyph_Name( face, gindex, buf, 32 ) )
+              JSON_Text( out, NULL, buf );
+            JSON_Close( out, ']' );
+          }
+          else if ( have_range && charcode == last + 1 )
+            last = charcode;
+          else
+          {
+            if ( have_range )
+              JSON_Range( out, first, last );
+
+            first      = last = charcode;
+            have_range = 1;
+          }
+
+          charcode = FT_Get_Next_Char( face, charcode, &gindex );
+        }
+
+        if ( have_range )
+          JSON_Range( out, first, last );
+
+        JSON_Close( out, ']' );
+      }
+
+      JSON_Close( out, '}' );
+    }
+
+    JSON_Close( out, ']' );
+  }
+
+
+  static void
+  JSON_ROS( Output*  out,
+            FT_Face  face )
+  {
+    FT_Bool      is_cid = 0;
+    const char*  r = NULL;
+    const char*  o = NULL;
+    FT_Int       s = -1;
+
+
+    if ( FT_Get_CID_Is_Internally_CID_Keyed( face, &is_cid ) || !is_cid )
+      return;
+
+    if ( FT_Get_CID_Registry_Ordering_Supplement( face, &r, &o, &s ) )
+      return;
+
+    JSON_Open( out, "cid", '{' );
+    JSON_Text( out, "registry", r );
+    JSON_Text( out, "ordering", o );
+    JSON_Long( out, "supplement", s );
+
+    if ( coverage > 0 )
+    {
+      JSON_Open( out, "ranges", '[' );
+      Print_CIDs( out, face );
+      JSON_Close( out, ']' );
+    }
+
+    JSON_Close( out, '}' );
+  }
+
+
+  static void
+  JSON_MM_Info( Output*  out,
+                FT_Face  face )
+  {
+    FT_MM_Var*       mm;
+    FT_Multi_Master  dummy;
+    FT_UInt          is_GX, i, j;
+    FT_Error         error;
+
+
+    is_GX = FT_Get_Multi_Master( face, &dummy ) ? 1 : 0;
+
+    JSON_Open( out, "variations", '{' );
+
+    error = FT_Get_MM_Var( face, &mm );
+    if ( error )
+    {
+      JSON_Long( out, "error", error );
+      JSON_Close( out, '}' );
+      return;
+    }
+
+    JSON_Text( out, "type", is_GX ? "GX" : "MM" );
+
+    JSON_Open( out, "axes", '[' );
+    for ( i = 0; i < mm->num_axis; i++ )
+    {
+      JSON_Open( out, NULL, '{' );
+      if ( is_GX )
+        JSON_English_Name( out, "name", face, mm->axis[i].strid,
+                           mm->axis[i].name );
+      else
+        JSON_Text( out, "name", mm->axis[i].name );
+      JSON_Tag( out, "tag", mm->axis[i].tag );
+      JSON_Double( out, "minimum", mm->axis[i].minimum / 65536.0 );
+      JSON_Double( out, "maximum", mm->axis[i].maximum / 65536.0 );
+      JSON_Double( out, "default", mm->axis[i].def / 65536.0 );
+      JSON_Close( out, '}' );
+    }
+    JSON_Close( out, ']' );
+
+    if ( is_GX )
+    {
+      FT_Fixed*  coords;
+      FT_UInt    instance_count;
+      FT_UInt    default_named_instance;
+
+      FT_Var_Named_Style*  named_styles;
+
+
+      coords = (FT_Fixed*)malloc( mm->num_axis * sizeof ( FT_Fixed ) );
+      if ( coords )
+      {
+        /* see `Print_MM_Info' */
+        FT_Get_Var_Design_Coordinates( face, mm->num_axis, coords );
+        FT_Set_Var_Design_Coordinates( face, mm->num_axis, coords );
+
+        JSON_Text( out, "ps_name_prefix", FT_Get_Postscript_Name( face ) );
+
+        FT_Set_Var_Design_Coordinates( face, 0, NULL );
+
+        free( coords );
+      }
+
+      instance_count = (FT_UInt)face->style_flags >> 16;
+      named_styles   = mm->namedstyle;
+
+      FT_Get_Default_Named_Instance( face, &default_named_instance );
+
+      JSON_Open( out, "instances", '[' );
+      for ( i = 0; i < instance_count; i++ )
+      {
+        JSON_Open( out, NULL, '{' );
+        JSON_Long( out, "index", (long)i + 1 );
+        JSON_English_Name( out, "name", face,
+                           named_styles[i].strid, NULL );
+        JSON_English_Name( out, "postscript", face,
+                           named_styles[i].psid, NULL );
+        JSON_Bool( out, "default", i + 1 == default_named_instance );
+
+        JSON_Open( out, "coords", '[' );
+        for ( j = 0; j < mm->num_axis; j++ )
+          JSON_Double( out, NULL, named_styles[i].coords[j] / 65536.0 );
+        JSON_Close( out, ']' );
+
+        JSON_Close( out, '}' );
+      }
+      JSON_Close( out, ']' );
+    }
+
+    JSON_Close( out, '}' );
+
+    FT_Done_MM_Var( face->glyph->library, mm );
+  }
+
+
+  /* the warnings collected for the current face, as an array of strings */
+  static void
+  JSON_Warnings( Output*  out )
+  {
+    char*  line = out->warnings;
+    char*  end  = out->warnings + out->warnings_length;
+    char*  eol;
+
+
+    JSON_Open( out, "warnings", '[' );
+    for ( ; line < end; line = eol + 1 )
+    {
+      eol  = (char*)memchr( line, '\n', (size_t)( end - line ) );
+      *eol = '\0';
+      JSON_Text( out, NULL, line );
+    }
+    JSON_Close( out, ']' );
+
+    out->warnings_length = 0;
+  }
+
+
+  static void
+  JSON_Face( Output*      out,
+             FontFile*    file,
+             const char*  fname,
+             FT_Long      face_index,
+             FT_Long      num_faces,
+             FT_Face      face )
+  {
+    out->comma = 0;
+
+    JSON_Open( out, NULL, '{' );
+    JSON_Text( out, "file", fname );
+    JSON_Long( out, "face", face_index );
+    JSON_Long( out, "faces", num_faces );
+
+    JSON_Names( out, file, face );
+    JSON_Type( out, face );
+
+    if ( name_tables )
+      JSON_Dictionaries( out, face );
+
+    if ( tables && FT_IS_SFNT( face ) )
+      JSON_Sfnt_Tables( out, face );
+
+    if ( face->num_fixed_sizes )
+      JSON_Fixed( out, face );
+
+    if ( face->num_charmaps )
+      JSON_Charmaps( out, face );
+
+    JSON_ROS( out, face );
+
+    if ( FT_HAS_MULTIPLE_MASTERS( face ) )
+      JSON_MM_Info( out, face );
+
+    if ( profile && FT_IS_SFNT( face ) )
+      JSON_Profile( out, file, face );
+
+    if ( out->warnings_length )
+      JSON_Warnings( out );
+
+    JSON_Close( out, '}' );
+    Print( out, "\n" );
+  }
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* Dumping files.                                                        */
+  /*                                                                       */
+  /*************************************************************************/
+
+
+  /* `stage' is one of `init', `open', or `face' for JSON consumers; */
+  /* `message' is shown in text mode                                 */
+  static void
+  Report_Error( Output*      out,
+                const char*  fname,
+                FT_Long      face_index,
+                const char*  stage,
+                const char*  message,
+                FT_Error     error )
+  {
+    if ( json )
+    {
+      out->comma = 0;
+
+      JSON_Open( out, NULL, '{' );
+      JSON_Text( out, "file", fname );
+      if ( face_index >= 0 )
+        JSON_Long( out, "face", face_index );
+      JSON_Long( out, "error", error );
+      JSON_Text( out, "stage", stage );
+      JSON_Text( out, "message", Error_String( error ) );
+      JSON_Close( out, '}' );
+      Print( out, "\n" );
+    }
+    else
+    {
+      out->fname = fname;
+      Warn( out, "%s\n  error = 0x%04x, %s",
+            message, error, Error_String( error ) );
+    }
+  }
+
+
+  static void
+  Print_Face( Output*    out,
+              FontFile*  file,
+              FT_Face    face )
+  {
+    Print_Name( out, face );
+
+    Print_Field( out, "glyph count", "%ld\n", face->num_glyphs );
+    if ( FT_IS_SFNT( face ) )
+      Print_Glyfs( out, file, face );
+
+    Print( out, "\n" );
+    Print_Type( out, face );
+
+    if ( name_tables )
+    {
+      PS_FontInfoRec  font_info;
+      PS_PrivateRec   font_private;
+
+
+      if ( FT_Get_PS_Font_Info( face, &font_info ) == FT_Err_Ok )
+      {
+        Print( out, "\n" );
+        Print_FontInfo_Dictionary( out, &font_info );
+      }
+
+      if ( FT_Get_PS_Font_Private( face, &font_private ) == FT_Err_Ok )
+      {
+        Print( out, "\n" );
+        Print_FontPrivate_Dictionary( out, &font_private );
+      }
+
+      if ( FT_IS_SFNT( face ) )
+      {
+        Print( out, "\n" );
+        Print_Sfnt_Names( out, face );
+      }
+    }
+
+    if ( tables && FT_IS_SFNT( face ) )
+    {
+      Print( out, "\n" );
+      Print_Sfnt_Tables( out, face );
+    }
+
+    if ( bytecode && FT_IS_SFNT( face ) )
+    {
+      Print( out, "\n" );
+      Print_Programs( out, file, face );
+    }
+
+    if ( profile && FT_IS_SFNT( face ) )
+    {
+      Print( out, "\n" );
+      Print_Profile( out, file, face );
+    }
+
+    if ( face->num_fixed_sizes )
+    {
+      Print( out, "\n" );
+      Print_Fixed( out, face );
+    }
+
+    if ( face->num_charmaps )
+    {
+      Print( out, "\n" );
+      Print_Charmaps( out, face );
+    }
+
+    /* FT_IS_CID_KEYED() does not catch an OpenType/CFF,
+     * let Print_ROS_From_Face() catch various cases.
+     */
+    Print_ROS_From_Face( out, face );
+
+    if ( FT_HAS_MULTIPLE_MASTERS( face ) )
+    {
+      Print( out, "\n" );
+      Print_MM_Info( out, face );
+    }
+  }
+
+
+  /* dump all faces of a file; return 1 in case of errors */
+  static int
+  Dump_File( FT_Library   library,
+             const char*  fname,
+             Output*      out )
+  {
+    FT_Error  error;
+    FT_Face   face;
+    char      filename[1024];
+    int       i, num_faces;
+    int       result = 0;
+
+    /* mapped on first use by the `glyf' statistics */
+    FontFile  file = { filename, NULL, 0, 0 };
+
+
+    out->fname = fname;
+
+    snprintf( filename, sizeof ( filename ), "%s", fname );
+
+    /* try to load the file name as is */
+    error = FT_New_Face( library, filename, -1, &face );
+    if ( !error )
+      goto Success;
+
+#ifndef macintosh
+    /* try again, with `.ttf' appended if no extension */
+    i = (int)strlen( filename );
+    while ( i > 0 && filename[i] != '\\' && filename[i] != '/' )
+    {
+      if ( filename[i] == '.' )
+        i = 0;
+      i--;
+    }
+
+    if ( i >= 0 )
+    {
+      snprintf( filename, sizeof ( filename ), "%s%s", fname, ".ttf" );
+
+      error = FT_New_Face( library, filename, -1, &face );
+    }
+#endif
+
+    if ( error )
+    {
+      Report_Error( out, fname, -1, "open",
+                    "Unrecognized font format.", error );
+      return 1;
+    }
+
+  Success:
+    num_faces = face->num_faces;
+    FT_Done_Face( face );
+
+    if ( !json )
+      Print( out, num_faces == 1 ? "There is %d face in %s.\n"
+                                 : "There are %d faces in %s.\n",
+             num_faces, ft_basename( filename ) );
+
+    for ( i = 0; i < num_faces; i++ )
+    {
+      if ( !json )
+        Print( out, "\n----- Face number: %d -----\n\n", i );
+
+      error = FT_New_Face( library, filename, i, &face );
+      if ( error )
+      {
+        Report_Error( out, filename, i, "face",
+                      "Could not open face.", error );
+        result = 1;
+        break;
+      }
+
+      if ( json )
+        JSON_Face( out, &file, filename, i, num_faces, face );
+      else
+        Print_Face( out, &file, face );
+
       FT_Done_Face( face );
     }
 
+    if ( file.base )
+      ft_unmap_file( (void*)file.base, file.size );
+
+    return result;
+  }
+
+
+  /* a job of `workpool_run': dump one file of the batch */
+  static void
+  Dump_Job( void*         data,
+            unsigned int  index,
+            unsigned int  worker )
+  {
+    Batch*       batch   = (Batch*)data;
+    FT_Library*  library = &batch->libraries[worker];
+    Output*      out     = &batch->outputs[index];
+
+
+    if ( !*library )
+    {
+      FT_Error  error = FT_Init_FreeType( library );
+
+
+      if ( error )
+      {
+        *library = NULL;
+        Report_Error( out, batch->fnames[index], -1, "init",
+                      "Could not initialize FreeType library", error );
+        batch->failed[index] = 1;
+        return;
+      }
+    }
+
+    batch->failed[index] = Dump_File( *library, batch->fnames[index], out );
+  }
+
+
+  int
+  main( int    argc,
+        char*  argv[] )
+  {
+    FT_Error  error;
+    int       file;
+    int       option;
+    int       num_workers = 1;
+    int       status      = 0;
+
+    FT_Library  library;      /* the FreeType library */
+
+    const char*  execname = ft_basename( argv[0] );
+
+
+    /* Initialize engine */
+    error = FT_Init_FreeType( &library );
+    if ( error )
+      PanicZ( library, error, "Could not initialize FreeType library" );
+
+    while ( 1 )
+    {
+      option = getopt( argc, argv, "CcJj:nPptuv" );
+
+      if ( option == -1 )
+        break;
+
+      switch ( option )
+      {
+      case 'C':
+        coverage = 2;
+        break;
+
+      case 'c':
+        coverage = 1;
+        break;
+
+      case 'J':
+        json = 1;
+        break;
+
+      case 'j':
+        num_workers = atoi( optarg );
+        if ( num_workers <= 0 )
+          num_workers = (int)workpool_num_cpus();
+        break;
+
+      case 'n':
+        name_tables = 1;
+        break;
+
+      case 'P':
+        profile = 1;
+        break;
+
+      case 'p':
+        bytecode = 1;
+        break;
+
+      case 't':
+        tables = 1;
+        break;
+
+      case 'u':
+        utf8 = 1;
+        break;
+
+      case 'v':
+        {
+          FT_Int  major, minor, patch;
+
+
+          FT_Library_Version( library, &major, &minor, &patch );
+
+          printf( "ftdump (FreeType) %d.%d", major, minor );
+          if ( patch )
+            printf( ".%d", patch );
+          printf( "\n" );
+          exit( 0 );
+        }
+        /* break; */
+
+      default:
+        usage( library, execname );
+        break;
+      }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if ( argc < 1 )
+      usage( library, execname );
+
+    many_files = argc > 1;
+
+    if ( num_workers == 1 || argc == 1 )
+    {
+      Output  out = { NULL, NULL, 0, 0, 0, NULL, NULL, 0, 0 };
+
+
+      out.file = stdout;
+
+      for ( file = 0; file < argc; file++ )
+      {
+        if ( file && !json )
+          Print( &out, "\n" );
+
+        status |= Dump_File( library, argv[file], &out );
+      }
+
+      free( out.warnings );
+    }
+    else
+    {
+      /* Dump the files in batches on the worker threads, */
+      /* each with its own library, and print the reports */
+      /* of a batch in the order of the files             */
+      Batch         batch;
+      unsigned int  batch_size = (unsigned int)num_workers * BATCH_PER_WORKER;
+      unsigned int  count, i;
+
+
+      batch.outputs   = (Output*)calloc( batch_size, sizeof ( Output ) );
+      batch.failed    = (int*)calloc( batch_size, sizeof ( int ) );
+      batch.libraries = (FT_Library*)calloc( (size_t)num_workers,
+                                             sizeof ( FT_Library ) );
+      if ( !batch.outputs || !batch.failed || !batch.libraries )
+      {
+        fprintf( stderr, "ftdump: out of memory\n" );
+        exit( 1 );
+      }
+
+      /* the first worker uses the main library */
+      batch.libraries[0] = library;
+
+      for ( file = 0; file < argc; file += (int)count )
+      {
+        count = (unsigned int)( argc - file );
+        if ( count > batch_size )
+          count = batch_size;
+
+        batch.fnames = argv + file;
+
+        workpool_run( (unsigned int)num_workers, count, Dump_Job, &batch );
+
+        for ( i = 0; i < count; i++ )
+        {
+          if ( ( file || i ) && !json )
+            fputs( "\n", stdout );
+
+          if ( batch.outputs[i].length )
+            fwrite( batch.outputs[i].buffer, 1, batch.outputs[i].length,
+                    stdout );
+          batch.outputs[i].length = 0;
+
+          /* warnings follow the report of their file */
+          if ( batch.outputs[i].warnings_length )
+          {
+            fflush( stdout );
+            fwrite( batch.outputs[i].warnings, 1,
+                    batch.outputs[i].warnings_length, stderr );
+          }
+          batch.outputs[i].warnings_length = 0;
+
+          status |= batch.failed[i];
+        }
+      }
+
+      for ( i = 0; i < batch_size; i++ )
+      {
+        free( batch.outputs[i].buffer );
+        free( batch.outputs[i].warnings );
+      }
+      free( batch.outputs );
+      free( batch.failed );
+
+      for ( i = 1; i < (unsigned int)num_workers; i++ )
+        FT_Done_FreeType( batch.libraries[i] );
+      free( batch.libraries );
+    }
+
     FT_Done_FreeType( library );
 
-    exit( 0 );      /* for safety reasons */
-    /* return 0; */ /* never reached */
+    exit( status );   /* for safety reasons */
+    /* return 0; */   /* never reached */
   }
 
 
@@ -410,7 +410,8 @@
       s -= p * ( r - 1 );
 
     bit->buffer = NULL;  /* to replace */
-    if ( grNewBitmap( bit->mode, bit->grays, w * scale, r * scale, bit ) )
+    if ( grNewBitmapEx( bit->mode, bit->grays, w * scale, r * scale,
+                        gr_bitmap_flag_aligned, bit ) )
       return;
 
     line = bit->buffer;
@@ -526,6 +527,7 @@
     int           scale = (int)st->scale;
     int           ox    = st->x_origin;
     int           oy    = st->y_origin;
+    double        t;
 
 
     err = FTDemo_Get_Size( handle, &size );
@@ -540,7 +542,10 @@
     af_debug_disable_blue_hints_ = !st->do_blue_hints;
 #endif
 
-    if ( FT_Load_Glyph( size->face, glyph_idx, handle->load_flags ) )
+    t   = frametime_start( &handle->frame_time );
+    err = FT_Load_Glyph( size->face, glyph_idx, handle->load_flags );
+    frametime_stop( &handle->frame_time, FRAMETIME_LOAD, t );
+    if ( err )
       return;
 
     slot = size->face->glyph;
@@ -662,9 +667,11 @@
         {
           bitmap_scale( st, &bitg, scale );
 
+          t = frametime_start( &handle->frame_time );
           grBlitGlyphToSurface( display->surface, &bitg,
                                 ox + left * scale, oy - top * scale,
                                 st->axis_color );
+          frametime_stop( &handle->frame_time, FRAMETIME_BLIT, t );
 
           grDoneBitmap( &bitg );
         }
@@ -952,7 +959,7 @@
     grWriteln( "L           cycle through LCD           P           print PNG file          " );
     grWriteln( "             filters                    q, ESC      quit ftgrid             " );
     grLn();
-    grWriteln( "g, v        adjust gamma value" );
+    grWriteln( "g, v        adjust gamma value          T           toggle frame timing" );
     /*          |----------------------------------|    |----------------------------------| */
     grLn();
     grLn();
@@ -1539,6 +1546,10 @@
                                      : "grid drawing disabled";
       break;
 
+    case grKEY( 'T' ):
+      handle->frame_time.enabled = !handle->frame_time.enabled;
+      break;
+
     case grKEY( 'd' ):
       status.work ^= DO_DOTS;
       break;
@@ -1918,9 +1929,8 @@
     FT_Stroker_Set( status.stroker, 32, FT_STROKER_LINECAP_BUTT,
                       FT_STROKER_LINEJOIN_BEVEL, 0x20000 );
 
-    for ( ; argc > 0; argc--, argv++ )
-      FTDemo_Install_Font( handle, argv[0], 0,
-                           status.no_named_instances ? 1 : 0 );
+    FTDemo_Install_Fonts( handle, argc, argv, 0,
+                          status.no_named_instances ? 1 : 0, NULL );
 
     if ( handle->num_fonts == 0 )
       Fatal( "could not find/open any font file" );
@@ -1942,6 +1952,7 @@
     do
     {
       FTDemo_Display_Clear( display );
+      FTDemo_Frame_Time_Begin( handle );
 
       if ( status.do_grid )
         grid_status_draw_grid( &status );
@@ -1950,6 +1961,7 @@
         grid_status_draw_outline( &status, handle, display );
 
       write_header( 0 );
+      FTDemo_Frame_Time_Draw( handle, display );
 
     } while ( !Process_Event() );
 
@@ -17,14 +17,19 @@
 #include <freetype/freetype.h>
 #include <freetype/ftoutln.h>
 #include <freetype/ftbitmap.h>
+#include <freetype/ftsizes.h>
 
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
 #include <limits.h>
 
 #include "common.h"
 #include "md5.h"
+#include "acutance.h"
+#include "workpool.h"
 
 #ifdef UNIX
 #include <unistd.h>
@@ -33,18 +38,165 @@
 #endif
 
 
-  static FT_Error        error;
-  static FT_Library      library;
-  static FT_Face         face;
-  static FT_Render_Mode  render_mode = FT_RENDER_MODE_NORMAL;
   static FT_Int32        load_flags  = FT_LOAD_DEFAULT;
 
   static const FT_String*  modes[FT_RENDER_MODE_MAX] =
     { "normal", "light", "mono", "lcd", "lcd-v", "sdf" };
 
-  static int           ptsize;
 
-  static int  Fail;
+  /* a combination of size and render mode to check the glyphs with */
+  typedef struct  Setting_
+  {
+    int             ptsize;
+    unsigned int    size_index;    /* into `ptsizes' */
+    FT_Int32        load_flags;
+    FT_Render_Mode  render_mode;
+
+  } Setting;
+
+#define MAX_SIZES  32
+
+  /* all sizes of a face are set up once; the settings are */
+  /* sorted by size and then by render mode                */
+  static int           ptsizes[MAX_SIZES];
+  static unsigned int  num_ptsizes;
+  static Setting       settings[MAX_SIZES * FT_RENDER_MODE_MAX];
+  static unsigned int  num_settings;
+
+  static unsigned int  first_index = 0;
+  static unsigned int  last_index  = UINT_MAX;
+  static int           quiet       = 0;
+  static int           json        = 0;
+  static int           rollup      = 0;   /* show face digests as text */
+
+
+  /* the available bitmap digests; the first one is the default */
+  typedef struct  DigestRec_
+  {
+    const char*   name;
+    const char*   label;
+    unsigned int  size;     /* in bytes, at most 16 */
+
+  } DigestRec;
+
+  static const DigestRec  digests[] =
+  {
+    { "md5",   "MD5",   16 },
+#ifdef FT_INT64
+    { "xxh64", "XXH64",  8 },
+#endif
+  };
+
+#define NUM_DIGESTS  ( sizeof ( digests ) / sizeof ( digests[0] ) )
+
+  static const DigestRec*  digest = digests;
+
+
+  /* the report of a file goes to `file' directly or, if it is linted */
+  /* by a worker thread, to `buffer' until it is its turn to be shown */
+  typedef struct  Output_
+  {
+    FILE*   file;
+    char*   buffer;
+    size_t  length;
+    size_t  size;
+
+  } Output;
+
+
+  /* files are linted in batches of this many per worker to bound */
+  /* the memory used by buffered reports                          */
+#define BATCH_PER_WORKER  16
+
+  typedef struct  Batch_
+  {
+    char**        fnames;
+    Output*       outputs;
+    FT_Library*   libraries;   /* one per worker, created on demand */
+
+  } Batch;
+
+
+  /* what was found out about a glyph */
+  typedef struct  GlyphInfo_
+  {
+    unsigned int   id;
+    FT_Error       error;
+    const char*    stage;        /* where `error' happened            */
+    unsigned long  format;       /* of the loaded glyph               */
+    double         shape;        /* complexity; negative if void      */
+    int            turns[2];     /* X and Y turns of the outline      */
+    int            rendered;     /* are the following fields set?     */
+    unsigned int   width;
+    unsigned int   rows;
+    double         acutance[2];  /* X and Y; negative if void         */
+    Acutance       sums;         /* the derivatives behind it         */
+    unsigned char  digest[16];   /* of the bitmap                     */
+    char           hash[33];     /* the same in hexadecimal           */
+
+  } GlyphInfo;
+
+
+  static void
+  Print( Output*      out,
+         const char*  format,
+         ... )
+  {
+    va_list  args;
+
+
+    va_start( args, format );
+
+    if ( out->file )
+      vfprintf( out->file, format, args );
+    else
+    {
+      for ( ;; )
+      {
+        size_t   available = out->size - out->length;
+        int      ret       = -1;
+        va_list  copy;
+
+
+        if ( available )
+        {
+          va_copy( copy, args );
+          ret = vsnprintf( out->buffer + out->length, available,
+                           format, copy );
+          va_end( copy );
+        }
+
+        if ( ret >= 0 && (size_t)ret < available )
+        {
+          out->length += (size_t)ret;
+          break;
+        }
+
+        /* NOTE: On Windows, vsnprintf() can return -1 in case of */
+        /* truncation!                                            */
+        {
+          size_t  size = out->size ? 2 * out->size : 4096;
+          char*   buffer;
+
+
+          if ( ret >= 0 && size < out->length + (size_t)ret + 1 )
+            size = out->length + (size_t)ret + 1;
+
+          buffer = (char*)realloc( out->buffer, size );
+          if ( !buffer )
+          {
+            fprintf( stderr, "ftlint: out of memory\n" );
+            exit( 1 );
+          }
+
+          out->buffer = buffer;
+          out->size   = size;
+        }
+      }
+    }
+
+    va_end( args );
+  }
 
 
   /* error messages */
@@ -54,8 +206,8 @@
 #define FT_ERROR_END_LIST       default: str = "unknown error"; }
 
 
-  static void
-  Error( const FT_String  *msg )
+  static const FT_String*
+  Error_String( FT_Error  error )
   {
     const FT_String  *str;
 
@@ -63,7 +215,16 @@
     switch( error )
     #include <freetype/fterrors.h>
 
-    printf( "%serror = 0x%04x, %s\n", msg, error, str );
+    return str;
+  }
+
+
+  static void
+  Error( Output*           out,
+         const FT_String  *msg,
+         FT_Error          error )
+  {
+    Print( out, "%serror = 0x%04x, %s\n", msg, error, Error_String( error ) );
   }
 
 
@@ -80,33 +241,41 @@
     fprintf( stderr,
       "\n"
       "  -f L    Use hex number L as load flags (see `FT_LOAD_XXX')\n"
-      "  -r N    Set render mode to N\n"
+      "  -r N    Set render mode to N (a comma-separated list is possible)\n"
       "  -i I-J  Range of glyph indices to use (default: all)\n"
       "  -q      Quiet mode without the rendering analysis\n"
-      "\n" );
+      "  -j N    Lint N files at a time (default: 1, 0: one per CPU)\n"
+      "  -J      Write JSON Lines, one object per glyph and face\n"
+      "  -d D    Use digest D for bitmaps and show the digest of each face\n"
+      "          (`md5' (default) or `xxh64')\n"
+      "\n"
+      "  `ppem' can be a comma-separated list of sizes, too.  Each face is\n"
+      "  checked with all combinations of sizes and render modes.\n"
+      "\n"
+      "       %s -c old.jsonl new.jsonl\n"
+      "\n"
+      "  Compare two JSON Lines reports and list the changed glyphs.\n"
+      "\n",
+             name );
 
-    exit( 1 );
+    /* status 1 means that `-c' found differences */
+    exit( 2 );
   }
 
 
 #define SIGN( x )  ( ( x > 0 ) - ( x < 0 ) )
 
+  /* count the turns of an outline */
   static void
-  Explore( FT_GlyphSlot  slot )
+  Explore( FT_GlyphSlot  slot,
+           GlyphInfo*    info )
   {
-    unsigned long  format = slot->format;
     FT_Outline*    outline = &slot->outline;
     int            c, p, first, last;
     FT_Vector      d, v;
     int            dx, dy, bx, by, sx, sy;
 
 
-    if ( format != FT_GLYPH_FORMAT_OUTLINE )
-    {
-      fputs( "   +    ", stdout );
-      return;
-    }
-
     sx = sy = 0;
     last = -1;
     for ( c = 0; c < outline->n_contours; c++ )
@@ -145,14 +314,16 @@
       sy += sy & 1;
     }
 
-    printf( "%3d+%-3d ", sx, sy );
+    info->turns[0] = sx;
+    info->turns[1] = sy;
   }
 
 
+  /* measure the shape complexity of an outline */
   static void
-  Examine( FT_GlyphSlot  slot )
+  Examine( FT_GlyphSlot  slot,
+           GlyphInfo*    info )
   {
-    unsigned long  format = slot->format;
     FT_Outline*    outline = &slot->outline;
     int            c, p, first, last;
     FT_Vector      d, v;
@@ -160,17 +331,6 @@
     FT_BBox        cbox;
 
 
-    if ( format != FT_GLYPH_FORMAT_OUTLINE )
-    {
-      putchar( ' ' );
-      putchar( ( format >> 24 ) & 0xFF );
-      putchar( ( format >> 16 ) & 0xFF );
-      putchar( ( format >>  8 ) & 0xFF );
-      putchar( ( format       ) & 0xFF );
-      putchar( ' ' );
-      return;
-    }
-
     taxi = 0;
     last = -1;
     for ( c = 0; c < outline->n_contours; c++ )
@@ -195,291 +355,1437 @@
     if ( taxi )
     {
       FT_Outline_Get_CBox( outline, &cbox );
-      printf( "%5.2f ", 0.5 * taxi /
-                        ( cbox.xMax - cbox.xMin + cbox.yMax - cbox.yMin ) );
+      info->shape = 0.5 * taxi /
+                      ( cbox.xMax - cbox.xMin + cbox.yMax - cbox.yMin );
     }
     else
-      printf( " void " );
+      info->shape = -1.0;
   }
 
 
   /* Analyze X- and Y-acutance; bitmap should have positive pitch */
   static void
-  Analyze( FT_Bitmap* bitmap )
+  Analyze( FT_Bitmap*  bitmap,
+           GlyphInfo*  info )
+  {
+    acutance_init( &info->sums );
+    acutance_add( &info->sums, bitmap->buffer,
+                  bitmap->width, bitmap->rows, bitmap->pitch );
+
+    info->acutance[0] = acutance_get( &info->sums, 0 );
+    info->acutance[1] = acutance_get( &info->sums, 1 );
+  }
+
+
+#ifdef FT_INT64
+
+  /* XXH64 of Yann Collet, a fast non-cryptographic hash */
+
+#define XXH_PRIME1  (FT_UInt64)0x9E3779B185EBCA87ULL
+#define XXH_PRIME2  (FT_UInt64)0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME3  (FT_UInt64)0x165667B19E3779F9ULL
+#define XXH_PRIME4  (FT_UInt64)0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME5  (FT_UInt64)0x27D4EB2F165667C5ULL
+
+#define XXH_ROTL( x, r )  ( ( (x) << (r) ) | ( (x) >> ( 64 - (r) ) ) )
+
+
+  /* compilers turn these into plain loads on little-endian machines */
+  static FT_UInt64
+  XXH_Read64( const unsigned char*  p )
+  {
+    return   (FT_UInt64)p[0]         | ( (FT_UInt64)p[1] <<  8 ) |
+           ( (FT_UInt64)p[2] << 16 ) | ( (FT_UInt64)p[3] << 24 ) |
+           ( (FT_UInt64)p[4] << 32 ) | ( (FT_UInt64)p[5] << 40 ) |
+           ( (FT_UInt64)p[6] << 48 ) | ( (FT_UInt64)p[7] << 56 );
+  }
+
+
+  static FT_UInt64
+  XXH_Read32( const unsigned char*  p )
+  {
+    return   (FT_UInt64)p[0]         | ( (FT_UInt64)p[1] <<  8 ) |
+           ( (FT_UInt64)p[2] << 16 ) | ( (FT_UInt64)p[3] << 24 );
+  }
+
+
+  static FT_UInt64
+  XXH_Round( FT_UInt64  acc,
+             FT_UInt64  input )
+  {
+    acc += input * XXH_PRIME2;
+    acc  = XXH_ROTL( acc, 31 );
+
+    return acc * XXH_PRIME1;
+  }
+
+
+  static FT_UInt64
+  XXH_Merge( FT_UInt64  acc,
+             FT_UInt64  val )
+  {
+    acc ^= XXH_Round( 0, val );
+
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+  }
+
+
+  static FT_UInt64
+  XXH64( const unsigned char*  p,
+         unsigned long         size )
   {
-    unsigned int   i, j;
-    unsigned char  *b;
-    unsigned long  s1, s2;
-    long           d0, d1;
+    const unsigned char*  limit = p + size;
+    FT_UInt64             h;
 
 
-    /* X-acutance */
-    for ( b = bitmap->buffer, s1 = s2 = 0, i = 0; i < bitmap->rows; i++ )
+    if ( size >= 32 )
     {
-      for ( d0 = d1 = 0, j = 0; j < bitmap->width; j++, b++ )
+      FT_UInt64  v1 = XXH_PRIME1 + XXH_PRIME2;
+      FT_UInt64  v2 = XXH_PRIME2;
+      FT_UInt64  v3 = 0;
+      FT_UInt64  v4 = 0 - XXH_PRIME1;
+
+
+      /* four independent lanes of 8 bytes each */
+      do
       {
-        d1 -= *b;
-        /* second derivative sum */
-        s2 += (unsigned long)( d1 >= d0 ? d1 - d0 : d0 - d1 );
-        /*  first derivative sum */
-        s1 += (unsigned long)( d1 >= 0 ? d1 : -d1 );
-        d0  = d1;
-        d1  = *b;
-      }
-      s2 += (unsigned long)( d1 > d0 ? d1 - d0 : d0 - d1 );
-      s2 += (unsigned long)d1;
-      s1 += (unsigned long)d1;
+        v1 = XXH_Round( v1, XXH_Read64( p      ) );
+        v2 = XXH_Round( v2, XXH_Read64( p +  8 ) );
+        v3 = XXH_Round( v3, XXH_Read64( p + 16 ) );
+        v4 = XXH_Round( v4, XXH_Read64( p + 24 ) );
+        p += 32;
+
+      } while ( limit - p >= 32 );
+
+      h = XXH_ROTL( v1,  1 ) + XXH_ROTL( v2,  7 ) +
+          XXH_ROTL( v3, 12 ) + XXH_ROTL( v4, 18 );
+      h = XXH_Merge( h, v1 );
+      h = XXH_Merge( h, v2 );
+      h = XXH_Merge( h, v3 );
+      h = XXH_Merge( h, v4 );
     }
-
-    if ( s1 )
-      printf( "%.4lf ", (double)s2 / s1 );
     else
-      printf( "  void " );
+      h = XXH_PRIME5;
 
-    /* Y-acutance */
-    for ( s1 = s2 = 0, j = 0; j < bitmap->width; j++ )
+    h += size;
+
+    for ( ; limit - p >= 8; p += 8 )
     {
-      b = bitmap->buffer + j;
-      for ( d0 = d1 = 0, i = 0; i < bitmap->rows; i++, b += bitmap->pitch )
-      {
-        d1 -= *b;
-        /* second derivative sum */
-        s2 += (unsigned long)( d1 >= d0 ? d1 - d0 : d0 - d1 );
-        /*  first derivative sum */
-        s1 += (unsigned long)( d1 >= 0 ? d1 : -d1 );
-        d0  = d1;
-        d1  = *b;
-      }
-      s2 += (unsigned long)( d1 > d0 ? d1 - d0 : d0 - d1 );
-      s2 += (unsigned long)d1;
-      s1 += (unsigned long)d1;
+      h ^= XXH_Round( 0, XXH_Read64( p ) );
+      h  = XXH_ROTL( h, 27 ) * XXH_PRIME1 + XXH_PRIME4;
     }
 
-    if ( s1 )
-      printf( "%.4lf ", (double)s2 / s1 );
-    else
-      printf( "  void " );
+    if ( limit - p >= 4 )
+    {
+      h ^= XXH_Read32( p ) * XXH_PRIME1;
+      h  = XXH_ROTL( h, 23 ) * XXH_PRIME2 + XXH_PRIME3;
+      p += 4;
+    }
+
+    for ( ; p < limit; p++ )
+    {
+      h ^= *p * XXH_PRIME5;
+      h  = XXH_ROTL( h, 11 ) * XXH_PRIME1;
+    }
+
+    /* avalanche */
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+
+    return h;
   }
 
+#endif /* FT_INT64 */
+
 
-  /* Calculate MD5 checksum; bitmap should have positive pitch */
+  /* compute the selected digest of a block of memory */
   static void
-  Checksum( FT_Bitmap* bitmap )
+  Digest( const unsigned char*  data,
+          unsigned long         size,
+          unsigned char*        result )
   {
-    MD5_CTX        ctx;
-    unsigned char  md5[16];
-    int            i;
+#ifdef FT_INT64
+    if ( digest != digests )
+    {
+      FT_UInt64  h = XXH64( data, size );
+      int        i;
+
 
-    MD5_Init( &ctx );
-    if ( bitmap->buffer )
-      MD5_Update( &ctx, bitmap->buffer,
-                  (unsigned long)bitmap->rows * (unsigned long)bitmap->pitch );
-    MD5_Final( md5, &ctx );
+      /* canonical big-endian form */
+      for ( i = 7; i >= 0; i--, h >>= 8 )
+        result[i] = (unsigned char)h;
+    }
+    else
+#endif
+    {
+      MD5_CTX  ctx;
 
-    for ( i = 0; i < 16; i++ )
-       printf( "%02X", md5[i] );
+
+      MD5_Init( &ctx );
+      if ( size )
+        MD5_Update( &ctx, data, size );
+      MD5_Final( result, &ctx );
+    }
   }
 
 
-  int
-  main( int     argc,
-        char**  argv )
+  /* Calculate the digest; bitmap should have positive pitch */
+  static void
+  Checksum( FT_Bitmap*  bitmap,
+            GlyphInfo*  info )
   {
-    int           file_index, face_index;
-    const char*   execname;
-    char*         fname;
-    int           opt;
-    unsigned int  first_index = 0;
-    unsigned int  last_index = UINT_MAX;
-    int           quiet = 0;
+    unsigned int  i;
 
 
-    execname = ft_basename( argv[0] );
-
-    while ( ( opt =  getopt( argc, argv, "f:r:i:q") ) != -1)
-    {
+    Digest( bitmap->buffer,
+            bitmap->buffer ? (unsigned long)bitmap->rows *
+                               (unsigned long)bitmap->pitch
+                           : 0,
+            info->digest );
 
-      switch ( opt )
-      {
+    for ( i = 0; i < digest->size; i++ )
+       sprintf( info->hash + 2 * i, "%02X", info->digest[i] );
+  }
 
-      case 'f':
-        load_flags = strtol( optarg, NULL, 16 );
-        break;
 
-      case 'r':
-        {
-         int  rm = atoi( optarg );
+  /* fold a glyph into the digest of its face, in glyph index order */
+  static void
+  Rollup( unsigned char*  face_digest,
+          GlyphInfo*      info )
+  {
+    unsigned char  buffer[16 + 16 + 16];
+    unsigned int   fields[4];
+    unsigned int   i, j, n = digest->size;
 
 
-         if ( rm < 0 || rm >= FT_RENDER_MODE_MAX )
-            render_mode = FT_RENDER_MODE_NORMAL;
-          else
-            render_mode = (FT_Render_Mode)rm;
-        }
-        break;
+    fields[0] = info->id;
+    fields[1] = (unsigned int)info->error;
+    fields[2] = info->width;
+    fields[3] = info->rows;
 
-      case 'i':
-        {
-          int           j;
-          unsigned int  fi, li;
+    memcpy( buffer, face_digest, n );
+    for ( i = 0; i < 4; i++ )
+      for ( j = 0; j < 4; j++ )
+        buffer[n + 4 * i + j] = (unsigned char)( fields[i] >> ( 8 * j ) );
+    memcpy( buffer + n + 16, info->digest, n );
 
-          j = sscanf( optarg, "%u%*[,:-]%u", &fi, &li );
+    Digest( buffer, 2 * n + 16, face_digest );
+  }
 
-          if ( j == 2 )
-          {
-            first_index = fi;
-            last_index  = li >= fi ? li : UINT_MAX;
-          }
-          else if ( j == 1 )
-            first_index = last_index = fi;
-        }
-        break;
 
-      case 'q':
-        quiet = 1;
-        break;
+  /* check a glyph; return 0 if it loaded and rendered fine */
+  static int
+  Check_Glyph( FT_Library      library,
+               FT_Face         face,
+               const Setting*  setting,
+               unsigned int    id,
+               GlyphInfo*      info )
+  {
+    FT_GlyphSlot  slot = face->glyph;
+    FT_Bitmap     bitmap;
 
-      default:
-        Usage( execname );
-        break;
-      }
-    }
 
-    argc -= optind;
-    argv += optind;
+    memset( info, 0, sizeof ( *info ) );
+    info->id = id;
 
-    if ( argc < 2 || sscanf( argv[0], "%d", &ptsize) != 1 )
-      Usage( execname );
+    info->error = FT_Load_Glyph( face, id, setting->load_flags );
+    if ( info->error )
+    {
+      info->stage = "loading";
+      return 1;
+    }
 
-    /* sync target and mode */
-    load_flags |= FT_LOAD_TARGET_( render_mode );
-    render_mode = (FT_Render_Mode)( ( load_flags & 0xF0000 ) >> 16 );
+    if ( quiet )
+      return 0;
 
-    error = FT_Init_FreeType( &library );
-    if ( error )
+    info->format = slot->format;
+    if ( slot->format == FT_GLYPH_FORMAT_OUTLINE )
     {
-      Error( "" );
-      exit( 1 );
+      Examine( slot, info );
+      Explore( slot, info );
     }
 
-    /* Now check all files */
-    for ( face_index = 0, file_index = 1; file_index < argc; file_index++ )
+    info->error = FT_Render_Glyph( slot, setting->render_mode );
+    if ( info->error && slot->format != FT_GLYPH_FORMAT_BITMAP )
     {
-      unsigned int  id, fi, li;
+      info->stage = "rendering";
+      return 1;
+    }
 
+    FT_Bitmap_Init( &bitmap );
 
-      fname = argv[file_index];
+    /* convert to an 8-bit bitmap with a positive pitch */
+    info->error = FT_Bitmap_Convert( library, &slot->bitmap, &bitmap, 1 );
+    if ( info->error )
+    {
+      /* not counted as a failure */
+      info->stage = "converting";
+      return 0;
+    }
 
-      printf( "%s:\n", fname );
+    info->rendered = 1;
+    info->width    = bitmap.width;
+    info->rows     = bitmap.rows;
 
-    Next_Face:
-      error = FT_New_Face( library, fname, face_index, &face );
-      if ( error )
-      {
-        Error( "  opening " );
-        continue;
-      }
+    Analyze( &bitmap, info );
+    Checksum( &bitmap, info );
 
-      printf( "  %s %s, %d ppem, %08X, %s%c",
-              face->family_name, face->style_name,
-              ptsize, load_flags, modes[render_mode],
-              quiet ? ':' : '\n' );
+    FT_Bitmap_Done( library, &bitmap );
 
-      error = FT_Set_Char_Size( face, ptsize << 6, ptsize << 6, 72, 72 );
-      if ( error )
-      {
-        Error( "  sizing " );
-        goto Finalize;
-      }
+    return 0;
+  }
 
-      /* nothing to do */
-      if ( !face->num_glyphs )
-        goto Finalize;
 
-      fi = first_index > 0 ? first_index : 0;
-      li = last_index < (unsigned int)face->num_glyphs ?
-                        last_index : (unsigned int)face->num_glyphs - 1;
+  static void
+  Print_Glyph_Text( Output*     out,
+                    GlyphInfo*  info )
+  {
+    int  i;
+
 
+    if ( info->error && !strcmp( info->stage, "loading" ) )
+    {
       if ( !quiet )
       {
-        /*        "NNNNN SS.SS XXX+YYY WWWxHHHH X.XXXX Y.YYYY MMDD55MMDD55MMDD55MMDD55MMDD55MM" */
-        printf( "\n GID  shape X+Yturn imgsize  Xacut  Yacut  MD5 hashsum" );
-        printf( "\n-------------------------------------------------------------------\n" );
+        Print( out, "%5u ", info->id );
+        Error( out, "loading ", info->error );
       }
+      return;
+    }
 
-      Fail = 0;
-      for ( id = fi; id <= li; id++ )
-      {
-        FT_Bitmap  bitmap;
+    if ( quiet )
+      return;
 
+    Print( out, "%5u ", info->id );
 
-        error = FT_Load_Glyph( face, id, load_flags );
-        if ( error )
-        {
-          if ( !quiet )
-          {
-            printf( "%5u ", id );
-            Error( "loading " );
-          }
-          Fail++;
-          continue;
-        }
+    if ( info->format != FT_GLYPH_FORMAT_OUTLINE )
+      Print( out, " %c%c%c%c    +    ",
+             (int)( ( info->format >> 24 ) & 0xFF ),
+             (int)( ( info->format >> 16 ) & 0xFF ),
+             (int)( ( info->format >>  8 ) & 0xFF ),
+             (int)( ( info->format       ) & 0xFF ) );
+    else
+    {
+      if ( info->shape >= 0 )
+        Print( out, "%5.2f ", info->shape );
+      else
+        Print( out, " void " );
 
-        if ( quiet )
-          continue;
+      Print( out, "%3d+%-3d ", info->turns[0], info->turns[1] );
+    }
 
-        printf( "%5u ", id );
+    if ( info->error )
+    {
+      Print( out, "%s ", info->stage );
+      Error( out, "", info->error );
+      return;
+    }
 
-        Examine( face->glyph );
-        Explore( face->glyph );
+    Print( out, "%3ux%-4u ", info->width, info->rows );
 
-        error = FT_Render_Glyph( face->glyph, render_mode );
-        if ( error && face->glyph->format != FT_GLYPH_FORMAT_BITMAP )
-        {
-          Error( "rendering " );
-          Fail++;
-          continue;
-        }
+    for ( i = 0; i < 2; i++ )
+      if ( info->acutance[i] >= 0 )
+        Print( out, "%.4lf ", info->acutance[i] );
+      else
+        Print( out, "  void " );
 
-        FT_Bitmap_Init( &bitmap );
+    Print( out, "%s\n", info->hash );
+  }
 
-        /* convert to an 8-bit bitmap with a positive pitch */
-        error = FT_Bitmap_Convert( library, &face->glyph->bitmap, &bitmap, 1 );
-        if ( error )
-        {
-          Error( "converting " );
-          continue;
-        }
-        else
-          printf( "%3ux%-4u ", bitmap.width, bitmap.rows );
 
-        Analyze( &bitmap );
-        Checksum( &bitmap );
+  static void
+  Print_JSON_String( Output*      out,
+                     const char*  str )
+  {
+    const unsigned char*  p = (const unsigned char*)( str ? str : "" );
 
-        FT_Bitmap_Done( library, &bitmap );
 
-        printf( "\n" );
-      }
+    Print( out, "\"" );
 
-      if ( Fail == 0 )
-        printf( "  OK.\n" );
-      else if ( Fail == 1 )
-        printf( "  1 fail.\n" );
+    for ( ; *p; p++ )
+    {
+      if ( *p == '"' || *p == '\\' )
+        Print( out, "\\%c", *p );
+      else if ( *p < 0x20 )
+        Print( out, "\\u%04x", *p );
       else
-        printf( "  %d fails.\n", Fail );
+        Print( out, "%c", *p );
+    }
 
-    Finalize:
+    Print( out, "\"" );
+  }
 
-      if ( ++face_index == face->num_faces )
-        face_index = 0;
 
-      FT_Done_Face( face );
+  /* start a JSON object with the file name, face index, and setting */
+  static void
+  Print_JSON_Start( Output*         out,
+                    const char*     type,
+                    const char*     fname,
+                    FT_Long         face_index,
+                    const Setting*  setting )
+  {
+    Print( out, "{\"type\":\"%s\",\"file\":", type );
+    Print_JSON_String( out, fname );
+    Print( out, ",\"face\":%ld", face_index );
+
+    if ( setting )
+      Print( out, ",\"ppem\":%d,\"flags\":\"%08X\",\"mode\":\"%s\"",
+             setting->ptsize, setting->load_flags,
+             modes[setting->render_mode] );
+  }
+
+
+  static void
+  Print_JSON_Error( Output*      out,
+                    FT_Error     error,
+                    const char*  stage )
+  {
+    Print( out, ",\"error\":%d", error );
+    if ( error )
+    {
+      Print( out, ",\"stage\":\"%s\",\"message\":", stage );
+      Print_JSON_String( out, Error_String( error ) );
+    }
+  }
+
+
+  static void
+  Print_Glyph_JSON( Output*         out,
+                    const char*     fname,
+                    FT_Long         face_index,
+                    const Setting*  setting,
+                    GlyphInfo*      info )
+  {
+    /* in quiet mode, only failures are of interest */
+    if ( quiet && !info->error )
+      return;
+
+    Print_JSON_Start( out, "glyph", fname, face_index, setting );
+    Print( out, ",\"gid\":%u", info->id );
+    Print_JSON_Error( out, info->error, info->stage );
+
+    if ( info->format )
+    {
+      if ( info->format == FT_GLYPH_FORMAT_OUTLINE )
+      {
+        if ( info->shape >= 0 )
+          Print( out, ",\"shape\":%.4f", info->shape );
+        else
+          Print( out, ",\"shape\":null" );
+
+        Print( out, ",\"turns\":[%d,%d]", info->turns[0], info->turns[1] );
+      }
+      else
+        Print( out, ",\"format\":\"%c%c%c%c\"",
+               (int)( ( info->format >> 24 ) & 0xFF ),
+               (int)( ( info->format >> 16 ) & 0xFF ),
+               (int)( ( info->format >>  8 ) & 0xFF ),
+               (int)( ( info->format       ) & 0xFF ) );
+    }
+
+    if ( info->rendered )
+    {
+      int  i;
+
+
+      Print( out, ",\"width\":%u,\"rows\":%u", info->width, info->rows );
+
+      for ( i = 0; i < 2; i++ )
+        if ( info->acutance[i] >= 0 )
+          Print( out, ",\"%cacut\":%.4f", "xy"[i], info->acutance[i] );
+        else
+          Print( out, ",\"%cacut\":null", "xy"[i] );
+
+      Print( out, ",\"%s\":\"%s\"", digest->name, info->hash );
+    }
+
+    Print( out, "}\n" );
+  }
+
+
+  /* lint a face with one setting */
+  static void
+  Lint_Setting( FT_Library      library,
+                FT_Face         face,
+                FT_Size*        sizes,
+                FT_Error*       size_errors,
+                const Setting*  setting,
+                const char*     fname,
+                FT_Long         face_index,
+                Output*         out )
+  {
+    FT_Error       error;
+    unsigned int   id, fi, li, count = 0;
+    int            Fail = 0;
+    unsigned char  face_digest[16];
+    char           face_hash[33];
+    Acutance       face_sums;
+
+
+    if ( !json )
+      Print( out, "  %s %s, %d ppem, %08X, %s%c",
+             face->family_name, face->style_name,
+             setting->ptsize, setting->load_flags,
+             modes[setting->render_mode],
+             quiet ? ':' : '\n' );
+
+    memset( face_digest, 0, sizeof ( face_digest ) );
+    acutance_init( &face_sums );
+
+    error = size_errors[setting->size_index];
+    if ( !error )
+      error = FT_Activate_Size( sizes[setting->size_index] );
+    if ( error )
+    {
+      if ( !json )
+        Error( out, "  sizing ", error );
+      goto Finalize;
+    }
+
+    /* nothing to do */
+    if ( !face->num_glyphs )
+      goto Finalize;
+
+    fi = first_index > 0 ? first_index : 0;
+    li = last_index < (unsigned int)face->num_glyphs ?
+                      last_index : (unsigned int)face->num_glyphs - 1;
+
+    if ( !quiet && !json )
+    {
+      /*             "NNNNN SS.SS XXX+YYY WWWxHHHH X.XXXX Y.YYYY MMDD55MMDD55MMDD55MMDD55MMDD55MM" */
+      Print( out, "\n GID  shape X+Yturn imgsize  Xacut  Yacut  %s hashsum",
+             digest->label );
+      Print( out, "\n-------------------------------------------------------------------\n" );
+    }
+
+    for ( id = fi; id <= li; id++, count++ )
+    {
+      GlyphInfo  info;
+
+
+      Fail += Check_Glyph( library, face, setting, id, &info );
+
+      /* the face digest is only shown with `-d' or `-J' */
+      if ( !quiet && ( rollup || json ) )
+        Rollup( face_digest, &info );
+
+      /* the acutance of the whole face */
+      if ( info.rendered )
+      {
+        face_sums.first[0]  += info.sums.first[0];
+        face_sums.first[1]  += info.sums.first[1];
+        face_sums.second[0] += info.sums.second[0];
+        face_sums.second[1] += info.sums.second[1];
+      }
+
+      if ( json )
+        Print_Glyph_JSON( out, fname, face_index, setting, &info );
+      else
+        Print_Glyph_Text( out, &info );
+    }
+
+    if ( !json )
+    {
+      if ( rollup && !quiet )
+      {
+        for ( id = 0; id < digest->size; id++ )
+          sprintf( face_hash + 2 * id, "%02X", face_digest[id] );
+        Print( out, "  face %s: %s\n", digest->name, face_hash );
+      }
+
+      if ( Fail == 0 )
+        Print( out, "  OK.\n" );
+      else if ( Fail == 1 )
+        Print( out, "  1 fail.\n" );
+      else
+        Print( out, "  %d fails.\n", Fail );
+    }
+
+  Finalize:
+
+    if ( json )
+    {
+      Print_JSON_Start( out, "face", fname, face_index, setting );
+      Print_JSON_Error( out, error, "sizing" );
+      Print( out, ",\"family\":" );
+      Print_JSON_String( out, face->family_name );
+      Print( out, ",\"style\":" );
+      Print_JSON_String( out, face->style_name );
+      Print( out, ",\"glyphs\":%u,\"fails\":%d", count, Fail );
+
+      /* the rollup needs the rendering results */
+      if ( !quiet && !error )
+      {
+        for ( id = 0; id < 2; id++ )
+          if ( acutance_get( &face_sums, (int)id ) >= 0 )
+            Print( out, ",\"%cacut\":%.4f",
+                   "xy"[id], acutance_get( &face_sums, (int)id ) );
+          else
+            Print( out, ",\"%cacut\":null", "xy"[id] );
+
+        for ( id = 0; id < digest->size; id++ )
+          sprintf( face_hash + 2 * id, "%02X", face_digest[id] );
+        Print( out, ",\"digest\":\"%s\",\"rollup\":\"%s\"",
+               digest->name, face_hash );
+      }
+
+      Print( out, "}\n" );
+    }
+  }
+
+
+  /* lint all faces of a file; each face is opened and */
+  /* each of its sizes is set up only once             */
+  static void
+  Lint_File( FT_Library   library,
+             const char*  fname,
+             Output*      out )
+  {
+    FT_Error      error;
+    FT_Face       face;
+    FT_Long       face_index = 0;
+    FT_Size       sizes[MAX_SIZES];
+    FT_Error      size_errors[MAX_SIZES];
+    unsigned int  i;
+
+
+    if ( !json )
+      Print( out, "%s:\n", fname );
+
+    do
+    {
+      error = FT_New_Face( library, fname, face_index, &face );
+      if ( error )
+      {
+        if ( json )
+        {
+          Print_JSON_Start( out, "face", fname, face_index, NULL );
+          Print_JSON_Error( out, error, "opening" );
+          Print( out, "}\n" );
+        }
+        else
+          Error( out, "  opening ", error );
+        return;
+      }
+
+      /* the face's own size object serves the first size */
+      for ( i = 0; i < num_ptsizes; i++ )
+      {
+        FT_F26Dot6  size = (FT_F26Dot6)ptsizes[i] << 6;
+
+
+        sizes[i]       = face->size;
+        size_errors[i] = i ? FT_New_Size( face, &sizes[i] ) : 0;
+        if ( !size_errors[i] )
+          size_errors[i] = FT_Activate_Size( sizes[i] );
+        if ( !size_errors[i] )
+          size_errors[i] = FT_Set_Char_Size( face, size, size, 72, 72 );
+      }
+
+      for ( i = 0; i < num_settings; i++ )
+        Lint_Setting( library, face, sizes, size_errors, &settings[i],
+                      fname, face_index, out );
+
+      if ( ++face_index == face->num_faces )
+        face_index = 0;
+
+      /* this also discards the sizes */
+      FT_Done_Face( face );
+
+    } while ( face_index );
+  }
+
+
+  /* a job of `workpool_run': lint one file of the batch */
+  static void
+  Lint_Job( void*         data,
+            unsigned int  index,
+            unsigned int  worker )
+  {
+    Batch*       batch   = (Batch*)data;
+    FT_Library*  library = &batch->libraries[worker];
+    Output*      out     = &batch->outputs[index];
+
+
+    if ( !*library )
+    {
+      FT_Error  error = FT_Init_FreeType( library );
+
+
+      if ( error )
+      {
+        *library = NULL;
+        if ( json )
+        {
+          Print_JSON_Start( out, "face", batch->fnames[index], 0, NULL );
+          Print_JSON_Error( out, error, "initializing" );
+          Print( out, "}\n" );
+        }
+        else
+        {
+          Print( out, "%s:\n", batch->fnames[index] );
+          Error( out, "  initializing ", error );
+        }
+        return;
+      }
+    }
+
+    Lint_File( *library, batch->fnames[index], out );
+  }
+
+
+  /*************************************************************************/
+  /*                                                                       */
+  /* Comparison of two JSON Lines reports.  The parser only understands    */
+  /* the flat objects written above, one per line.                         */
+  /*                                                                       */
+  /*************************************************************************/
+
+  /* a face with one setting */
+  typedef struct  FaceStat_
+  {
+    char*         file;
+    long          index;
+    int           ppem;
+    char          flags[9];
+    unsigned int  glyphs;     /* in the new report */
+    unsigned int  changed;
+    unsigned int  added;
+    unsigned int  removed;
+
+  } FaceStat;
+
+
+  typedef struct  GlyphRecord_
+  {
+    unsigned int  face;       /* index into the face array */
+    unsigned int  gid;
+    int           error;
+    int           rendered;
+    unsigned int  width;
+    unsigned int  rows;
+    char          hash[33];
+    int           seen;
+    int           next;       /* in the hash bucket, or -1 */
+
+  } GlyphRecord;
+
+
+  typedef struct  Report_
+  {
+    FaceStat*     faces;
+    unsigned int  num_faces;
+    unsigned int  max_faces;
+
+    GlyphRecord*  glyphs;     /* of the old report */
+    unsigned int  num_glyphs;
+    unsigned int  max_glyphs;
+
+    int*          buckets;
+    unsigned int  num_buckets;  /* a power of 2 */
+
+  } Report;
+
+
+  static void*
+  Grow( void*         block,
+        unsigned int  count,
+        unsigned int* max,
+        size_t        item_size )
+  {
+    if ( count < *max )
+      return block;
+
+    *max  = *max ? 2 * *max : 64;
+    block = realloc( block, *max * item_size );
+    if ( !block )
+    {
+      fprintf( stderr, "ftlint: out of memory\n" );
+      exit( 2 );
+    }
+
+    return block;
+  }
+
+
+  /* read a whole line of any length; return NULL at the end of the file */
+  static char*
+  Read_Line( FILE*    file,
+             char**   buffer,
+             size_t*  size )
+  {
+    size_t  length = 0;
+
+
+    if ( !*buffer )
+    {
+      *size   = 1024;
+      *buffer = (char*)malloc( *size );
+    }
+
+    while ( *buffer )
+    {
+      if ( !fgets( *buffer + length, (int)( *size - length ), file ) )
+        return length ? *buffer : NULL;
+
+      length += strlen( *buffer + length );
+      if ( length && (*buffer)[length - 1] == '\n' )
+        return *buffer;
+
+      if ( length + 1 < *size )   /* no newline at the end of the file */
+        return *buffer;
+
+      *size  *= 2;
+      *buffer = (char*)realloc( *buffer, *size );
+    }
+
+    fprintf( stderr, "ftlint: out of memory\n" );
+    exit( 2 );
+  }
+
+
+  /* return what follows `"key":' in a flat JSON object, or NULL */
+  static const char*
+  JSON_Find( const char*  line,
+             const char*  key )
+  {
+    size_t       len = strlen( key );
+    const char*  p   = line;
+
+
+    while ( ( p = strchr( p, '"' ) ) != NULL )
+    {
+      if ( p > line                              &&
+           ( p[-1] == '{' || p[-1] == ',' )      &&
+           !strncmp( p + 1, key, len )           &&
+           p[len + 1] == '"' && p[len + 2] == ':' )
+        return p + len + 3;
+
+      /* skip the string */
+      for ( p++; *p && *p != '"'; p++ )
+        if ( *p == '\\' && p[1] )
+          p++;
+      if ( !*p )
+        break;
+      p++;
+    }
+
+    return NULL;
+  }
+
+
+  /* unescape a string value into a new block; NULL if missing */
+  static char*
+  JSON_String( const char*  line,
+               const char*  key )
+  {
+    const char*  p = JSON_Find( line, key );
+    char*        str;
+    char*        q;
+
+
+    if ( !p || *p++ != '"' )
+      return NULL;
+
+    str = q = (char*)malloc( strlen( p ) + 1 );
+    if ( !str )
+      return NULL;
+
+    for ( ; *p && *p != '"'; p++ )
+    {
+      if ( *p == '\\' && p[1] )
+      {
+        p++;
+        if ( *p == 'u' )
+        {
+          unsigned int  c;
+
+
+          if ( sscanf( p + 1, "%4x", &c ) == 1 )
+          {
+            *q++ = (char)c;
+            p   += 4;
+          }
+          continue;
+        }
+      }
+      *q++ = *p;
+    }
+    *q = '\0';
+
+    return str;
+  }
+
+
+  /* get a number value; return 0 if missing or null */
+  static int
+  JSON_Number( const char*  line,
+               const char*  key,
+               double*      value )
+  {
+    const char*  p = JSON_Find( line, key );
+    char*        end;
+
+
+    if ( !p )
+      return 0;
+
+    *value = strtod( p, &end );
+
+    return end != p;
+  }
+
+
+  static unsigned int
+  Report_Face( Report*      report,
+               const char*  line )
+  {
+    char*         file  = JSON_String( line, "file" );
+    char*         flags = JSON_String( line, "flags" );
+    double        index, ppem;
+    unsigned int  i;
+
+
+    if ( !file )
+      file = ft_strdup( "" );
+    if ( !JSON_Number( line, "face", &index ) )
+      index = 0;
+    if ( !JSON_Number( line, "ppem", &ppem ) )
+      ppem = 0;
+
+    /* records come grouped by face, so search backwards */
+    for ( i = report->num_faces; i > 0; i-- )
+    {
+      FaceStat*  face = &report->faces[i - 1];
+
+
+      if ( face->index == (long)index                &&
+           face->ppem == (int)ppem                    &&
+           !strcmp( face->flags, flags ? flags : "" ) &&
+           !strcmp( face->file, file )                )
+      {
+        free( file );
+        free( flags );
+        return i - 1;
+      }
+    }
+
+    report->faces = (FaceStat*)Grow( report->faces, report->num_faces,
+                                     &report->max_faces,
+                                     sizeof ( FaceStat ) );
+
+    memset( &report->faces[report->num_faces], 0, sizeof ( FaceStat ) );
+    report->faces[report->num_faces].file  = file;
+    report->faces[report->num_faces].index = (long)index;
+    report->faces[report->num_faces].ppem  = (int)ppem;
+    if ( flags )
+      strncpy( report->faces[report->num_faces].flags, flags, 8 );
+    free( flags );
+
+    return report->num_faces++;
+  }
+
+
+  /* parse a glyph record; return 0 if `line' is not one */
+  static int
+  Report_Glyph( Report*       report,
+                const char*   line,
+                GlyphRecord*  rec )
+  {
+    const char*   type = JSON_Find( line, "type" );
+    double        value;
+    char*         hash = NULL;
+    unsigned int  i;
+
+
+    if ( !type || strncmp( type, "\"glyph\"", 7 ) )
+      return 0;
+
+    memset( rec, 0, sizeof ( *rec ) );
+
+    if ( !JSON_Number( line, "gid", &value ) )
+      return 0;
+    rec->gid = (unsigned int)value;
+
+    if ( JSON_Number( line, "error", &value ) )
+      rec->error = (int)value;
+
+    for ( i = 0; i < NUM_DIGESTS && !hash; i++ )
+      hash = JSON_String( line, digests[i].name );
+    if ( hash )
+    {
+      /* reports with different digests never match */
+      strncpy( rec->hash, hash, 32 );
+      free( hash );
+
+      rec->rendered = 1;
+      if ( JSON_Number( line, "width", &value ) )
+        rec->width = (unsigned int)value;
+      if ( JSON_Number( line, "rows", &value ) )
+        rec->rows = (unsigned int)value;
+    }
+
+    rec->face = Report_Face( report, line );
+    rec->next = -1;
+
+    return 1;
+  }
+
+
+  static unsigned int
+  Report_Hash( unsigned int  face,
+               unsigned int  gid )
+  {
+    return ( face * 2654435761U ) ^ ( gid * 40503U );
+  }
+
+
+  static GlyphRecord*
+  Report_Lookup( Report*       report,
+                 unsigned int  face,
+                 unsigned int  gid )
+  {
+    int  i;
+
+
+    if ( !report->num_buckets )
+      return NULL;
+
+    i = report->buckets[Report_Hash( face, gid ) &
+                          ( report->num_buckets - 1 )];
+    for ( ; i >= 0; i = report->glyphs[i].next )
+      if ( report->glyphs[i].face == face && report->glyphs[i].gid == gid )
+        return &report->glyphs[i];
+
+    return NULL;
+  }
+
+
+  static void
+  Report_Insert( Report*       report,
+                 GlyphRecord*  rec )
+  {
+    unsigned int  i, h;
+
+
+    /* rehash when the load factor reaches 1 */
+    if ( report->num_glyphs >= report->num_buckets )
+    {
+      report->num_buckets = report->num_buckets ? 2 * report->num_buckets
+                                                : 1024;
+      free( report->buckets );
+      report->buckets = (int*)malloc( report->num_buckets * sizeof ( int ) );
+      if ( !report->buckets )
+      {
+        fprintf( stderr, "ftlint: out of memory\n" );
+        exit( 2 );
+      }
+
+      memset( report->buckets, -1, report->num_buckets * sizeof ( int ) );
+      for ( i = 0; i < report->num_glyphs; i++ )
+      {
+        h = Report_Hash( report->glyphs[i].face, report->glyphs[i].gid ) &
+              ( report->num_buckets - 1 );
+        report->glyphs[i].next = report->buckets[h];
+        report->buckets[h]     = (int)i;
+      }
+    }
+
+    report->glyphs = (GlyphRecord*)Grow( report->glyphs, report->num_glyphs,
+                                         &report->max_glyphs,
+                                         sizeof ( GlyphRecord ) );
+
+    h = Report_Hash( rec->face, rec->gid ) & ( report->num_buckets - 1 );
+    rec->next          = report->buckets[h];
+    report->buckets[h] = (int)report->num_glyphs;
+
+    report->glyphs[report->num_glyphs++] = *rec;
+  }
+
+
+  static void
+  Print_Face_Label( FaceStat*  face )
+  {
+    printf( "%s[%ld], %d ppem, %s", face->file, face->index,
+            face->ppem, face->flags );
+  }
+
+
+  static void
+  Print_Glyph_Diff( FaceStat*     face,
+                    GlyphRecord*  old,
+                    GlyphRecord*  rec )
+  {
+    Print_Face_Label( face );
+    printf( ": gid %u:", rec->gid );
+
+    if ( old->error != rec->error )
+      printf( " error 0x%04x -> 0x%04x", old->error, rec->error );
+
+    if ( old->rendered != rec->rendered )
+      printf( old->rendered ? " no longer rendered" : " now rendered" );
+    else if ( old->rendered )
+    {
+      if ( old->width != rec->width || old->rows != rec->rows )
+        printf( " size %ux%u -> %ux%u",
+                old->width, old->rows, rec->width, rec->rows );
+      if ( strcmp( old->hash, rec->hash ) )
+        printf( " digest %s -> %s", old->hash, rec->hash );
+    }
+
+    printf( "\n" );
+  }
+
+
+  /* compare two reports; return 1 if they differ */
+  static int
+  Compare( const char*  old_name,
+           const char*  new_name )
+  {
+    Report        report;
+    GlyphRecord   rec;
+    GlyphRecord*  old;
+    FILE*         file;
+    char*         line = NULL;
+    size_t        size = 0;
+    unsigned int  i;
+    unsigned int  glyphs  = 0;
+    unsigned int  changed = 0;
+    unsigned int  added   = 0;
+    unsigned int  removed = 0;
+
+
+    memset( &report, 0, sizeof ( report ) );
+
+    file = fopen( old_name, "r" );
+    if ( !file )
+    {
+      fprintf( stderr, "ftlint: cannot open `%s'\n", old_name );
+      exit( 2 );
+    }
+
+    while ( Read_Line( file, &line, &size ) )
+      if ( Report_Glyph( &report, line, &rec ) )
+        Report_Insert( &report, &rec );
+
+    fclose( file );
+
+    file = fopen( new_name, "r" );
+    if ( !file )
+    {
+      fprintf( stderr, "ftlint: cannot open `%s'\n", new_name );
+      exit( 2 );
+    }
+
+    while ( Read_Line( file, &line, &size ) )
+    {
+      FaceStat*  face;
+
+
+      if ( !Report_Glyph( &report, line, &rec ) )
+        continue;
+
+      face = &report.faces[rec.face];
+      face->glyphs++;
+
+      old = Report_Lookup( &report, rec.face, rec.gid );
+      if ( !old )
+      {
+        Print_Face_Label( face );
+        printf( ": gid %u: added\n", rec.gid );
+        face->added++;
+        continue;
+      }
+
+      old->seen = 1;
+
+      if ( old->error    != rec.error    ||
+           old->rendered != rec.rendered ||
+           old->width    != rec.width    ||
+           old->rows     != rec.rows     ||
+           strcmp( old->hash, rec.hash ) )
+      {
+        Print_Glyph_Diff( face, old, &rec );
+        face->changed++;
+      }
+    }
+
+    fclose( file );
+    free( line );
+
+    for ( i = 0; i < report.num_glyphs; i++ )
+    {
+      FaceStat*  face;
+
+
+      old = &report.glyphs[i];
+      if ( old->seen )
+        continue;
+
+      face = &report.faces[old->face];
+      Print_Face_Label( face );
+      printf( ": gid %u: removed\n", old->gid );
+      face->removed++;
+    }
+
+    for ( i = 0; i < report.num_faces; i++ )
+    {
+      FaceStat*  face = &report.faces[i];
+
+
+      if ( face->changed || face->added || face->removed )
+      {
+        Print_Face_Label( face );
+        printf( ": %u glyphs, %u changed, %u added, %u removed\n",
+                face->glyphs, face->changed, face->added, face->removed );
+      }
+
+      glyphs  += face->glyphs;
+      changed += face->changed;
+      added   += face->added;
+      removed += face->removed;
+
+      free( face->file );
+    }
+
+    printf( "%u settings, %u glyphs, %u changed, %u added, %u removed\n",
+            report.num_faces, glyphs, changed, added, removed );
+
+    free( report.faces );
+    free( report.glyphs );
+    free( report.buckets );
+
+    return changed || added || removed;
+  }
+
+
+  /* parse a comma-separated list of numbers; return 0 if invalid */
+  static unsigned int
+  Parse_List( const char*   str,
+              int*          values,
+              unsigned int  max )
+  {
+    unsigned int  n = 0;
+    char*         end;
+
+
+    for ( ;; )
+    {
+      long  value = strtol( str, &end, 10 );
+
+
+      if ( end == str || n == max )
+        return 0;
+
+      values[n++] = (int)value;
+      if ( *end != ',' )
+        return n;
+
+      str = end + 1;
+    }
+  }
+
+
+  int
+  main( int     argc,
+        char**  argv )
+  {
+    FT_Error      error;
+    FT_Library    library;
+    const char*   execname;
+    int           opt;
+    int           file_index;
+    int           num_workers = 1;
+    int           compare     = 0;
+    int           render_modes[FT_RENDER_MODE_MAX] = { 0 };
+    unsigned int  num_modes   = 1;
+    unsigned int  i, j;
+
+
+    execname = ft_basename( argv[0] );
+
+    while ( ( opt =  getopt( argc, argv, "f:r:i:qj:Jcd:") ) != -1)
+    {
+
+      switch ( opt )
+      {
+
+      case 'f':
+        load_flags = strtol( optarg, NULL, 16 );
+        break;
+
+      case 'r':
+        num_modes = Parse_List( optarg, render_modes, FT_RENDER_MODE_MAX );
+        if ( !num_modes )
+          num_modes = 1;
+
+        for ( i = 0; i < num_modes; i++ )
+          if ( render_modes[i] < 0 || render_modes[i] >= FT_RENDER_MODE_MAX )
+            render_modes[i] = FT_RENDER_MODE_NORMAL;
+        break;
+
+      case 'i':
+        {
+          int           j;
+          unsigned int  fi, li;
+
+          j = sscanf( optarg, "%u%*[,:-]%u", &fi, &li );
+
+          if ( j == 2 )
+          {
+            first_index = fi;
+            last_index  = li >= fi ? li : UINT_MAX;
+          }
+          else if ( j == 1 )
+            first_index = last_index = fi;
+        }
+        break;
+
+      case 'q':
+        quiet = 1;
+        break;
+
+      case 'j':
+        num_workers = atoi( optarg );
+        if ( num_workers <= 0 )
+          num_workers = (int)workpool_num_cpus();
+        break;
+
+      case 'J':
+        json = 1;
+        break;
+
+      case 'c':
+        compare = 1;
+        break;
+
+      case 'd':
+        {
+          unsigned int  i;
+
+
+          for ( i = 0; i < NUM_DIGESTS; i++ )
+            if ( !strcmp( optarg, digests[i].name ) )
+              break;
+
+          if ( i == NUM_DIGESTS )
+            Usage( execname );
+
+          digest = &digests[i];
+          rollup = 1;
+        }
+        break;
+
+      default:
+        Usage( execname );
+        break;
+      }
+    }
+
+    argc -= optind;
+    argv += optind;
+
+    if ( compare )
+    {
+      if ( argc != 2 )
+        Usage( execname );
+
+      exit( Compare( argv[0], argv[1] ) );
+    }
+
+    if ( argc < 2 )
+      Usage( execname );
+
+    num_ptsizes = Parse_List( argv[0], ptsizes, MAX_SIZES );
+    if ( !num_ptsizes )
+      Usage( execname );
+
+    for ( i = 0; i < num_ptsizes; i++ )
+      for ( j = 0; j < num_modes; j++ )
+      {
+        Setting*  setting = &settings[num_settings++];
+
+
+        setting->ptsize     = ptsizes[i];
+        setting->size_index = i;
+
+        /* sync target and mode */
+        setting->load_flags  = load_flags |
+                                 FT_LOAD_TARGET_( render_modes[j] );
+        setting->render_mode = (FT_Render_Mode)
+                                 ( ( setting->load_flags & 0xF0000 ) >> 16 );
+      }
+
+    if ( num_workers == 1 || argc == 2 )
+    {
+      Output  out = { NULL, NULL, 0, 0 };
+
+
+      out.file = stdout;
+
+      error = FT_Init_FreeType( &library );
+      if ( error )
+      {
+        Error( &out, "", error );
+        exit( 1 );
+      }
+
+      /* Now check all files */
+      for ( file_index = 1; file_index < argc; file_index++ )
+        Lint_File( library, argv[file_index], &out );
+
+      FT_Done_FreeType( library );
+    }
+    else
+    {
+      /* Check the files in batches on the worker threads, */
+      /* each with its own library, and print the reports  */
+      /* of a batch in the order of the files              */
+      Batch         batch;
+      unsigned int  batch_size = (unsigned int)num_workers * BATCH_PER_WORKER;
+      unsigned int  count, i;
+
+
+      batch.outputs   = (Output*)calloc( batch_size, sizeof ( Output ) );
+      batch.libraries = (FT_Library*)calloc( (size_t)num_workers,
+                                             sizeof ( FT_Library ) );
+      if ( !batch.outputs || !batch.libraries )
+      {
+        fprintf( stderr, "ftlint: out of memory\n" );
+        exit( 1 );
+      }
+
+      for ( file_index = 1; file_index < argc; file_index += (int)count )
+      {
+        count = (unsigned int)( argc - file_index );
+        if ( count > batch_size )
+          count = batch_size;
+
+        batch.fnames = argv + file_index;
+
+        workpool_run( (unsigned int)num_workers, count, Lint_Job, &batch );
+
+        for ( i = 0; i < count; i++ )
+        {
+          if ( batch.outputs[i].length )
+            fwrite( batch.outputs[i].buffer, 1, batch.outputs[i].length,
+                    stdout );
+          batch.outputs[i].length = 0;
+        }
+      }
+
+      for ( i = 0; i < batch_size; i++ )
+        free( batch.outputs[i].buffer );
+      free( batch.outputs );
 
-      if ( face_index )
-        goto Next_Face;
+      for ( i = 0; i < (unsigned int)num_workers; i++ )
+        FT_Done_FreeType( batch.libraries[i] );
+      free( batch.libraries );
     }
 
-    FT_Done_FreeType( library );
     exit( 0 );      /* for safety reasons */
 
     /* return 0; */ /* never reached */
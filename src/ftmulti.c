@@ -31,6 +31,7 @@
 
 #include "graph.h"
 #include "grfont.h"
+#include "frametime.h"
 
 #define  DIM_X   640
 #define  DIM_Y   480
@@ -63,6 +64,9 @@
   static grBitmap*   bit;            /* current display bitmap      */
   static grColor     fore_color;     /* foreground on black back    */
   static grColor     step_color;     /* step color                  */
+  static grColor     back_color;     /* black background            */
+
+  static FrameTime   frame_time;     /* per-frame timing overlay    */
 
   static unsigned short  width  = DIM_X;     /* window width        */
   static unsigned short  height = DIM_Y;     /* window height       */
@@ -345,6 +349,7 @@
 
     fore_color = grFindColor( bit, 255, 255, 255, 255 );  /* white */
     step_color = grFindColor( bit,   0, 100,   0, 255 );  /* green */
+    back_color = grFindColor( bit,   0,   0,   0, 255 );  /* black */
 
     grSetTitle( surface, "FreeType Variations Viewer - press ? for help" );
   }
@@ -357,6 +362,7 @@
   {
     grBitmap  bit3;
     FT_Pos    x_top, y_top;
+    double    t;
 
 
     /* first, render the glyph image into a bitmap */
@@ -367,8 +373,10 @@
       /* toggle these flag to test the effects                     */
       glyph->outline.flags ^= overlaps | fillrule;
 
+      t     = frametime_start( &frame_time );
       error = FT_Render_Glyph( glyph, antialias ? FT_RENDER_MODE_NORMAL
                                                 : FT_RENDER_MODE_MONO );
+      frametime_stop( &frame_time, FRAMETIME_RENDER, t );
       if ( error )
         return error;
     }
@@ -395,8 +403,10 @@
     x_top = x_offset + glyph->bitmap_left;
     y_top = y_offset - glyph->bitmap_top;
 
+    t = frametime_start( &frame_time );
     grBlitGlyphToSurface( surface, &bit3,
                           x_top, y_top, fore_color );
+    frametime_stop( &frame_time, FRAMETIME_BLIT, t );
 
     return 0;
   }
@@ -415,7 +425,9 @@
   LoadChar( unsigned int  idx,
             int           hint )
   {
-    int  flags = FT_LOAD_NO_BITMAP;
+    int       flags = FT_LOAD_NO_BITMAP;
+    double    t;
+    FT_Error  err;
 
 
     if ( !antialias )
@@ -427,7 +439,11 @@
     else if ( autohint )
       flags |= FT_LOAD_FORCE_AUTOHINT;
 
-    return FT_Load_Glyph( face, idx, flags );
+    t   = frametime_start( &frame_time );
+    err = FT_Load_Glyph( face, idx, flags );
+    frametime_stop( &frame_time, FRAMETIME_LOAD, t );
+
+    return err;
   }
 
 
@@ -595,6 +611,7 @@
     grLn();
     grWriteln( "Tab         toggle anti-aliasing" );
     grWriteln( "Space       toggle rendering mode" );
+    grWriteln( "T           toggle frame timing" );
     grLn();
     grWriteln( ", .         previous/next font" );
     grLn();
@@ -754,6 +771,10 @@
                                  : "rendering test text string";
       break;
 
+    case grKEY( 'T' ):
+      frame_time.enabled = !frame_time.enabled;
+      break;
+
     /* MM-related keys */
 
     case grKEY( '+' ):
@@ -1202,6 +1223,7 @@
 
 
       Clear_Display();
+      frametime_begin( &frame_time );
 
       strbuf_init( header, Header, sizeof ( Header ) );
       strbuf_reset( header );
@@ -1328,6 +1350,7 @@
                        res == 72 ? "ppem" : "pt" );
 
       grWriteCellString( bit, 0, HEADER_HEIGHT, Header, fore_color );
+      frametime_draw( &frame_time, bit, fore_color, back_color, NULL );
 
       if ( !( key = Process_Event() ) )
         goto End;
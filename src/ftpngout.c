@@ -11,50 +11,454 @@
 /****************************************************************************/
 
 #include "ftcommon.h"
+#include "workpool.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-#ifdef FT_CONFIG_OPTION_USE_PNG
 
-#include <png.h>
+  /* how images are written, set from the environment on first use */
+  typedef struct  PrintOptions_
+  {
+    int  initialized;
+    int  pnm;         /* write PGM, PPM, or PAM instead of PNG  */
+    int  level;       /* PNG compression level, -1 for default  */
+    int  filter;      /* PNG row filters, -1 for default        */
+    int  thread;      /* write in the background                */
+
+  } PrintOptions;
+
+
+  /* a snapshot of the display, written by `Print_Job_Run' */
+  typedef struct  PrintJob_
+  {
+    grBitmap  bitmap;     /* with its own copy of the buffer */
+    double    gamma;
+    char*     filename;
+    char*     ver_str;
+
+  } PrintJob;
+
+
+  static PrintOptions   print_options;
+  static workpool_task  print_task;    /* the job being written */
+
+
+  static int  Print_PNG( PrintJob*  job );
+
+
+  static void
+  Print_Options_Init( void )
+  {
+    const char*  s;
+
+
+    print_options.initialized = 1;
+    print_options.level       = -1;
+    print_options.filter      = -1;
+    print_options.thread      = 1;
+
+    s = getenv( "FTDEMO_PRINT_FORMAT" );
+    if ( s && !strcmp( s, "pnm" ) )
+      print_options.pnm = 1;
+
+    s = getenv( "FTDEMO_PRINT_LEVEL" );
+    if ( s && *s )
+    {
+      print_options.level = atoi( s );
+      if ( print_options.level < 0 )
+        print_options.level = 0;
+      if ( print_options.level > 9 )
+        print_options.level = 9;
+    }
+
+    s = getenv( "FTDEMO_PRINT_FILTER" );
+    if ( s && *s )
+    {
+      static const char* const  names[] =
+      {
+        "none", "sub", "up", "avg", "paeth", "all"
+      };
+
+      int  i;
+
+
+      for ( i = 0; i < 6; i++ )
+        if ( !strcmp( s, names[i] ) )
+          print_options.filter = i;
+
+      if ( print_options.filter < 0 )
+        fprintf( stderr, "Unknown PNG filter `%s'\n", s );
+    }
+
+    s = getenv( "FTDEMO_PRINT_THREAD" );
+    if ( s && !strcmp( s, "0" ) )
+      print_options.thread = 0;
+  }
+
+
+  /* number of channels written for a pixel mode, 0 if unsupported */
+  static int
+  Print_Channels( grPixelMode  mode )
+  {
+    switch ( mode )
+    {
+    case gr_pixel_mode_gray:
+      return 1;
+    case gr_pixel_mode_rgb555:
+    case gr_pixel_mode_rgb565:
+    case gr_pixel_mode_rgb24:
+    case gr_pixel_mode_rgb32:
+      return 3;
+    case gr_pixel_mode_bgra:
+      return 4;
+    default:
+      return 0;
+    }
+  }
+
+
+  /* return the topmost row and let `*pitch' step down */
+  static unsigned char*
+  Print_First_Row( grBitmap*  bit,
+                   int*       pitch )
+  {
+    unsigned char*  row = bit->buffer;
+
+
+    if ( bit->pitch < 0 )
+      row -= ( bit->rows - 1 ) * bit->pitch;
+
+    *pitch = bit->pitch;
+
+    return row;
+  }
+
+
+  /* convert a row to 8-bit gray, RGB, or straight RGBA; */
+  /* gray and RGB24 rows are used as is                  */
+  static unsigned char*
+  Print_Convert_Row( grBitmap*       bit,
+                     unsigned char*  src,
+                     unsigned char*  dst )
+  {
+    unsigned char*  d = dst;
+    int             x;
+
+
+    switch ( bit->mode )
+    {
+    case gr_pixel_mode_rgb555:
+      for ( x = 0; x < bit->width; x++, d += 3 )
+      {
+        unsigned int  v = ( (unsigned short*)src )[x];
+        unsigned int  r = ( v >> 10 ) & 31;
+        unsigned int  g = ( v >>  5 ) & 31;
+        unsigned int  b =   v         & 31;
+
+
+        d[0] = (unsigned char)( ( r << 3 ) | ( r >> 2 ) );
+        d[1] = (unsigned char)( ( g << 3 ) | ( g >> 2 ) );
+        d[2] = (unsigned char)( ( b << 3 ) | ( b >> 2 ) );
+      }
+      return dst;
+
+    case gr_pixel_mode_rgb565:
+      for ( x = 0; x < bit->width; x++, d += 3 )
+      {
+        unsigned int  v = ( (unsigned short*)src )[x];
+        unsigned int  r = ( v >> 11 ) & 31;
+        unsigned int  g = ( v >>  5 ) & 63;
+        unsigned int  b =   v         & 31;
+
+
+        d[0] = (unsigned char)( ( r << 3 ) | ( r >> 2 ) );
+        d[1] = (unsigned char)( ( g << 2 ) | ( g >> 4 ) );
+        d[2] = (unsigned char)( ( b << 3 ) | ( b >> 2 ) );
+      }
+      return dst;
+
+    case gr_pixel_mode_rgb32:
+      for ( x = 0; x < bit->width; x++, d += 3 )
+      {
+        unsigned int  v = ( (unsigned int*)src )[x];
+
+
+        d[0] = (unsigned char)( v >> 16 );
+        d[1] = (unsigned char)( v >>  8 );
+        d[2] = (unsigned char)  v;
+      }
+      return dst;
+
+    case gr_pixel_mode_bgra:
+      /* undo premultiplication */
+      for ( x = 0; x < bit->width; x++, src += 4, d += 4 )
+      {
+        unsigned int  a = src[3];
+
+
+        if ( a == 0 || a == 255 )
+        {
+          d[0] = a ? src[2] : 0;
+          d[1] = a ? src[1] : 0;
+          d[2] = a ? src[0] : 0;
+        }
+        else
+        {
+          unsigned int  r = ( src[2] * 255U + a / 2 ) / a;
+          unsigned int  g = ( src[1] * 255U + a / 2 ) / a;
+          unsigned int  b = ( src[0] * 255U + a / 2 ) / a;
+
+
+          d[0] = (unsigned char)( r > 255 ? 255 : r );
+          d[1] = (unsigned char)( g > 255 ? 255 : g );
+          d[2] = (unsigned char)( b > 255 ? 255 : b );
+        }
+        d[3] = (unsigned char)a;
+      }
+      return dst;
+
+    default:
+      return src;
+    }
+  }
+
+
+  /* write binary PGM, PPM, or PAM (with alpha); these are quick */
+  /* to write and read but much larger than PNG files            */
+  static int
+  Print_PNM( PrintJob*  job )
+  {
+    grBitmap*       bit      = &job->bitmap;
+    int             channels = Print_Channels( bit->mode );
+    int             height   = bit->rows;
+    int             pitch;
+    unsigned char*  row      = Print_First_Row( bit, &pitch );
+    unsigned char*  conv;
+    FILE*           fp;
+    int             code     = 1;
+
+
+    conv = (unsigned char*)malloc( (size_t)bit->width * 4 );
+    if ( !conv )
+      return 1;
+
+    fp = fopen( job->filename, "wb" );
+    if ( fp == NULL )
+    {
+      fprintf( stderr, "Could not open file %s for writing\n",
+               job->filename );
+      goto Exit;
+    }
+
+    if ( channels == 4 )
+      fprintf( fp, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\n"
+                   "TUPLTYPE RGB_ALPHA\nENDHDR\n",
+               bit->width, bit->rows );
+    else
+      fprintf( fp, "P%c\n%d %d\n255\n",
+               channels == 1 ? '5' : '6', bit->width, bit->rows );
+
+    while ( height-- )
+    {
+      fwrite( Print_Convert_Row( bit, row, conv ),
+              (size_t)channels, (size_t)bit->width, fp );
+      row += pitch;
+    }
+
+    if ( ferror( fp ) )
+      fprintf( stderr, "Could not write file %s\n", job->filename );
+    else
+      code = 0;
+
+    fclose( fp );
+
+  Exit:
+    free( conv );
+
+    return code;
+  }
+
+
+  static void
+  Print_Job_Free( PrintJob*  job )
+  {
+    free( job->bitmap.buffer );
+    free( job->filename );
+    free( job->ver_str );
+    free( job );
+  }
+
+
+  /* copy the display; for PNM output, replace a `.png' */
+  /* extension of `filename' with the fitting one       */
+  static PrintJob*
+  Print_Job_New( FTDemo_Display*  display,
+                 const char*      filename,
+                 FT_String*       ver_str )
+  {
+    grBitmap*  bit  = display->bitmap;
+    size_t     size = (size_t)bit->rows *
+                      (size_t)( bit->pitch < 0 ? -bit->pitch : bit->pitch );
+    size_t     len  = strlen( filename );
+    PrintJob*  job;
+
+
+    job = (PrintJob*)calloc( 1, sizeof ( *job ) );
+    if ( !job )
+      return NULL;
+
+    job->bitmap        = *bit;
+    job->bitmap.buffer = (unsigned char*)malloc( size ? size : 1 );
+    job->gamma         = display->gamma;
+    job->filename      = (char*)malloc( len + 5 );
+    if ( ver_str )
+      job->ver_str = (char*)malloc( strlen( ver_str ) + 1 );
+
+    if ( !job->bitmap.buffer || !job->filename ||
+         ( ver_str && !job->ver_str )          )
+    {
+      Print_Job_Free( job );
+      return NULL;
+    }
+
+    memcpy( job->bitmap.buffer, bit->buffer, size );
+    if ( ver_str )
+      strcpy( job->ver_str, ver_str );
+
+    strcpy( job->filename, filename );
+    if ( print_options.pnm )
+    {
+      const char*  ext;
+
+
+      switch ( Print_Channels( bit->mode ) )
+      {
+      case 1:
+        ext = ".pgm";
+        break;
+      case 4:
+        ext = ".pam";
+        break;
+      default:
+        ext = ".ppm";
+      }
+
+      if ( len > 4 && !strcmp( filename + len - 4, ".png" ) )
+        len -= 4;
+      strcpy( job->filename + len, ext );
+    }
+
+    return job;
+  }
+
+
+  static int
+  Print_Job_Write( PrintJob*  job )
+  {
+    return print_options.pnm ? Print_PNM( job ) : Print_PNG( job );
+  }
+
+
+  static void
+  Print_Job_Run( void*         data,
+                 unsigned int  index,
+                 unsigned int  worker )
+  {
+    PrintJob*  job = (PrintJob*)data;
+
+    FT_UNUSED( index );
+    FT_UNUSED( worker );
+
+
+    Print_Job_Write( job );
+    Print_Job_Free( job );
+  }
+
 
   int
   FTDemo_Display_Print( FTDemo_Display*  display,
                         const char*      filename,
                         FT_String*       ver_str )
   {
-    grBitmap*  bit    = display->bitmap;
-    int        width  = bit->width;
-    int        height = bit->rows;
+    PrintJob*  job;
+    int        code;
+
+
+    if ( !print_options.initialized )
+      Print_Options_Init();
+
+    if ( !Print_Channels( display->bitmap->mode ) )
+    {
+      fprintf( stderr, "Unsupported color type\n" );
+      return 1;
+    }
+
+    job = Print_Job_New( display, filename, ver_str );
+    if ( !job )
+    {
+      fprintf( stderr, "Could not allocate print job\n" );
+      return 1;
+    }
+
+    /* only one image is in flight; the previous one is usually */
+    /* done while the next frame was rendered                   */
+    FTDemo_Display_Print_Wait();
+
+    if ( print_options.thread )
+    {
+      print_task = workpool_start( Print_Job_Run, job );
+      return 0;
+    }
+
+    code = Print_Job_Write( job );
+    Print_Job_Free( job );
+
+    return code;
+  }
+
+
+  void
+  FTDemo_Display_Print_Wait( void )
+  {
+    workpool_wait( print_task );
+    print_task = NULL;
+  }
+
+
+#ifdef FT_CONFIG_OPTION_USE_PNG
+
+#include <png.h>
+
+  static int
+  Print_PNG( PrintJob*  job )
+  {
+    grBitmap*  bit      = &job->bitmap;
+    int        width    = bit->width;
+    int        height   = bit->rows;
     int        color_type;
-    FILE*      fp     = NULL;
+    int        pitch;
+    FILE*      fp       = NULL;
 
     png_structp  png_ptr  = NULL;
     png_infop    info_ptr = NULL;
-    png_bytep    row      = NULL;
+    png_bytep    row;
+    png_bytep    conv     = NULL;
 
     volatile int  code = 1;
 
 
-    /* Set color_type */
-    switch ( bit-> mode )
-    {
-    case gr_pixel_mode_gray:
-      color_type = PNG_COLOR_TYPE_GRAY;
-      break;
-    case gr_pixel_mode_rgb24:
-    case gr_pixel_mode_rgb32:
-      color_type = PNG_COLOR_TYPE_RGB;
-      break;
-    default:
-      fprintf( stderr, "Unsupported color type\n" );
+    conv = (png_bytep)malloc( (size_t)width * 4 );
+    if ( conv == NULL )
       goto Exit0;
-    }
 
     /* Open file for writing (binary mode) */
-    fp = fopen( filename, "wb" );
+    fp = fopen( job->filename, "wb" );
     if ( fp == NULL )
     {
-      fprintf( stderr, "Could not open file %s for writing\n", filename );
+      fprintf( stderr, "Could not open file %s for writing\n",
+               job->filename );
       goto Exit0;
     }
 
@@ -83,6 +487,37 @@
 
     png_init_io( png_ptr, fp );
 
+    /* Level 0 stores the data uncompressed; filtering is useless then */
+    if ( print_options.level >= 0 )
+      png_set_compression_level( png_ptr, print_options.level );
+
+    if ( print_options.filter >= 0 || print_options.level == 0 )
+    {
+      static const int  filters[] =
+      {
+        PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP,
+        PNG_FILTER_AVG, PNG_FILTER_PAETH, PNG_ALL_FILTERS
+      };
+
+
+      png_set_filter( png_ptr, PNG_FILTER_TYPE_BASE,
+                      filters[print_options.filter >= 0 ? print_options.filter
+                                                        : 0] );
+    }
+
+    /* Set color_type */
+    switch ( Print_Channels( bit->mode ) )
+    {
+    case 1:
+      color_type = PNG_COLOR_TYPE_GRAY;
+      break;
+    case 3:
+      color_type = PNG_COLOR_TYPE_RGB;
+      break;
+    default:
+      color_type = PNG_COLOR_TYPE_RGB_ALPHA;
+    }
+
     /* Write header (8 bit colour depth) */
     png_set_IHDR( png_ptr, info_ptr,
                   (png_uint_32)width, (png_uint_32)height,
@@ -90,45 +525,32 @@
                   PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE );
 
     /* Record version string  */
-    if ( ver_str != NULL )
+    if ( job->ver_str != NULL )
     {
       png_text  text;
 
 
       text.compression = PNG_TEXT_COMPRESSION_NONE;
       text.key         = (char *)"Software";
-      text.text        = ver_str;
+      text.text        = job->ver_str;
 
       png_set_text( png_ptr, info_ptr, &text, 1 );
     }
 
-    /* Set gamma */
-    png_set_gAMA( png_ptr, info_ptr, 1.0 / display->gamma );
+    /* Set gamma; zero stands for sRGB */
+    if ( job->gamma > 0.0 )
+      png_set_gAMA( png_ptr, info_ptr, 1.0 / job->gamma );
+    else
+      png_set_sRGB( png_ptr, info_ptr, PNG_sRGB_INTENT_PERCEPTUAL );
 
     png_write_info( png_ptr, info_ptr );
 
-    if ( bit->mode == gr_pixel_mode_rgb32 )
-    {
-      const int  x = 1;
-
-
-      if ( *(char*)&x )  /* little endian */
-      {
-        png_set_filler( png_ptr, 0, PNG_FILLER_AFTER );
-        png_set_bgr( png_ptr );
-      }
-      else
-        png_set_filler( png_ptr, 0, PNG_FILLER_BEFORE );
-    }
-
     /* Write image rows */
-    row = bit->buffer;
-    if ( bit->pitch < 0 )
-      row -= ( bit->rows - 1 ) * bit->pitch;
+    row = Print_First_Row( bit, &pitch );
     while ( height-- )
     {
-      png_write_row( png_ptr, row );
-      row += bit->pitch;
+      png_write_row( png_ptr, Print_Convert_Row( bit, row, conv ) );
+      row += pitch;
     }
 
     /* End write */
@@ -140,6 +562,7 @@
   Exit1:
     fclose( fp );
   Exit0:
+    free( conv );
     return code;
   }
 
@@ -285,12 +708,12 @@
   GpStatus WINGDIPAPI GdipFree(void* ptr);
 
 
-  int
-  FTDemo_Display_Print( FTDemo_Display*  display,
-                        const char*      filename,
-                        FT_String*       ver_str )
+  static int
+  Print_PNG( PrintJob*  job )
   {
-    grBitmap*  bit = display->bitmap;
+    grBitmap*    bit      = &job->bitmap;
+    const char*  filename = job->filename;
+    FT_String*   ver_str  = job->ver_str ? job->ver_str : (FT_String*)"";
 
     WCHAR         wfilename[20];
     PixelFormat   format;
@@ -303,7 +726,7 @@
     GDIPCONST CLSID      GpPngEncoder = { 0x557cf406, 0x1a04, 0x11d3,
                            { 0x9a,0x73,0x00,0x00,0xf8,0x1e,0xf3,0x2e } };
 
-    ULONG         gg[2] =    { display->gamma * 0x10000, 0x10000 };
+    ULONG         gg[2] =    { job->gamma * 0x10000, 0x10000 };
     PropertyItem  gamma =    { PropertyTagGamma, 2 * sizeof ( ULONG ),
                                PropertyTagTypeRational, gg };
     PropertyItem  software = { PropertyTagSoftwareUsed, strlen( ver_str ) + 1,
@@ -338,6 +761,9 @@
     case gr_pixel_mode_rgb32:
       format = PixelFormat32bppRGB;
       break;
+    case gr_pixel_mode_bgra:
+      format = PixelFormat32bppPARGB;
+      break;
     default:
       fprintf( stderr, "Unsupported color type.\n" );
       ret = UnknownImageFormat;
@@ -375,11 +801,11 @@
 
 #else
 
-  int
-  FTDemo_Display_Print( FTDemo_Display*  display,
-                        const char*      filename,
-                        FT_String*       ver_str )
+  static int
+  Print_PNG( PrintJob*  job )
   {
+    FT_UNUSED( job );
+
     return 0;
   }
 
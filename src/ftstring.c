@@ -20,6 +20,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <math.h>
+#include <time.h>
 
 #include <freetype/ftlcdfil.h>
 #include <freetype/fttrigon.h>
@@ -90,6 +91,7 @@
     const char*    keys;
     const char*    dims;
     const char*    device;
+    double         bench_time;
 
     int            render_mode;
     unsigned long  encoding;
@@ -106,7 +108,7 @@
     const char*  header;
     char         header_buffer[256];
 
-  } status = { "", DIM, NULL, RENDER_MODE_STRING, FT_ENCODING_UNICODE,
+  } status = { "", DIM, NULL, 0.0, RENDER_MODE_STRING, FT_ENCODING_UNICODE,
                72, 48, 0, NULL,
                { 0, 0, 0x8000, 0, NULL, 0, 0 },
                { 0, 0, 0, 0 }, 0, NULL, { 0 } };
@@ -270,6 +272,8 @@
     grWriteln( "  h         : toggle outline hinting" );
     grWriteln( "  H         : change hinting engine" );
     grWriteln( "  V         : toggle vertical rendering" );
+    grWriteln( "  s         : cycle through subpixel positioning" );
+    grWriteln( "  T         : toggle frame timing" );
     grLn();
     grWriteln( "  1-4       : select rendering mode" );
     grWriteln( "  l         : cycle through anti-aliasing modes" );
@@ -309,6 +313,28 @@
   }
 
 
+  static void
+  event_phases_change( void )
+  {
+    /* exact positions, then 1, 2, 4, 8, and 16 phases per pixel */
+    if ( handle->subpixel_phases == 0 )
+      handle->subpixel_phases = 1;
+    else if ( handle->subpixel_phases < 16 )
+      handle->subpixel_phases *= 2;
+    else
+      handle->subpixel_phases = 0;
+
+    if ( handle->subpixel_phases )
+      snprintf( status.header_buffer, sizeof ( status.header_buffer ),
+                "glyph positions rounded to 1/%d pixel",
+                handle->subpixel_phases );
+    else
+      snprintf( status.header_buffer, sizeof ( status.header_buffer ),
+                "exact glyph positions" );
+    status.header = status.header_buffer;
+  }
+
+
   static void
   event_font_change( int  delta )
   {
@@ -608,6 +634,14 @@
                       : "using horizontal layout";
       goto Exit;
 
+    case grKEY( 's' ):
+      event_phases_change();
+      goto Exit;
+
+    case grKEY( 'T' ):
+      handle->frame_time.enabled = !handle->frame_time.enabled;
+      goto Exit;
+
     case grKEY( 'g' ):
       FTDemo_Display_Gamma_Change( display,  1 );
       goto Exit;
@@ -723,6 +757,10 @@
       "            `ADOB' (Adobe standard), `ADBC' (Adobe custom),\n"
       "            or a numeric charmap index.\n"
       "  -m text   Use `text' for rendering.\n"
+      "  -s n      Round glyph positions to 1/n pixel (1 to 64) to\n"
+      "            reuse rendered glyphs (default: exact positions).\n"
+      "  -b secs   Benchmark text rendering for `secs' seconds per\n"
+      "            blitting method, then exit.\n"
       "\n"
       "  -v        Show version.\n"
       "\n" );
@@ -741,13 +779,20 @@
 
     while ( 1 )
     {
-      option = getopt( *argc, *argv, "d:e:k:m:r:v" );
+      option = getopt( *argc, *argv, "b:d:e:k:m:r:s:v" );
 
       if ( option == -1 )
         break;
 
       switch ( option )
       {
+      case 'b':
+        status.bench_time = atof( optarg );
+        if ( status.bench_time <= 0.0 )
+          usage( execname );
+        status.device = "batch";
+        break;
+
       case 'd':
         status.dims = optarg;
         break;
@@ -776,6 +821,12 @@
           usage( execname );
         break;
 
+      case 's':
+        handle->subpixel_phases = atoi( optarg );
+        if ( handle->subpixel_phases < 1 || handle->subpixel_phases > 64 )
+          usage( execname );
+        break;
+
       case 'v':
         {
           FT_String  str[64] = "ftstring (FreeType) ";
@@ -863,12 +914,12 @@
   }
 
 
-  static void
+  static int
   Render_Text( void )
   {
     int      x = FT_MulFix( display->bitmap->width, status.sc.center);
     int      y, step_y;
-    int      offset = 0;
+    int      offset = 0, count = 0, drawn;
     FT_Size  size;
 
     FTDemo_String_Context sc = status.sc;
@@ -879,7 +930,7 @@
 
     error = FTDemo_Get_Size( handle, &size );
     if ( error )
-      return;
+      return 0;
 
     step_y = ( size->metrics.height >> 6 ) + 1;
     y      = 40 + ( size->metrics.ascender >> 6 );
@@ -889,12 +940,80 @@
     {
       sc.offset = offset;
 
-      offset += FTDemo_String_Draw( handle, display, &sc, x, y );
+      drawn   = FTDemo_String_Draw( handle, display, &sc, x, y );
+      count  += drawn;
+      offset += drawn;
 
-      offset %= handle->string_length;
+      offset %= handle->string.length;
     }
 
-    return;
+    return count;
+  }
+
+
+  /* time full text pages drawn with individual and batched blits, */
+  /* then with batched blits of cached bitmaps                      */
+  static void
+  Benchmark( void )
+  {
+    static const char*  titles[4] = { "copied glyphs",
+                                      "per-glyph blits",
+                                      "batched blits",
+                                      "cached bitmaps" };
+
+    int  i;
+
+
+    printf( "ftstring benchmark: text page %dx%d, %g pt, ",
+            display->bitmap->width, display->bitmap->rows,
+            status.ptsize / 64.0 );
+    if ( status.angle )
+      printf( "rotated by %d degrees, ", status.angle );
+    if ( handle->subpixel_phases )
+      printf( "positions rounded to 1/%d pixel\n", handle->subpixel_phases );
+    else
+      printf( "exact positions\n" );
+
+    for ( i = 0; i < 4; i++ )
+    {
+      clock_t  start, elapsed;
+      long     frames = 0;
+      long     glyphs = 0;
+      double   secs;
+
+
+      handle->use_plain_render = i > 0;
+      handle->use_batch_blit   = i > 1;
+      handle->use_bitmap_cache = i > 2;
+
+      handle->bitmap_cache_hits   = 0;
+      handle->bitmap_cache_misses = 0;
+
+      start = clock();
+      do
+      {
+        FTDemo_Display_Clear( display );
+        glyphs += Render_Text();
+        frames++;
+
+        elapsed = clock() - start;
+      } while ( (double)elapsed < status.bench_time * CLOCKS_PER_SEC );
+
+      secs = (double)elapsed / CLOCKS_PER_SEC;
+
+      printf( "  %-16s %8.3f ms/frame %8.1f ns/glyph (%ld frames)\n",
+              titles[i],
+              1e3 * secs / (double)frames,
+              glyphs ? 1e9 * secs / (double)glyphs : 0.0,
+              frames );
+    }
+
+    printf( "  bitmap cache: %lu hits, %lu misses\n",
+            handle->bitmap_cache_hits, handle->bitmap_cache_misses );
+
+    handle->use_plain_render = 1;
+    handle->use_batch_blit   = 1;
+    handle->use_bitmap_cache = 1;
   }
 
 
@@ -1021,18 +1140,31 @@
 
     handle->encoding  = status.encoding;
 
-    for ( ; argc > 0; argc--, argv++ )
+    if ( argc > 0 )
     {
-      error = FTDemo_Install_Font( handle, argv[0], 0, 0 );
+      FT_Error*  errors = (FT_Error*)calloc( (size_t)argc,
+                                             sizeof ( FT_Error ) );
+      int        i;
 
-      if ( error )
+
+      if ( !errors )
+        PanicZ( "not enough memory" );
+
+      FTDemo_Install_Fonts( handle, argc, argv, 0, 0, errors );
+
+      for ( i = 0; i < argc; i++ )
       {
-        fprintf( stderr, "failed to install %s", argv[0] );
-        if ( error == FT_Err_Invalid_CharMap_Handle )
-          fprintf( stderr, ": missing valid charmap\n" );
-        else
-          fprintf( stderr, "\n" );
+        if ( errors[i] )
+        {
+          fprintf( stderr, "failed to install %s", argv[i] );
+          if ( errors[i] == FT_Err_Invalid_CharMap_Handle )
+            fprintf( stderr, ": missing valid charmap\n" );
+          else
+            fprintf( stderr, "\n" );
+        }
       }
+
+      free( errors );
     }
 
     if ( handle->num_fonts == 0 )
@@ -1052,9 +1184,19 @@
     FTDemo_Update_Current_Flags( handle );
     FTDemo_String_Load( handle, &status.sc );
 
+    if ( status.bench_time > 0.0 )
+    {
+      Benchmark();
+
+      FTDemo_Display_Done( display );
+      FTDemo_Done( handle );
+      exit( 0 );
+    }
+
     do
     {
       FTDemo_Display_Clear( display );
+      FTDemo_Frame_Time_Begin( handle );
 
       switch ( status.render_mode )
       {
@@ -1080,6 +1222,7 @@
       }
 
       write_header( error );
+      FTDemo_Frame_Time_Draw( handle, display );
 
     } while ( !Process_Event() );
 
@@ -31,11 +31,19 @@
 
 #include "common.h"
 #include "mlgetopt.h"
+#include "workpool.h"
 
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>  /* for `_POSIX_TIMERS' */
+#endif
 
 
   static const char*  execname;
@@ -100,6 +108,8 @@
                                     const char* tables,
                                     int         validation_level );
     int         (* list_tables)   ( FT_Face     face );
+    FT_Error    (* run_quietly)   ( FT_Face     face,
+                                    FT_UInt     validation_flags );
 
     TableSpec      table_spec;
     unsigned int   n_table_spec;
@@ -124,6 +134,13 @@
   static int list_gx_tables                 ( FT_Face  face );
   static int list_ckern_tables              ( FT_Face  face );
 
+  static FT_Error run_ot_quietly            ( FT_Face  face,
+                                              FT_UInt  validation_flags );
+  static FT_Error run_gx_quietly            ( FT_Face  face,
+                                              FT_UInt  validation_flags );
+  static FT_Error run_ckern_quietly         ( FT_Face  face,
+                                              FT_UInt  validation_flags );
+
 
   static ValidatorRec validators[] =
   {
@@ -137,6 +154,7 @@
       is_ot_validator_implemented,
       run_ot_validator,
       list_ot_tables,
+      run_ot_quietly,
       ot_table_spec,
       N_OT_TABLE_SPEC,
     },
@@ -150,6 +168,7 @@
       is_gx_validator_implemented,
       run_gx_validator,
       list_gx_tables,
+      run_gx_quietly,
       gx_table_spec,
       N_GX_TABLE_SPEC,
     },
@@ -163,6 +182,7 @@
       is_ckern_validator_implemented,
       run_ckern_validator,
       list_ckern_tables,
+      run_ckern_quietly,
       NULL,
       0,
     },
@@ -225,7 +245,7 @@
       "---------------------------------------------------------------\n"
       "\n" );
     fprintf( stderr,
-      "Usage: %s [options] fontfile\n"
+      "Usage: %s [options] fontfile ...\n"
       "\n",
              execname );
 
@@ -237,6 +257,12 @@
       "  -f index      Select font index (default: 0).\n"
       "\n" );
 
+    fprintf( stderr,
+      "  -j N          Validate on N threads (0 for one per CPU) and\n"
+      "                print a summary table of all tables and files;\n"
+      "                this is the default for several font files.\n"
+      "\n" );
+
     fprintf( stderr,
       "  -t validator  Select validator.\n"
       "                Available validators:\n"
@@ -597,6 +623,30 @@
   }
 
 
+  static FT_Error
+  run_ot_quietly( FT_Face  face,
+                  FT_UInt  validation_flags )
+  {
+    FT_Error      error;
+    FT_Bytes      data[N_OT_TABLE_SPEC];
+    unsigned int  i;
+
+
+    for ( i = 0; i < N_OT_TABLE_SPEC; i++ )
+      data[i] = NULL;
+
+    error = FT_OpenType_Validate(
+              face,
+              validation_flags,
+              &data[0], &data[1], &data[2], &data[3], &data[4] );
+
+    for ( i = 0; i < N_OT_TABLE_SPEC; i++ )
+      FT_OpenType_Free( face, data[i] );
+
+    return error;
+  }
+
+
   /*
    * TrueTypeGX related functions
    */
@@ -656,6 +706,31 @@
   }
 
 
+  static FT_Error
+  run_gx_quietly( FT_Face  face,
+                  FT_UInt  validation_flags )
+  {
+    FT_Error      error;
+    FT_Bytes      data[N_GX_TABLE_SPEC];
+    unsigned int  i;
+
+
+    for ( i = 0; i < N_GX_TABLE_SPEC; i++ )
+      data[i] = NULL;
+
+    error = FT_TrueTypeGX_Validate(
+              face,
+              validation_flags,
+              data,
+              N_GX_TABLE_SPEC );
+
+    for ( i = 0; i < N_GX_TABLE_SPEC; i++ )
+      FT_TrueTypeGX_Free( face, data[i] );
+
+    return error;
+  }
+
+
   /*
    * Classic kern related functions
    */
@@ -669,6 +744,27 @@
   }
 
 
+  static FT_UInt
+  parse_ckern_dialect( const char*  dialect_request )
+  {
+    if ( dialect_request == NULL )
+      dialect_request = "ms:apple";
+
+    if ( strcmp( dialect_request, "ms:apple" ) == 0 ||
+         strcmp( dialect_request, "apple:ms" ) == 0 )
+      return FT_VALIDATE_MS | FT_VALIDATE_APPLE;
+    else if ( strcmp( dialect_request, "ms" ) == 0 )
+      return FT_VALIDATE_MS;
+    else if ( strcmp( dialect_request, "apple" ) == 0 )
+      return FT_VALIDATE_APPLE;
+
+    fprintf( stderr, "Wrong classic kern dialect: %s\n", dialect_request );
+    print_usage( NULL );
+
+    return 0;
+  }
+
+
   static FT_Error
   run_ckern_validator( FT_Face      face,
                        const char*  dialect_request,
@@ -684,19 +780,7 @@
 
 
     validation_flags  = (FT_UInt)validation_level;
-
-    if ( strcmp( dialect_request, "ms:apple" ) == 0 ||
-         strcmp( dialect_request, "apple:ms" ) == 0 )
-      validation_flags |= FT_VALIDATE_MS | FT_VALIDATE_APPLE;
-    else if ( strcmp( dialect_request, "ms" ) == 0 )
-      validation_flags |= FT_VALIDATE_MS;
-    else if ( strcmp( dialect_request, "apple" ) == 0 )
-      validation_flags |= FT_VALIDATE_APPLE;
-    else
-    {
-      fprintf( stderr, "Wrong classic kern dialect: %s\n", dialect_request );
-      print_usage( NULL );
-    }
+    validation_flags |= parse_ckern_dialect( dialect_request );
 
     printf( "[%s:%s] validation targets: %s...",
             execname, validators[validator].symbol, dialect_request );
@@ -731,6 +815,416 @@
     return 0;
   }
 
+
+  static FT_Error
+  run_ckern_quietly( FT_Face  face,
+                     FT_UInt  validation_flags )
+  {
+    FT_Error  error;
+    FT_Bytes  data = NULL;
+
+
+    error = FT_ClassicKern_Validate( face, validation_flags, &data );
+
+    FT_ClassicKern_Free( face, data );
+
+    return error;
+  }
+
+
+  /*
+   * Batch mode
+   *
+   * Every table of every file is a separate job; the jobs are spread
+   * over worker threads, each with its own library and the face it
+   * opened last.
+   */
+
+  typedef enum
+  {
+    RESULT_ABSENT = 0,
+    RESULT_PASS,
+    RESULT_FAIL,
+    RESULT_NO_FACE
+
+  } ResultStatus;
+
+
+  typedef struct  ResultRec_
+  {
+    ResultStatus  status;
+    FT_Error      error;
+    double        time;      /* in ms */
+
+  } ResultRec, *Result;
+
+
+  typedef struct  WorkerRec_
+  {
+    FT_Library  library;
+    FT_Face     face;
+    int         file;        /* of `face', or -1 */
+    FT_Error    error;       /* from opening `face' */
+
+  } WorkerRec, *Worker;
+
+
+  typedef struct  BatchRec_
+  {
+    char**         fnames;
+    int            num_files;
+    int            font_index;
+
+    TableSpecRec*  columns;   /* the validated tables */
+    int            num_columns;
+    FT_UInt        validation_flags;
+
+    ResultRec*     results;   /* `num_files' rows of `num_columns' */
+    WorkerRec*     workers;
+
+  } BatchRec, *Batch;
+
+
+  /* the CPU time of the calling thread in milliseconds */
+  static double
+  get_time( void )
+  {
+#if defined _WIN32
+    FILETIME        start, end, kern, user;
+    ULARGE_INTEGER  k, u;
+
+
+    GetThreadTimes( GetCurrentThread(), &start, &end, &kern, &user );
+
+    k.LowPart  = kern.dwLowDateTime;
+    k.HighPart = kern.dwHighDateTime;
+    u.LowPart  = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+
+    return 1E-4 * (double)( k.QuadPart + u.QuadPart );  /* 100ns units */
+
+#elif defined _POSIX_TIMERS && _POSIX_TIMERS > 0 && \
+      defined _POSIX_THREAD_CPUTIME
+    struct timespec  tv;
+
+
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &tv );
+
+    return 1E3 * (double)tv.tv_sec + 1E-6 * (double)tv.tv_nsec;
+
+#else
+    /* Without a per-thread clock, this is the CPU time of the whole */
+    /* process, which includes the work of the other workers.        */
+    return 1E3 * (double)clock() / (double)CLOCKS_PER_SEC;
+#endif
+  }
+
+
+  /* a job of `workpool_run': validate one table of one file */
+  static void
+  validate_job( void*         data,
+                unsigned int  index,
+                unsigned int  worker_index )
+  {
+    Batch      batch  = (Batch)data;
+    Worker     worker = &batch->workers[worker_index];
+    Result     result = &batch->results[index];
+    int        file   = (int)index / batch->num_columns;
+    TableSpec  column = &batch->columns[index % batch->num_columns];
+    FT_UInt    flags, lookups = 0;
+    double     start;
+
+
+    if ( !worker->library )
+    {
+      worker->error = FT_Init_FreeType( &worker->library );
+      if ( worker->error )
+      {
+        worker->library = NULL;
+        result->status  = RESULT_NO_FACE;
+        result->error   = worker->error;
+        return;
+      }
+    }
+
+    /* consecutive jobs of a worker often belong to the same file */
+    if ( worker->file != file )
+    {
+      if ( worker->face )
+        FT_Done_Face( worker->face );
+
+      worker->face  = NULL;
+      worker->file  = file;
+      worker->error = FT_New_Face( worker->library, batch->fnames[file],
+                                   batch->font_index, &worker->face );
+    }
+
+    if ( worker->error )
+    {
+      result->status = RESULT_NO_FACE;
+      result->error  = worker->error;
+      return;
+    }
+
+    if ( try_load( worker->face, column->tag ) )
+      return;
+
+    flags = batch->validation_flags | column->validation_flag;
+
+    /* `GDEF' and `JSTF' are checked against the lookups */
+    if ( validator == OT_VALIDATE     &&
+         ( column->tag == TTAG_GDEF ||
+           column->tag == TTAG_JSTF )  )
+    {
+      if ( !try_load( worker->face, TTAG_GSUB ) )
+        lookups |= FT_VALIDATE_GSUB;
+      if ( !try_load( worker->face, TTAG_GPOS ) )
+        lookups |= FT_VALIDATE_GPOS;
+    }
+
+    start         = get_time();
+    result->error = validators[validator].run_quietly( worker->face,
+                                                       flags | lookups );
+
+    /* if the lookups are invalid themselves, blame them only */
+    if ( result->error && lookups                                    &&
+         validators[validator].run_quietly(
+           worker->face, batch->validation_flags | lookups )         )
+      result->error = validators[validator].run_quietly( worker->face,
+                                                         flags );
+    result->time  = get_time() - start;
+
+    result->status = result->error ? RESULT_FAIL : RESULT_PASS;
+  }
+
+
+  /* Print a table with a row per file and a column per table, */
+  /* followed by the totals; return 1 if anything failed.      */
+  static int
+  report_batch( Batch  batch,
+                int    explicit_tables )
+  {
+    int     i, j;
+    int     width  = 4;
+    int     failed = 0;
+    int     last   = -1;      /* the last column shown */
+    int     count_width;      /* of `passes/tables' in the total row */
+    int     column;           /* the width of all columns but the last */
+    char    tag[5];
+    char    cell[48];
+    int*    shown;
+    Result  r;
+
+
+    shown = (int*)calloc( (size_t)batch->num_columns, sizeof ( int ) );
+    if ( !shown )
+      panic( FT_Err_Out_Of_Memory, "Could not allocate memory" );
+
+    /* skip tables that no font has unless they were requested */
+    for ( i = 0; i < batch->num_files; i++ )
+    {
+      int  len = (int)strlen( batch->fnames[i] );
+
+
+      if ( len > width )
+        width = len;
+
+      for ( j = 0; j < batch->num_columns; j++ )
+      {
+        r = &batch->results[i * batch->num_columns + j];
+        if ( explicit_tables || r->status == RESULT_PASS ||
+                                r->status == RESULT_FAIL )
+          shown[j] = 1;
+      }
+    }
+
+    for ( j = 0; j < batch->num_columns; j++ )
+      if ( shown[j] )
+        last = j;
+
+    tag[4] = '\0';
+
+    /* no padding if there are no columns */
+    if ( last < 0 )
+      width = 0;
+
+    /* `pass 1234.56ms' needs 14 characters; the total row needs more */
+    /* if the count of passes is wider than 4 characters              */
+    snprintf( cell, sizeof ( cell ), "%d/%d",
+              batch->num_files, batch->num_files );
+    count_width = (int)strlen( cell );
+    if ( count_width < 4 )
+      count_width = 4;
+    column = count_width + 10;
+
+    printf( "%-*s", width, "font" );
+    for ( j = 0; j < batch->num_columns; j++ )
+      if ( shown[j] )
+        printf( "  %-*s", j == last ? 0 : column,
+                make_tag_chararray( tag, batch->columns[j].tag ) );
+    printf( "\n" );
+
+    for ( i = 0; i < batch->num_files; i++ )
+    {
+      r = &batch->results[i * batch->num_columns];
+
+      printf( "%-*s", width, batch->fnames[i] );
+
+      for ( j = 0; j < batch->num_columns; j++, r++ )
+      {
+        if ( r->status == RESULT_NO_FACE )
+        {
+          printf( "  could not open face (error 0x%04x)", r->error );
+          failed = 1;
+          break;
+        }
+
+        if ( !shown[j] )
+          continue;
+
+        if ( r->status == RESULT_ABSENT )
+          printf( "  %-*s", j == last ? 0 : column, "-" );
+        else
+        {
+          snprintf( cell, sizeof ( cell ), "%s %7.2fms",
+                    r->status == RESULT_PASS ? "pass" : "FAIL",
+                    r->time );
+          printf( "  %-*s", j == last ? 0 : column, cell );
+        }
+
+        if ( r->status == RESULT_FAIL )
+          failed = 1;
+      }
+
+      printf( "\n" );
+    }
+
+    printf( "%-*s", width, "total" );
+    for ( j = 0; j < batch->num_columns; j++ )
+    {
+      int     passes  = 0;
+      int     targets = 0;
+      double  time    = 0.0;
+      char    count[24];
+
+
+      if ( !shown[j] )
+        continue;
+
+      for ( i = 0; i < batch->num_files; i++ )
+      {
+        r = &batch->results[i * batch->num_columns + j];
+
+        if ( r->status == RESULT_PASS )
+          passes++;
+        if ( r->status == RESULT_PASS || r->status == RESULT_FAIL )
+          targets++;
+
+        time += r->time;
+      }
+
+      snprintf( count, sizeof ( count ), "%d/%d", passes, targets );
+      printf( "  %-*s %7.2fms", count_width, count, time );
+    }
+    printf( "\n" );
+
+    free( shown );
+
+    return failed;
+  }
+
+
+  /* validate all files; return 1 if anything failed */
+  static int
+  run_batch( char**       fnames,
+             int          num_files,
+             int          font_index,
+             const char*  tables,
+             int          validation_level,
+             int          num_workers )
+  {
+    BatchRec             batch;
+    TableSpecRec         kern_spec = { TTAG_kern, 0 };
+    const TableSpecRec*  spec;
+    int                  n_spec, i, status;
+    FT_UInt              selected;
+
+
+    batch.fnames     = fnames;
+    batch.num_files  = num_files;
+    batch.font_index = font_index;
+
+    batch.validation_flags = (FT_UInt)validation_level;
+
+    if ( validator == CKERN_VALIDATE )
+    {
+      /* the dialects are part of the validation flags */
+      batch.validation_flags |= parse_ckern_dialect( tables );
+
+      spec     = &kern_spec;
+      n_spec   = 1;
+      selected = 0;
+    }
+    else
+    {
+      spec     = validators[validator].table_spec;
+      n_spec   = (int)validators[validator].n_table_spec;
+      selected = tables ? parse_table_specs( tables, spec, n_spec )
+                        : ~0U;
+    }
+
+    if ( num_workers <= 0 )
+      num_workers = (int)workpool_num_cpus();
+
+    batch.columns = (TableSpecRec*)malloc( (size_t)n_spec *
+                                           sizeof ( TableSpecRec ) );
+    batch.workers = (WorkerRec*)calloc( (size_t)num_workers,
+                                        sizeof ( WorkerRec ) );
+    if ( !batch.columns || !batch.workers )
+      panic( FT_Err_Out_Of_Memory, "Could not allocate memory" );
+
+    batch.num_columns = 0;
+    for ( i = 0; i < n_spec; i++ )
+      if ( !spec[i].validation_flag               ||
+           ( spec[i].validation_flag & selected ) )
+        batch.columns[batch.num_columns++] = spec[i];
+
+    batch.results = (ResultRec*)calloc( (size_t)num_files *
+                                          (size_t)batch.num_columns,
+                                        sizeof ( ResultRec ) );
+    if ( !batch.results )
+      panic( FT_Err_Out_Of_Memory, "Could not allocate memory" );
+
+    for ( i = 0; i < num_workers; i++ )
+      batch.workers[i].file = -1;
+
+    printf( "[%s:%s] %d files, validation level %d\n",
+            execname, validators[validator].symbol,
+            num_files, validation_level );
+
+    workpool_run( (unsigned int)num_workers,
+                  (unsigned int)( num_files * batch.num_columns ),
+                  validate_job,
+                  &batch );
+
+    for ( i = 0; i < num_workers; i++ )
+    {
+      if ( batch.workers[i].face )
+        FT_Done_Face( batch.workers[i].face );
+      if ( batch.workers[i].library )
+        FT_Done_FreeType( batch.workers[i].library );
+    }
+
+    status = report_batch( &batch, tables != NULL );
+
+    free( batch.results );
+    free( batch.workers );
+    free( batch.columns );
+
+    return status;
+  }
+
+
   /*
    * Main driver
    */
@@ -751,7 +1245,8 @@
 
     int  validation_level;
 
-    int  font_index = 0;
+    int  font_index  = 0;
+    int  num_workers = -1;
 
 
     execname = ft_basename( argv[0] );
@@ -774,7 +1269,7 @@
 
     while ( 1 )
     {
-      option = getopt( argc, argv, "f:lt:T:vV:" );
+      option = getopt( argc, argv, "f:j:lt:T:vV:" );
 
       if ( option == -1 )
         break;
@@ -825,6 +1320,10 @@
         font_index = atoi( optarg );
         break;
 
+      case 'j':
+        num_workers = atoi( optarg );
+        break;
+
       case 'v':
         {
           FT_Int  major, minor, patch;
@@ -854,10 +1353,49 @@
       fprintf(stderr, "*** Font file is not specified.\n");
       print_usage( NULL );
     }
-    else if ( argc > 1 )
+
+    if ( !validators[validator].is_implemented( library ) )
+      panic( FT_Err_Unimplemented_Feature,
+             validators[validator].unimplemented_message );
+
+    if ( dump_table_list && argc > 1 )
     {
-      fprintf(stderr, "*** Too many font files.\n");
-      print_usage( NULL );
+      int  i;
+
+
+      for ( i = 0; i < argc; i++ )
+      {
+        FT_Face  face;
+
+
+        printf( "%s: ", argv[i] );
+        fflush( stdout );
+
+        error = FT_New_Face( library, argv[i], font_index, &face );
+        if ( error )
+        {
+          printf( "could not open face (error 0x%04x)\n", error );
+          continue;
+        }
+
+        validators[validator].list_tables( face );
+        FT_Done_Face( face );
+      }
+
+      FT_Done_FreeType( library );
+      return 0;
+    }
+
+    if ( !dump_table_list && ( argc > 1 || num_workers >= 0 ) )
+    {
+      int  status;
+
+
+      status = run_batch( argv, argc, font_index, tables,
+                          validation_level, num_workers );
+
+      FT_Done_FreeType( library );
+      return status;
     }
 
     fontfile = argv[0];
@@ -871,11 +1409,6 @@
 
       status = 0;
 
-      if ( !validators[validator].is_implemented( library ) )
-        panic( FT_Err_Unimplemented_Feature,
-               validators[validator].unimplemented_message );
-
-
       /* TODO: Multiple faces in a font file? */
       error = FT_New_Face( library, fontfile, font_index, &face );
       if ( error )
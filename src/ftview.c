@@ -201,12 +201,15 @@
     {
       FT_UInt   glyph_idx;
       FT_Glyph  glyph;
+      double    t;
 
 
       glyph_idx = FTDemo_Get_Index( handle, (FT_UInt32)i );
 
+      t     = frametime_start( &handle->frame_time );
       error = FT_Load_Glyph( face, glyph_idx,
                              handle->load_flags | FT_LOAD_NO_BITMAP );
+      frametime_stop( &handle->frame_time, FRAMETIME_LOAD, t );
       if ( error )
         goto Next;
 
@@ -328,11 +331,14 @@
     for ( i = offset; i < num_indices; i++ )
     {
       FT_UInt  glyph_idx;
+      double   t;
 
 
       glyph_idx = FTDemo_Get_Index( handle, (FT_UInt32)i );
 
+      t     = frametime_start( &handle->frame_time );
       error = FT_Load_Glyph( face, glyph_idx, handle->load_flags );
+      frametime_stop( &handle->frame_time, FRAMETIME_LOAD, t );
       if ( error )
         goto Next;
 
@@ -469,6 +475,8 @@
       FT_UInt  layer_glyph_idx;
       FT_UInt  layer_color_idx;
 
+      double  t;
+
 
       glyph_idx = FTDemo_Get_Index( handle, (FT_UInt32)i );
 
@@ -506,7 +514,10 @@
           FT_Color   color;
 
 
+          /* the layers are rendered while loading */
+          t     = frametime_start( &handle->frame_time );
           error = FT_Load_Glyph( face, layer_glyph_idx, load_flags );
+          frametime_stop( &handle->frame_time, FRAMETIME_RENDER, t );
           if ( error )
             break;
 
@@ -569,7 +580,9 @@
       }
       else
       {
+        t     = frametime_start( &handle->frame_time );
         error = FT_Load_Glyph( face, glyph_idx, handle->load_flags );
+        frametime_stop( &handle->frame_time, FRAMETIME_LOAD, t );
         if ( error )
           goto Next;
       }
@@ -857,7 +870,7 @@
     grWriteln( "Z           toggle SVG glyphs                        emboldening (in mode 2)" );
     grWriteln( "                                        s, S        adjust slanting         " );
     grWriteln( "K           toggle cache modes                       (in mode 2)            " );
-    grWriteln( "                                        r, R        adjust stroking radius  " );
+    grWriteln( "T           toggle frame timing         r, R        adjust stroking radius  " );
     grWriteln( "p, n        previous/next font                       (in mode 3)            " );
     grWriteln( "                                                                            " );
     grWriteln( "Up, Down    adjust size by 1 unit       L           cycle through           " );
@@ -1200,6 +1213,10 @@
       handle->use_sbits_cache = !handle->use_sbits_cache;
       return 1;
 
+    case grKEY( 'T' ):
+      handle->frame_time.enabled = !handle->frame_time.enabled;
+      return 1;
+
     case grKEY( 'f' ):
       if ( handle->hinted )
       {
@@ -1682,7 +1699,8 @@
              N_LCD_IDXS - 1 );
     fprintf( stderr,
       "  -L N,...  Set LCD filter or geometry by comma-separated values.\n"
-      "  -p        Preload file in memory to simulate memory-mapping.\n"
+      "  -p        Map font files into memory once, shared by all\n"
+      "            faces and instances, and report their size.\n"
       "\n"
       "  -v        Show version.\n"
       "\n" );
@@ -1844,12 +1862,23 @@
     if ( status.preload )
       FTDemo_Set_Preload( handle, 1 );
 
-    for ( ; argc > 0; argc--, argv++ )
-      FTDemo_Install_Font( handle, argv[0], 0, 0 );
+    FTDemo_Install_Fonts( handle, argc, argv, 0, 0, NULL );
 
     if ( handle->num_fonts == 0 )
       Fatal( "could not find/open any font file" );
 
+    if ( status.preload )
+    {
+      size_t  mapped, resident;
+      int     count = FTDemo_Get_Preload_Size( handle, &mapped, &resident );
+
+
+      printf( "preloaded %d font file%s: %lukB mapped, %lukB resident\n",
+              count, count == 1 ? "" : "s",
+              (unsigned long)( mapped >> 10 ),
+              (unsigned long)( resident >> 10 ) );
+    }
+
     display = FTDemo_Display_New( status.device, status.dims,
                         "FreeType Glyph Viewer - press ? for help" );
     if ( !display )
@@ -1864,6 +1893,7 @@
     do
     {
       FTDemo_Display_Clear( display );
+      FTDemo_Frame_Time_Begin( handle );
 
       switch ( status.render_mode )
       {
@@ -1892,6 +1922,7 @@
       }
 
       write_header( last );
+      FTDemo_Frame_Time_Draw( handle, display );
 
     } while ( Process_Event() );
 
@@ -0,0 +1,323 @@
+/****************************************************************************/
+/*                                                                          */
+/*  The FreeType project -- a free and portable quality TrueType renderer.  */
+/*                                                                          */
+/*  Copyright (C) 2026 by                                                   */
+/*  D. Turner, R.Wilhelm, and W. Lemberg                                    */
+/*                                                                          */
+/*                                                                          */
+/*  workpool.c - run independent jobs on a few worker threads.              */
+/*                                                                          */
+/****************************************************************************/
+
+
+#include "workpool.h"
+
+#include <stdlib.h>
+
+#if defined( _WIN32 )
+#define WORKPOOL_WIN32
+#include <windows.h>
+#elif defined( unix ) || defined( __unix__ ) || defined( __APPLE__ )
+#define WORKPOOL_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+
+#define WORKPOOL_MAX_WORKERS  64
+
+
+  typedef struct  WorkPool_
+  {
+    workpool_job  job;
+    void*         data;
+    unsigned int  count;
+    unsigned int  next;   /* next job to start */
+
+#if defined( WORKPOOL_WIN32 )
+    CRITICAL_SECTION  lock;
+#elif defined( WORKPOOL_PTHREAD )
+    pthread_mutex_t   lock;
+#endif
+
+  } WorkPool;
+
+
+  typedef struct  Worker_
+  {
+    WorkPool*     pool;
+    unsigned int  index;
+
+  } Worker;
+
+
+  typedef struct  WorkPoolTask_
+  {
+    workpool_job  job;
+    void*         data;
+
+#if defined( WORKPOOL_WIN32 )
+    HANDLE            thread;
+#elif defined( WORKPOOL_PTHREAD )
+    pthread_t         thread;
+#endif
+
+  } WorkPoolTask;
+
+
+  unsigned int
+  workpool_num_cpus( void )
+  {
+#if defined( WORKPOOL_WIN32 )
+
+    SYSTEM_INFO  info;
+
+
+    GetSystemInfo( &info );
+
+    return info.dwNumberOfProcessors > 0
+             ? (unsigned int)info.dwNumberOfProcessors
+             : 1;
+
+#elif defined( WORKPOOL_PTHREAD ) && defined( _SC_NPROCESSORS_ONLN )
+
+    long  n = sysconf( _SC_NPROCESSORS_ONLN );
+
+
+    return n > 0 ? (unsigned int)n : 1;
+
+#else
+
+    return 1;
+
+#endif
+  }
+
+
+  /* fetch the next job index; return 0 if there are no more jobs */
+  static int
+  workpool_next( WorkPool*      pool,
+                 unsigned int*  index )
+  {
+    int  more;
+
+
+#if defined( WORKPOOL_WIN32 )
+    EnterCriticalSection( &pool->lock );
+#elif defined( WORKPOOL_PTHREAD )
+    pthread_mutex_lock( &pool->lock );
+#endif
+
+    more = pool->next < pool->count;
+    if ( more )
+      *index = pool->next++;
+
+#if defined( WORKPOOL_WIN32 )
+    LeaveCriticalSection( &pool->lock );
+#elif defined( WORKPOOL_PTHREAD )
+    pthread_mutex_unlock( &pool->lock );
+#endif
+
+    return more;
+  }
+
+
+  static void
+  workpool_work( Worker*  worker )
+  {
+    WorkPool*     pool = worker->pool;
+    unsigned int  index;
+
+
+    while ( workpool_next( pool, &index ) )
+      pool->job( pool->data, index, worker->index );
+  }
+
+
+#if defined( WORKPOOL_WIN32 )
+
+  static DWORD WINAPI
+  workpool_thread( LPVOID  arg )
+  {
+    workpool_work( (Worker*)arg );
+
+    return 0;
+  }
+
+
+  static DWORD WINAPI
+  workpool_task_thread( LPVOID  arg )
+  {
+    WorkPoolTask*  task = (WorkPoolTask*)arg;
+
+
+    task->job( task->data, 0, 0 );
+
+    return 0;
+  }
+
+#elif defined( WORKPOOL_PTHREAD )
+
+  static void*
+  workpool_thread( void*  arg )
+  {
+    workpool_work( (Worker*)arg );
+
+    return NULL;
+  }
+
+
+  static void*
+  workpool_task_thread( void*  arg )
+  {
+    WorkPoolTask*  task = (WorkPoolTask*)arg;
+
+
+    task->job( task->data, 0, 0 );
+
+    return NULL;
+  }
+
+#endif
+
+
+  unsigned int
+  workpool_run( unsigned int  num_workers,
+                unsigned int  count,
+                workpool_job  job,
+                void*         data )
+  {
+    WorkPool      pool;
+    Worker        workers[WORKPOOL_MAX_WORKERS];
+    unsigned int  i, started = 1;
+
+#if defined( WORKPOOL_WIN32 )
+    HANDLE        threads[WORKPOOL_MAX_WORKERS];
+#elif defined( WORKPOOL_PTHREAD )
+    pthread_t     threads[WORKPOOL_MAX_WORKERS];
+#endif
+
+
+    if ( num_workers == 0 )
+      num_workers = workpool_num_cpus();
+    if ( num_workers > count )
+      num_workers = count;
+    if ( num_workers > WORKPOOL_MAX_WORKERS )
+      num_workers = WORKPOOL_MAX_WORKERS;
+
+    pool.job   = job;
+    pool.data  = data;
+    pool.count = count;
+    pool.next  = 0;
+
+    for ( i = 0; i < WORKPOOL_MAX_WORKERS; i++ )
+    {
+      workers[i].pool  = &pool;
+      workers[i].index = i;
+    }
+
+#if defined( WORKPOOL_WIN32 )
+
+    InitializeCriticalSection( &pool.lock );
+
+    /* the calling thread is worker 0 */
+    for ( ; started < num_workers; started++ )
+    {
+      threads[started] = CreateThread( NULL, 0, workpool_thread,
+                                       &workers[started], 0, NULL );
+      if ( !threads[started] )
+        break;
+    }
+
+    workpool_work( &workers[0] );
+
+    for ( i = 1; i < started; i++ )
+    {
+      WaitForSingleObject( threads[i], INFINITE );
+      CloseHandle( threads[i] );
+    }
+
+    DeleteCriticalSection( &pool.lock );
+
+#elif defined( WORKPOOL_PTHREAD )
+
+    pthread_mutex_init( &pool.lock, NULL );
+
+    /* the calling thread is worker 0 */
+    for ( ; started < num_workers; started++ )
+      if ( pthread_create( &threads[started], NULL,
+                           workpool_thread, &workers[started] ) )
+        break;
+
+    workpool_work( &workers[0] );
+
+    for ( i = 1; i < started; i++ )
+      pthread_join( threads[i], NULL );
+
+    pthread_mutex_destroy( &pool.lock );
+
+#else
+
+    workpool_work( &workers[0] );
+
+#endif
+
+    return started;
+  }
+
+
+  workpool_task
+  workpool_start( workpool_job  job,
+                  void*         data )
+  {
+#if defined( WORKPOOL_WIN32 ) || defined( WORKPOOL_PTHREAD )
+
+    WorkPoolTask*  task = (WorkPoolTask*)malloc( sizeof ( *task ) );
+
+
+    if ( task )
+    {
+      task->job  = job;
+      task->data = data;
+
+#if defined( WORKPOOL_WIN32 )
+      task->thread = CreateThread( NULL, 0, workpool_task_thread,
+                                   task, 0, NULL );
+      if ( task->thread )
+        return task;
+#else
+      if ( !pthread_create( &task->thread, NULL,
+                            workpool_task_thread, task ) )
+        return task;
+#endif
+
+      free( task );
+    }
+
+#endif
+
+    job( data, 0, 0 );
+
+    return NULL;
+  }
+
+
+  void
+  workpool_wait( workpool_task  task )
+  {
+    if ( !task )
+      return;
+
+#if defined( WORKPOOL_WIN32 )
+    WaitForSingleObject( task->thread, INFINITE );
+    CloseHandle( task->thread );
+#elif defined( WORKPOOL_PTHREAD )
+    pthread_join( task->thread, NULL );
+#endif
+
+    free( task );
+  }
+
+
+/* End */
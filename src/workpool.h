@@ -0,0 +1,89 @@
+/****************************************************************************/
+/*                                                                          */
+/*  The FreeType project -- a free and portable quality TrueType renderer.  */
+/*                                                                          */
+/*  Copyright (C) 2026 by                                                   */
+/*  D. Turner, R.Wilhelm, and W. Lemberg                                    */
+/*                                                                          */
+/*                                                                          */
+/*  workpool.h - run independent jobs on a few worker threads.              */
+/*                                                                          */
+/****************************************************************************/
+
+
+#ifndef WORKPOOL_H_
+#define WORKPOOL_H_
+
+
+#ifdef __cplusplus
+  extern "C" {
+#endif
+
+
+  /*
+   * A job gets the shared `data' pointer, the index of the job, and the
+   * index of the worker thread running it (between 0 and the number of
+   * workers minus one), which can be used to access per-thread state
+   * like a separate `FT_Library' object.
+   */
+  typedef void
+  (*workpool_job)( void*         data,
+                   unsigned int  index,
+                   unsigned int  worker );
+
+
+  /*
+   * Return the number of online processors, or 1 if unknown.
+   */
+  extern unsigned int
+  workpool_num_cpus( void );
+
+
+  /*
+   * Run `job' for all indices from 0 to `count - 1' on at most
+   * `num_workers' threads (0 means one per processor) and wait until all
+   * of them have finished.  Jobs are started in index order but may
+   * complete in any order.  The return value is the number of workers
+   * actually used.
+   *
+   * On platforms without thread support, or if thread creation fails,
+   * the jobs run sequentially in the calling thread as worker 0.
+   */
+  extern unsigned int
+  workpool_run( unsigned int  num_workers,
+                unsigned int  count,
+                workpool_job  job,
+                void*         data );
+
+
+  typedef struct WorkPoolTask_*  workpool_task;
+
+
+  /*
+   * Start `job' with index 0 on a new background thread and return
+   * immediately; the result must be passed to `workpool_wait'.
+   *
+   * On platforms without thread support, or if thread creation fails,
+   * the job runs in the calling thread before this function returns
+   * NULL.
+   */
+  extern workpool_task
+  workpool_start( workpool_job  job,
+                  void*         data );
+
+
+  /*
+   * Wait until a job started by `workpool_start' has finished and
+   * release `task'.  Does nothing if `task' is NULL.
+   */
+  extern void
+  workpool_wait( workpool_task  task );
+
+#ifdef __cplusplus
+  }
+#endif
+
+#endif /* WORKPOOL_H_ */
+
+
+/* End */